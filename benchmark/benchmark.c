@@ -68,6 +68,7 @@
 #endif
 
 extern void initialize_data_host(void **odata, int nowned, int nremote, int type_size, int start);
+extern void release_data_host(void *data);
 
 // If CUDA is available, initialize data on CUDA device
 #ifdef HAVE_CUDA
@@ -146,6 +147,22 @@ static int irregularity_remote = 1;
 static int report_params = 0;
 static int seed = -1;
 static memspace_t memspace = MEMSPACE_HOST;
+static int ngroups = 1;
+static int group = 0;
+static MPI_Comm group_comm = MPI_COMM_WORLD;
+static int update_method = -1;    /* -1: L7 default (L7_UPDATE_METHOD) */
+static int send_order = L7_SEND_ORDER_RANK;
+static int max_in_flight = 0;
+
+static const char *update_method_names[] = { "neighbor", "p2p" };
+static const char *send_order_names[] = { "rank", "rotate", "size" };
+
+/* long-only options */
+enum {
+    OPT_METHOD = 1000,
+    OPT_SEND_ORDER,
+    OPT_MAX_IN_FLIGHT
+};
 
 float finalLatencyMean = 0;
 float finalLatencyMin  = 0;
@@ -182,6 +199,10 @@ static struct option long_options[] = {
     {"distribution",   required_argument, 0, 'd'},
     {"units",          required_argument, 0, 'u'},
     {"seed",           required_argument, 0, 'S'},
+    {"groups",         required_argument, 0, 'g'},
+    {"method",         required_argument, 0, OPT_METHOD},
+    {"send-order",     required_argument, 0, OPT_SEND_ORDER},
+    {"max-in-flight",  required_argument, 0, OPT_MAX_IN_FLIGHT},
     {"disable-irregularity", no_argument, &irregularity, 0},
     {"disable-irregularity-owned", no_argument, &irregularity_owned, 0},
     {"disable-irregularity-neighbors", no_argument, &irregularity_neighbors, 0},
@@ -483,7 +504,7 @@ int empirical_dist(char param[]) {
 void usage(char *exename, int penum)
 {
     if (penum == 0) {
-        fprintf(stderr, "usage: %s [-t typesize] [-I samples] [-i iterations] [-n neighbors] [-o owned] [-r remote] [-b blocksize] [-s stride] [-m memspace] \n use `--help` flag for more detailed instructions \n", exename);
+        fprintf(stderr, "usage: %s [-t typesize] [-I samples] [-i iterations] [-n neighbors] [-o owned] [-r remote] [-b blocksize] [-s stride] [-m memspace] [-g groups] \n use `--help` flag for more detailed instructions \n", exename);
     }
     exit(-1);
 }
@@ -493,7 +514,7 @@ void usage(char *exename, int penum)
 void usage_long(char *exename, int penum) {
     if (penum == 0) {
         fprintf(stdout,
-            "usage: %s [-t typesize] [-I samples] [-i iterations] [-n neighbors] [-o owned] [-r remote] [-b blocksize] [-s stride] [-S seed] [-m memspace]\n\n"
+            "usage: %s [-t typesize] [-I samples] [-i iterations] [-n neighbors] [-o owned] [-r remote] [-b blocksize] [-s stride] [-S seed] [-m memspace] [-g groups]\n\n"
             "[ -f filepath       ]\tspecify the path to the BENCHMARK_CONFIG file\n"
             "[ -t typesize       ]\tspecify the size of the variable being sent (in bytes)\n"
             "[ -I samples        ]\tspecify the number of random samples to generate\n"
@@ -511,7 +532,11 @@ void usage_long(char *exename, int penum) {
             "[ -T stride_stdv    ]\tspecify stdev size of stride\n"
             "[ -m memspace       ]\tchoose from: host, cuda, openmp, opencl\n"
             "[ -d distribution   ]\tchoose from: gaussian (default), empirical\n"
-            "[ -u units          ]\tchoose from: a,b,k,m,g (auto, bytes, kilobytes, etc.)\n\n"
+            "[ -u units          ]\tchoose from: a,b,k,m,g (auto, bytes, kilobytes, etc.)\n"
+            "[ -g groups         ]\tsplit the processes into this many groups that run the benchmark concurrently (default 1)\n\n"
+            "[ --method m        ]\thost update method, choose from: neighbor (default), p2p\n"
+            "[ --send-order o    ]\tp2p send posting order, choose from: rank (default), rotate, size\n"
+            "[ --max-in-flight k ]\tp2p sends outstanding at once, 0 for no limit (default)\n\n"
             "[ --report-params   ]\tenables parameter reporting for use with analysis scripts\n"
             "NOTE: setting parameters for the benchmark such as (neighbors, owned, remote, blocksize, and stride)\n"
             "      sets parameters to those values for the reference benchmark.\n"
@@ -530,7 +555,7 @@ void parse_arguments(int argc, char **argv, int penum)
         /* getopt_long stores the option index here. */
         int option_index = 0;
 
-        c = getopt_long (argc, argv, ":h:f:t:i:I:n:N:o:O:r:R:b:B:s:S:T:m:d:u:",
+        c = getopt_long (argc, argv, ":h:f:t:i:I:n:N:o:O:r:R:b:B:s:S:T:m:d:u:g:",
                        long_options, &option_index);
         if (c == -1) {
             break;
@@ -680,6 +705,38 @@ void parse_arguments(int argc, char **argv, int penum)
                     usage(argv[0], penum);
                 }
                 break;
+            case 'g':
+                // used to split the processes into independent groups
+                ngroups = atoi(optarg);
+                if (ngroups < 1 || ngroups > numpes) usage(argv[0], penum);
+                break;
+            case OPT_METHOD:
+                // used to choose the host update path (L7_Set_Update_Schedule)
+                if (strcmp(optarg, "neighbor") == 0) {
+                    update_method = L7_UPDATE_NEIGHBOR;
+                } else if (strcmp(optarg, "p2p") == 0) {
+                    update_method = L7_UPDATE_P2P;
+                } else {
+                    fprintf(stderr, "Invalid update method: %s\n", optarg);
+                    usage(argv[0], penum);
+                }
+                break;
+            case OPT_SEND_ORDER:
+                if (strcmp(optarg, "rank") == 0) {
+                    send_order = L7_SEND_ORDER_RANK;
+                } else if (strcmp(optarg, "rotate") == 0) {
+                    send_order = L7_SEND_ORDER_ROTATE;
+                } else if (strcmp(optarg, "size") == 0) {
+                    send_order = L7_SEND_ORDER_SIZE;
+                } else {
+                    fprintf(stderr, "Invalid send order: %s\n", optarg);
+                    usage(argv[0], penum);
+                }
+                break;
+            case OPT_MAX_IN_FLIGHT:
+                max_in_flight = atoi(optarg);
+                if (max_in_flight < 0) usage(argv[0], penum);
+                break;
             case 'h':
                 usage_long(argv[0], penum);
                 break;
@@ -689,6 +746,22 @@ void parse_arguments(int argc, char **argv, int penum)
         }
     }
 
+    /* Each group of contiguous ranks runs its own copy of the benchmark
+     * on a sub-communicator, so one launch can measure several process
+     * counts side by side (or contention between concurrent exchanges).
+     * From here on numpes is the size of this process's group. */
+    if (ngroups > 1) {
+        #ifdef HAVE_OPENCL
+        if (memspace == MEMSPACE_OPENCL) {
+            if (penum == 0) printf("Error: groups are not supported with the opencl memspace.\n");
+            exit(1);
+        }
+        #endif
+        group = (int)(((long long)penum * ngroups) / numpes);
+        MPI_Comm_split(MPI_COMM_WORLD, group, penum, &group_comm);
+        MPI_Comm_size(group_comm, &numpes);
+    }
+
     /* parses the config file to set default mean & stdev values for:
      * - nowned
      * - nremote
@@ -800,6 +873,9 @@ void report_final_results() {
   }
 
   // Print results
+  if (ngroups > 1) {
+      printf("Group %d of %d ", group, ngroups);
+  }
   printf("Final Results (across samples):\n");
   printf("Lat - secs (avg/min/max)\tBW - %s (avg/min/max)\n", unit_symbol);
   printf("%f/%f/%f,\t%f/%f/%f\n",
@@ -819,9 +895,9 @@ void report_results_update(int penum, double *time_total_pe, int count_updated_p
 
     /* Gather iteration data from each node */
     /* The maximum iteration time */
-    L7_Array_Max(time_total_pe, num_timings, L7_DOUBLE, time_total_global);
+    L7_Array_Max_Comm(time_total_pe, num_timings, L7_DOUBLE, time_total_global, group_comm);
     /* The total number of items received */
-    L7_Sum(&count_updated_pe, 1, L7_INT, &count_updated_global);
+    L7_Sum_Comm(&count_updated_pe, 1, L7_INT, &count_updated_global, group_comm);
     bytes_updated = count_updated_global*type_size;
 
     // eliminates prints across all but 1 process
@@ -885,6 +961,9 @@ void report_results_update(int penum, double *time_total_pe, int count_updated_p
         }
 
         // Print results
+        if (ngroups > 1) {
+            printf("Group %d of %d:\n", group, ngroups);
+        }
         printf("nPEs\tMem\tType\tnOwned\tnRemote\tBlockSz\tStride\tnIter");
         printf("\tLat - secs (avg/min/med/max)\t\tBW - %s (avg/min/med/max)\n", unit_symbol);
         printf("%d,\t%d,\t%d,\t%d,\t%d,\t%d,\t%d,\t%d,",
@@ -1135,7 +1214,8 @@ int benchmark(int penum) {
 
         /*
          * Note that neighbors need to be an ascending order. We do this by sorting
-         * our list of neighbors after computing it
+         * our list of neighbors after computing it. L7_Setup accepts any order,
+         * but a sorted list skips its internal sort and L7_Dev_Setup requires it
         */
         qsort(partner_pe, nneighbors, sizeof(int), int_compare);
 
@@ -1186,6 +1266,10 @@ int benchmark(int penum) {
         switch (memspace) {
             case MEMSPACE_HOST:
                 initialize_data_host(&data, nowned, nremote, typesize, my_start_index);
+                // report the allocation policy actually applied (L7_MEM_POLICY)
+                if (sample_iter == 0 && penum == 0) {
+                    printf("Host memory policy: %s\n", L7_Mem_Policy_Name(L7_Mem_Get_Policy()));
+                }
                 break;
             #if defined(HAVE_CUDA) && defined(L7_CUDA_OFFLOAD)
             case MEMSPACE_CUDA:
@@ -1229,7 +1313,17 @@ int benchmark(int penum) {
         } else
         #endif
         {
-            L7_Setup(0, my_start_index, nowned, needed_indices, nremote, &l7_id);
+            L7_Setup_Comm(0, my_start_index, nowned, needed_indices, nremote, group_comm, &l7_id);
+
+            // --method/--send-order/--max-in-flight override the L7 defaults
+            if (update_method >= 0) {
+                L7_Set_Update_Schedule(l7_id, update_method, send_order, max_in_flight);
+                if (sample_iter == 0 && penum == 0) {
+                    printf("Update schedule: %s, send order %s, max in flight %d\n",
+                           update_method_names[update_method], send_order_names[send_order],
+                           max_in_flight);
+                }
+            }
         }
 
         /*
@@ -1279,12 +1373,20 @@ int benchmark(int penum) {
 
         // free's memory allocated through L7
         L7_Free(&l7_id);
+
+        if (memspace == MEMSPACE_HOST) {
+            release_data_host(data);
+        }
     }
 
     if (penum == 0) {
       report_final_results();
     }
 
+    if (group_comm != MPI_COMM_WORLD) {
+        MPI_Comm_free(&group_comm);
+    }
+
     out:
        L7_Terminate();
 
@@ -1304,6 +1406,9 @@ int main(int argc, char *argv[])
     // parse CLI arguments
     parse_arguments(argc, argv, penum);
 
+    // with -g, penum is the rank within this process's group
+    MPI_Comm_rank(group_comm, &penum);
+
     if (irregularity) {
         if (seed == -1) {
             // Use the current time as the seed for
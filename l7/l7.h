@@ -43,6 +43,10 @@
 #ifdef HAVE_OPENCL
 #include "ezcl/ezcl.h"
 #endif
+#include <stddef.h>
+#ifdef HAVE_MPI
+#include <mpi.h>
+#endif
 
 // #define _L7_DEBUG
 
@@ -57,6 +61,9 @@ extern "C"
 
 #define L7_OK   0 /* Successful return. */
 
+#define L7_REQUEST_NULL 0 /* Handle of no (or a completed) nonblocking
+                             operation, see L7_Iupdate. */
+
 enum  L7_Datatype
 {
    L7_GENERIC8  = 0,
@@ -82,6 +89,36 @@ enum  L7_Datatype
    L7_DATATYPE_MAX = L7_REAL8
 };
 
+/* Operation of one entry of L7_Reduce_Multi. */
+enum L7_ReduceOp
+{
+   L7_REDUCE_SUM = 0,
+   L7_REDUCE_MAX,
+   L7_REDUCE_MIN,
+
+   L7_REDUCE_OP_MIN = L7_REDUCE_SUM,
+   L7_REDUCE_OP_MAX = L7_REDUCE_MIN
+};
+
+/* One scalar reduction of an L7_Reduce_Multi batch. output receives
+ * what L7_Sum, L7_Max or L7_Min would return for input[0:count-1];
+ * l7_datatype is one of the integer or floating point types those
+ * accept.
+ */
+struct L7_Reduction
+{
+   void
+      *input;
+   int
+      count;
+   enum L7_Datatype
+      l7_datatype;
+   enum L7_ReduceOp
+      op;
+   void
+      *output;
+};
+
 /* Processor/disk patterns */
 enum L7_DiskPatternType
 {
@@ -118,6 +155,155 @@ enum L7_IO_ProfilingLevel
    L7_IO_PROF_LEVEL_MAX = L7_IO_PROF_VERBOSE
 };
 
+/* How much of an update database L7_Compact releases. Setup-only
+ * state is what L7_Setup needs to build the communicator and datatypes
+ * but L7_Update never reads again. L7_COMPACT_ALL also drops the local
+ * send indices, which live on in the send datatypes; L7_Update_Check,
+ * L7_Plan_Save and L7_Get_Local_Indices are then unavailable for the
+ * database until it is set up again.
+ */
+enum L7_CompactLevel
+{
+   L7_COMPACT_NONE  = 0,
+   L7_COMPACT_SETUP,
+   L7_COMPACT_ALL,
+
+   L7_COMPACT_LEVEL_MIN = L7_COMPACT_NONE,
+   L7_COMPACT_LEVEL_MAX = L7_COMPACT_ALL
+};
+
+/* Placement of host memory from L7_Mem_Alloc, combined with bitwise
+ * or. L7_MEM_THP asks for transparent huge pages, L7_MEM_HUGETLB for
+ * explicit (reserved) huge pages, and L7_MEM_LOCAL binds the pages to
+ * the NUMA node of the allocating thread. The environment variable
+ * L7_MEM_POLICY, e.g. "thp,local", sets the initial policy.
+ */
+enum L7_MemPolicy
+{
+   L7_MEM_DEFAULT  = 0,
+   L7_MEM_THP      = 1,
+   L7_MEM_HUGETLB  = 2,
+   L7_MEM_LOCAL    = 4,
+
+   L7_MEM_POLICY_MAX = L7_MEM_THP | L7_MEM_HUGETLB | L7_MEM_LOCAL
+};
+
+/* How L7_Sum adds L7_DOUBLE and L7_REAL8 values. L7_SUM_REPRODUCIBLE
+ * gives the same bits for any number of processes and any distribution
+ * of the values, at up to about twice the cost of the local part of
+ * L7_SUM_FAST. Set with L7_Set_Sum_Mode or the environment variable
+ * L7_SUM_MODE (fast, reproducible). L7_Isum and L7_Reduce_Multi always
+ * use the plain sum.
+ */
+enum L7_SumMode
+{
+   L7_SUM_FAST = 0,
+   L7_SUM_REPRODUCIBLE
+};
+
+/* How L7_Update moves data. L7_UPDATE_NEIGHBOR is a single
+ * MPI_Neighbor_alltoallw with derived datatypes. L7_UPDATE_P2P pre-posts
+ * a receive from every neighbor straight into the ghost region, then
+ * packs and sends to each neighbor in the order given by enum
+ * L7_SendOrder, with at most max_in_flight sends outstanding. All
+ * processes of a database must use the same method. Set with
+ * L7_Set_Update_Schedule or the environment variables L7_UPDATE_METHOD
+ * (neighbor, p2p), L7_SEND_ORDER (rank, rotate, size) and
+ * L7_MAX_IN_FLIGHT.
+ */
+enum L7_UpdateMethod
+{
+   L7_UPDATE_NEIGHBOR = 0,
+   L7_UPDATE_P2P,
+
+   L7_UPDATE_METHOD_MIN = L7_UPDATE_NEIGHBOR,
+   L7_UPDATE_METHOD_MAX = L7_UPDATE_P2P
+};
+
+/* Order of sends in the L7_UPDATE_P2P path. RANK follows send_to, which
+ * is ascending rank, so every process hits low ranks first. ROTATE
+ * starts with the first neighbor above the sender, (penum + k) % numpes,
+ * spreading simultaneous arrivals across receivers. SIZE sends the
+ * largest messages first.
+ */
+enum L7_SendOrder
+{
+   L7_SEND_ORDER_RANK = 0,
+   L7_SEND_ORDER_ROTATE,
+   L7_SEND_ORDER_SIZE,
+
+   L7_SEND_ORDER_MIN = L7_SEND_ORDER_RANK,
+   L7_SEND_ORDER_MAX = L7_SEND_ORDER_SIZE
+};
+
+/* Allocator for the internal arrays of update databases (communication
+ * lists, index arrays, neighbor state and datatype arrays). Every
+ * database calls create once for its own state; alloc returns zeroed
+ * memory or NULL, release may defer freeing until reset, which drops
+ * everything allocated since the last reset when the database is set up
+ * again, and destroy ends the state when the database is freed. The
+ * default is a per-database arena; L7_ALLOCATOR=malloc in the
+ * environment selects plain malloc/free, which memory checkers prefer.
+ */
+typedef struct L7_Allocator
+{
+   void *(*create)(void *context);
+   void *(*alloc)(void *state, size_t nbytes);
+   void  (*release)(void *state, void *ptr);
+   void  (*reset)(void *state);
+   void  (*destroy)(void *state);
+   void  *context;             /* Passed to create                     */
+} L7_Allocator;
+
+/* Number of buckets in the update latency histogram. Bucket 0 counts
+ * calls shorter than 1 microsecond, bucket b counts calls taking
+ * [2^(b-1), 2^b) microseconds and the last bucket counts everything
+ * longer.
+ */
+#define L7_STATS_NUM_BUCKETS 24
+
+/* Communication statistics for an update or push database, as
+ * returned by L7_Get_Stats and L7_Push_Get_Stats. Every update sends
+ * one message to each neighbor in send_to and receives one from each
+ * neighbor in recv_from, so per-neighbor message counts equal
+ * num_updates (num_pushes for push databases). The neighbor arrays
+ * point into the database and are valid until it is set up again or
+ * freed.
+ */
+struct L7_Stats
+{
+   long long
+      num_setups,              /* Calls to setup for this database     */
+      num_updates,             /* Calls to L7_Update                   */
+      num_pushes,              /* Calls to L7_Push_Update              */
+      bytes_sent,              /* Total bytes sent by updates/pushes   */
+      bytes_recvd,             /* Total bytes received                 */
+      msgs_sent,               /* Total messages sent                  */
+      msgs_recvd,              /* Total messages received              */
+      num_checks,              /* Calls to L7_Update_Check             */
+      num_check_errors,        /* Ghost segments failing the check     */
+      memory_bytes,            /* Host memory held by an update
+                                  database after setup/L7_Compact      */
+      latency_hist[L7_STATS_NUM_BUCKETS];
+
+   double
+      setup_time,              /* Cumulative seconds in setup          */
+      update_time,             /* Cumulative seconds in updates/pushes */
+      update_time_max;         /* Slowest single update/push           */
+
+   int
+      num_sends,               /* Length of send_to/nbr_bytes_sent     */
+      num_recvs;               /* Length of recv_from/nbr_bytes_recvd  */
+
+   const int
+      *send_to,                /* Ranks this pe sends to               */
+      *recv_from;              /* Ranks this pe receives from          */
+
+   const long long
+      *nbr_bytes_sent,         /* Bytes sent to each send_to rank      */
+      *nbr_bytes_recvd;        /* Bytes received from each recv_from   */
+};
+
 /*
  * C Prototypes.
  *
@@ -183,6 +369,11 @@ int L7_All(
 		void                    *output
 		);
 
+int L7_Reduce_Multi(
+		struct L7_Reduction     *reductions,
+		const int               num_reductions
+		);
+
 int L7_Array_Sum(
 		void                    *input,
 		const int               count,
@@ -323,8 +514,294 @@ int L7_Get_Numpes(void);
 
 double L7_Wtime(void);
 
+int L7_Get_Thread_Level(void);
+
 int L7_Get_Timeout_Signal(void);
 
+/*
+ * Versions of the collectives above on a given communicator instead of
+ * MPI_COMM_WORLD, and setup of update databases whose processes are
+ * the members of a communicator. Only available when mpi.h has been
+ * included.
+ */
+
+#if defined(HAVE_MPI) || defined(MPI_VERSION)
+
+int L7_Broadcast_Comm(
+		void                    *data_buffer,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		const int               root_pe,
+		MPI_Comm                comm
+		);
+
+int L7_Allgather_Comm(
+		void                    *local_buffer,
+		const int               count,
+		void                    *global_buffer,
+		const enum L7_Datatype  l7_datatype,
+		MPI_Comm                comm
+		);
+
+void L7_Sum_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *output,
+		MPI_Comm                comm
+		);
+
+int L7_Max_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *output,
+		MPI_Comm                comm
+		);
+
+int L7_Min_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *output,
+		MPI_Comm                comm
+		);
+
+int L7_Any_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *output,
+		MPI_Comm                comm
+		);
+
+int L7_All_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *output,
+		MPI_Comm                comm
+		);
+
+int L7_Reduce_Multi_Comm(
+		struct L7_Reduction     *reductions,
+		const int               num_reductions,
+		MPI_Comm                comm
+		);
+
+int L7_Array_Sum_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *output,
+		MPI_Comm                comm
+		);
+
+int L7_Array_Max_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *output,
+		MPI_Comm                comm
+		);
+
+int L7_Array_Min_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *output,
+		MPI_Comm                comm
+		);
+
+int L7_MaxLoc_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		int                     *output,
+		MPI_Comm                comm
+		);
+
+int L7_MinLoc_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		int                     *output,
+		MPI_Comm                comm
+		);
+
+int L7_MaxValLoc_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *val,
+		int                     *loc,
+		MPI_Comm                comm
+		);
+
+int L7_MinValLoc_Comm(
+		void                    *input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *val,
+		int                     *loc,
+		MPI_Comm                comm
+		);
+
+int L7_MaxValLocLoc_Int4_Comm(
+		void                    *input,
+		void                    *loc2input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *val,
+		void                    *loc,
+		void                    *loc2,
+		MPI_Comm                comm
+		);
+
+int L7_MaxValLocLoc_Int8_Comm(
+		void                    *input,
+		void                    *loc2input,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		void                    *val,
+		void                    *loc,
+		void                    *loc2,
+		MPI_Comm                comm
+		);
+
+int L7_GetGlobal_Comm(
+		void                    *array,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		const int               index,
+		void                    *val,
+		MPI_Comm                comm
+		);
+
+int L7_Setup_Comm(
+        const int       num_base,
+        const int       my_start_index,
+        const int       num_indices_owned,
+        int             *indices_needed,
+        const int       num_indices_needed,
+        MPI_Comm        comm,
+        int             *l7_id
+        );
+
+int L7_Plan_Load_Comm(
+      const char              *path,
+      MPI_Comm                comm,
+      int                     *l7_id
+      );
+
+int L7_Setup_Known(
+      const int               num_base,
+      const int               my_start_index,
+      const int               num_indices_owned,
+      const int               num_recvs,
+      const int               *recv_from,
+      const int               *recv_counts,
+      const int               num_sends,
+      const int               *send_to,
+      const int               *send_counts,
+      const int               *indices_local_to_send,
+      MPI_Comm                comm,
+      int                     *l7_id
+      );
+
+int L7_Setup_Symmetric(
+      const int               num_base,
+      const int               my_start_index,
+      const int               num_indices_owned,
+      const int               num_neighbors,
+      const int               *neighbors,
+      const int               *counts,
+      const int               *indices_local_to_send,
+      MPI_Comm                comm,
+      int                     *l7_id
+      );
+
+int L7_Isum_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      );
+
+int L7_Imax_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      );
+
+int L7_Imin_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      );
+
+int L7_Iarray_Sum_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      );
+
+int L7_Iarray_Max_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      );
+
+int L7_Iarray_Min_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      );
+
+int L7_Ireduce_Multi_Comm(
+      struct L7_Reduction     *reductions,
+      const int               num_reductions,
+      MPI_Comm                comm,
+      int                     *request
+      );
+
+int L7_Ibroadcast_Comm(
+      void                    *data_buffer,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      const int               root_pe,
+      MPI_Comm                comm,
+      int                     *request
+      );
+
+int L7_Iallgather_Comm(
+      void                    *local_buffer,
+      const int               count,
+      void                    *global_buffer,
+      const enum L7_Datatype  l7_datatype,
+      MPI_Comm                comm,
+      int                     *request
+      );
+
+#endif /* HAVE_MPI || MPI_VERSION */
+
 int L7_Setup(
         const int       num_base,
         const int       my_start_index,
@@ -336,6 +813,17 @@ int L7_Setup(
         int             *l7_id
         );
 
+int L7_Setup_Placed(
+        const int       num_base,
+        const int       my_start_index,
+        const int       num_indices_owned,
+        int             *indices_needed,
+        const int       num_indices_needed,
+        const int       *owned_offsets,
+        const int       *ghost_offsets,
+        int             *l7_id
+        );
+
 int L7_Dev_Setup(
         const int       num_base,
         const int       my_start_index,
@@ -361,6 +849,114 @@ int L7_Update(
       const int               l7_id
       );
 
+int L7_Iupdate(
+      void                    *data_buffer,
+      const enum L7_Datatype  l7_datatype,
+      const int               l7_id,
+      int                     *request
+      );
+
+int L7_Wait(
+      int                     *request
+      );
+
+int L7_Waitall(
+      const int               count,
+      int                     *requests
+      );
+
+int L7_Test(
+      int                     *request,
+      int                     *flag
+      );
+
+int L7_Progress(void);
+
+int L7_Get_Progress_Thread(void);
+
+/*
+ * Nonblocking collectives. Each returns a request handle for L7_Wait,
+ * L7_Waitall or L7_Test, like L7_Iupdate; scalar outputs are set on
+ * completion, array and broadcast buffers must be left alone until then.
+ */
+
+int L7_Isum(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      );
+
+int L7_Imax(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      );
+
+int L7_Imin(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      );
+
+int L7_Iarray_Sum(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      );
+
+int L7_Iarray_Max(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      );
+
+int L7_Iarray_Min(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      );
+
+int L7_Ireduce_Multi(
+      struct L7_Reduction     *reductions,
+      const int               num_reductions,
+      int                     *request
+      );
+
+int L7_Ibroadcast(
+      void                    *data_buffer,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      const int               root_pe,
+      int                     *request
+      );
+
+int L7_Iallgather(
+      void                    *local_buffer,
+      const int               count,
+      void                    *global_buffer,
+      const enum L7_Datatype  l7_datatype,
+      int                     *request
+      );
+
+int L7_Update_Batch(
+      const int               n,
+      void                    **data_buffers,
+      const enum L7_Datatype  *l7_datatypes,
+      const int               *l7_ids
+      );
+
 #ifdef HAVE_OPENCL
 int L7_Dev_Update(
       cl_mem                  dev_data_buffer,
@@ -375,6 +971,16 @@ int L7_Update_Check(
       const int               l7_id
       );
 
+int L7_Plan_Save(
+      const int               l7_id,
+      const char              *path
+      );
+
+int L7_Plan_Load(
+      const char              *path,
+      int                     *l7_id
+      );
+
 int L7_Get_Num_Indices(
       const int               l7_id
       );
@@ -384,6 +990,18 @@ int L7_Get_Local_Indices(
       int                     *local_indices
       );
 
+int L7_Gid_To_Local(
+      const int               l7_id,
+      const int               gid
+      );
+
+int L7_Gid_To_Local_Batch(
+      const int               l7_id,
+      const int               count,
+      const int               *gids,
+      int                     *locals
+      );
+
 int L7_Push_Setup(
       const int               num_comm_partners,
       const int               *comm_partner,
@@ -403,6 +1021,77 @@ int L7_Push_Free(
       const int               *l7_push_id
       );
 
+int L7_Compact(
+      const int               l7_id,
+      const int               level
+      );
+
+int L7_Set_Update_Schedule(
+      const int               l7_id,
+      const int               method,
+      const int               send_order,
+      const int               max_in_flight
+      );
+
+int L7_Reorder(
+      const int               l7_id,
+      int                     *new_local_index,
+      int                     *num_boundary,
+      int                     *new_indices_needed,
+      int                     *new_ghost_index
+      );
+
+int L7_Get_Memory_Usage(
+      const int               l7_id,
+      size_t                  *bytes
+      );
+
+void *L7_Mem_Alloc(
+      const size_t            nbytes
+      );
+
+void L7_Mem_Release(
+      void                    *ptr
+      );
+
+int L7_Set_Allocator(
+      const L7_Allocator      *allocator
+      );
+
+int L7_Mem_Set_Policy(
+      const int               policy
+      );
+
+int L7_Mem_Get_Policy(void);
+
+int L7_Set_Sum_Mode(
+      const int               mode
+      );
+
+int L7_Get_Sum_Mode(void);
+
+int L7_Set_Coll_Hierarchy(
+      const int               max_bytes
+      );
+
+int L7_Get_Coll_Hierarchy(void);
+
+const char *L7_Mem_Policy_Name(
+      const int               policy
+      );
+
+int L7_Get_Stats(
+      const int               l7_id,
+      struct L7_Stats         *stats
+      );
+
+int L7_Push_Get_Stats(
+      const int               l7_push_id,
+      struct L7_Stats         *stats
+      );
+
+int L7_Stats_Report(void);
+
 /*
  * L7 File Prototypes.
  */
@@ -467,6 +1156,28 @@ int L7_File_Symlink(
       const enum L7_DiskPatternType  l7_disk_pattern
       );
 
+int L7_File_Read_Id(
+      const int                      fid,
+      long long                      *disk_loc,
+      void                           *buf,
+      const enum L7_Datatype         l7_datatype,
+      const int                      l7_id
+      );
+
+int L7_File_Write_Id(
+      const int                      fid,
+      long long                      *disk_loc,
+      void                           *buf,
+      const enum L7_Datatype         l7_datatype,
+      const int                      l7_id
+      );
+
+int L7_Set_IO_Profiling(
+      const int                      level
+      );
+
+int L7_Get_IO_Profiling(void);
+
 void L7_Sort(
       void                   *array_in,
       const int              nsize,
@@ -0,0 +1,447 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_ALLOCATOR"
+
+/*
+ * Allocators for update database arrays.
+ *
+ * The default arena hands out small arrays from slabs by bumping a
+ * pointer, so a database's metadata sits in one or a few contiguous
+ * slabs. Releasing the most recent block rolls the pointer back (this is
+ * how setup temporaries are returned); other small blocks wait for the
+ * reset at the next setup. After a reset the arena keeps one slab big
+ * enough for everything the previous setup used, so repeated
+ * setup/free cycles stop calling malloc altogether. Blocks of
+ * ARENA_LARGE bytes or more, the index arrays of big meshes, get their
+ * own chunk and are freed at once, so L7_Compact still returns them.
+ *
+ * The malloc allocator keeps a list of its blocks only so reset and
+ * destroy can find them.
+ */
+
+#define ARENA_ALIGN  64            /* Blocks start on cache lines.      */
+#define ARENA_SLAB   4096          /* Smallest slab.                    */
+#define ARENA_LARGE  16384         /* Blocks this big get a chunk.      */
+
+#define ARENA_ROUND(n)  (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct arena_chunk {
+   struct arena_chunk
+     *next,
+     *prev;
+   size_t
+     size;                         /* Bytes after the header.           */
+   int
+     large;                        /* 1 for a single large block.       */
+};
+
+#define CHUNK_HEADER  ARENA_ROUND(sizeof(struct arena_chunk))
+#define CHUNK_DATA(c) ((char *)(c) + CHUNK_HEADER)
+
+struct arena {
+   struct arena_chunk
+     *chunks;                      /* Slabs and large blocks.           */
+   char
+     *cur,                         /* Next free byte of the last slab.  */
+     *last;                        /* Most recent small block.          */
+   size_t
+     left,                         /* Bytes left in the last slab.      */
+     slab_size,                    /* Size of the last slab.            */
+     used,                         /* Small bytes since the last reset. */
+     high_water;                   /* Most small bytes of any setup.    */
+};
+
+static struct arena_chunk *arena_chunk_new(
+      struct arena  *arena,
+      const size_t  size,
+      const int     large
+      )
+{
+   struct arena_chunk
+     *chunk;
+   void
+     *mem;
+
+   if (posix_memalign(&mem, ARENA_ALIGN, CHUNK_HEADER + size) != 0)
+      return(NULL);
+
+   chunk = (struct arena_chunk *)mem;
+   chunk->size  = size;
+   chunk->large = large;
+   chunk->prev  = NULL;
+   chunk->next  = arena->chunks;
+   if (arena->chunks)
+      arena->chunks->prev = chunk;
+   arena->chunks = chunk;
+
+   return(chunk);
+}
+
+static void arena_chunk_free(
+      struct arena        *arena,
+      struct arena_chunk  *chunk
+      )
+{
+   if (chunk->prev)
+      chunk->prev->next = chunk->next;
+   else
+      arena->chunks = chunk->next;
+   if (chunk->next)
+      chunk->next->prev = chunk->prev;
+   free(chunk);
+}
+
+static void *arena_create(void *context)
+{
+   (void)context;
+   return(calloc(1, sizeof(struct arena)));
+}
+
+static void *arena_alloc(void *state, size_t nbytes)
+{
+   struct arena
+     *arena = (struct arena *)state;
+   struct arena_chunk
+     *chunk;
+   size_t
+     size;
+   char
+     *ptr;
+
+   nbytes = ARENA_ROUND(nbytes > 0 ? nbytes : 1);
+
+   if (nbytes >= ARENA_LARGE){
+      chunk = arena_chunk_new(arena, nbytes, 1);
+      if (chunk == NULL)
+         return(NULL);
+      memset(CHUNK_DATA(chunk), 0, nbytes);
+      return(CHUNK_DATA(chunk));
+   }
+
+   if (nbytes > arena->left){
+      /* The first slab after a reset fits the whole previous setup. */
+      size = arena->slab_size ? 2*arena->slab_size : arena->high_water;
+      if (size < ARENA_SLAB)
+         size = ARENA_SLAB;
+      if (size < nbytes)
+         size = nbytes;
+      chunk = arena_chunk_new(arena, size, 0);
+      if (chunk == NULL)
+         return(NULL);
+      arena->cur       = CHUNK_DATA(chunk);
+      arena->left      = size;
+      arena->slab_size = size;
+   }
+
+   ptr = arena->cur;
+   arena->cur  += nbytes;
+   arena->left -= nbytes;
+   arena->used += nbytes;
+   arena->last  = ptr;
+
+   memset(ptr, 0, nbytes);
+   return(ptr);
+}
+
+static void arena_release(void *state, void *ptr)
+{
+   struct arena
+     *arena = (struct arena *)state;
+   struct arena_chunk
+     *chunk;
+
+   if (ptr == NULL)
+      return;
+
+   if (ptr == arena->last){
+      arena->left += (size_t)(arena->cur - arena->last);
+      arena->used -= (size_t)(arena->cur - arena->last);
+      arena->cur   = arena->last;
+      arena->last  = NULL;
+      return;
+   }
+
+   for (chunk = arena->chunks; chunk; chunk = chunk->next){
+      if (chunk->large && CHUNK_DATA(chunk) == (char *)ptr){
+         arena_chunk_free(arena, chunk);
+         return;
+      }
+   }
+
+   /* Other small blocks are returned by the next reset. */
+}
+
+static void arena_reset(void *state)
+{
+   struct arena
+     *arena = (struct arena *)state;
+   struct arena_chunk
+     *chunk,
+     *next,
+     *keep = NULL;
+
+   if (arena->used > arena->high_water)
+      arena->high_water = arena->used;
+
+   /* Keep a slab that already holds a whole setup, drop the rest. */
+   for (chunk = arena->chunks; chunk; chunk = next){
+      next = chunk->next;
+      if (keep == NULL && ! chunk->large && chunk->size >= arena->high_water)
+         keep = chunk;
+      else
+         arena_chunk_free(arena, chunk);
+   }
+
+   arena->cur       = keep ? CHUNK_DATA(keep) : NULL;
+   arena->left      = keep ? keep->size : 0;
+   arena->slab_size = 0;
+   arena->last      = NULL;
+   arena->used      = 0;
+}
+
+static void arena_destroy(void *state)
+{
+   struct arena
+     *arena = (struct arena *)state;
+
+   while (arena->chunks)
+      arena_chunk_free(arena, arena->chunks);
+   free(arena);
+}
+
+/* Plain malloc/free, with a list so reset can free everything. */
+
+static void *heap_create(void *context)
+{
+   (void)context;
+   return(calloc(1, sizeof(struct arena)));
+}
+
+static void *heap_alloc(void *state, size_t nbytes)
+{
+   struct arena_chunk
+     *chunk;
+
+   chunk = arena_chunk_new((struct arena *)state, nbytes, 1);
+   if (chunk == NULL)
+      return(NULL);
+   memset(CHUNK_DATA(chunk), 0, nbytes);
+   return(CHUNK_DATA(chunk));
+}
+
+static void heap_release(void *state, void *ptr)
+{
+   if (ptr != NULL)
+      arena_chunk_free((struct arena *)state, (struct arena_chunk *)((char *)ptr - CHUNK_HEADER));
+}
+
+static void heap_reset(void *state)
+{
+   struct arena
+     *arena = (struct arena *)state;
+
+   while (arena->chunks)
+      arena_chunk_free(arena, arena->chunks);
+}
+
+static void heap_destroy(void *state)
+{
+   heap_reset(state);
+   free(state);
+}
+
+void l7p_allocator_default(
+      L7_Allocator    *ops
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Fill in the allocator new databases get unless L7_Set_Allocator
+    * says otherwise: the arena, or malloc with L7_ALLOCATOR=malloc.
+    */
+
+   if (getenv("L7_ALLOCATOR") != NULL && strcmp(getenv("L7_ALLOCATOR"), "malloc") == 0){
+      ops->create  = heap_create;
+      ops->alloc   = heap_alloc;
+      ops->release = heap_release;
+      ops->reset   = heap_reset;
+      ops->destroy = heap_destroy;
+   }
+   else {
+      ops->create  = arena_create;
+      ops->alloc   = arena_alloc;
+      ops->release = arena_release;
+      ops->reset   = arena_reset;
+      ops->destroy = arena_destroy;
+   }
+   ops->context = NULL;
+
+} /* End l7p_allocator_default */
+
+void l7p_allocator_create(
+      l7p_allocator   *allocator
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Give a new database the current allocator. If its create fails the
+    * database falls back to the heap (state NULL).
+    */
+
+   if (l7.allocator.create == NULL)
+      l7p_allocator_default(&l7.allocator);
+
+   allocator->ops   = l7.allocator;
+   allocator->state = allocator->ops.create(allocator->ops.context);
+
+} /* End l7p_allocator_create */
+
+void *l7p_alloc(
+      l7p_allocator   *allocator,
+      const size_t    nbytes
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Zeroed memory from a database allocator, or from the heap when
+    * allocator is NULL (push databases) or has no state.
+    */
+
+   if (allocator == NULL || allocator->state == NULL)
+      return(calloc(1, nbytes > 0 ? nbytes : 1));
+
+   return(allocator->ops.alloc(allocator->state, nbytes));
+
+} /* End l7p_alloc */
+
+void l7p_release(
+      l7p_allocator   *allocator,
+      void            *ptr
+      )
+{
+   if (ptr == NULL)
+      return;
+
+   if (allocator == NULL || allocator->state == NULL){
+      free(ptr);
+      return;
+   }
+
+   allocator->ops.release(allocator->state, ptr);
+
+} /* End l7p_release */
+
+void l7p_allocator_reset(
+      l7p_allocator   *allocator
+      )
+{
+   if (allocator->state)
+      allocator->ops.reset(allocator->state);
+
+} /* End l7p_allocator_reset */
+
+void l7p_allocator_destroy(
+      l7p_allocator   *allocator
+      )
+{
+   if (allocator->state)
+      allocator->ops.destroy(allocator->state);
+   allocator->state = NULL;
+
+} /* End l7p_allocator_destroy */
+
+int L7_Set_Allocator(
+      const L7_Allocator      *allocator
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Set_Allocator replaces the allocator of update databases
+    * created from now on.
+    *
+    * Arguments
+    * =========
+    * allocator          (input) const L7_Allocator*
+    *                    Operations to use, all of them set, or NULL for
+    *                    the default (see L7_Allocator in l7.h).
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Purely local. Existing databases keep the allocator they were
+    *    created with, including through later setups on their l7_id.
+    * 2) Push databases always use the heap.
+    *
+    */
+
+   int
+     ierr;
+
+   if (allocator == NULL){
+      l7p_allocator_default(&l7.allocator);
+      return(L7_OK);
+   }
+
+   if (allocator->create == NULL || allocator->alloc == NULL ||
+       allocator->release == NULL || allocator->reset == NULL ||
+       allocator->destroy == NULL){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Every L7_Allocator operation must be set", ierr);
+   }
+
+   l7.allocator = *allocator;
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Set_Allocator */
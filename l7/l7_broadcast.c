@@ -39,16 +39,18 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  *
  */
+#include <string.h>
 #include "l7.h"
 #include "l7p.h"
 
 #define L7_LOCATION "L7_BROADCAST"
 
-int L7_Broadcast (
+int L7_Broadcast_Comm(
 		void                    *data_buffer,
 		const int               count,
 		const enum L7_Datatype  l7_datatype,
-		const int               root_pe
+		const int               root_pe,
+		MPI_Comm                comm
 		)
 {
 	/* Purpose
@@ -131,12 +133,13 @@ int L7_Broadcast (
 */
 
 		/*
-		 * Call MPI Broadcast
+		 * Call MPI Broadcast, through the node-hierarchical path
+		 * for small messages when enabled.
 		 */
 
 		local_count = count;
-		ierr = MPI_Bcast(data_buffer, local_count, mpi_type, root_pe,
-				MPI_COMM_WORLD);
+		ierr = l7p_bcast(data_buffer, local_count, mpi_type, root_pe,
+				comm);
 
 		if (ierr != L7_OK){
 			ierr = -3;
@@ -145,7 +148,17 @@ int L7_Broadcast (
 	}
 #endif /* HAVE_MPI */
 	return(ierr);
-} /* End L7_BROADCAST */
+} /* End L7_Broadcast_Comm */
+
+int L7_Broadcast(
+		void                    *data_buffer,
+		const int               count,
+		const enum L7_Datatype  l7_datatype,
+		const int               root_pe
+		)
+{
+	return(L7_Broadcast_Comm(data_buffer, count, l7_datatype, root_pe, MPI_COMM_WORLD));
+} /* End L7_Broadcast */
 
 void l7_broadcast_ (
 		void                   *data_buffer,
@@ -159,3 +172,79 @@ void l7_broadcast_ (
 } /* End l7_broadcast_ */
 
 
+
+int L7_Allgather_Comm(
+		void                    *local_buffer,
+		const int               count,
+		void                    *global_buffer,
+		const enum L7_Datatype  l7_datatype,
+		MPI_Comm                comm
+		)
+{
+	/* Purpose
+	 * =======
+	 * L7_Allgather collects count items from every processor into
+	 * global_buffer on all processors, in rank order.
+	 *
+	 * Arguments
+	 * =========
+	 * local_buffer          (input) void*
+	 *                       This processor's count items.
+	 *
+	 * count                 (input) const int
+	 *                       Number of items from each processor.
+	 *
+	 * global_buffer         (output) void*
+	 *                       count items times the number of processors.
+	 *
+	 * l7_datatype           (input) const enum L7_Datatype
+	 *                       Datatype of the items.
+	 *
+	 * Return value
+	 * ============
+	 * Returns non-zero value for any error
+	 *
+	 * Notes:
+	 * ======
+	 *
+	 * 1) Serial operation copies local_buffer to global_buffer.
+	 *
+	 */
+
+	int
+	   ierr=L7_OK,
+	   sizeof_type;
+
+	if (l7.initialized != 1){
+		ierr = -1;
+		L7_ASSERT(l7.initialized == 1, "L7 not initialized", ierr);
+	}
+
+#ifdef HAVE_MPI
+	if (l7.initialized_mpi){
+		MPI_Datatype
+		   mpi_type = l7p_mpi_type(l7_datatype);
+
+		ierr = MPI_Allgather(local_buffer, count, mpi_type, global_buffer,
+				count, mpi_type, comm);
+		L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Allgather", ierr);
+		return(L7_OK);
+	}
+#endif /* HAVE_MPI */
+
+	sizeof_type = l7p_sizeof(l7_datatype);
+	if (count > 0 && global_buffer != local_buffer)
+		memcpy(global_buffer, local_buffer, (size_t)count*(size_t)sizeof_type);
+
+	return(ierr);
+} /* End L7_Allgather_Comm */
+
+int L7_Allgather(
+		void                    *local_buffer,
+		const int               count,
+		void                    *global_buffer,
+		const enum L7_Datatype  l7_datatype
+		)
+{
+	return(L7_Allgather_Comm(local_buffer, count, global_buffer, l7_datatype, MPI_COMM_WORLD));
+} /* End L7_Allgather */
@@ -0,0 +1,218 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_COMPACT"
+
+int L7_Compact(
+      const int               l7_id,
+      const int               level
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Compact releases state of an update database that L7_Update no
+    * longer needs once L7_Setup has built the neighbor communicator and
+    * datatypes: the copy of indices_needed, the global send indices,
+    * the starting indices of every process and the setup request
+    * arrays. With L7_COMPACT_ALL the local send indices are released
+    * as well.
+    *
+    * Arguments
+    * =========
+    * l7_id              (input) const int
+    *                    Handle to database to compact.
+    *
+    * level              (input) const int
+    *                    An enum L7_CompactLevel value.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Purely local. Setting the environment variable L7_COMPACT to a
+    *    level compacts every database at the end of its setup.
+    * 2) The database may be set up again afterwards as usual.
+    * 3) Serial compilation creates a no-op.
+    *
+    */
+
+   int
+     ierr;
+
+#if defined HAVE_MPI
+
+   l7_id_database
+     *l7_id_db;
+
+   if (! l7.mpi_initialized){
+      return(0);
+   }
+
+   if (level < L7_COMPACT_LEVEL_MIN || level > L7_COMPACT_LEVEL_MAX){
+      ierr = -1;
+      L7_ASSERT(level >= L7_COMPACT_LEVEL_MIN && level <= L7_COMPACT_LEVEL_MAX,
+            "Invalid compact level", ierr);
+   }
+
+   if (l7_id <= 0){
+      ierr = -1;
+      L7_ASSERT( l7_id > 0, "l7_id <= 0", ierr);
+   }
+
+   l7_id_db = l7p_set_database(l7_id);
+   if (l7_id_db == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
+   }
+
+   l7p_database_compact(l7_id_db, level);
+
+#endif /* HAVE_MPI */
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Compact */
+
+int L7_Get_Memory_Usage(
+      const int               l7_id,
+      size_t                  *bytes
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Get_Memory_Usage returns the bytes of host memory held by an
+    * update database on this process, or by all update databases when
+    * l7_id is 0. MPI datatype storage is estimated from the arguments
+    * the types were built with; shared L7 buffers are not counted.
+    *
+    * Arguments
+    * =========
+    * l7_id              (input) const int
+    *                    Handle to database, or 0 for all databases.
+    *
+    * bytes              (output) size_t*
+    *                    Memory in bytes.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Purely local.
+    * 2) Serial compilation returns 0 bytes.
+    *
+    */
+
+   int
+     ierr;
+
+   if (bytes == NULL){
+      ierr = -1;
+      L7_ASSERT( bytes != NULL, "bytes != NULL", ierr);
+   }
+
+   *bytes = 0;
+
+#if defined HAVE_MPI
+
+   l7_id_database
+     *l7_id_db;
+
+   if (! l7.mpi_initialized){
+      return(L7_OK);
+   }
+
+   if (l7_id < 0){
+      ierr = -1;
+      L7_ASSERT( l7_id >= 0, "l7_id < 0", ierr);
+   }
+
+   if (l7_id == 0){
+      for (l7_id_db = l7.first_db; l7_id_db; l7_id_db = l7_id_db->next_db)
+         *bytes += l7p_database_memory_usage(l7_id_db);
+      return(L7_OK);
+   }
+
+   l7_id_db = l7p_set_database(l7_id);
+   if (l7_id_db == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
+   }
+
+   *bytes = l7p_database_memory_usage(l7_id_db);
+
+#endif /* HAVE_MPI */
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Get_Memory_Usage */
+
+void L7_COMPACT(
+      const int   *l7_id,
+      const int   *level,
+      int         *ierr
+      )
+{
+   *ierr = L7_Compact(*l7_id, *level);
+}
+
+void L7_GET_MEMORY_USAGE(
+      const int   *l7_id,
+      long long   *bytes,
+      int         *ierr
+      )
+{
+   size_t
+     nbytes;
+
+   *ierr = L7_Get_Memory_Usage(*l7_id, &nbytes);
+   *bytes = (long long)nbytes;
+}
@@ -84,9 +84,6 @@ int L7_Dev_Free(
       return(0);
    }
 
-   ierr = MPI_Comm_rank(MPI_COMM_WORLD, &l7.penum);
-   L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_rank error", ierr);
-
    if (l7.initialized != 1){
       ierr = -1;
       L7_ASSERT( l7.initialized != 1, "L7 not initialized", ierr);
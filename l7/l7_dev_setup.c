@@ -142,7 +142,6 @@ int L7_Dev_Setup(
 	  num_indices_acctd_for,
 	  num_outstanding_requests = 0,
 	  num_sends,
-	  num_recvs,
 	  offset,
 	  penum,                       /* Alias for l7_id_db.penum.             */
 	  *pi4_in,                     /* (int *)l7.receive_buffer              */
@@ -151,6 +150,9 @@ int L7_Dev_Setup(
 	  start_indices_needed,
 	  this_index;                  /* Offset into indexing set.             */
 
+	double
+	  setup_time_start;            /* MPI_Wtime at entry, for stats.       */
+
 	l7_id_database
 	  *l7_id_db;
 
@@ -176,6 +178,8 @@ int L7_Dev_Setup(
 		return(0);
 	}
 
+	setup_time_start = MPI_Wtime();
+
    if (l7.initialized != 1){
 		ierr = -1;
 		L7_ASSERT( l7.initialized == 1, "L7 not initialized", ierr);
@@ -242,11 +246,8 @@ int L7_Dev_Setup(
 					"Uninitialized l7_id input, but not found in this list",
 					ierr);
 		}
-		l7p_nbr_state_free(&l7_id_db->nbr_state);
-                L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[1]);
-                L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[2]);
-                L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[4]);
-                L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[8]);
+		l7p_database_comm_free(l7_id_db);
+		l7p_database_arrays_reset(l7_id_db);
 	}
 	else{
 
@@ -254,49 +255,13 @@ int L7_Dev_Setup(
 		 * Allocate new database, insert into linked list.
 		 */
 
-		if (l7.num_dbs >= L7_MAX_NUM_DBS){
-			ierr = -1;
-			L7_ASSERT(l7.num_dbs < L7_MAX_NUM_DBS,
-					"Too many L7 databases allocataed",
-					ierr);
-		}
-
-		l7_id_db = (l7_id_database*)calloc(1L, sizeof(l7_id_database) );
-
+		l7_id_db = l7p_database_new();
 		if (l7_id_db == NULL){
 			ierr = -1;
 			L7_ASSERT( l7_id_db != NULL, "Failed to allocate new database",
 					ierr);
 		}
 
-		if ( !(l7.first_db) ){
-			l7.first_db = l7_id_db;
-			l7.last_db  = l7_id_db;
-			l7_id_db->next_db = NULL; /* Paranoia */
-
-			l7_id_db->l7_id = 1;
-
-			l7.num_dbs = 1;
-		}
-		else{
-
-			/*
-			 * Assign a l7_id.
-			 */
-
-			l7_id_db->l7_id = l7.last_db->l7_id + 1;
-
-			/*
-			 * Reset links.
-			 */
-
-			l7.last_db->next_db = l7_id_db;
-
-			l7.last_db = l7_id_db;
-
-			l7.num_dbs++;
-		}
-
 		*l7_id = l7_id_db->l7_id;
 
 		/*
@@ -325,10 +290,10 @@ int L7_Dev_Setup(
 	if ( (l7_id_db->indices_needed_len < num_indices_needed ) &&
 		 (num_indices_needed > 0) ){
 		if (l7_id_db->indices_needed)
-			 free(l7_id_db->indices_needed);
+			 l7p_release(&l7_id_db->allocator, l7_id_db->indices_needed);
 
 		l7_id_db->indices_needed =
-			 (int *)calloc((unsigned long long)num_indices_needed, sizeof(int) );
+			 (int *) l7p_alloc(&l7_id_db->allocator, (size_t)num_indices_needed*sizeof(int));
 
 		if (l7_id_db->indices_needed == NULL){
 			 ierr = -1;
@@ -348,14 +313,21 @@ int L7_Dev_Setup(
 
 	l7_id_db->num_indices_needed = num_indices_needed;
 
+	/* Device updates use the default layout (see L7_Setup_Placed). */
+
+	if (l7_id_db->ghost_offsets){
+		l7p_release(&l7_id_db->allocator, l7_id_db->ghost_offsets);
+		l7_id_db->ghost_offsets = NULL;
+	}
+	l7_id_db->owned_placed = 0;
+	l7_id_db->comm = MPI_COMM_WORLD;
+
 	ierr = MPI_Comm_rank (MPI_COMM_WORLD, &l7_id_db->penum );
 	L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_rank", ierr);
 
 	ierr = MPI_Comm_size (MPI_COMM_WORLD, &l7_id_db->numpes );
 	L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_size", ierr);
 
-	l7.penum = l7_id_db->penum;
-
 	/* Local shorthand */
 
 	numpes   = l7_id_db->numpes;
@@ -377,8 +349,11 @@ int L7_Dev_Setup(
 	 * The latter two steps allows arrays to be used as below.
 	 */
 
+	if (l7_id_db->starting_indices)
+		l7p_release(&l7_id_db->allocator, l7_id_db->starting_indices);
+
 	l7_id_db->starting_indices =
-		(int *)calloc((unsigned long long)(numpes+1), sizeof(int));
+		(int *) l7p_alloc(&l7_id_db->allocator, (size_t)(numpes+1)*sizeof(int));
 	if(l7_id_db->starting_indices == NULL){
 		ierr = -1;
 		L7_ASSERT(l7_id_db->starting_indices != NULL,
@@ -455,10 +430,10 @@ int L7_Dev_Setup(
 
 	if (l7_id_db->num_recvs > l7_id_db->recv_counts_len){
 		if (l7_id_db->recv_counts)
-			free(l7_id_db->recv_counts);
+			l7p_release(&l7_id_db->allocator, l7_id_db->recv_counts);
 
 		l7_id_db->recv_counts =
-			(int *)calloc((unsigned long long)l7_id_db->num_recvs, sizeof(int) );
+			(int *) l7p_alloc(&l7_id_db->allocator, (size_t)(l7_id_db->num_recvs)*sizeof(int));
 		if (l7_id_db->recv_counts == NULL){
 			ierr = -1;
 			L7_ASSERT(l7_id_db->recv_counts != NULL,
@@ -474,10 +449,10 @@ int L7_Dev_Setup(
 
 	if (l7_id_db->num_recvs > l7_id_db->recv_from_len){
 		if (l7_id_db->recv_from)
-			free(l7_id_db->recv_from);
+			l7p_release(&l7_id_db->allocator, l7_id_db->recv_from);
 
 		l7_id_db->recv_from =
-			(int *)calloc((unsigned long long)l7_id_db->num_recvs, sizeof(int) );
+			(int *) l7p_alloc(&l7_id_db->allocator, (size_t)(l7_id_db->num_recvs)*sizeof(int));
 
 	if (l7_id_db->recv_from == NULL){
 		ierr = -1;
@@ -547,10 +522,9 @@ int L7_Dev_Setup(
 	 */
 
 	if (l7.sizeof_send_buffer < 2 * numpes * (int)sizeof(int)){
-	   if (l7.send_buffer)
-	      free(l7.send_buffer);
+	   L7_Mem_Release(l7.send_buffer);
 
-	   l7.send_buffer = calloc ((unsigned long long)(2*numpes), sizeof(int));
+	   l7.send_buffer = L7_Mem_Alloc((size_t)(2*numpes) * sizeof(int));
 	   if (l7.send_buffer == NULL){
 	      ierr = -1;
 	      L7_ASSERT(l7.send_buffer != NULL, "No memory for send buffer", ierr);
@@ -591,9 +565,9 @@ int L7_Dev_Setup(
 
 	if (num_msgs > l7_id_db->mpi_request_len) {
 	   if (l7_id_db->mpi_request)
-	      free(l7_id_db->mpi_request);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->mpi_request);
 
-	   l7_id_db->mpi_request = (MPI_Request *) calloc ((unsigned long long)num_msgs, sizeof(MPI_Request));
+	   l7_id_db->mpi_request = (MPI_Request *) l7p_alloc(&l7_id_db->allocator, (size_t)num_msgs*sizeof(MPI_Request));
 
 	  if (l7_id_db->mpi_request == NULL){
 	     ierr = -1;
@@ -605,9 +579,9 @@ int L7_Dev_Setup(
 
 	if (num_msgs > l7_id_db->mpi_status_len){
 	   if (l7_id_db->mpi_status)
-	      free(l7_id_db->mpi_status);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->mpi_status);
 
-	   l7_id_db->mpi_status = (MPI_Status *) calloc((unsigned long long)num_msgs, sizeof(MPI_Status) );
+	   l7_id_db->mpi_status = (MPI_Status *) l7p_alloc(&l7_id_db->allocator, (size_t)num_msgs*sizeof(MPI_Status));
 	   if (l7_id_db->mpi_status == NULL){
 	      ierr = -1;
 	      L7_ASSERT(l7_id_db->mpi_status != NULL,
@@ -647,9 +621,9 @@ int L7_Dev_Setup(
 
 	if (l7_id_db->num_sends > l7_id_db->send_counts_len){
 	   if (l7_id_db->send_counts)
-	      free(l7_id_db->send_counts);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->send_counts);
 
-	   l7_id_db->send_counts = (int *) calloc((unsigned long long)l7_id_db->num_sends, sizeof(int) );
+	   l7_id_db->send_counts = (int *) l7p_alloc(&l7_id_db->allocator, (size_t)(l7_id_db->num_sends)*sizeof(int));
 	   if (l7_id_db->send_counts == NULL){
 	      ierr = -1;
 	      L7_ASSERT(l7_id_db->send_counts != NULL,
@@ -660,9 +634,9 @@ int L7_Dev_Setup(
 
 	if (l7_id_db->num_sends > l7_id_db->send_to_len){
 	   if (l7_id_db->send_to)
-	      free(l7_id_db->send_to);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->send_to);
 
-	   l7_id_db->send_to = (int *) calloc((unsigned long long)l7_id_db->num_sends, sizeof(int) );
+	   l7_id_db->send_to = (int *) l7p_alloc(&l7_id_db->allocator, (size_t)(l7_id_db->num_sends)*sizeof(int));
 	   if (l7_id_db->send_to == NULL){
 	      ierr = -1;
          L7_ASSERT(l7_id_db->send_to != NULL,
@@ -705,11 +679,12 @@ int L7_Dev_Setup(
 	   count_total += l7_id_db->send_counts[i];
 	}
 
-	if (count_total > l7_id_db->indices_to_send_len){
+	if (count_total > l7_id_db->indices_to_send_len ||
+	    l7_id_db->indices_global_to_send == NULL){
 	   if (l7_id_db->indices_global_to_send)
-	      free(l7_id_db->indices_global_to_send);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->indices_global_to_send);
 
-	   l7_id_db->indices_global_to_send = (int *) calloc((unsigned long long)count_total, sizeof(int) );
+	   l7_id_db->indices_global_to_send = (int *) l7p_alloc(&l7_id_db->allocator, (size_t)count_total*sizeof(int));
 	   if (l7_id_db->indices_global_to_send == NULL){
 	      ierr = -1;
 	      L7_ASSERT(l7_id_db->indices_global_to_send != NULL,
@@ -717,9 +692,9 @@ int L7_Dev_Setup(
 	   }
 
 	   if (l7_id_db->indices_local_to_send)
-	      free(l7_id_db->indices_local_to_send);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->indices_local_to_send);
 
-	   l7_id_db->indices_local_to_send = (int *) calloc((unsigned long long)count_total, sizeof(int) );
+	   l7_id_db->indices_local_to_send = (int *) l7p_alloc(&l7_id_db->allocator, (size_t)count_total*sizeof(int));
       if (l7_id_db->indices_local_to_send == NULL){
          ierr = -1;
          L7_ASSERT(l7_id_db->indices_local_to_send != NULL,
@@ -867,10 +842,10 @@ int L7_Dev_Setup(
 	   send_buffer_bytes_needed += l7_id_db->send_counts[i] * max_sizeof_type;
 
 	if (send_buffer_bytes_needed > l7.sizeof_send_buffer ){
-	   if (l7.send_buffer)
-	      free(l7.send_buffer);
+	   L7_Mem_Release(l7.send_buffer);
 
-	   l7.send_buffer = (char *)calloc((unsigned long long)send_buffer_bytes_needed, sizeof (char) );
+	   /* Staging buffer for packed device data (see L7_MEM_POLICY). */
+	   l7.send_buffer = L7_Mem_Alloc((size_t)send_buffer_bytes_needed);
 	   if (l7.send_buffer == NULL){
 	      ierr = -1;
 	      L7_ASSERT(l7.send_buffer != NULL, "No memory for send buffer", ierr);
@@ -889,6 +864,13 @@ int L7_Dev_Setup(
 
         size_t num_indices_have = l7_id_db->num_indices_have;
 
+        /* A database set up again replaces its device send list. */
+        if (l7_id_db->indices_have)
+           free(l7_id_db->indices_have);
+        if (l7_id_db->dev_indices_have)
+           ezcl_device_memory_delete(l7_id_db->dev_indices_have);
+        l7_id_db->dev_indices_have = NULL;
+
         l7_id_db->indices_have = (int *) malloc(num_indices_have*sizeof(int));
 
         int ioffset = 0;
@@ -913,44 +895,25 @@ int L7_Dev_Setup(
            l7_id_db->dev_indices_have = ezcl_malloc(NULL, "dev_indices_have", &num_indices_have,  sizeof(cl_int), CL_MEM_READ_WRITE, 0);
            cl_command_queue command_queue = ezcl_get_command_queue();
            ezcl_enqueue_write_buffer(command_queue, l7_id_db->dev_indices_have, CL_TRUE,  0, num_indices_have*sizeof(cl_int), &l7_id_db->indices_have[0],     NULL);
+
+           /* Size the L7_Dev_Update staging buffers for the widest type
+            * now, so updates do not allocate. */
+           ierr = l7p_dev_pool_reserve(l7_id_db, sizeof(cl_double));
+           L7_ASSERT(ierr == L7_OK, "Failed to allocate device update buffers", ierr);
         }
 #endif
 
         /* Now that we have all of the information on our communiation partners
-         * and which indicies needto be communicated where, setup a neighbor collective
-         * to do all the acutal work. Start using the graph information to create a
-         * communicator with a distributed graph topology for neighbor communication */
-        num_sends = l7_id_db->num_sends;
-        num_recvs = l7_id_db->num_recvs;
-
-        ierr = MPI_Dist_graph_create_adjacent(MPI_COMM_WORLD,
-                        num_recvs, l7_id_db->recv_from, MPI_UNWEIGHTED,
-                        num_sends, l7_id_db->send_to, MPI_UNWEIGHTED,
-                        MPI_INFO_NULL, 0, &l7_id_db->nbr_state.comm);
-
-        if (ierr != MPI_SUCCESS) {
-          ierr = -1;
-          L7_ASSERT(ierr == MPI_SUCCESS, "Failed to create graph communicator.", ierr)
-        }
+         * and which indicies needto be communicated where, build the graph
+         * communicator and neighbor datatypes that do all the actual work. */
+        ierr = l7p_database_comm_create(l7_id_db);
+        L7_ASSERT(ierr == L7_OK, "Failed to create neighbor communication state.", ierr);
 
-        /* The sender/receiver order used by MPI neighbor collectives is the same as
-         * the order in the send_to/recv_from list used to create the graph; MPI guarantees
-         * that this is the case if the graph was created with graph_create_adjacent.
-         *
-         * We cannot know the offset in bytes here, which is what the neighbor
-         * collectives want, as it depends on the type we're sending/receiving
-         * and we don't know that at setup. As a result we use an offset of 0
-         * and count of 1 and let the derived datatypes take care of where in
-         * the array the data goes to and comes from. */
-
-        /* Create update_datatypes for all the L7 datatype sizes */
-        ierr = l7p_nbr_state_create(&l7_id_db->nbr_state, num_recvs, num_sends);
-        L7_ASSERT(ierr == L7_OK, "Could not create neighbor state", ierr);
-
-        L7P_Update_Type_Create(l7_id_db, L7_CHAR, &l7_id_db->nbr_state.update_datatypes[1]);
-        L7P_Update_Type_Create(l7_id_db, L7_SHORT, &l7_id_db->nbr_state.update_datatypes[2]);
-        L7P_Update_Type_Create(l7_id_db, L7_INT, &l7_id_db->nbr_state.update_datatypes[4]);
-        L7P_Update_Type_Create(l7_id_db, L7_DOUBLE, &l7_id_db->nbr_state.update_datatypes[8]);
+        /* Drop setup-only state when the job asked for it (L7_COMPACT). */
+        l7p_database_compact(l7_id_db, l7.compact_level);
+
+        l7_id_db->stats.num_setups++;
+        l7_id_db->stats.setup_time += MPI_Wtime() - setup_time_start;
 
 	/*
 	 * Message tag management
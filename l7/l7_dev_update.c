@@ -38,6 +38,7 @@
  *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  *  POSSIBILITY OF SUCH DAMAGE.
  */
+#include <stdint.h>
 #include <stdlib.h>
 #include "l7.h"
 #include "l7p.h"
@@ -46,6 +47,252 @@
 // #define _L7_DEBUG
 
 #ifdef HAVE_OPENCL
+
+#define DEV_POOL_MIN 4096 /* Smallest pooled buffer, bytes. */
+
+static size_t dev_size_class(
+      size_t                  bytes
+      )
+{
+   /*
+    * Pooled buffers come in powers of two, so a database whose counts
+    * change a little when it is set up again keeps its buffers.
+    */
+
+   size_t
+     cls = DEV_POOL_MIN;
+
+   while (cls < bytes)
+      cls *= 2;
+
+   return(cls);
+}
+
+static int dev_pinned_reserve(
+      cl_mem                  *mem,
+      void                    **host,
+      size_t                  *capacity,
+      const char              *name,
+      const size_t            bytes
+      )
+{
+   /*
+    * Grow a pinned host staging buffer: a CL_MEM_ALLOC_HOST_PTR buffer
+    * kept mapped for the life of the database, so device reads and
+    * writes to it run at full DMA speed and MPI can use it directly.
+    */
+
+   cl_command_queue
+     command_queue = ezcl_get_command_queue();
+   cl_int
+     ierr;
+   size_t
+     cls;
+
+   if (*host != NULL && bytes <= *capacity)
+      return(L7_OK);
+
+   if (*host != NULL){
+      clEnqueueUnmapMemObject(command_queue, *mem, *host, 0, NULL, NULL);
+      ezcl_device_memory_delete(*mem);
+   }
+   *mem      = NULL;
+   *host     = NULL;
+   *capacity = 0;
+
+   cls = dev_size_class(bytes);
+   *mem = ezcl_device_memory_malloc(ezcl_get_context(), NULL, name, cls, 1,
+         CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, 0);
+   if (*mem == NULL)
+      return(-1);
+
+   *host = clEnqueueMapBuffer(command_queue, *mem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+         0, cls, 0, NULL, NULL, &ierr);
+   if (ierr != CL_SUCCESS || *host == NULL){
+      ezcl_device_memory_delete(*mem);
+      *mem  = NULL;
+      *host = NULL;
+      return(-1);
+   }
+   *capacity = cls;
+
+   return(L7_OK);
+}
+
+static void dev_pinned_free(
+      cl_mem                  *mem,
+      void                    **host,
+      size_t                  *capacity
+      )
+{
+   if (*host != NULL){
+      clEnqueueUnmapMemObject(ezcl_get_command_queue(), *mem, *host, 0, NULL, NULL);
+      ezcl_device_memory_delete(*mem);
+   }
+   *mem      = NULL;
+   *host     = NULL;
+   *capacity = 0;
+}
+
+int l7p_dev_pool_reserve(
+      l7_id_database          *l7_id_db,
+      const size_t            elsize
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_dev_pool_reserve makes sure the database's device update
+    * staging buffers hold elements of elsize bytes: the device packed
+    * buffer and its pinned host copy (num_indices_have elements), the
+    * pinned ghost receive buffer (num_indices_needed elements) and the
+    * request array. Buffers are only replaced when they are too small.
+    *
+    * Return value
+    * ============
+    * L7_OK, or -1 if out of memory.
+    *
+    */
+
+   size_t
+     packed = (size_t)l7_id_db->num_indices_have * elsize,
+     ghost  = (size_t)l7_id_db->num_indices_needed * elsize,
+     cls;
+   int
+     num_requests = l7_id_db->num_sends + l7_id_db->num_recvs;
+
+   if (packed > l7_id_db->dev_packed_bytes || l7_id_db->dev_packed_data == NULL){
+      if (l7_id_db->dev_packed_data)
+         ezcl_device_memory_delete(l7_id_db->dev_packed_data);
+      cls = dev_size_class(packed);
+      l7_id_db->dev_packed_data = ezcl_malloc(NULL, "dev_packed_data", &cls, 1, CL_MEM_READ_WRITE, 0);
+      l7_id_db->dev_packed_bytes = (l7_id_db->dev_packed_data != NULL) ? cls : 0;
+      if (l7_id_db->dev_packed_data == NULL)
+         return(-1);
+   }
+
+   if (dev_pinned_reserve(&l7_id_db->host_packed_mem, &l7_id_db->host_packed_data,
+         &l7_id_db->host_packed_bytes, "host_packed_data", packed) != L7_OK)
+      return(-1);
+
+   if (dev_pinned_reserve(&l7_id_db->host_ghost_mem, &l7_id_db->host_ghost_data,
+         &l7_id_db->host_ghost_bytes, "host_ghost_data", ghost) != L7_OK)
+      return(-1);
+
+   if (num_requests > l7_id_db->dev_requests_len || l7_id_db->dev_requests == NULL){
+      free(l7_id_db->dev_requests);
+      l7_id_db->dev_requests = (MPI_Request *)malloc((size_t)(num_requests+1) * sizeof(MPI_Request));
+      l7_id_db->dev_requests_len = (l7_id_db->dev_requests != NULL) ? num_requests : 0;
+      if (l7_id_db->dev_requests == NULL)
+         return(-1);
+   }
+
+   return(L7_OK);
+
+} /* End l7p_dev_pool_reserve */
+
+void l7p_dev_pool_free(
+      l7_id_database          *l7_id_db
+      )
+{
+   /*
+    * Release the device update staging buffers of a database.
+    */
+
+   if (l7_id_db->dev_packed_data)
+      ezcl_device_memory_delete(l7_id_db->dev_packed_data);
+   l7_id_db->dev_packed_data  = NULL;
+   l7_id_db->dev_packed_bytes = 0;
+
+   dev_pinned_free(&l7_id_db->host_packed_mem, &l7_id_db->host_packed_data,
+         &l7_id_db->host_packed_bytes);
+   dev_pinned_free(&l7_id_db->host_ghost_mem, &l7_id_db->host_ghost_data,
+         &l7_id_db->host_ghost_bytes);
+
+   free(l7_id_db->host_update_data);
+   l7_id_db->host_update_data  = NULL;
+   l7_id_db->host_update_bytes = 0;
+
+   free(l7_id_db->dev_requests);
+   l7_id_db->dev_requests     = NULL;
+   l7_id_db->dev_requests_len = 0;
+
+} /* End l7p_dev_pool_free */
+
+#if defined HAVE_MPI
+
+static int dev_update_host(
+      l7_id_database          *l7_id_db,
+      cl_mem                  dev_data_buffer,
+      const enum L7_Datatype  l7_datatype,
+      const size_t            elsize
+      )
+{
+   /*
+    * Ghosts that are not one contiguous block in receive order (placed
+    * ghosts, repeated needed indices) go through the host L7_Update on a
+    * full owned+ghost array, built from the packed buffer already read
+    * into host_packed_data.
+    */
+
+   size_t
+     num_indices_have   = l7_id_db->num_indices_have,
+     num_indices_owned  = l7_id_db->num_indices_owned,
+     num_indices_needed = l7_id_db->num_indices_needed,
+     update = (num_indices_owned + num_indices_needed) * elsize,
+     cls;
+   int
+     ierr;
+
+   if (l7_id_db->indices_have == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db->indices_have != NULL,
+            "Device send indices released by L7_Compact", ierr);
+   }
+
+   if (update > l7_id_db->host_update_bytes || l7_id_db->host_update_data == NULL){
+      free(l7_id_db->host_update_data);
+      cls = dev_size_class(update);
+      l7_id_db->host_update_data = malloc(cls);
+      l7_id_db->host_update_bytes = (l7_id_db->host_update_data != NULL) ? cls : 0;
+      if (l7_id_db->host_update_data == NULL){
+         ierr = -1;
+         L7_ASSERT(ierr == 0, "No memory for device update array", ierr);
+      }
+   }
+
+   switch (elsize) {
+      case 2:
+         for (size_t ii = 0; ii < num_indices_have; ii++){
+            ((short *)l7_id_db->host_update_data)[l7_id_db->indices_have[ii]] = ((short *)l7_id_db->host_packed_data)[ii];
+         }
+         break;
+      case 4:
+         for (size_t ii = 0; ii < num_indices_have; ii++){
+            ((int32_t *)l7_id_db->host_update_data)[l7_id_db->indices_have[ii]] = ((int32_t *)l7_id_db->host_packed_data)[ii];
+         }
+         break;
+      default:
+         for (size_t ii = 0; ii < num_indices_have; ii++){
+            ((double *)l7_id_db->host_update_data)[l7_id_db->indices_have[ii]] = ((double *)l7_id_db->host_packed_data)[ii];
+         }
+         break;
+   }
+
+#ifdef _L7_DEBUG
+   printf("[pe %d] Calling underlying L7_Update.\n", l7.penum);
+#endif
+   ierr = L7_Update (l7_id_db->host_update_data, l7_datatype, l7_id_db->l7_id);
+   L7_ASSERT(ierr == L7_OK, "L7_Update", ierr);
+
+   ezcl_enqueue_write_buffer(ezcl_get_command_queue(), dev_data_buffer, CL_TRUE, num_indices_owned*elsize,
+         num_indices_needed*elsize, (char *)l7_id_db->host_update_data + num_indices_owned*elsize, NULL);
+
+   return(L7_OK);
+}
+
+#endif /* HAVE_MPI */
+
 int L7_Dev_Update(
       cl_mem                  dev_data_buffer,
       const enum L7_Datatype  l7_datatype,
@@ -78,6 +325,14 @@ int L7_Dev_Update(
     * Notes:
     * =====
     * 1) Serial compilation creates a no-op
+    * 2) The send data is packed on the device and read into a pinned
+    *    host buffer, each neighbor's share is sent from it as one
+    *    contiguous message, the ghosts are received into a second
+    *    pinned buffer and written straight into the ghost region of
+    *    data_buffer. No owned+ghost host array is built, and
+    *    L7_UPDATE_CHECK is not applied.
+    * 3) Placed ghosts (L7_Setup_Placed) and repeated needed indices go
+    *    through the host L7_Update instead.
     *
     */
 #if defined HAVE_MPI
@@ -135,7 +390,6 @@ int L7_Dev_Update(
       L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
    }
 
-   l7.penum = l7_id_db->penum;
 
    if (l7_id_db->numpes == 1){ /* No-op */
       ierr = L7_OK;
@@ -148,229 +402,121 @@ int L7_Dev_Update(
 
    size_t num_indices_have   = l7_id_db->num_indices_have;
    size_t num_indices_owned  = l7_id_db->num_indices_owned;
-   size_t num_indices_needed = l7_id_db->num_indices_needed;
 
    cl_command_queue command_queue = ezcl_get_command_queue();
 
-   /*
-    * Pull the data off the GPU and organize into regular array.
-    */
-
-   size_t pack_local_work_size = 128;
-   size_t pack_global_work_size = ((num_indices_have + pack_local_work_size - 1) /pack_local_work_size) * pack_local_work_size;
-
-   cl_mem dev_packed_data = NULL;
-   cl_mem dev_data_buffer_add = NULL;
-   short *short_data_buffer = NULL;
-   short *packed_short_data = NULL;
-   int *packed_int_data = NULL;
-   int *int_data_buffer = NULL;
-   float *packed_float_data = NULL;
-   float *float_data_buffer = NULL;
-   double *packed_double_data = NULL;
-   double *double_data_buffer = NULL;
-
-   size_t ghost_local_work_size = 64;
-   size_t ghost_global_work_size = ((num_indices_needed + ghost_local_work_size - 1) /ghost_local_work_size) * ghost_local_work_size;
+   cl_kernel pack_kernel;
+   size_t elsize;
 
    switch (l7_datatype) {
       case L7_SHORT:
-         dev_packed_data = ezcl_malloc(NULL, "dev_packed_data", &num_indices_have, sizeof(cl_short), CL_MEM_READ_WRITE, 0);
-
-         ezcl_set_kernel_arg(l7.kernel_pack_short_have_data, 0, sizeof(cl_int), (void *)&num_indices_have);
-         ezcl_set_kernel_arg(l7.kernel_pack_short_have_data, 1, sizeof(cl_mem), (void *)&l7_id_db->dev_indices_have);
-         ezcl_set_kernel_arg(l7.kernel_pack_short_have_data, 2, sizeof(cl_mem), (void *)&dev_data_buffer);
-         ezcl_set_kernel_arg(l7.kernel_pack_short_have_data, 3, sizeof(cl_mem), (void *)&dev_packed_data);
-
-         ezcl_enqueue_ndrange_kernel(command_queue, l7.kernel_pack_short_have_data,   1, NULL, &pack_global_work_size, &pack_local_work_size, NULL);
-
-         packed_short_data = (short *)malloc(num_indices_have*sizeof(short));
-         ezcl_enqueue_read_buffer(command_queue, dev_packed_data, CL_TRUE, 0, num_indices_have*sizeof(cl_short), &packed_short_data[0], NULL);
-
-         short_data_buffer = (short *)malloc((num_indices_owned+num_indices_needed)*sizeof(short));
-         for (unsigned int ii = 0; ii < num_indices_have; ii++){
-            short_data_buffer[l7_id_db->indices_have[ii]] = packed_short_data[ii];
-         }
-
-         free(packed_short_data);
-
-         ezcl_device_memory_delete(dev_packed_data);
-
-         /*
-          * Do the regular L7_Update across processor.
-          */
-
-         L7_Update (short_data_buffer, l7_datatype, l7_id);
-
-         dev_data_buffer_add    = ezcl_malloc(NULL, "dev_data_buffer_add",    &num_indices_needed,     sizeof(cl_short), CL_MEM_READ_WRITE, 0);
-         ezcl_enqueue_write_buffer(command_queue, dev_data_buffer_add, CL_TRUE,  0, num_indices_needed*sizeof(cl_short), &short_data_buffer[num_indices_owned],     NULL);
-
-         free(short_data_buffer);
-
-         // Fill in ghost
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_short_data, 0, sizeof(cl_int), &num_indices_owned);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_short_data, 1, sizeof(cl_int), (void *)&num_indices_needed);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_short_data, 2, sizeof(cl_mem), (void *)&dev_data_buffer);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_short_data, 3, sizeof(cl_mem), (void *)&dev_data_buffer_add);
-
-         ezcl_enqueue_ndrange_kernel(command_queue, l7.kernel_copy_ghost_short_data,   1, NULL, &ghost_global_work_size, &ghost_local_work_size, NULL);
-
-         ezcl_device_memory_delete(dev_data_buffer_add);
-
+         pack_kernel = l7.kernel_pack_short_have_data;
+         elsize = sizeof(cl_short);
          break;
       case L7_INT:
-#ifdef _L7_DEBUG
-	printf("[pe %d] Packing OpenCL INT onto device buffer.\n", l7.penum);
-#endif
-         dev_packed_data = ezcl_malloc(NULL, "dev_packed_data", &num_indices_have, sizeof(cl_int), CL_MEM_READ_WRITE, 0);
-
-         ezcl_set_kernel_arg(l7.kernel_pack_int_have_data, 0, sizeof(cl_int), (void *)&num_indices_have);
-         ezcl_set_kernel_arg(l7.kernel_pack_int_have_data, 1, sizeof(cl_mem), (void *)&l7_id_db->dev_indices_have);
-         ezcl_set_kernel_arg(l7.kernel_pack_int_have_data, 2, sizeof(cl_mem), (void *)&dev_data_buffer);
-         ezcl_set_kernel_arg(l7.kernel_pack_int_have_data, 3, sizeof(cl_mem), (void *)&dev_packed_data);
-
-         ezcl_enqueue_ndrange_kernel(command_queue, l7.kernel_pack_int_have_data,   1, NULL, &pack_global_work_size, &pack_local_work_size, NULL);
-
-#ifdef _L7_DEBUG
-	printf("[pe %d] Copying packed device buffer onto host.\n", l7.penum);
-#endif
-         packed_int_data = (int *)malloc(num_indices_have*sizeof(int));
-         ezcl_enqueue_read_buffer(command_queue, dev_packed_data, CL_TRUE, 0, num_indices_have*sizeof(cl_int), &packed_int_data[0], NULL);
-
-#ifdef _L7_DEBUG
-	 printf("[pe %d] Copying device indices on host buffer.\n", l7.penum);
-#endif
-         int_data_buffer = (int *)malloc((num_indices_owned+num_indices_needed)*sizeof(int));
-         for (unsigned int ii = 0; ii < num_indices_have; ii++){
-            int_data_buffer[l7_id_db->indices_have[ii]] = packed_int_data[ii];
-         }
-
-         free(packed_int_data);
-
-         ezcl_device_memory_delete(dev_packed_data);
-
-         /*
-          * Do the regular L7_Update across processor.
-          */
-
-#ifdef _L7_DEBUG
-	 printf("[pe %d] Calling underlying L7_Update.\n", l7.penum);
-#endif
-         L7_Update (int_data_buffer, l7_datatype, l7_id);
-
-#ifdef _L7_DEBUG
-	 printf("[pe %d] Moving received data to device.\n", l7.penum);
-#endif
-         dev_data_buffer_add    = ezcl_malloc(NULL, "dev_data_buffer_add",    &num_indices_needed,     sizeof(cl_int), CL_MEM_READ_WRITE, 0);
-         ezcl_enqueue_write_buffer(command_queue, dev_data_buffer_add, CL_TRUE,  0, num_indices_needed*sizeof(cl_int), &int_data_buffer[num_indices_owned],     NULL);
-
-         free(int_data_buffer);
-
-         // Fill in ghost
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_int_data, 0, sizeof(cl_int), &num_indices_owned);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_int_data, 1, sizeof(cl_int), (void *)&num_indices_needed);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_int_data, 2, sizeof(cl_mem), (void *)&dev_data_buffer);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_int_data, 3, sizeof(cl_mem), (void *)&dev_data_buffer_add);
-
-         ezcl_enqueue_ndrange_kernel(command_queue, l7.kernel_copy_ghost_int_data,   1, NULL, &ghost_global_work_size, &ghost_local_work_size, NULL);
-
-         ezcl_device_memory_delete(dev_data_buffer_add);
-
-#ifdef _L7_DEBUG
-	 printf("[pe %d] Finished L7_INT dev_update.\n", l7.penum);
-#endif
+         pack_kernel = l7.kernel_pack_int_have_data;
+         elsize = sizeof(cl_int);
          break;
       case L7_FLOAT:
-         dev_packed_data = ezcl_malloc(NULL, "dev_packed_data", &num_indices_have, sizeof(cl_float), CL_MEM_READ_WRITE, 0);
-
-         ezcl_set_kernel_arg(l7.kernel_pack_float_have_data, 0, sizeof(cl_int), (void *)&num_indices_have);
-         ezcl_set_kernel_arg(l7.kernel_pack_float_have_data, 1, sizeof(cl_mem), (void *)&l7_id_db->dev_indices_have);
-         ezcl_set_kernel_arg(l7.kernel_pack_float_have_data, 2, sizeof(cl_mem), (void *)&dev_data_buffer);
-         ezcl_set_kernel_arg(l7.kernel_pack_float_have_data, 3, sizeof(cl_mem), (void *)&dev_packed_data);
-
-         ezcl_enqueue_ndrange_kernel(command_queue, l7.kernel_pack_float_have_data,   1, NULL, &pack_global_work_size, &pack_local_work_size, NULL);
-
-         packed_float_data = (float *)malloc(num_indices_have*sizeof(float));
-         ezcl_enqueue_read_buffer(command_queue, dev_packed_data, CL_TRUE, 0, num_indices_have*sizeof(cl_float), &packed_float_data[0], NULL);
-
-         float_data_buffer = (float *)malloc((num_indices_owned+num_indices_needed)*sizeof(float));
-         for (unsigned int ii = 0; ii < num_indices_have; ii++){
-            float_data_buffer[l7_id_db->indices_have[ii]] = packed_float_data[ii];
-         }
-
-         free(packed_float_data);
-
-         ezcl_device_memory_delete(dev_packed_data);
-
-         /*
-          * Do the regular L7_Update across processor.
-          */
-
-         L7_Update (float_data_buffer, l7_datatype, l7_id);
-
-         dev_data_buffer_add    = ezcl_malloc(NULL, "dev_data_buffer_add",    &num_indices_needed,     sizeof(cl_float), CL_MEM_READ_WRITE, 0);
-         ezcl_enqueue_write_buffer(command_queue, dev_data_buffer_add, CL_TRUE,  0, num_indices_needed*sizeof(cl_float), &float_data_buffer[num_indices_owned],     NULL);
+         pack_kernel = l7.kernel_pack_float_have_data;
+         elsize = sizeof(cl_float);
+         break;
+      case L7_DOUBLE:
+         pack_kernel = l7.kernel_pack_double_have_data;
+         elsize = sizeof(cl_double);
+         break;
+      default:
+         return(L7_OK);
+   }
 
-         free(float_data_buffer);
+   /*
+    * The staging buffers are kept with the database from L7_Dev_Setup on
+    * and only grow if a wider type comes along.
+    */
 
-         // Fill in ghost
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_float_data, 0, sizeof(cl_int), &num_indices_owned);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_float_data, 1, sizeof(cl_int), (void *)&num_indices_needed);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_float_data, 2, sizeof(cl_mem), (void *)&dev_data_buffer);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_float_data, 3, sizeof(cl_mem), (void *)&dev_data_buffer_add);
+   ierr = l7p_dev_pool_reserve(l7_id_db, elsize);
+   L7_ASSERT(ierr == L7_OK, "Failed to allocate device update buffers", ierr);
 
-         ezcl_enqueue_ndrange_kernel(command_queue, l7.kernel_copy_ghost_float_data,   1, NULL, &ghost_global_work_size, &ghost_local_work_size, NULL);
+   int direct = (l7_id_db->ghost_offsets == NULL && l7_id_db->num_ghost_dups == 0);
 
-         ezcl_device_memory_delete(dev_data_buffer_add);
+   int num_sends = l7_id_db->num_sends;
+   int num_recvs = l7_id_db->num_recvs;
+   int tag = L7_UPDATE_P2P_TAG;   /* On nbr_state.comm, as in l7p_update_p2p. */
+   MPI_Request *recv_requests = l7_id_db->dev_requests;
+   MPI_Request *send_requests = &l7_id_db->dev_requests[num_recvs];
+   size_t offset, num_ghosts = 0;
 
-         break;
-      case L7_DOUBLE:
-         dev_packed_data = ezcl_malloc(NULL, "dev_packed_data", &num_indices_have, sizeof(cl_double), CL_MEM_READ_WRITE, 0);
+   double time_start = MPI_Wtime();
 
-         ezcl_set_kernel_arg(l7.kernel_pack_double_have_data, 0, sizeof(cl_int), (void *)&num_indices_have);
-         ezcl_set_kernel_arg(l7.kernel_pack_double_have_data, 1, sizeof(cl_mem), (void *)&l7_id_db->dev_indices_have);
-         ezcl_set_kernel_arg(l7.kernel_pack_double_have_data, 2, sizeof(cl_mem), (void *)&dev_data_buffer);
-         ezcl_set_kernel_arg(l7.kernel_pack_double_have_data, 3, sizeof(cl_mem), (void *)&dev_packed_data);
+   /*
+    * Post the receives first, each neighbor's ghosts into its block of
+    * the pinned ghost buffer, so they overlap the device pack and read.
+    */
 
-         ezcl_enqueue_ndrange_kernel(command_queue, l7.kernel_pack_double_have_data,   1, NULL, &pack_global_work_size, &pack_local_work_size, NULL);
+   if (direct){
+      offset = 0;
+      for (int i=0; i<num_recvs; i++){
+         ierr = MPI_Irecv((char *)l7_id_db->host_ghost_data + offset*elsize,
+               l7_id_db->recv_counts[i] * (int)elsize, MPI_BYTE,
+               l7_id_db->recv_from[i], tag, l7_id_db->nbr_state.comm, &recv_requests[i]);
+         L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Irecv", ierr);
+         offset += l7_id_db->recv_counts[i];
+      }
+      num_ghosts = offset;
+   }
 
-         packed_double_data = (double *)malloc(num_indices_have*sizeof(double));
-         ezcl_enqueue_read_buffer(command_queue, dev_packed_data, CL_TRUE, 0, num_indices_have*sizeof(cl_double), &packed_double_data[0], NULL);
+   /*
+    * Pull the data off the GPU and organize into regular array.
+    */
 
-         double_data_buffer = (double *)malloc((num_indices_owned+num_indices_needed)*sizeof(double));
-         for (unsigned int ii = 0; ii < num_indices_have; ii++){
-            double_data_buffer[l7_id_db->indices_have[ii]] = packed_double_data[ii];
-         }
+   size_t pack_local_work_size = 128;
+   size_t pack_global_work_size = ((num_indices_have + pack_local_work_size - 1) /pack_local_work_size) * pack_local_work_size;
 
-         free(packed_double_data);
+#ifdef _L7_DEBUG
+   printf("[pe %d] Packing OpenCL data onto device buffer.\n", l7.penum);
+#endif
+   ezcl_set_kernel_arg(pack_kernel, 0, sizeof(cl_int), (void *)&num_indices_have);
+   ezcl_set_kernel_arg(pack_kernel, 1, sizeof(cl_mem), (void *)&l7_id_db->dev_indices_have);
+   ezcl_set_kernel_arg(pack_kernel, 2, sizeof(cl_mem), (void *)&dev_data_buffer);
+   ezcl_set_kernel_arg(pack_kernel, 3, sizeof(cl_mem), (void *)&l7_id_db->dev_packed_data);
 
-         ezcl_device_memory_delete(dev_packed_data);
+   ezcl_enqueue_ndrange_kernel(command_queue, pack_kernel,   1, NULL, &pack_global_work_size, &pack_local_work_size, NULL);
 
-         /*
-          * Do the regular L7_Update across processor.
-          */
+   ezcl_enqueue_read_buffer(command_queue, l7_id_db->dev_packed_data, CL_TRUE, 0, num_indices_have*elsize, l7_id_db->host_packed_data, NULL);
 
-         L7_Update (double_data_buffer, l7_datatype, l7_id);
+   if (! direct)
+      return(dev_update_host(l7_id_db, dev_data_buffer, l7_datatype, elsize));
 
-         dev_data_buffer_add    = ezcl_malloc(NULL, "dev_data_buffer_add",    &num_indices_needed,     sizeof(cl_double), CL_MEM_READ_WRITE, 0);
-         ezcl_enqueue_write_buffer(command_queue, dev_data_buffer_add, CL_TRUE,  0, num_indices_needed*sizeof(cl_double), &double_data_buffer[num_indices_owned],     NULL);
+   /*
+    * The packed buffer is in send order, so each neighbor's data is one
+    * contiguous slice of it.
+    */
 
-         free(double_data_buffer);
+   offset = 0;
+   for (int i=0; i<num_sends; i++){
+      ierr = MPI_Isend((char *)l7_id_db->host_packed_data + offset*elsize,
+            l7_id_db->send_counts[i] * (int)elsize, MPI_BYTE,
+            l7_id_db->send_to[i], tag, l7_id_db->nbr_state.comm, &send_requests[i]);
+      L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Isend", ierr);
+      offset += l7_id_db->send_counts[i];
+   }
 
-         // Fill in ghost
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_double_data, 0, sizeof(cl_int), &num_indices_owned);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_double_data, 1, sizeof(cl_int), (void *)&num_indices_needed);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_double_data, 2, sizeof(cl_mem), (void *)&dev_data_buffer);
-         ezcl_set_kernel_arg(l7.kernel_copy_ghost_double_data, 3, sizeof(cl_mem), (void *)&dev_data_buffer_add);
+   ierr = MPI_Waitall(num_recvs + num_sends, l7_id_db->dev_requests, MPI_STATUSES_IGNORE);
+   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Waitall", ierr);
 
-         ezcl_enqueue_ndrange_kernel(command_queue, l7.kernel_copy_ghost_double_data,   1, NULL, &ghost_global_work_size, &ghost_local_work_size, NULL);
+   /*
+    * The ghost region follows the owned data, so it is written straight
+    * into place.
+    */
 
-         ezcl_device_memory_delete(dev_data_buffer_add);
+   if (num_ghosts > 0)
+      ezcl_enqueue_write_buffer(command_queue, dev_data_buffer, CL_TRUE, num_indices_owned*elsize,
+            num_ghosts*elsize, l7_id_db->host_ghost_data, NULL);
 
-         break;
-      default:
-         break;
-   }
+   l7_id_db->stats.num_updates++;
+   l7p_stats_record(&l7_id_db->stats, l7_id_db->nbr_bytes_sent,
+         l7_id_db->nbr_bytes_recvd, l7_id_db->send_counts,
+         l7_id_db->recv_counts, (int)elsize, MPI_Wtime() - time_start);
 
 #endif /* HAVE_MPI */
 
@@ -439,6 +585,12 @@ int L7_Get_Local_Indices(const int l7_id, int *local_indices)
       L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
    }
 
+   if (l7_id_db->num_sends > 0 && l7_id_db->indices_local_to_send == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db->indices_local_to_send != NULL,
+            "Send indices released by L7_Compact", ierr);
+   }
+
    //int num_indices = 0;
 
    int num_sends = l7_id_db->num_sends;
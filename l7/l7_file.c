@@ -0,0 +1,1236 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* symlink, fseeko */
+#endif
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_FILE"
+
+/*
+ * Parallel file I/O.
+ *
+ * Arrays are read and written at an explicit byte offset, disk_loc,
+ * that every process passes with the same value and that is advanced
+ * past the data on return. A distributed array is stored in rank order,
+ * each process's piece following those of the lower ranks, which is the
+ * L7 global numbering; a replicated array is stored once.
+ *
+ *   L7_ONE_PROC            pe 0 holds the file and does all the I/O; the
+ *                          other processes' pieces are relayed through it
+ *                          in rank order, receiving the next piece while
+ *                          writing the current one.
+ *   L7_BUFFERED_ONE_PROC   the same through a stdio stream buffered with
+ *                          L7_IO_BUFFER bytes.
+ *   L7_ALL_PROCS           every process opens the file with MPI-IO and
+ *                          writes or reads its own piece with one
+ *                          collective call at its offset, so the MPI
+ *                          library can aggregate the pieces.
+ *   L7_BUFFERED_ALL_PROCS  as L7_ALL_PROCS, but small writes are staged in
+ *                          a per-file buffer of L7_IO_BUFFER bytes and go
+ *                          to the file together, in a single collective
+ *                          call through an indexed file view, when the
+ *                          buffer would overflow, before a read or a write
+ *                          behind the staged data, and at close. Collective
+ *                          buffering hints are set on the file.
+ *
+ * Offsets of a distributed piece come from an MPI_Exscan of the piece
+ * sizes, or straight from the database's starting_indices in
+ * L7_File_Read_Id and L7_File_Write_Id. Every staging decision only
+ * depends on values that are the same on every process, so the
+ * collective calls always match up.
+ *
+ * Operations on names (L7_File_Inquire, L7_File_Size, L7_File_Link,
+ * L7_File_Unlink and L7_File_Symlink) are done by pe 0 and the result
+ * broadcast, whatever the pattern, to keep metadata traffic off the file
+ * system. Without MPI every process works on its own.
+ */
+
+#define FILE_CHUNK    (1LL << 30) /* Largest single transfer, bytes. */
+#define FILE_MIN_SEGS 64          /* Initial staged piece list. */
+#define FILE_STAGE_DIV 256        /* Only pieces of up to 1/256th of the
+                                     buffer are staged; bigger ones already
+                                     amortize a collective call. */
+
+struct file_layout
+{
+   long long
+     offset,                   /* Byte offset of this pe's piece.      */
+     total,                    /* Bytes stored by all pes together.    */
+     max_local;                /* Largest piece of any pe.             */
+};
+
+static int file_mode(
+      const char              *type,
+      int                     *readable,
+      int                     *writable,
+      int                     *truncate
+      )
+{
+   /*
+    * Decode an fopen style mode: r, w or a, optionally with + and b.
+    * Returns 0, or -1 for an unknown mode.
+    */
+
+   if (type == NULL)
+      return(-1);
+
+   *readable = (type[0] == 'r' || strchr(type, '+') != NULL);
+   *writable = (type[0] != 'r' || strchr(type, '+') != NULL);
+   *truncate = (type[0] == 'w');
+
+   if (type[0] != 'r' && type[0] != 'w' && type[0] != 'a')
+      return(-1);
+
+   return(0);
+}
+
+static long long file_local_rw(
+      struct l7_file_record   *rec,
+      const long long         disk_loc,
+      void                    *buf,
+      const long long         nbytes,
+      const int               writing
+      )
+{
+   /*
+    * Transfer nbytes at disk_loc in a file this process holds with a
+    * descriptor or a stream. Returns the bytes moved or -1.
+    */
+
+   if (l7p_fseek(rec->file_id, disk_loc) < 0)
+      return(-1);
+
+   if (nbytes == 0)
+      return(0);
+
+   if (rec->handler == L7_FILE_STREAM){
+      if (writing)
+         return((long long)fwrite(buf, 1, (size_t)nbytes, rec->file_handler.fstream));
+      return((long long)fread(buf, 1, (size_t)nbytes, rec->file_handler.fstream));
+   }
+
+   if (writing)
+      return(l7p_writefd(rec->file_handler.fd, buf, (size_t)nbytes));
+   return(l7p_readfd(rec->file_handler.fd, buf, (size_t)nbytes));
+}
+
+#ifdef HAVE_MPI
+
+static int file_layout_get(
+      const long long         nbytes,
+      const int               l7_data_pattern,
+      struct file_layout      *layout
+      )
+{
+   /*
+    * Place this process's piece: replicated data is pe 0's, distributed
+    * pieces follow in rank order.
+    */
+
+   long long
+     mine[2],
+     most[2];
+   int
+     ierr;
+
+   if (l7_data_pattern == L7_REPLICATED){
+      layout->offset    = 0;
+      layout->total     = nbytes;
+      layout->max_local = nbytes;
+      return(MPI_SUCCESS);
+   }
+
+   layout->offset = 0;
+   ierr = MPI_Exscan((void *)&nbytes, &layout->offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+   if (ierr != MPI_SUCCESS)
+      return(ierr);
+   if (l7.penum == 0)
+      layout->offset = 0;
+
+   /* The last rank's inclusive sum is the largest. */
+   mine[0] = layout->offset + nbytes;
+   mine[1] = nbytes;
+   ierr = l7p_allreduce(mine, most, 2, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+   layout->total     = most[0];
+   layout->max_local = most[1];
+
+   return(ierr);
+}
+
+static int file_mpi_collective(
+      struct l7_file_record   *rec,
+      const long long         disk_loc,
+      char                    *buf,
+      const long long         nbytes,
+      const long long         max_local,
+      const int               writing
+      )
+{
+   /*
+    * Collective transfer of each process's nbytes at disk_loc, in as
+    * many rounds of at most FILE_CHUNK bytes as the largest piece needs.
+    */
+
+   MPI_Status
+     status;
+   long long
+     done = 0,
+     len;
+   int
+     count,
+     ierr = MPI_SUCCESS,
+     err;
+
+   while (max_local > 0 && done < max_local){
+      len = nbytes - done;
+      if (len > FILE_CHUNK)
+         len = FILE_CHUNK;
+      if (len < 0)
+         len = 0;
+      if (writing)
+         err = MPI_File_write_at_all(rec->file_handler.mpi_fh, (MPI_Offset)(disk_loc + done),
+               buf + (len > 0 ? done : 0), (int)len, MPI_BYTE, &status);
+      else
+         err = MPI_File_read_at_all(rec->file_handler.mpi_fh, (MPI_Offset)(disk_loc + done),
+               buf + (len > 0 ? done : 0), (int)len, MPI_BYTE, &status);
+      if (err == MPI_SUCCESS && len > 0){
+         MPI_Get_count(&status, MPI_BYTE, &count);
+         if (count != (int)len)
+            err = MPI_ERR_IO;
+      }
+      if (err != MPI_SUCCESS)
+         ierr = err;
+      done += FILE_CHUNK;
+   }
+
+   return(ierr);
+}
+
+static int file_flush(
+      struct l7_file_record   *rec
+      )
+{
+   /*
+    * Write the staged pieces of a buffered MPI-IO file with one
+    * collective call through an indexed view of the file. Collective;
+    * a no-op on every process when nothing is staged anywhere.
+    */
+
+   MPI_Datatype
+     filetype = MPI_BYTE;
+   MPI_Aint
+     *displs;
+   MPI_Status
+     status;
+   int
+     i,
+     ierr,
+     err;
+
+   if (rec->stage_end == 0)
+      return(MPI_SUCCESS);
+
+   if (rec->num_segs > 0){
+      displs = (MPI_Aint *)malloc((size_t)rec->num_segs*sizeof(MPI_Aint));
+      if (displs == NULL)
+         return(MPI_ERR_NO_MEM);
+      for (i=0; i<rec->num_segs; i++)
+         displs[i] = (MPI_Aint)rec->seg_offset[i];
+      MPI_Type_create_hindexed(rec->num_segs, rec->seg_length, displs, MPI_BYTE, &filetype);
+      MPI_Type_commit(&filetype);
+      free(displs);
+   }
+
+   ierr = MPI_File_set_view(rec->file_handler.mpi_fh, 0, MPI_BYTE, filetype, "native", MPI_INFO_NULL);
+   err = MPI_File_write_at_all(rec->file_handler.mpi_fh, 0, rec->buffer,
+         (int)rec->buffer_used, MPI_BYTE, &status);
+   if (ierr == MPI_SUCCESS)
+      ierr = err;
+   err = MPI_File_set_view(rec->file_handler.mpi_fh, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL);
+   if (ierr == MPI_SUCCESS)
+      ierr = err;
+
+   if (filetype != MPI_BYTE)
+      MPI_Type_free(&filetype);
+
+   rec->buffer_used = 0;
+   rec->num_segs    = 0;
+   rec->stage_end   = 0;
+   rec->stage_max   = 0;
+
+   return(ierr);
+}
+
+static int file_stage(
+      struct l7_file_record   *rec,
+      const long long         disk_loc,
+      const void              *buf,
+      const long long         nbytes,
+      const struct file_layout *layout
+      )
+{
+   /*
+    * Add this process's piece of a write to the staging buffer, writing
+    * out what is staged first if the new piece would not fit on some
+    * process or lies before staged data. Large pieces are written
+    * directly. Collective.
+    *
+    * stage_end and the used bound below are the same on every process,
+    * so every process flushes and writes directly at the same calls.
+    * The bound is the sum of the largest pieces staged since the last
+    * flush, which no process's buffer_used can exceed.
+    */
+
+   long long
+     *offsets;
+   int
+     *lengths,
+     n,
+     ierr;
+
+   if (rec->stage_end > 0 &&
+       (disk_loc < rec->stage_end || rec->stage_max + layout->max_local > l7.io_buffer_size)){
+      ierr = file_flush(rec);
+      if (ierr != MPI_SUCCESS)
+         return(ierr);
+   }
+
+   if (layout->max_local > l7.io_buffer_size / FILE_STAGE_DIV)
+      return(file_mpi_collective(rec, disk_loc + layout->offset, (char *)buf, nbytes,
+               layout->max_local, 1));
+
+   if (rec->buffer == NULL){
+      rec->buffer = (char *)malloc((size_t)l7.io_buffer_size);
+      if (rec->buffer == NULL)
+         return(MPI_ERR_NO_MEM);
+   }
+
+   if (nbytes > 0){
+      n = rec->num_segs;
+      if (n > 0 && rec->seg_offset[n-1] + rec->seg_length[n-1] == disk_loc + layout->offset){
+         rec->seg_length[n-1] += (int)nbytes;
+      }
+      else {
+         if (n == rec->max_segs){
+            rec->max_segs = (n == 0) ? FILE_MIN_SEGS : 2*n;
+            offsets = (long long *)realloc(rec->seg_offset, (size_t)rec->max_segs*sizeof(long long));
+            if (offsets == NULL)
+               return(MPI_ERR_NO_MEM);
+            rec->seg_offset = offsets;
+            lengths = (int *)realloc(rec->seg_length, (size_t)rec->max_segs*sizeof(int));
+            if (lengths == NULL)
+               return(MPI_ERR_NO_MEM);
+            rec->seg_length = lengths;
+         }
+         rec->seg_offset[n] = disk_loc + layout->offset;
+         rec->seg_length[n] = (int)nbytes;
+         rec->num_segs++;
+      }
+      memcpy(rec->buffer + rec->buffer_used, buf, (size_t)nbytes);
+      rec->buffer_used += nbytes;
+   }
+
+   if (layout->total > 0){
+      rec->stage_max += layout->max_local;
+      rec->stage_end  = disk_loc + layout->total;
+   }
+
+   return(MPI_SUCCESS);
+}
+
+static int file_relay(
+      struct l7_file_record   *rec,
+      const long long         disk_loc,
+      char                    *buf,
+      const long long         nbytes,
+      long long               *total,
+      const int               writing
+      )
+{
+   /*
+    * Distributed transfer through pe 0, which holds the file. The pieces
+    * go in rank order in messages of at most min(L7_IO_BUFFER,
+    * FILE_CHUNK) bytes; pe 0 keeps the next message in flight while it
+    * does the I/O for the current one. pe 0 keeps the message sequence
+    * going after an I/O error, so nobody is left waiting, and returns
+    * the error.
+    */
+
+   MPI_Request
+     req[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+   long long
+     *counts,
+     mine,
+     chunk,
+     len,
+     done,
+     io = 0;
+   char
+     *stage[2] = { NULL, NULL };
+   int
+     pe, next_pe, k,
+     ierr = MPI_SUCCESS;
+
+   chunk = l7.io_buffer_size < FILE_CHUNK ? l7.io_buffer_size : FILE_CHUNK;
+   mine  = nbytes;
+
+   counts = (long long *)malloc((size_t)l7.numpes*sizeof(long long));
+   if (l7.penum == 0){
+      stage[0] = (char *)malloc((size_t)chunk);
+      stage[1] = (char *)malloc((size_t)chunk);
+   }
+   /* A negative count tells everybody to give up before any message. */
+   if (counts == NULL || (l7.penum == 0 && (stage[0] == NULL || stage[1] == NULL)))
+      mine = -1;
+   ierr = MPI_Allgather(&mine, 1, MPI_LONG_LONG, counts, 1, MPI_LONG_LONG, MPI_COMM_WORLD);
+
+   *total = 0;
+   for (pe=0; ierr == MPI_SUCCESS && pe<l7.numpes; pe++){
+      if (counts[pe] < 0)
+         ierr = MPI_ERR_NO_MEM;
+      *total += counts[pe];
+   }
+   if (ierr != MPI_SUCCESS){
+      free(stage[0]);
+      free(stage[1]);
+      free(counts);
+      return(ierr);
+   }
+
+   if (l7.penum != 0){
+      for (done = 0; done < nbytes; done += len){
+         len = nbytes - done < chunk ? nbytes - done : chunk;
+         if (writing)
+            MPI_Send(buf + done, (int)len, MPI_BYTE, 0, L7_FILE_RELAY_TAG, MPI_COMM_WORLD);
+         else
+            MPI_Recv(buf + done, (int)len, MPI_BYTE, 0, L7_FILE_RELAY_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+      }
+      free(counts);
+      return(MPI_SUCCESS);
+   }
+
+   io = file_local_rw(rec, disk_loc, buf, nbytes, writing);
+   if (io != nbytes)
+      ierr = MPI_ERR_IO;
+
+   for (pe=1; pe<l7.numpes && counts[pe] == 0; pe++);
+
+   k = 0;
+   done = 0;
+   if (writing && pe < l7.numpes){
+      len = counts[pe] < chunk ? counts[pe] : chunk;
+      MPI_Irecv(stage[k], (int)len, MPI_BYTE, pe, L7_FILE_RELAY_TAG, MPI_COMM_WORLD, &req[k]);
+   }
+
+   while (pe < l7.numpes){
+      len = counts[pe] - done < chunk ? counts[pe] - done : chunk;
+
+      /* Next message of the sequence. */
+      next_pe = pe;
+      done += len;
+      if (done == counts[pe]){
+         for (next_pe=pe+1; next_pe<l7.numpes && counts[next_pe] == 0; next_pe++);
+         done = 0;
+      }
+
+      if (writing){
+         MPI_Wait(&req[k], MPI_STATUS_IGNORE);
+         if (next_pe < l7.numpes){
+            MPI_Irecv(stage[1-k], (int)(counts[next_pe] - done < chunk ? counts[next_pe] - done : chunk),
+                  MPI_BYTE, next_pe, L7_FILE_RELAY_TAG, MPI_COMM_WORLD, &req[1-k]);
+         }
+         if (ierr == MPI_SUCCESS){
+            io = rec->handler == L7_FILE_STREAM ?
+               (long long)fwrite(stage[k], 1, (size_t)len, rec->file_handler.fstream) :
+               l7p_writefd(rec->file_handler.fd, stage[k], (size_t)len);
+            if (io != len)
+               ierr = MPI_ERR_IO;
+         }
+      }
+      else {
+         MPI_Wait(&req[k], MPI_STATUS_IGNORE);
+         if (ierr == MPI_SUCCESS){
+            io = rec->handler == L7_FILE_STREAM ?
+               (long long)fread(stage[k], 1, (size_t)len, rec->file_handler.fstream) :
+               l7p_readfd(rec->file_handler.fd, stage[k], (size_t)len);
+            if (io != len)
+               ierr = MPI_ERR_IO;
+         }
+         MPI_Isend(stage[k], (int)len, MPI_BYTE, pe, L7_FILE_RELAY_TAG, MPI_COMM_WORLD, &req[k]);
+      }
+
+      pe = next_pe;
+      k = 1-k;
+   }
+
+   MPI_Waitall(2, req, MPI_STATUSES_IGNORE);
+
+   free(stage[0]);
+   free(stage[1]);
+   free(counts);
+
+   return(ierr);
+}
+
+#endif /* HAVE_MPI */
+
+int L7_File_Open(
+      const char *fdesc,
+      const char *type,
+      const enum L7_DiskPatternType  l7_disk_pattern
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_File_Open opens a file on all processes for L7_File_Read and
+    * L7_File_Write.
+    *
+    * Arguments
+    * =========
+    * fdesc              (input) const char*
+    *                    File name.
+    * type               (input) const char*
+    *                    fopen style mode: "r", "w", "a", each optionally
+    *                    with "+"; "b" is accepted and ignored.
+    * l7_disk_pattern    (input) const enum L7_DiskPatternType
+    *                    Which processes do the I/O and whether it is
+    *                    buffered, see the top of this file.
+    *
+    * Return value
+    * ============
+    * A positive file handle, or a negative value on error, the same on
+    * every process.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over MPI_COMM_WORLD.
+    * 2) "w" truncates an existing file. Offsets are always explicit, so
+    *    "a" only means the file is not truncated.
+    *
+    */
+
+   union l7_file_handler
+     handler;
+   struct l7_file_record
+     *rec;
+   struct timeval
+     begin,
+     end;
+   int
+     readable,
+     writable,
+     truncate,
+     kind,
+     holder,
+     flags,
+     fid = -1,
+     ok = 0,
+     ierr;
+   char
+     mode[4];
+
+   gettimeofday(&begin, NULL);
+
+   if (l7_disk_pattern < L7_DISK_PATTERN_MIN || l7_disk_pattern > L7_DISK_PATTERN_MAX){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Invalid disk pattern", ierr);
+   }
+
+   if (fdesc == NULL || file_mode(type, &readable, &writable, &truncate) != 0){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Invalid file name or mode", ierr);
+   }
+
+   memset(&handler, 0, sizeof(handler));
+   kind = L7_FILE_FD;
+   if (l7_disk_pattern == L7_BUFFERED_ONE_PROC || l7_disk_pattern == L7_BUFFERED_ALL_PROCS)
+      kind = L7_FILE_STREAM;
+   holder = 1;
+
+#ifdef HAVE_MPI
+   if (l7.mpi_initialized){
+      if (l7_disk_pattern == L7_ALL_PROCS || l7_disk_pattern == L7_BUFFERED_ALL_PROCS){
+         MPI_Info
+           info = MPI_INFO_NULL;
+
+         kind = L7_FILE_MPI;
+         flags = readable && writable ? MPI_MODE_RDWR : (writable ? MPI_MODE_WRONLY : MPI_MODE_RDONLY);
+         if (writable)
+            flags |= MPI_MODE_CREATE;
+
+         if (l7_disk_pattern == L7_BUFFERED_ALL_PROCS){
+            MPI_Info_create(&info);
+            MPI_Info_set(info, "romio_cb_write", "enable");
+            MPI_Info_set(info, "romio_cb_read", "enable");
+         }
+
+         ierr = MPI_File_open(MPI_COMM_WORLD, (char *)fdesc, flags, info, &handler.mpi_fh);
+         ok = (ierr == MPI_SUCCESS);
+         if (ok && truncate){
+            ierr = MPI_File_set_size(handler.mpi_fh, 0);
+            if (ierr != MPI_SUCCESS){
+               MPI_File_close(&handler.mpi_fh);
+               ok = 0;
+            }
+         }
+         if (info != MPI_INFO_NULL)
+            MPI_Info_free(&info);
+      }
+      else {
+         holder = (l7.penum == 0);
+      }
+   }
+#endif
+
+   if (kind != L7_FILE_MPI && holder){
+      if (kind == L7_FILE_STREAM){
+         /* "a" must not truncate, but fopen "r+" needs an existing file. */
+         if (truncate)
+            strcpy(mode, readable ? "w+b" : "wb");
+         else if (!writable)
+            strcpy(mode, "rb");
+         else
+            strcpy(mode, access(fdesc, F_OK) == 0 ? "r+b" : "w+b");
+         handler.fstream = fopen(fdesc, mode);
+         ok = (handler.fstream != NULL);
+         if (ok)
+            setvbuf(handler.fstream, NULL, _IOFBF, (size_t)l7.io_buffer_size);
+      }
+      else {
+         flags = readable && writable ? O_RDWR : (writable ? O_WRONLY : O_RDONLY);
+         if (writable)
+            flags |= O_CREAT;
+         if (truncate)
+            flags |= O_TRUNC;
+         handler.fd = open(fdesc, flags, 0666);
+         ok = (handler.fd >= 0);
+      }
+   }
+
+#ifdef HAVE_MPI
+   if (l7.mpi_initialized && kind != L7_FILE_MPI)
+      l7p_bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+
+   if (ok){
+      fid = l7p_file_record_new(fdesc, l7_disk_pattern, handler);
+      rec = l7p_file_record_get(fid);
+      if (rec != NULL){
+         rec->handler = kind;
+         rec->is_open = holder;
+      }
+   }
+
+   gettimeofday(&end, NULL);
+   l7p_io_prof_vrecord(L7_IO_PROF_OPEN, begin, end, fid, l7_disk_pattern, 0, fid, fdesc);
+   l7p_io_prof_vfdrecord(fid, L7_IO_PROF_OPEN, fdesc, begin, end);
+
+   if (!ok){
+      ierr = -1;
+      L7_ASSERT(ok, "Cannot open file", ierr);
+   }
+
+   return(fid);
+
+} /* End L7_File_Open */
+
+int L7_File_Close(
+      const int fid
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_File_Close writes out any buffered data and closes a file.
+    *
+    * Arguments
+    * =========
+    * fid                (input) const int
+    *                    Handle from L7_File_Open.
+    *
+    * Return value
+    * ============
+    * Zero if successful, non-zero for error.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over MPI_COMM_WORLD.
+    *
+    */
+
+   struct l7_file_record
+     *rec;
+   struct timeval
+     begin,
+     end;
+   enum L7_DiskPatternType
+     pattern;
+   int
+     ok = 1,
+     ierr;
+
+   gettimeofday(&begin, NULL);
+
+   rec = l7p_file_record_get(fid);
+   if (rec == NULL){
+      ierr = -1;
+      L7_ASSERT(rec != NULL, "Unknown file handle", ierr);
+   }
+   pattern = rec->l7_disk_pattern;
+
+#ifdef HAVE_MPI
+   if (rec->handler == L7_FILE_MPI){
+      if (file_flush(rec) != MPI_SUCCESS)
+         ok = 0;
+      if (MPI_File_close(&rec->file_handler.mpi_fh) != MPI_SUCCESS)
+         ok = 0;
+   }
+#endif
+   if (rec->handler == L7_FILE_STREAM && rec->is_open){
+      if (fclose(rec->file_handler.fstream) != 0)
+         ok = 0;
+   }
+   if (rec->handler == L7_FILE_FD && rec->is_open){
+      if (close(rec->file_handler.fd) != 0)
+         ok = 0;
+   }
+
+#ifdef HAVE_MPI
+   if (l7.mpi_initialized && rec->handler != L7_FILE_MPI)
+      l7p_bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+
+   l7p_file_record_delete(fid);
+
+   gettimeofday(&end, NULL);
+   l7p_io_prof_vrecord(L7_IO_PROF_CLOSE, begin, end, fid, pattern, 0, !ok, NULL);
+   l7p_io_prof_vfdrecord(fid, L7_IO_PROF_CLOSE, NULL, begin, end);
+
+   if (!ok){
+      ierr = -1;
+      L7_ASSERT(ok, "Error closing file", ierr);
+   }
+
+   return(L7_OK);
+
+} /* End L7_File_Close */
+
+static int file_transfer(
+      const int                      fid,
+      long long                      *disk_loc,
+      void                           *buf,
+      const long long                nwords,
+      const enum L7_Datatype         l7_datatype,
+      const enum L7_DataPatternType  l7_data_pattern,
+      const int                      *starting_indices,
+      const int                      writing
+      )
+{
+   /*
+    * Common part of the reads and writes. starting_indices, if not
+    * NULL, is a database's [numpes+1] element prefix sum of owned
+    * counts, which gives the layout without communication.
+    */
+
+   struct l7_file_record
+     *rec;
+   struct timeval
+     begin,
+     end;
+   long long
+     nbytes,
+     moved;
+   int
+     size,
+     ierr = 0;
+
+   gettimeofday(&begin, NULL);
+
+   rec = l7p_file_record_get(fid);
+   if (rec == NULL){
+      ierr = -1;
+      L7_ASSERT(rec != NULL, "Unknown file handle", ierr);
+   }
+   if (disk_loc == NULL || nwords < 0 || (buf == NULL && nwords > 0)){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Invalid file location, buffer or count", ierr);
+   }
+   if (l7_data_pattern < L7_DATA_PATTERN_MIN || l7_data_pattern > L7_DATA_PATTERN_MAX){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Invalid data pattern", ierr);
+   }
+   size = l7p_sizeof(l7_datatype);
+   if (size <= 0){
+      ierr = -1;
+      L7_ASSERT(size > 0, "Invalid datatype", ierr);
+   }
+   nbytes = nwords * size;
+   moved  = nbytes;
+
+#ifdef HAVE_MPI
+   if (l7.mpi_initialized){
+      struct file_layout
+        layout;
+      long long
+        local = nbytes;
+      int
+        pe;
+
+      if (l7_data_pattern == L7_REPLICATED && l7.penum != 0)
+         local = 0;
+
+      if (rec->handler == L7_FILE_MPI){
+         if (starting_indices != NULL && l7_data_pattern == L7_DISTRIBUTED){
+            layout.offset    = (long long)starting_indices[l7.penum] * size;
+            layout.total     = (long long)starting_indices[l7.numpes] * size;
+            layout.max_local = 0;
+            for (pe=0; pe<l7.numpes; pe++){
+               if ((long long)(starting_indices[pe+1] - starting_indices[pe]) * size > layout.max_local)
+                  layout.max_local = (long long)(starting_indices[pe+1] - starting_indices[pe]) * size;
+            }
+         }
+         else {
+            ierr = file_layout_get(nbytes, l7_data_pattern, &layout);
+         }
+
+         if (ierr == MPI_SUCCESS){
+            if (writing && rec->l7_disk_pattern == L7_BUFFERED_ALL_PROCS){
+               ierr = file_stage(rec, *disk_loc, buf, local, &layout);
+            }
+            else {
+               if (rec->l7_disk_pattern == L7_BUFFERED_ALL_PROCS)
+                  ierr = file_flush(rec);
+               if (ierr == MPI_SUCCESS)
+                  ierr = file_mpi_collective(rec, *disk_loc + layout.offset, (char *)buf,
+                        local, layout.max_local, writing);
+            }
+         }
+         *disk_loc += layout.total;
+         moved = local;
+      }
+      else if (l7_data_pattern == L7_DISTRIBUTED){
+         ierr = file_relay(rec, *disk_loc, (char *)buf, nbytes, &layout.total, writing);
+         l7p_bcast(&ierr, 1, MPI_INT, 0, MPI_COMM_WORLD);
+         *disk_loc += layout.total;
+         moved = l7.penum == 0 ? layout.total : 0;
+      }
+      else {
+         if (l7.penum == 0 && file_local_rw(rec, *disk_loc, buf, nbytes, writing) != nbytes)
+            ierr = MPI_ERR_IO;
+         moved = local;
+         *disk_loc += nbytes;
+         l7p_bcast(&ierr, 1, MPI_INT, 0, MPI_COMM_WORLD);
+      }
+
+      /* Replicated reads: pe 0 read it, everybody gets a copy. */
+      if (!writing && l7_data_pattern == L7_REPLICATED){
+         long long
+           done,
+           len;
+         if (rec->handler == L7_FILE_MPI)
+            l7p_bcast(&ierr, 1, MPI_INT, 0, MPI_COMM_WORLD);
+         for (done = 0; ierr == MPI_SUCCESS && done < nbytes; done += len){
+            len = nbytes - done < FILE_CHUNK ? nbytes - done : FILE_CHUNK;
+            ierr = MPI_Bcast((char *)buf + done, (int)len, MPI_BYTE, 0, MPI_COMM_WORLD);
+         }
+      }
+   }
+   else
+#endif
+   {
+      if (file_local_rw(rec, *disk_loc, buf, nbytes, writing) != nbytes)
+         ierr = -1;
+      *disk_loc += nbytes;
+   }
+
+   gettimeofday(&end, NULL);
+   l7p_io_prof_vrecord(writing ? L7_IO_PROF_WRITE : L7_IO_PROF_READ, begin, end, fid,
+         rec->l7_disk_pattern, moved, l7_data_pattern, NULL);
+
+   if (ierr != 0){
+      L7_ASSERT(ierr == 0, writing ? "File write error" : "File read error", ierr);
+   }
+
+   return(L7_OK);
+}
+
+void L7_File_Read(
+      const int                      fid,
+      long long                      *disk_loc,
+      void                           *buf,
+      const long long                nwords,
+      const enum L7_Datatype         l7_datatype,
+      const enum L7_DataPatternType  l7_data_pattern
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_File_Read reads an array at byte offset *disk_loc.
+    *
+    * Arguments
+    * =========
+    * fid                (input) const int
+    *                    Handle from L7_File_Open.
+    * disk_loc           (input/output) long long*
+    *                    Byte offset of the array, the same on every
+    *                    process; advanced past the whole array.
+    * buf                (output) void*
+    *                    This process's nwords elements.
+    * nwords             (input) const long long
+    *                    Elements on this process; for replicated data the
+    *                    same on every process.
+    * l7_datatype        (input) const enum L7_Datatype
+    * l7_data_pattern    (input) const enum L7_DataPatternType
+    *                    L7_DISTRIBUTED: each process reads its own piece,
+    *                    pieces stored in rank order. L7_REPLICATED: every
+    *                    process gets the same nwords elements.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over MPI_COMM_WORLD. Errors are reported on stderr.
+    *
+    */
+
+   int
+     ierr;
+
+   ierr = file_transfer(fid, disk_loc, buf, nwords, l7_datatype, l7_data_pattern, NULL, 0);
+   L7_ASSERTN(ierr == L7_OK, "L7_File_Read", ierr);
+
+} /* End L7_File_Read */
+
+void L7_File_Write(
+      const int                      fid,
+      long long                      *disk_loc,
+      void                           *buf,
+      const long long                nwords,
+      const enum L7_Datatype         l7_datatype,
+      const enum L7_DataPatternType  l7_data_pattern
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_File_Write writes an array at byte offset *disk_loc.
+    *
+    * Arguments
+    * =========
+    * As L7_File_Read, with buf as input. Replicated data is taken from
+    * pe 0.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over MPI_COMM_WORLD. Errors are reported on stderr.
+    * 2) With L7_BUFFERED_ALL_PROCS the data may still be staged on
+    *    return; buf can be reused, but the file is only complete after
+    *    a read of the same file, L7_File_Close or L7_Terminate.
+    *
+    */
+
+   int
+     ierr;
+
+   ierr = file_transfer(fid, disk_loc, buf, nwords, l7_datatype, l7_data_pattern, NULL, 1);
+   L7_ASSERTN(ierr == L7_OK, "L7_File_Write", ierr);
+
+} /* End L7_File_Write */
+
+static int file_transfer_id(
+      const int               fid,
+      long long               *disk_loc,
+      void                    *buf,
+      const enum L7_Datatype  l7_datatype,
+      const int               l7_id,
+      const int               writing
+      )
+{
+   /*
+    * Reads and writes of the owned part of an update database's array.
+    */
+
+   int
+     ierr;
+
+#ifdef HAVE_MPI
+   l7_id_database
+     *l7_id_db;
+   const int
+     *starts;              /* Layout from the database, or NULL.  */
+   int
+     result,               /* MPI_Comm_compare of comm and world. */
+     use_starts;           /* All processes can use starts.       */
+
+   if (l7_id <= 0){
+      ierr = -1;
+      L7_ASSERT( l7_id > 0, "l7_id <= 0", ierr);
+   }
+
+   l7_id_db = l7p_set_database(l7_id);
+   if (l7_id_db == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
+   }
+
+   /*
+    * starting_indices is numbered in the database's communicator, so it
+    * only gives the file layout when that is MPI_COMM_WORLD in the same
+    * order and the database was not compacted. Otherwise the pieces are
+    * scanned; all processes must agree, since only the scan is collective.
+    */
+
+   starts = NULL;
+   if (l7.mpi_initialized){
+      use_starts = 0;
+      if (l7_id_db->starting_indices != NULL){
+         ierr = MPI_Comm_compare(l7_id_db->comm, MPI_COMM_WORLD, &result);
+         L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Comm_compare", ierr);
+         use_starts = (result == MPI_IDENT || result == MPI_CONGRUENT);
+      }
+      ierr = l7p_allreduce(MPI_IN_PLACE, &use_starts, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+      L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Allreduce", ierr);
+      if (use_starts)
+         starts = l7_id_db->starting_indices;
+   }
+
+   ierr = file_transfer(fid, disk_loc, buf, (long long)l7_id_db->num_indices_owned,
+         l7_datatype, L7_DISTRIBUTED, starts, writing);
+#else
+   (void)fid; (void)disk_loc; (void)buf; (void)l7_datatype; (void)l7_id; (void)writing;
+   ierr = -1;
+#endif
+
+   return(ierr);
+}
+
+int L7_File_Read_Id(
+      const int               fid,
+      long long               *disk_loc,
+      void                    *buf,
+      const enum L7_Datatype  l7_datatype,
+      const int               l7_id
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_File_Read_Id reads the owned part of an array laid out by
+    * update database l7_id, whose global index i is stored at element i
+    * of the array on disk.
+    *
+    * Arguments
+    * =========
+    * fid                (input) const int
+    *                    Handle from L7_File_Open.
+    * disk_loc           (input/output) long long*
+    *                    Byte offset of the array; advanced past it.
+    * buf                (output) void*
+    *                    num_indices_owned elements.
+    * l7_datatype        (input) const enum L7_Datatype
+    * l7_id              (input) const int
+    *                    Update database handle.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over MPI_COMM_WORLD. One small allreduce checks that
+    *    every process can take its offset from the database; the pieces
+    *    are scanned instead when the database is not on MPI_COMM_WORLD
+    *    or was compacted on any process.
+    *
+    */
+
+   return(file_transfer_id(fid, disk_loc, buf, l7_datatype, l7_id, 0));
+
+} /* End L7_File_Read_Id */
+
+int L7_File_Write_Id(
+      const int               fid,
+      long long               *disk_loc,
+      void                    *buf,
+      const enum L7_Datatype  l7_datatype,
+      const int               l7_id
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_File_Write_Id writes the owned part of an array laid out by
+    * update database l7_id; see L7_File_Read_Id.
+    *
+    */
+
+   return(file_transfer_id(fid, disk_loc, buf, l7_datatype, l7_id, 1));
+
+} /* End L7_File_Write_Id */
+
+static long long file_name_op(
+      const int                      func_idx,
+      const char                     *name,
+      const char                     *name2,
+      const enum L7_DiskPatternType  l7_disk_pattern
+      )
+{
+   /*
+    * Operations on names, done by pe 0 and broadcast.
+    */
+
+   struct stat
+     sb;
+   struct timeval
+     begin,
+     end;
+   long long
+     result = -1;
+
+   gettimeofday(&begin, NULL);
+
+   if (l7.penum == 0 || !l7.mpi_initialized){
+      switch (func_idx){
+         case L7_IO_PROF_INQUIRE:
+            result = (name != NULL && access(name, F_OK) == 0) ? 1 : 0;
+            break;
+         case L7_IO_PROF_FILESIZE:
+            result = (name != NULL && stat(name, &sb) == 0) ? (long long)sb.st_size : -1;
+            break;
+         case L7_IO_PROF_LINK:
+            result = (name != NULL && name2 != NULL && link(name, name2) == 0) ? 0 : -1;
+            break;
+         case L7_IO_PROF_SYMLINK:
+            result = (name != NULL && name2 != NULL && symlink(name, name2) == 0) ? 0 : -1;
+            break;
+         case L7_IO_PROF_UNLINK:
+            result = (name != NULL && unlink(name) == 0) ? 0 : -1;
+            break;
+      }
+   }
+
+#ifdef HAVE_MPI
+   if (l7.mpi_initialized)
+      l7p_bcast(&result, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+#endif
+
+   gettimeofday(&end, NULL);
+   l7p_io_prof_vrecord(func_idx, begin, end, 0, l7_disk_pattern, result, 0, name);
+
+   return(result);
+}
+
+int L7_File_Inquire(
+      const char                     *fildes,
+      const enum L7_DiskPatternType  l7_disk_pattern
+      )
+{
+   /*
+    * Returns 1 if file fildes exists, 0 if not. Collective.
+    */
+
+   return((int)file_name_op(L7_IO_PROF_INQUIRE, fildes, NULL, l7_disk_pattern));
+
+} /* End L7_File_Inquire */
+
+long long L7_File_Size(
+      const char *fildes,
+      const enum L7_DiskPatternType  l7_disk_pattern
+      )
+{
+   /*
+    * Returns the size of file fildes in bytes, or -1 if it cannot be
+    * examined. Collective.
+    */
+
+   return(file_name_op(L7_IO_PROF_FILESIZE, fildes, NULL, l7_disk_pattern));
+
+} /* End L7_File_Size */
+
+int L7_File_Link(
+      const char *oldname,
+      const char *newname,
+      const enum L7_DiskPatternType  l7_disk_pattern
+      )
+{
+   /*
+    * Makes newname a hard link to oldname. Returns 0, or -1 for error.
+    * Collective.
+    */
+
+   return((int)file_name_op(L7_IO_PROF_LINK, oldname, newname, l7_disk_pattern));
+
+} /* End L7_File_Link */
+
+int L7_File_Symlink(
+      const char *oldname,
+      const char *newname,
+      const enum L7_DiskPatternType  l7_disk_pattern
+      )
+{
+   /*
+    * Makes newname a symbolic link to oldname. Returns 0, or -1 for
+    * error. Collective.
+    */
+
+   return((int)file_name_op(L7_IO_PROF_SYMLINK, oldname, newname, l7_disk_pattern));
+
+} /* End L7_File_Symlink */
+
+int L7_File_Unlink(
+      const char *name,
+      const enum L7_DiskPatternType  l7_disk_pattern
+      )
+{
+   /*
+    * Removes file name. Returns 0, or -1 for error. Collective.
+    */
+
+   return((int)file_name_op(L7_IO_PROF_UNLINK, name, NULL, l7_disk_pattern));
+
+} /* End L7_File_Unlink */
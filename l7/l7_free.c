@@ -98,9 +98,6 @@ int L7_Free(
       return(0);
    }
 
-   ierr = MPI_Comm_rank(MPI_COMM_WORLD, &l7.penum);
-   L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_rank error", ierr);
-
    if (l7.initialized != 1){
       ierr = -1;
       L7_ASSERT( l7.initialized != 1, "L7 not initialized", ierr);
@@ -130,43 +127,27 @@ int L7_Free(
    }
 
    /*
-    * Free all data associated with this id.
+    * Unpublish the handle before anything is released.
     */
-   l7p_nbr_state_free(&l7_db->nbr_state);
-   L7P_Update_Type_Free(l7_db, &l7_db->nbr_state.update_datatypes[1]);
-   L7P_Update_Type_Free(l7_db, &l7_db->nbr_state.update_datatypes[2]);
-   L7P_Update_Type_Free(l7_db, &l7_db->nbr_state.update_datatypes[4]);
-   L7P_Update_Type_Free(l7_db, &l7_db->nbr_state.update_datatypes[8]);
-
-   if (l7_db->indices_needed)
-      free(l7_db->indices_needed);
-
-   if (l7_db->recv_from)
-      free(l7_db->recv_from);
-
-   if (l7_db->recv_counts)
-      free(l7_db->recv_counts);
 
-   if (l7_db->send_to)
-      free(l7_db->send_to);
+   __atomic_store_n(&l7.db_table[l7_db->l7_id], NULL, __ATOMIC_RELEASE);
 
-   if (l7_db->send_counts)
-      free(l7_db->send_counts);
-
-   if (l7_db->indices_global_to_send)
-      free(l7_db->indices_global_to_send);
+   /*
+    * Free all data associated with this id.
+    */
+   l7p_stats_accumulate(&l7.stats_freed, &l7_db->stats);
+   l7p_stats_nbr_free(&l7_db->stats, &l7_db->nbr_bytes_sent, &l7_db->nbr_bytes_recvd);
 
-   if (l7_db->indices_local_to_send)
-      free(l7_db->indices_local_to_send);
+   l7p_database_comm_free(l7_db);
+   l7p_batch_free_id(l7_db->l7_id);
 
-   if (l7_db->starting_indices)
-      free(l7_db->starting_indices);
+   l7p_database_arrays_reset(l7_db);
+   l7p_allocator_destroy(&l7_db->allocator);
 
-   if (l7_db->mpi_request)
-      free(l7_db->mpi_request);
+   l7p_gid_map_free(l7_db);
 
-   if (l7_db->mpi_status)
-      free(l7_db->mpi_status);
+   if (l7_db->check_sums)
+      free(l7_db->check_sums);
 
 #ifdef HAVE_OPENCL
    if (l7_db->indices_have)
@@ -174,6 +155,8 @@ int L7_Free(
 
    if (l7_db->dev_indices_have)
       ezcl_device_memory_delete(l7_db->dev_indices_have);
+
+   l7p_dev_pool_free(l7_db);
 #endif
 
    /*
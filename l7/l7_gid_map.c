@@ -0,0 +1,603 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_GID_MAP"
+
+/*
+ * Global id to local offset map.
+ *
+ * Owned indices and ghosts mostly come in runs of consecutive global
+ * ids stored at consecutive offsets: the owned range itself, and the
+ * block each neighbor sends. Runs of at least GID_MAP_MIN_RUN are kept
+ * sorted by first id and found by binary search; the scattered ghosts
+ * left over go into a small open-addressing hash table (global_ids and
+ * index_for_gid, linear probing, multiplicative hashing). Ghosts whose
+ * id appeared earlier in the ghost list are left out, so every id is
+ * in the map once, at its first occurrence, and runs never overlap.
+ */
+
+#ifdef HAVE_MPI
+
+#define GID_MAP_MIN_RUN  8
+#define GID_MAP_EMPTY    (-1)      /* Global ids are never negative. */
+#define GID_MAP_HASH(gid, shift) \
+   ((int)(((uint32_t)(gid) * 2654435761u) >> (shift)))
+
+/* Consecutive pairs (global id, offset); either side may be implicit. */
+struct gid_pairs {
+   int
+     n;
+   const int
+     *gids,                    /* NULL for gid_base + k                */
+     *locals;                  /* NULL for local_base + k              */
+   int
+     gid_base,
+     local_base;
+   const char
+     *skip;                    /* Nonzero for pairs left out, or NULL  */
+};
+
+#define PAIR_GID(p, k)   ((p)->gids   ? (p)->gids[k]   : (p)->gid_base   + (k))
+#define PAIR_LOCAL(p, k) ((p)->locals ? (p)->locals[k] : (p)->local_base + (k))
+
+static int gid_pos_compare(const void *a, const void *b)
+{
+   const int *pa = (const int *)a, *pb = (const int *)b;
+   if (pa[0] != pb[0])
+      return((pa[0] > pb[0]) - (pa[0] < pb[0]));
+   return((pa[1] > pb[1]) - (pa[1] < pb[1]));
+}
+
+static char *gid_repeats(
+      const int   *gids,
+      const int   n
+      )
+{
+   /*
+    * Flag every position whose gid appeared at an earlier position, or
+    * return NULL if memory runs out.
+    */
+
+   int
+     *pairs,
+     k;
+   char
+     *repeat;
+
+   pairs  = (int *)malloc(2*((size_t)n+1)*sizeof(int));
+   repeat = (char *)calloc((size_t)n+1, 1);
+   if (pairs == NULL || repeat == NULL){
+      free(pairs);
+      free(repeat);
+      return(NULL);
+   }
+
+   for (k=0; k<n; k++){
+      pairs[2*k]   = gids[k];
+      pairs[2*k+1] = k;
+   }
+   qsort(pairs, (size_t)n, 2*sizeof(int), gid_pos_compare);
+   for (k=1; k<n; k++){
+      if (pairs[2*k] == pairs[2*k-2])
+         repeat[pairs[2*k+1]] = 1;
+   }
+   free(pairs);
+
+   return(repeat);
+}
+
+static int run_compare(const void *a, const void *b)
+{
+   int ga = ((const struct l7_gid_run *)a)->gid;
+   int gb = ((const struct l7_gid_run *)b)->gid;
+   return((ga > gb) - (ga < gb));
+}
+
+static void gid_map_add(
+      l7_id_database          *l7_id_db,
+      const struct gid_pairs  *pairs,
+      int                     *num_runs,
+      int                     *num_scattered
+      )
+{
+   /*
+    * Split pairs into maximal runs. With l7_id_db->gid_runs NULL only
+    * count runs and scattered ids; otherwise store them.
+    */
+
+   int
+     h,
+     k,
+     len,
+     start;
+
+   for (start=0; start<pairs->n; start+=len){
+      len = 1;
+      if (pairs->skip && pairs->skip[start])
+         continue;
+      while (start+len < pairs->n &&
+             ! (pairs->skip && pairs->skip[start+len]) &&
+             PAIR_GID(pairs, start+len)   == PAIR_GID(pairs, start)   + len &&
+             PAIR_LOCAL(pairs, start+len) == PAIR_LOCAL(pairs, start) + len)
+         len++;
+
+      if (len >= GID_MAP_MIN_RUN){
+         if (l7_id_db->gid_runs){
+            l7_id_db->gid_runs[*num_runs].gid   = PAIR_GID(pairs, start);
+            l7_id_db->gid_runs[*num_runs].len   = len;
+            l7_id_db->gid_runs[*num_runs].local = PAIR_LOCAL(pairs, start);
+         }
+         (*num_runs)++;
+         continue;
+      }
+
+      if (l7_id_db->gid_runs){
+         for (k=start; k<start+len; k++){
+            h = GID_MAP_HASH(PAIR_GID(pairs, k), l7_id_db->gid_hash_shift);
+            while (l7_id_db->global_ids[h] != GID_MAP_EMPTY &&
+                   l7_id_db->global_ids[h] != PAIR_GID(pairs, k))
+               h = (h+1) & (l7_id_db->gid_hash_size-1);
+            if (l7_id_db->global_ids[h] == GID_MAP_EMPTY){
+               l7_id_db->global_ids[h]    = PAIR_GID(pairs, k);
+               l7_id_db->index_for_gid[h] = PAIR_LOCAL(pairs, k);
+            }
+         }
+      }
+      *num_scattered += len;
+   }
+}
+
+static inline int gid_map_find(
+      const l7_id_database  *l7_id_db,
+      const int             gid,
+      int                   *run_hint
+      )
+{
+   /*
+    * Offset of gid, or -1. *run_hint is the run the previous lookup hit
+    * and is tried first, since callers tend to look up neighbors.
+    */
+
+   const struct l7_gid_run
+     *runs = l7_id_db->gid_runs,
+     *run;
+   int
+     h,
+     hi,
+     lo,
+     mid;
+
+   if (gid < 0)
+      return(-1);
+
+   if (*run_hint < l7_id_db->num_gid_runs){
+      run = &runs[*run_hint];
+      if (gid >= run->gid && gid - run->gid < run->len)
+         return(run->local + gid - run->gid);
+   }
+
+   lo = 0;
+   hi = l7_id_db->num_gid_runs;
+   while (lo < hi){
+      mid = (lo + hi) / 2;
+      if (runs[mid].gid <= gid)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   if (lo > 0 && gid - runs[lo-1].gid < runs[lo-1].len){
+      *run_hint = lo - 1;
+      return(runs[lo-1].local + gid - runs[lo-1].gid);
+   }
+
+   if (l7_id_db->gid_hash_size == 0)
+      return(-1);
+
+   h = GID_MAP_HASH(gid, l7_id_db->gid_hash_shift);
+   while (l7_id_db->global_ids[h] != GID_MAP_EMPTY){
+      if (l7_id_db->global_ids[h] == gid)
+         return(l7_id_db->index_for_gid[h]);
+      h = (h+1) & (l7_id_db->gid_hash_size-1);
+   }
+
+   return(-1);
+}
+
+int l7p_gid_map_build(
+      l7_id_database  *l7_id_db,
+      const int       *owned_offsets,
+      const int       *ghost_gids
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_gid_map_build (re)builds the global id to local offset map of
+    * a database from its owned range and ghost list.
+    *
+    * Arguments
+    * =========
+    * l7_id_db        (input/output) l7_id_database*
+    *                 Database to build the map for.
+    *
+    * owned_offsets   (input) const int*
+    *                 Offsets of the owned indices (L7_Setup_Placed), or
+    *                 NULL for 0 .. num_indices_owned-1.
+    *
+    * ghost_gids      (input) const int*
+    *                 Global id of each of the num_indices_needed
+    *                 ghosts, placed by ghost_offsets or after the owned
+    *                 indices; NULL if ghost ids are not known.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    */
+
+   struct gid_pairs
+     owned,
+     ghosts;
+   char
+     *repeat = NULL;
+   int
+     ierr,
+     num_runs = 0,
+     num_scattered = 0,
+     size,
+     shift;
+
+   l7p_gid_map_free(l7_id_db);
+
+   owned.n          = l7_id_db->num_indices_owned;
+   owned.gids       = NULL;
+   owned.gid_base   = l7_id_db->my_start_index;
+   owned.locals     = owned_offsets;
+   owned.local_base = 0;
+   owned.skip       = NULL;
+
+   ghosts.n          = ghost_gids ? l7_id_db->num_indices_needed : 0;
+   ghosts.gids       = ghost_gids;
+   ghosts.gid_base   = 0;
+   ghosts.locals     = l7_id_db->ghost_offsets;
+   ghosts.local_base = l7_id_db->num_indices_owned;
+   ghosts.skip       = NULL;
+
+   if (ghosts.n > 0){
+      ghosts.skip = repeat = gid_repeats(ghost_gids, ghosts.n);
+      if (repeat == NULL){
+         ierr = -1;
+         L7_ASSERT( repeat != NULL, "Memory failure for global id map", ierr);
+      }
+   }
+
+   gid_map_add(l7_id_db, &owned,  &num_runs, &num_scattered);
+   gid_map_add(l7_id_db, &ghosts, &num_runs, &num_scattered);
+
+   /* Hash table at most half full. */
+
+   size  = 0;
+   shift = 32;
+   if (num_scattered > 0){
+      for (size = 2; size < 2*num_scattered; size *= 2)
+         shift--;
+      shift--;
+   }
+
+   l7_id_db->gid_runs = (struct l7_gid_run *)malloc(((size_t)num_runs+1)*sizeof(struct l7_gid_run));
+   if (size > 0){
+      l7_id_db->global_ids    = (int *)malloc((size_t)size*sizeof(int));
+      l7_id_db->index_for_gid = (int *)malloc((size_t)size*sizeof(int));
+   }
+   if (l7_id_db->gid_runs == NULL ||
+       (size > 0 && (l7_id_db->global_ids == NULL || l7_id_db->index_for_gid == NULL))){
+      l7p_gid_map_free(l7_id_db);
+      free(repeat);
+      ierr = -1;
+      L7_ASSERT( l7_id_db->gid_runs != NULL, "Memory failure for global id map", ierr);
+   }
+
+   for (int i=0; i<size; i++)
+      l7_id_db->global_ids[i] = GID_MAP_EMPTY;
+
+   l7_id_db->gid_hash_size  = size;
+   l7_id_db->gid_hash_shift = shift;
+
+   num_runs      = 0;
+   num_scattered = 0;
+   gid_map_add(l7_id_db, &owned,  &num_runs, &num_scattered);
+   gid_map_add(l7_id_db, &ghosts, &num_runs, &num_scattered);
+   l7_id_db->num_gid_runs = num_runs;
+   free(repeat);
+
+   qsort(l7_id_db->gid_runs, (size_t)num_runs, sizeof(struct l7_gid_run), run_compare);
+
+   return(L7_OK);
+
+} /* End l7p_gid_map_build */
+
+void l7p_gid_map_free(
+      l7_id_database  *l7_id_db
+      )
+{
+   free(l7_id_db->gid_runs);
+   free(l7_id_db->global_ids);
+   free(l7_id_db->index_for_gid);
+
+   l7_id_db->gid_runs       = NULL;
+   l7_id_db->global_ids     = NULL;
+   l7_id_db->index_for_gid  = NULL;
+   l7_id_db->num_gid_runs   = 0;
+   l7_id_db->gid_hash_size  = 0;
+   l7_id_db->gid_hash_shift = 0;
+}
+
+static l7_id_database *gid_map_database(
+      const int   l7_id
+      )
+{
+   /*
+    * Database of l7_id with its map built, or NULL after reporting why.
+    */
+
+   l7_id_database
+     *l7_id_db;
+   int
+     ierr;
+
+   if (l7_id <= 0){
+      ierr = -1;
+      L7_PRINT( l7_id > 0, "l7_id <= 0", ierr);
+      return(NULL);
+   }
+
+   l7_id_db = l7p_set_database(l7_id);
+   if (l7_id_db == NULL){
+      ierr = -1;
+      L7_PRINT(l7_id_db != NULL, "Failed to find database.", ierr);
+      return(NULL);
+   }
+
+   if (l7_id_db->gid_runs)
+      return(l7_id_db);
+
+   if (l7_id_db->owned_placed){
+      ierr = -1;
+      L7_PRINT(! l7_id_db->owned_placed,
+            "Placed owned indices are only mapped with L7_GID_MAP=1", ierr);
+      return(NULL);
+   }
+
+   if (l7_id_db->num_indices_needed > 0 && l7_id_db->indices_needed == NULL){
+      ierr = -1;
+      L7_PRINT(l7_id_db->indices_needed != NULL,
+            "Ghost global ids not kept (L7_Compact or L7_Setup_Known); set L7_GID_MAP=1", ierr);
+      return(NULL);
+   }
+
+   if (l7p_gid_map_build(l7_id_db, NULL, l7_id_db->indices_needed) != L7_OK)
+      return(NULL);
+
+   return(l7_id_db);
+}
+
+#endif /* HAVE_MPI */
+
+int L7_Gid_To_Local(
+      const int   l7_id,
+      const int   gid
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Gid_To_Local returns where a global index lives in the data
+    * arrays of an update database on this process.
+    *
+    * Arguments
+    * =========
+    * l7_id           (input) const int
+    *                 Handle to database.
+    *
+    * gid             (input) const int
+    *                 Global index, in the numbering given to L7_Setup.
+    *
+    * Return value
+    * ============
+    * Offset (0-based element) of gid in the data buffer, either an
+    * owned index or the ghost slot an update fills; -1 if gid is
+    * neither owned nor needed here, or on error.
+    *
+    * Notes:
+    * =====
+    * 1) Purely local. The map is built by setup when the environment
+    *    sets L7_GID_MAP=1, else by the first lookup; lookups from
+    *    several threads are safe once it exists.
+    * 2) Without L7_GID_MAP=1 the first lookup needs indices_needed, so
+    *    it fails after L7_Compact, for L7_Setup_Known databases (which
+    *    map owned indices only) and when owned indices were placed by
+    *    L7_Setup_Placed.
+    * 3) A global index needed more than once maps to the slot of its
+    *    first occurrence in the needed list.
+    * 4) Serial compilation returns gid.
+    *
+    */
+
+#if defined HAVE_MPI
+
+   l7_id_database
+     *l7_id_db;
+   int
+     run_hint = 0;
+
+   if (! l7.mpi_initialized){
+      return(gid);
+   }
+
+   l7_id_db = gid_map_database(l7_id);
+   if (l7_id_db == NULL){
+      return(-1);
+   }
+
+   return(gid_map_find(l7_id_db, gid, &run_hint));
+
+#else
+
+   (void)l7_id;
+   return(gid);
+
+#endif /* HAVE_MPI */
+
+} /* End L7_Gid_To_Local */
+
+int L7_Gid_To_Local_Batch(
+      const int   l7_id,
+      const int   count,
+      const int   *gids,
+      int         *locals
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Gid_To_Local_Batch translates an array of global indices as
+    * L7_Gid_To_Local does, looking up the database once.
+    *
+    * Arguments
+    * =========
+    * l7_id           (input) const int
+    *                 Handle to database.
+    *
+    * count           (input) const int
+    *                 Number of global indices.
+    *
+    * gids            (input) const int*
+    *                 Global indices.
+    *
+    * locals          (output) int*
+    *                 Offset of each, or -1 if not held on this process.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) See L7_Gid_To_Local. Each lookup first tries the run the
+    *    previous one hit, so gids in roughly ascending order, such as
+    *    neighbor lists built cell by cell, resolve without a search.
+    * 2) Threaded with OpenMP for large counts.
+    *
+    */
+
+   int
+     i,
+     ierr;
+
+   if (count < 0 || (count > 0 && (gids == NULL || locals == NULL))){
+      ierr = -1;
+      L7_ASSERT( count >= 0 && (count == 0 || (gids != NULL && locals != NULL)),
+            "Invalid gids or locals", ierr);
+   }
+
+#if defined HAVE_MPI
+
+   l7_id_database
+     *l7_id_db;
+
+   if (l7.mpi_initialized){
+      l7_id_db = gid_map_database(l7_id);
+      if (l7_id_db == NULL){
+         ierr = -1;
+         L7_ASSERT(l7_id_db != NULL, "No global id map", ierr);
+      }
+
+#ifdef _OPENMP
+#pragma omp parallel if (count >= 65536)
+#endif
+      {
+         int run_hint = 0;
+#ifdef _OPENMP
+#pragma omp for
+#endif
+         for (i=0; i<count; i++){
+            locals[i] = gid_map_find(l7_id_db, gids[i], &run_hint);
+         }
+      }
+
+      ierr = L7_OK;
+      return(ierr);
+   }
+
+#endif /* HAVE_MPI */
+
+   (void)l7_id;
+   for (i=0; i<count; i++){
+      locals[i] = gids[i];
+   }
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Gid_To_Local_Batch */
+
+void L7_GID_TO_LOCAL(
+      const int   *l7_id,
+      const int   *gid,
+      int         *local
+      )
+{
+   *local = L7_Gid_To_Local(*l7_id, *gid);
+}
+
+void L7_GID_TO_LOCAL_BATCH(
+      const int   *l7_id,
+      const int   *count,
+      const int   *gids,
+      int         *locals,
+      int         *ierr
+      )
+{
+   *ierr = L7_Gid_To_Local_Batch(*l7_id, *count, gids, locals);
+}
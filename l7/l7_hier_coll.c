@@ -0,0 +1,508 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_HIER_COLL"
+
+/*
+ * Node-hierarchical allreduce and broadcast.
+ *
+ * For messages of at most l7.hier_coll_max bytes, the ranks on a node
+ * exchange data through a shared-memory window and only one leader per
+ * node joins the inter-node collective:
+ *
+ *   1) every rank copies its contribution into its own slot of the
+ *      node window;
+ *   2) the node leader combines the slots with MPI_Reduce_local (or
+ *      picks up the broadcast root's slot) into the result area;
+ *   3) leaders run MPI_Allreduce/MPI_Bcast among themselves;
+ *   4) every rank copies the result back out.
+ *
+ * Two node barriers order each call: slots are only written before the
+ * first and read between the two, and the result area is only written
+ * between the two and read after the second. Larger messages are
+ * bandwidth bound and go straight to the flat MPI collective.
+ *
+ * The node and leader communicators and the window are built on first
+ * use of a communicator and cached on it as an attribute, so they are
+ * released when the communicator is freed or at L7_Terminate.
+ */
+
+#define HIER_ALIGN  64   /* Slot size rounding, one cache line. */
+
+#ifdef HAVE_MPI
+
+static int hier_delete(
+      MPI_Comm                comm,
+      int                     keyval,
+      void                    *attribute_val,
+      void                    *extra_state
+      )
+{
+   /*
+    * Attribute delete callback: free the node state of a communicator.
+    */
+
+   struct l7p_hier
+     *hier = (struct l7p_hier *)attribute_val,
+     **link;
+
+   (void)comm;
+   (void)keyval;
+   (void)extra_state;
+
+   for (link = &l7.first_hier; *link != NULL; link = &(*link)->next_hier){
+      if (*link == hier){
+         *link = hier->next_hier;
+         break;
+      }
+   }
+
+   MPI_Win_unlock_all(hier->win);
+   MPI_Win_free(&hier->win);
+   if (hier->leader_comm != MPI_COMM_NULL)
+      MPI_Comm_free(&hier->leader_comm);
+   MPI_Comm_free(&hier->node_comm);
+   free(hier->node_of);
+   free(hier);
+
+   return(MPI_SUCCESS);
+
+} /* End hier_delete */
+
+static struct l7p_hier *hier_create(
+      MPI_Comm                comm
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Split comm into node and leader communicators and allocate the
+    * node window with slots of l7.hier_coll_max bytes. Collective over
+    * comm; returns NULL on every rank if any rank cannot allocate.
+    */
+
+   struct l7p_hier
+     *hier;
+
+   int
+     rank,
+     size,
+     ok,
+     leader_rank,
+     node_max,
+     *node_count,
+     pair[2],
+     *pairs,
+     disp_unit,
+     i;
+
+   MPI_Aint
+     window_size;
+
+   void
+     *base;
+
+   MPI_Comm_rank(comm, &rank);
+   MPI_Comm_size(comm, &size);
+
+   hier = (struct l7p_hier *)calloc(1L, sizeof(struct l7p_hier));
+   hier->node_of = (int *)malloc(2*(size_t)size*sizeof(int));
+   pairs = (int *)malloc(2*(size_t)size*sizeof(int));
+   node_count = (int *)calloc((size_t)size, sizeof(int));
+
+   /*
+    * Agree before any other collective on comm, so that a rank short of
+    * memory sends every rank down the flat path instead of leaving the
+    * others waiting in the node split.
+    */
+
+   ok = (hier != NULL && hier->node_of != NULL && pairs != NULL && node_count != NULL);
+   MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, comm);
+   if (! ok){
+      free(hier != NULL ? hier->node_of : NULL);
+      free(hier);
+      free(pairs);
+      free(node_count);
+      return(NULL);
+   }
+   hier->node_rank_of = hier->node_of + size;
+
+   MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &hier->node_comm);
+   MPI_Comm_rank(hier->node_comm, &hier->node_rank);
+   MPI_Comm_size(hier->node_comm, &hier->node_size);
+
+   MPI_Comm_split(comm, hier->node_rank == 0 ? 0 : MPI_UNDEFINED, rank, &hier->leader_comm);
+   leader_rank = 0;
+   if (hier->leader_comm != MPI_COMM_NULL)
+      MPI_Comm_rank(hier->leader_comm, &leader_rank);
+   MPI_Bcast(&leader_rank, 1, MPI_INT, 0, hier->node_comm);
+
+   /*
+    * Every rank learns which node (leader rank) and node slot each rank
+    * of comm has, for broadcasts from an arbitrary root.
+    */
+
+   pair[0] = leader_rank;
+   pair[1] = hier->node_rank;
+   MPI_Allgather(pair, 2, MPI_INT, pairs, 2, MPI_INT, comm);
+   node_max = 0;
+   for (i=0; i<size; i++){
+      hier->node_of[i]      = pairs[2*i];
+      hier->node_rank_of[i] = pairs[2*i+1];
+      node_count[pairs[2*i]]++;
+      if (node_count[pairs[2*i]] > node_max)
+         node_max = node_count[pairs[2*i]];
+   }
+   free(pairs);
+   free(node_count);
+
+   /*
+    * With one rank per node everywhere, or a single node whose MPI
+    * already reduces through shared memory, the hierarchy only adds
+    * copies and barriers.
+    */
+
+   hier->enabled = (node_max > 1 && node_max < size);
+
+   hier->slot_bytes = (l7.hier_coll_max + HIER_ALIGN - 1) / HIER_ALIGN * HIER_ALIGN;
+   window_size = (hier->node_rank == 0) ?
+      (MPI_Aint)(hier->node_size + 1) * hier->slot_bytes : 0;
+   MPI_Win_allocate_shared(window_size, 1, MPI_INFO_NULL, hier->node_comm, &base, &hier->win);
+   MPI_Win_shared_query(hier->win, 0, &window_size, &disp_unit, &base);
+   hier->slots  = (char *)base;
+   hier->result = hier->slots + (size_t)hier->node_size * hier->slot_bytes;
+   MPI_Win_lock_all(MPI_MODE_NOCHECK, hier->win);
+
+   hier->comm = comm;
+   hier->next_hier = l7.first_hier;
+   l7.first_hier = hier;
+
+   return(hier);
+
+} /* End hier_create */
+
+static struct l7p_hier *hier_get(
+      MPI_Comm                comm,
+      const int               bytes
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Node state for comm if a message of bytes should go hierarchical,
+    * else NULL. Collective over comm: every rank must ask for the same
+    * size, which holds for allreduce and broadcast counts.
+    */
+
+   struct l7p_hier
+     *hier;
+
+   int
+     found;
+
+   if (l7.hier_coll_max <= 0 || bytes > l7.hier_coll_max || comm == MPI_COMM_NULL)
+      return(NULL);
+
+   if (l7.hier_keyval == MPI_KEYVAL_INVALID)
+      MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, hier_delete, &l7.hier_keyval, NULL);
+
+   MPI_Comm_get_attr(comm, l7.hier_keyval, &hier, &found);
+
+   /*
+    * L7_Set_Coll_Hierarchy raised the limit past this window; rebuild.
+    */
+
+   if (found && bytes > hier->slot_bytes){
+      MPI_Comm_delete_attr(comm, l7.hier_keyval);
+      found = 0;
+   }
+
+   if (! found){
+      hier = hier_create(comm);
+      if (hier == NULL)
+         return(NULL);
+      MPI_Comm_set_attr(comm, l7.hier_keyval, hier);
+   }
+
+   return(hier->enabled ? hier : NULL);
+
+} /* End hier_get */
+
+static int hier_contiguous(
+      MPI_Datatype            mpi_type,
+      const int               count,
+      int                     *bytes
+      )
+{
+   /*
+    * 1 if count items of mpi_type are a packed block of *bytes bytes, so
+    * they can be memcpy'd into and out of the window.
+    */
+
+   int
+     type_size;
+
+   MPI_Aint
+     lb,
+     extent;
+
+   MPI_Type_size(mpi_type, &type_size);
+   MPI_Type_get_extent(mpi_type, &lb, &extent);
+   *bytes = count * type_size;
+
+   return(lb == 0 && extent == (MPI_Aint)type_size && count >= 0);
+
+} /* End hier_contiguous */
+
+static void hier_node_sync(
+      struct l7p_hier         *hier
+      )
+{
+   /*
+    * Make this rank's window stores visible and see everyone else's.
+    */
+
+   MPI_Win_sync(hier->win);
+   MPI_Barrier(hier->node_comm);
+   MPI_Win_sync(hier->win);
+
+} /* End hier_node_sync */
+
+int l7p_allreduce(
+      const void              *sendbuf,
+      void                    *recvbuf,
+      const int               count,
+      MPI_Datatype            mpi_type,
+      MPI_Op                  op,
+      MPI_Comm                comm
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * MPI_Allreduce for the L7 reductions, taking the node-hierarchical
+    * path for messages up to l7.hier_coll_max bytes. op must be
+    * commutative; sendbuf may be MPI_IN_PLACE.
+    *
+    * Return value
+    * ============
+    * MPI error code.
+    */
+
+   struct l7p_hier
+     *hier;
+
+   const void
+     *src;
+
+   int
+     bytes,
+     r,
+     ierr;
+
+   if (! hier_contiguous(mpi_type, count, &bytes) ||
+       (hier = hier_get(comm, bytes)) == NULL)
+      return(MPI_Allreduce(sendbuf, recvbuf, count, mpi_type, op, comm));
+
+   src = (sendbuf == MPI_IN_PLACE) ? recvbuf : sendbuf;
+   memcpy(hier->slots + (size_t)hier->node_rank * hier->slot_bytes, src, (size_t)bytes);
+   hier_node_sync(hier);
+
+   ierr = MPI_SUCCESS;
+   if (hier->node_rank == 0){
+      memcpy(hier->result, hier->slots + (size_t)(hier->node_size-1) * hier->slot_bytes,
+            (size_t)bytes);
+      for (r = hier->node_size-2; r >= 0; r--){
+         MPI_Reduce_local(hier->slots + (size_t)r * hier->slot_bytes, hier->result,
+               count, mpi_type, op);
+      }
+      ierr = MPI_Allreduce(MPI_IN_PLACE, hier->result, count, mpi_type, op,
+            hier->leader_comm);
+   }
+   hier_node_sync(hier);
+
+   memcpy(recvbuf, hier->result, (size_t)bytes);
+
+   return(ierr);
+
+} /* End l7p_allreduce */
+
+int l7p_bcast(
+      void                    *buffer,
+      const int               count,
+      MPI_Datatype            mpi_type,
+      const int               root,
+      MPI_Comm                comm
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * MPI_Bcast for L7_Broadcast, taking the node-hierarchical path for
+    * messages up to l7.hier_coll_max bytes.
+    *
+    * Return value
+    * ============
+    * MPI error code.
+    */
+
+   struct l7p_hier
+     *hier;
+
+   int
+     rank,
+     bytes,
+     ierr;
+
+   if (! hier_contiguous(mpi_type, count, &bytes) ||
+       (hier = hier_get(comm, bytes)) == NULL)
+      return(MPI_Bcast(buffer, count, mpi_type, root, comm));
+
+   MPI_Comm_rank(comm, &rank);
+   if (rank == root)
+      memcpy(hier->slots + (size_t)hier->node_rank * hier->slot_bytes, buffer, (size_t)bytes);
+   hier_node_sync(hier);
+
+   ierr = MPI_SUCCESS;
+   if (hier->node_rank == 0){
+      if (hier->node_of[rank] == hier->node_of[root]){
+         memcpy(hier->result,
+               hier->slots + (size_t)hier->node_rank_of[root] * hier->slot_bytes,
+               (size_t)bytes);
+      }
+      ierr = MPI_Bcast(hier->result, count, mpi_type, hier->node_of[root],
+            hier->leader_comm);
+   }
+   hier_node_sync(hier);
+
+   if (rank != root)
+      memcpy(buffer, hier->result, (size_t)bytes);
+
+   return(ierr);
+
+} /* End l7p_bcast */
+
+#endif /* HAVE_MPI */
+
+void l7p_hier_coll_free(void)
+{
+   /*
+    * Release the node state of every communicator still holding one and
+    * the keyval (L7_Terminate, before MPI_Finalize).
+    */
+
+#ifdef HAVE_MPI
+   while (l7.first_hier != NULL)
+      MPI_Comm_delete_attr(l7.first_hier->comm, l7.hier_keyval);
+
+   if (l7.hier_keyval != MPI_KEYVAL_INVALID)
+      MPI_Comm_free_keyval(&l7.hier_keyval);
+   l7.hier_keyval = MPI_KEYVAL_INVALID;
+#endif
+
+} /* End l7p_hier_coll_free */
+
+int L7_Set_Coll_Hierarchy(
+      const int               max_bytes
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Set_Coll_Hierarchy sets the largest message, in bytes, that the
+    * L7 reductions and L7_Broadcast send through the node-hierarchical
+    * shared-memory path, overriding L7_COLL_HIER_MAX.
+    *
+    * Arguments
+    * =========
+    * max_bytes          (input) const int
+    *                    Messages of at most this many bytes reduce or
+    *                    broadcast within each node first and only node
+    *                    leaders communicate between nodes; larger ones
+    *                    use the flat MPI collective. 0 disables.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) All processes must set the same value, since it decides which
+    *    algorithm each collective runs.
+    * 2) A communicator's window is sized on its first hierarchical call
+    *    and regrown if the limit is later raised past it.
+    *
+    */
+
+   int
+     ierr;
+
+   if (max_bytes < 0){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Negative hierarchical collective size", ierr);
+   }
+
+   l7.hier_coll_max = max_bytes;
+
+   return(L7_OK);
+
+} /* End L7_Set_Coll_Hierarchy */
+
+int L7_Get_Coll_Hierarchy(void)
+{
+   /*
+    * Returns the hierarchical collective limit in bytes, 0 if disabled.
+    */
+
+   return(l7.hier_coll_max);
+}
+
+void l7_set_coll_hierarchy_(
+      const int               *max_bytes,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Set_Coll_Hierarchy(*max_bytes);
+}
@@ -0,0 +1,553 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <string.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_ICOLLECTIVES"
+
+/*
+ * Nonblocking versions of the L7 reductions and collectives.
+ *
+ * Each call starts the operation and returns a request handle that is
+ * completed by L7_Wait, L7_Waitall or a successful L7_Test, and driven
+ * by L7_Progress or the progress thread meanwhile, exactly like an
+ * L7_Iupdate. Scalar reductions go through the packed slots of
+ * L7_Reduce_Multi, so their outputs are written on completion; the
+ * array versions, L7_Ibroadcast and L7_Iallgather hand the caller's
+ * buffers straight to the MPI nonblocking collective, which must not
+ * be touched until then. When L7 is not running on MPI every call
+ * completes at once and returns L7_REQUEST_NULL.
+ */
+
+static int ireduce_scalar(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      const enum L7_ReduceOp  op,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   struct L7_Reduction
+     reduction;
+
+   reduction.input       = input;
+   reduction.count       = count;
+   reduction.l7_datatype = l7_datatype;
+   reduction.op          = op;
+   reduction.output      = output;
+
+   return(l7p_reduce_multi_post(&reduction, 1, comm, request));
+}
+
+static int icollective_post(
+      const int               kind,
+      void                    *input,
+      void                    *output,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      const MPI_Op            op,
+      const int               root_pe,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   /*
+    * Start an MPI nonblocking collective on the caller's buffers:
+    * kind 0 is MPI_Iallreduce, 1 MPI_Ibcast and 2 MPI_Iallgather.
+    */
+
+   int
+     ierr,
+     sizeof_type;
+
+   *request = L7_REQUEST_NULL;
+
+   if (l7.initialized != 1){
+      ierr = -1;
+      L7_ASSERT(l7.initialized == 1, "L7 not initialized", ierr);
+   }
+
+   if (count < 0 || (count > 0 && (input == NULL || (kind != 1 && output == NULL)))){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Invalid buffer or count", ierr);
+   }
+
+   sizeof_type = l7p_sizeof(l7_datatype);
+   if (sizeof_type <= 0){
+      ierr = -1;
+      L7_ASSERT(sizeof_type > 0, "Unsupported L7 datatype", ierr);
+   }
+
+#ifdef HAVE_MPI
+   if (l7.mpi_initialized){
+      struct l7_request
+        *req;
+      MPI_Datatype
+        mpi_type = l7p_mpi_type(l7_datatype);
+
+      *request = l7p_request_new();
+      if (*request == L7_REQUEST_NULL){
+         ierr = -1;
+         L7_ASSERT(ierr == 0, "Too many outstanding L7 requests", ierr);
+      }
+      req = &l7.requests[*request];
+
+      req->l7_id_db    = NULL;
+      req->data_buffer = NULL;
+      req->reductions  = NULL;
+      req->sizeof_type = sizeof_type;
+      req->time_start  = MPI_Wtime();
+
+      switch (kind){
+         case 0:
+            ierr = MPI_Iallreduce(input, output, count, mpi_type, op, comm,
+                  &req->mpi_request);
+            break;
+         case 1:
+            ierr = MPI_Ibcast(input, count, mpi_type, root_pe, comm,
+                  &req->mpi_request);
+            break;
+         default:
+            ierr = MPI_Iallgather(input, count, mpi_type, output, count,
+                  mpi_type, comm, &req->mpi_request);
+            break;
+      }
+      if (ierr != MPI_SUCCESS){
+         l7p_request_release(*request);
+         *request = L7_REQUEST_NULL;
+      }
+      L7_ASSERT(ierr == MPI_SUCCESS, "Failed to start nonblocking collective", ierr);
+
+      l7p_request_post(*request);
+      return(L7_OK);
+   }
+#else
+   (void)op;
+   (void)root_pe;
+   (void)comm;
+#endif
+
+   /* One process: an array reduction or allgather is a copy. */
+   if (kind != 1 && output != input && count > 0)
+      memcpy(output, input, (size_t)count*(size_t)sizeof_type);
+
+   ierr = L7_OK;
+   return(ierr);
+}
+
+int L7_Isum_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Isum_Comm starts L7_Sum_Comm; output is set by L7_Wait or a
+    * successful L7_Test on request. L7_Imax_Comm and L7_Imin_Comm are
+    * the same for L7_Max_Comm and L7_Min_Comm.
+    *
+    * Arguments
+    * =========
+    * input              (input) void*
+    *                    Local values; read before return.
+    *
+    * count              (input) const int
+    *                    Number of local values.
+    *
+    * l7_datatype        (input) const enum L7_Datatype
+    *                    Integer or floating point type of input and
+    *                    output.
+    *
+    * output             (output) void*
+    *                    Global result, valid on completion.
+    *
+    * comm               (input) MPI_Comm
+    *                    Communicator to reduce over.
+    *
+    * request            (output) int*
+    *                    Handle to pass to L7_Wait or L7_Test;
+    *                    L7_REQUEST_NULL if output is already set.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Several scalars needed at the same point are cheaper as one
+    *    L7_Ireduce_Multi than as separate calls.
+    * 2) Doubles are always added with the plain sum; L7_SUM_REPRODUCIBLE
+    *    (L7_Set_Sum_Mode) applies to the blocking L7_Sum only.
+    *
+    */
+
+   return(ireduce_scalar(input, count, l7_datatype, L7_REDUCE_SUM, output, comm, request));
+} /* End L7_Isum_Comm */
+
+int L7_Isum(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      )
+{
+   return(L7_Isum_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD, request));
+} /* End L7_Isum */
+
+int L7_Imax_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   return(ireduce_scalar(input, count, l7_datatype, L7_REDUCE_MAX, output, comm, request));
+} /* End L7_Imax_Comm */
+
+int L7_Imax(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      )
+{
+   return(L7_Imax_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD, request));
+} /* End L7_Imax */
+
+int L7_Imin_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   return(ireduce_scalar(input, count, l7_datatype, L7_REDUCE_MIN, output, comm, request));
+} /* End L7_Imin_Comm */
+
+int L7_Imin(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      )
+{
+   return(L7_Imin_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD, request));
+} /* End L7_Imin */
+
+int L7_Iarray_Sum_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Iarray_Sum_Comm starts L7_Array_Sum_Comm, the elementwise sum of
+    * input over all processes into output. L7_Iarray_Max_Comm and
+    * L7_Iarray_Min_Comm are the same for the maximum and minimum.
+    *
+    * Arguments
+    * =========
+    * input              (input) void*
+    *                    Local array of count values.
+    *
+    * count              (input) const int
+    *                    Array length.
+    *
+    * l7_datatype        (input) const enum L7_Datatype
+    *                    Type of input and output.
+    *
+    * output             (output) void*
+    *                    Global array of count values.
+    *
+    * comm               (input) MPI_Comm
+    *                    Communicator to reduce over.
+    *
+    * request            (output) int*
+    *                    Handle to pass to L7_Wait or L7_Test.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Neither input nor output may be accessed until completion.
+    *
+    */
+
+   return(icollective_post(0, input, output, count, l7_datatype, MPI_SUM, 0, comm, request));
+} /* End L7_Iarray_Sum_Comm */
+
+int L7_Iarray_Sum(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      )
+{
+   return(L7_Iarray_Sum_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD, request));
+} /* End L7_Iarray_Sum */
+
+int L7_Iarray_Max_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   return(icollective_post(0, input, output, count, l7_datatype, MPI_MAX, 0, comm, request));
+} /* End L7_Iarray_Max_Comm */
+
+int L7_Iarray_Max(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      )
+{
+   return(L7_Iarray_Max_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD, request));
+} /* End L7_Iarray_Max */
+
+int L7_Iarray_Min_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   return(icollective_post(0, input, output, count, l7_datatype, MPI_MIN, 0, comm, request));
+} /* End L7_Iarray_Min_Comm */
+
+int L7_Iarray_Min(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      int                     *request
+      )
+{
+   return(L7_Iarray_Min_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD, request));
+} /* End L7_Iarray_Min */
+
+int L7_Ibroadcast_Comm(
+      void                    *data_buffer,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      const int               root_pe,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Ibroadcast_Comm starts L7_Broadcast_Comm; data_buffer holds
+    * root_pe's data everywhere once request completes.
+    */
+
+   return(icollective_post(1, data_buffer, NULL, count, l7_datatype, MPI_OP_NULL,
+         root_pe, comm, request));
+} /* End L7_Ibroadcast_Comm */
+
+int L7_Ibroadcast(
+      void                    *data_buffer,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      const int               root_pe,
+      int                     *request
+      )
+{
+   return(L7_Ibroadcast_Comm(data_buffer, count, l7_datatype, root_pe, MPI_COMM_WORLD, request));
+} /* End L7_Ibroadcast */
+
+int L7_Iallgather_Comm(
+      void                    *local_buffer,
+      const int               count,
+      void                    *global_buffer,
+      const enum L7_Datatype  l7_datatype,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Iallgather_Comm starts L7_Allgather_Comm; global_buffer holds
+    * count values from each process, in rank order, once request
+    * completes.
+    */
+
+   return(icollective_post(2, local_buffer, global_buffer, count, l7_datatype,
+         MPI_OP_NULL, 0, comm, request));
+} /* End L7_Iallgather_Comm */
+
+int L7_Iallgather(
+      void                    *local_buffer,
+      const int               count,
+      void                    *global_buffer,
+      const enum L7_Datatype  l7_datatype,
+      int                     *request
+      )
+{
+   return(L7_Iallgather_Comm(local_buffer, count, global_buffer, l7_datatype, MPI_COMM_WORLD, request));
+} /* End L7_Iallgather */
+
+void l7_isum_(
+      void                    *input,
+      const int               *count,
+      const enum L7_Datatype  *l7_datatype,
+      void                    *output,
+      int                     *request,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Isum(input, *count, *l7_datatype, output, request);
+}
+
+void l7_imax_(
+      void                    *input,
+      const int               *count,
+      const enum L7_Datatype  *l7_datatype,
+      void                    *output,
+      int                     *request,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Imax(input, *count, *l7_datatype, output, request);
+}
+
+void l7_imin_(
+      void                    *input,
+      const int               *count,
+      const enum L7_Datatype  *l7_datatype,
+      void                    *output,
+      int                     *request,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Imin(input, *count, *l7_datatype, output, request);
+}
+
+void l7_iarray_sum_(
+      void                    *input,
+      const int               *count,
+      const enum L7_Datatype  *l7_datatype,
+      void                    *output,
+      int                     *request,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Iarray_Sum(input, *count, *l7_datatype, output, request);
+}
+
+void l7_iarray_max_(
+      void                    *input,
+      const int               *count,
+      const enum L7_Datatype  *l7_datatype,
+      void                    *output,
+      int                     *request,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Iarray_Max(input, *count, *l7_datatype, output, request);
+}
+
+void l7_iarray_min_(
+      void                    *input,
+      const int               *count,
+      const enum L7_Datatype  *l7_datatype,
+      void                    *output,
+      int                     *request,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Iarray_Min(input, *count, *l7_datatype, output, request);
+}
+
+void l7_ibroadcast_(
+      void                    *data_buffer,
+      const int               *count,
+      const enum L7_Datatype  *l7_datatype,
+      const int               *root_pe,
+      int                     *request,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Ibroadcast(data_buffer, *count, *l7_datatype, *root_pe, request);
+}
+
+void l7_iallgather_(
+      void                    *local_buffer,
+      const int               *count,
+      void                    *global_buffer,
+      const enum L7_Datatype  *l7_datatype,
+      int                     *request,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Iallgather(local_buffer, *count, global_buffer, *l7_datatype, request);
+}
@@ -47,6 +47,7 @@
 #include "l7.h"
 #include "l7p.h"
 #include <stdlib.h>
+#include <string.h>
 #include <dlfcn.h>
 
 #define L7_LOCATION "L7_INIT"
@@ -92,6 +93,9 @@ int L7_Init (
      * 1) If MPI has not been initialized when this subroutine is called,
      *    L7 will do so. In this case, L7 will also take responsibility for
      *    terminating MPI when L7_TERMINATE is called.
+     * 2) With the environment variable L7_THREAD_MULTIPLE=1 set, L7
+     *    initializes MPI with MPI_THREAD_MULTIPLE; L7_Get_Thread_Level
+     *    reports what the MPI library provided.
      *
      */
 
@@ -104,6 +108,7 @@ int L7_Init (
 #if defined(HAVE_MPI)
 
     int flag;    /* MPI_Initialized input. */
+    int required, provided; /* MPI_Init_thread support levels. */
 
     /*
      * Executable Statements
@@ -138,8 +143,20 @@ int L7_Init (
     L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Initialized", ierr );
 
     if ( !flag && *numpes != -1){
-        ierr = MPI_Init(argc, &argv);
-        L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Init", ierr);
+        /* L7_THREAD_MULTIPLE=1 asks for full thread support so that
+         * threads can update different databases concurrently. */
+        required = MPI_THREAD_SINGLE;
+        if (getenv("L7_THREAD_MULTIPLE") != NULL && atoi(getenv("L7_THREAD_MULTIPLE")) != 0)
+           required = MPI_THREAD_MULTIPLE;
+        /* So does the progress thread (L7_PROGRESS_THREAD=1). */
+        if (getenv("L7_PROGRESS_THREAD") != NULL && atoi(getenv("L7_PROGRESS_THREAD")) != 0)
+           required = MPI_THREAD_MULTIPLE;
+
+        ierr = MPI_Init_thread(argc, &argv, required, &provided);
+        L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Init_thread", ierr);
+        if (provided < required){
+           L7_PRINT( provided >= required, "MPI does not provide MPI_THREAD_MULTIPLE", -1);
+        }
 
           l7.initialized_mpi = 1;
           l7.mpi_initialized = 1;
@@ -149,6 +166,12 @@ int L7_Init (
        l7.mpi_initialized = 0;
     }
 
+    l7.thread_level = MPI_THREAD_SINGLE;
+    if (*numpes != -1) {
+        ierr = MPI_Query_thread(&l7.thread_level);
+        L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Query_thread", ierr );
+    }
+
     if (*numpes != -1) {
         ierr = MPI_Comm_rank (MPI_COMM_WORLD, &l7.penum );
         L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_rank", ierr );
@@ -165,13 +188,80 @@ int L7_Init (
         *numpes = 1;
     }
 
+   l7.update_check_interval = 0;
+   if (getenv("L7_UPDATE_CHECK") != NULL)
+      l7.update_check_interval = atoi(getenv("L7_UPDATE_CHECK"));
+
+   l7.compact_level = L7_COMPACT_NONE;
+   if (getenv("L7_COMPACT") != NULL)
+      l7.compact_level = atoi(getenv("L7_COMPACT"));
+
+   l7.update_method = L7_UPDATE_NEIGHBOR;
+   if (getenv("L7_UPDATE_METHOD") != NULL && strcmp(getenv("L7_UPDATE_METHOD"), "p2p") == 0)
+      l7.update_method = L7_UPDATE_P2P;
+
+   l7.send_order = L7_SEND_ORDER_RANK;
+   if (getenv("L7_SEND_ORDER") != NULL){
+      if (strcmp(getenv("L7_SEND_ORDER"), "rotate") == 0)
+         l7.send_order = L7_SEND_ORDER_ROTATE;
+      else if (strcmp(getenv("L7_SEND_ORDER"), "size") == 0)
+         l7.send_order = L7_SEND_ORDER_SIZE;
+   }
+
+   l7.max_in_flight = 0;
+   if (getenv("L7_MAX_IN_FLIGHT") != NULL && atoi(getenv("L7_MAX_IN_FLIGHT")) > 0)
+      l7.max_in_flight = atoi(getenv("L7_MAX_IN_FLIGHT"));
+
+   l7p_allocator_default(&l7.allocator);
+
+   l7.gid_map = 0;
+   if (getenv("L7_GID_MAP") != NULL && atoi(getenv("L7_GID_MAP")) != 0)
+      l7.gid_map = 1;
+
+   l7.sum_mode = L7_SUM_FAST;
+   if (getenv("L7_SUM_MODE") != NULL && strcmp(getenv("L7_SUM_MODE"), "reproducible") == 0)
+      l7.sum_mode = L7_SUM_REPRODUCIBLE;
+
+   l7.hier_coll_max = 0;
+   if (getenv("L7_COLL_HIER_MAX") != NULL && atoi(getenv("L7_COLL_HIER_MAX")) > 0)
+      l7.hier_coll_max = atoi(getenv("L7_COLL_HIER_MAX"));
+   l7.hier_keyval = MPI_KEYVAL_INVALID;
+   l7.first_hier  = NULL;
+   l7.loc_keyval  = MPI_KEYVAL_INVALID;
+
+   l7.io_buffer_size = 16LL << 20;
+   if (getenv("L7_IO_BUFFER") != NULL && atoll(getenv("L7_IO_BUFFER")) > 0){
+      l7.io_buffer_size = atoll(getenv("L7_IO_BUFFER"));
+      if (l7.io_buffer_size < 4096)
+         l7.io_buffer_size = 4096;
+      if (l7.io_buffer_size > (1LL << 30))
+         l7.io_buffer_size = 1LL << 30;
+   }
+   l7.first_file   = NULL;
+   l7.next_file_id = 1;
+   if (getenv("L7_IO_PROFILE") != NULL && strcmp(getenv("L7_IO_PROFILE"), "verbose") == 0)
+      l7p_io_prof_init(L7_IO_PROF_VERBOSE);
+   else if (getenv("L7_IO_PROFILE") != NULL && strcmp(getenv("L7_IO_PROFILE"), "simple") == 0)
+      l7p_io_prof_init(L7_IO_PROF_SIMPLE);
+   else
+      l7p_io_prof_init(L7_IO_PROF_OFF);
+
+   l7p_mem_init();
+
    l7.sizeof_workspace = 0;
 
    l7.sizeof_send_buffer = 2 * *numpes * sizeof(int);
-   l7.send_buffer = (void *)calloc(2 * *numpes, sizeof(int));
+   l7.send_buffer = L7_Mem_Alloc((size_t)(2 * *numpes) * sizeof(int));
 
    l7.initialized = 1;
 
+   if (l7.mpi_initialized){
+      l7p_reduce_multi_init();
+      l7p_repro_sum_init();
+      l7p_loc_init();
+      l7p_progress_start();
+   }
+
 #ifdef HAVE_QUO
    if (do_quo_setup) {
       // init QUO -- all MPI processes MUST do this at the same time.
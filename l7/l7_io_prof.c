@@ -0,0 +1,526 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* struct timespec */
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_IO_PROF"
+
+/*
+ * I/O profiling for L7_File_*.
+ *
+ * L7_IO_PROF_SIMPLE keeps a call count, the time and the bytes moved for
+ * each function; L7_Terminate prints them summed over processes, with
+ * the slowest process's time and the aggregate bandwidth it implies.
+ * L7_IO_PROF_VERBOSE also logs every call with its file, offset and
+ * size, and every process prints its log in rank order at the end.
+ * The level comes from L7_IO_PROFILE (off, simple, verbose) or
+ * L7_Set_IO_Profiling.
+ */
+
+static const char *io_prof_names[L7_MAX_FILE_FUNC_CALLS] = {
+   "L7_File_Open", "L7_File_Close", "L7_File_Read", "L7_File_Write",
+   "Seek", "Tell", "L7_File_Size", "L7_File_Inquire", "L7_File_Link",
+   "L7_File_Unlink", "L7_File_Symlink"
+};
+
+static struct simple_timing
+  io_simple[L7_MAX_FILE_FUNC_CALLS];
+static long long
+  io_bytes[L7_MAX_FILE_FUNC_CALLS];
+static struct verbose_timing
+  *io_first = NULL,
+  *io_last = NULL;
+static struct verbose_fd
+  *io_first_fd = NULL;
+static struct timeval
+  io_t0;
+
+static double tv_seconds(
+      const struct timeval    begin,
+      const struct timeval    end
+      )
+{
+   return((double)(end.tv_sec - begin.tv_sec) + 1.0e-6*(double)(end.tv_usec - begin.tv_usec));
+}
+
+static struct timespec tv_to_ts(
+      const struct timeval    tv
+      )
+{
+   struct timespec
+     ts;
+
+   ts.tv_sec  = tv.tv_sec;
+   ts.tv_nsec = (long)tv.tv_usec * 1000L;
+   return(ts);
+}
+
+static int ts_before(
+      const struct timespec   a,
+      const struct timespec   b
+      )
+{
+   /* 1 if a is no later than b. */
+   return(a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec <= b.tv_nsec));
+}
+
+static double ts_since_t0(
+      const struct timespec   ts
+      )
+{
+   return((double)(ts.tv_sec - io_t0.tv_sec) + 1.0e-9*(double)ts.tv_nsec - 1.0e-6*(double)io_t0.tv_usec);
+}
+
+static void io_prof_clear(void)
+{
+   struct verbose_timing
+     *cur;
+   struct verbose_fd
+     *fd;
+
+   while (io_first != NULL){
+      cur = io_first;
+      io_first = cur->next;
+      free(cur->var_string);
+      free(cur);
+   }
+   io_last = NULL;
+
+   while (io_first_fd != NULL){
+      fd = io_first_fd;
+      io_first_fd = fd->next;
+      free(fd->file_name);
+      free(fd);
+   }
+
+   memset(io_simple, 0, sizeof(io_simple));
+   memset(io_bytes, 0, sizeof(io_bytes));
+}
+
+void l7p_io_prof_init(
+      const int new_io_profiling_level
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_io_prof_init discards any collected timings and starts
+    * profiling at the given level.
+    *
+    * Arguments
+    * =========
+    * new_io_profiling_level  (input) const int
+    *                         enum L7_IO_ProfilingLevel; out of range
+    *                         values turn profiling off.
+    *
+    */
+
+   io_prof_clear();
+
+   l7.io_profiling_level = new_io_profiling_level;
+   if (new_io_profiling_level < L7_IO_PROF_LEVEL_MIN ||
+       new_io_profiling_level > L7_IO_PROF_LEVEL_MAX)
+      l7.io_profiling_level = L7_IO_PROF_OFF;
+
+   gettimeofday(&io_t0, NULL);
+
+} /* End l7p_io_prof_init */
+
+void l7p_io_prof_record(
+      const int            fname_index,
+      const struct timeval begin_tv,
+      const struct timeval end_tv
+      )
+{
+   /*
+    * Add one call of function fname_index to the simple totals.
+    */
+
+   if (l7.io_profiling_level == L7_IO_PROF_OFF ||
+       fname_index < L7_MIN_FILE_FUNC_CALLS || fname_index >= L7_MAX_FILE_FUNC_CALLS)
+      return;
+
+   io_simple[fname_index].num_calls++;
+   io_simple[fname_index].total_time += tv_seconds(begin_tv, end_tv);
+
+} /* End l7p_io_prof_record */
+
+void l7p_io_prof_vrecord(
+      const int                      fname_index,
+      const struct timeval           begin_tv,
+      const struct timeval           end_tv,
+      const int                      file_id,
+      const enum L7_DiskPatternType  l7_disk_pattern,
+      const long long                var_long,
+      const int                      var_int,
+      const char                     *var_string
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_io_prof_vrecord records one call: the simple totals always,
+    * and at L7_IO_PROF_VERBOSE a log entry as well.
+    *
+    * Arguments
+    * =========
+    * fname_index        (input) L7_IO_PROF_OPEN ... L7_IO_PROF_SYMLINK.
+    * begin_tv, end_tv   (input) Call entry and exit times.
+    * file_id            (input) File handle, 0 for calls by name.
+    * l7_disk_pattern    (input) Disk pattern of the call.
+    * var_long           (input) Bytes moved by this process for reads
+    *                    and writes, otherwise a call specific value.
+    * var_int            (input) Data pattern of reads and writes,
+    *                    otherwise the call's return value.
+    * var_string         (input) File name for calls by name, or NULL.
+    *
+    */
+
+   struct verbose_timing
+     *cur;
+
+   l7p_io_prof_record(fname_index, begin_tv, end_tv);
+
+   if (l7.io_profiling_level == L7_IO_PROF_OFF ||
+       fname_index < L7_MIN_FILE_FUNC_CALLS || fname_index >= L7_MAX_FILE_FUNC_CALLS)
+      return;
+
+   if (fname_index == L7_IO_PROF_READ || fname_index == L7_IO_PROF_WRITE)
+      io_bytes[fname_index] += var_long;
+
+   if (l7.io_profiling_level != L7_IO_PROF_VERBOSE)
+      return;
+
+   cur = (struct verbose_timing *)calloc(1, sizeof(struct verbose_timing));
+   if (cur == NULL)
+      return;
+
+   cur->fname_index     = fname_index;
+   cur->file_id         = file_id;
+   cur->time_in         = tv_to_ts(begin_tv);
+   cur->time_out        = tv_to_ts(end_tv);
+   cur->l7_disk_pattern = l7_disk_pattern;
+   cur->var_long        = var_long;
+   cur->var_int         = var_int;
+   if (var_string != NULL){
+      cur->var_string = (char *)malloc(strlen(var_string)+1);
+      if (cur->var_string != NULL)
+         strcpy(cur->var_string, var_string);
+   }
+
+   if (io_last != NULL)
+      io_last->next = cur;
+   else
+      io_first = cur;
+   io_last = cur;
+
+} /* End l7p_io_prof_vrecord */
+
+void l7p_io_prof_vfdrecord(
+      const int            file_id,
+      const int            func_idx,
+      const char           *file_name,
+      const struct timeval begin,
+      const struct timeval end
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_io_prof_vfdrecord remembers which file name a handle stood for
+    * between its open and its close, so that the verbose log can name
+    * the file of each call even after the handle has been reused.
+    *
+    * Arguments
+    * =========
+    * file_id            (input) File handle.
+    * func_idx           (input) L7_IO_PROF_OPEN or L7_IO_PROF_CLOSE.
+    * file_name          (input) Name, for L7_IO_PROF_OPEN.
+    * begin, end         (input) Times of the open or close call.
+    *
+    */
+
+   struct verbose_fd
+     *fd;
+
+   (void)begin;
+
+   if (l7.io_profiling_level != L7_IO_PROF_VERBOSE)
+      return;
+
+   if (func_idx == L7_IO_PROF_OPEN){
+      fd = (struct verbose_fd *)calloc(1, sizeof(struct verbose_fd));
+      if (fd == NULL)
+         return;
+      fd->file_id = file_id;
+      fd->file_name = (char *)malloc(strlen(file_name)+1);
+      if (fd->file_name != NULL)
+         strcpy(fd->file_name, file_name);
+      fd->valid_start = tv_to_ts(end);
+      fd->next = io_first_fd;
+      io_first_fd = fd;
+   }
+   else if (func_idx == L7_IO_PROF_CLOSE){
+      for (fd = io_first_fd; fd != NULL; fd = fd->next){
+         if (fd->file_id == file_id && fd->valid_end.tv_sec == 0 && fd->valid_end.tv_nsec == 0){
+            fd->valid_end = tv_to_ts(end);
+            break;
+         }
+      }
+   }
+
+} /* End l7p_io_prof_vfdrecord */
+
+char *l7p_io_prof_get_filename(
+      const struct verbose_timing *cur
+      )
+{
+   /*
+    * The file name a logged call used, or its own name argument for
+    * calls by name, or NULL if unknown.
+    */
+
+   struct verbose_fd
+     *fd;
+
+   if (cur->var_string != NULL)
+      return(cur->var_string);
+
+   for (fd = io_first_fd; fd != NULL; fd = fd->next){
+      if (fd->file_id != cur->file_id)
+         continue;
+      if (!ts_before(fd->valid_start, cur->time_out))
+         continue;
+      if ((fd->valid_end.tv_sec != 0 || fd->valid_end.tv_nsec != 0) &&
+          !ts_before(cur->time_in, fd->valid_end))
+         continue;
+      return(fd->file_name);
+   }
+
+   return(NULL);
+
+} /* End l7p_io_prof_get_filename */
+
+void l7p_io_prof_vfdprint(void)
+{
+   /*
+    * List this process's file handles and when each was open.
+    */
+
+   struct verbose_fd
+     *fd;
+
+   for (fd = io_first_fd; fd != NULL; fd = fd->next){
+      if (fd->valid_end.tv_sec == 0 && fd->valid_end.tv_nsec == 0){
+         printf("  [pe %d] file %d %s open from %.6f\n", l7.penum, fd->file_id,
+               fd->file_name ? fd->file_name : "?", ts_since_t0(fd->valid_start));
+      }
+      else {
+         printf("  [pe %d] file %d %s open from %.6f to %.6f\n", l7.penum, fd->file_id,
+               fd->file_name ? fd->file_name : "?", ts_since_t0(fd->valid_start),
+               ts_since_t0(fd->valid_end));
+      }
+   }
+
+} /* End l7p_io_prof_vfdprint */
+
+void l7p_io_prof_print_timings(void)
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_io_prof_print_timings prints the profile. Called by every
+    * process: the totals are reduced to pe 0, and in verbose mode each
+    * process prints its log in turn.
+    *
+    */
+
+   double
+     time_local[L7_MAX_FILE_FUNC_CALLS],
+     time_max[L7_MAX_FILE_FUNC_CALLS],
+     time_sum[L7_MAX_FILE_FUNC_CALLS],
+     mbytes;
+   long long
+     count_local[2*L7_MAX_FILE_FUNC_CALLS],
+     count_sum[2*L7_MAX_FILE_FUNC_CALLS];
+   int
+     i,
+     pe;
+   struct verbose_timing
+     *cur;
+   const char
+     *name;
+
+   if (l7.io_profiling_level == L7_IO_PROF_OFF)
+      return;
+
+   for (i=0; i<L7_MAX_FILE_FUNC_CALLS; i++){
+      time_local[i] = io_simple[i].total_time;
+      count_local[i] = io_simple[i].num_calls;
+      count_local[L7_MAX_FILE_FUNC_CALLS+i] = io_bytes[i];
+   }
+   memcpy(time_max, time_local, sizeof(time_local));
+   memcpy(time_sum, time_local, sizeof(time_local));
+   memcpy(count_sum, count_local, sizeof(count_local));
+
+#ifdef HAVE_MPI
+   if (l7.mpi_initialized){
+      MPI_Reduce(time_local, time_max, L7_MAX_FILE_FUNC_CALLS, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+      MPI_Reduce(time_local, time_sum, L7_MAX_FILE_FUNC_CALLS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+      MPI_Reduce(count_local, count_sum, 2*L7_MAX_FILE_FUNC_CALLS, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+   }
+#endif
+
+   if (l7.penum == 0){
+      printf("\n L7 I/O profile, %d pe(s)\n", l7.numpes);
+      printf("  %-16s %10s %14s %12s %12s %10s\n",
+            "function", "calls", "bytes", "max pe (s)", "mean pe (s)", "MB/s");
+      for (i=0; i<L7_MAX_FILE_FUNC_CALLS; i++){
+         if (count_sum[i] == 0)
+            continue;
+         mbytes = (double)count_sum[L7_MAX_FILE_FUNC_CALLS+i] / 1.0e6;
+         printf("  %-16s %10lld %14lld %12.6f %12.6f %10.1f\n",
+               io_prof_names[i], count_sum[i], count_sum[L7_MAX_FILE_FUNC_CALLS+i],
+               time_max[i], time_sum[i] / (double)l7.numpes,
+               time_max[i] > 0.0 ? mbytes / time_max[i] : 0.0);
+      }
+      fflush(stdout);
+   }
+
+   if (l7.io_profiling_level != L7_IO_PROF_VERBOSE)
+      return;
+
+   for (pe=0; pe<l7.numpes; pe++){
+      if (pe == l7.penum){
+         l7p_io_prof_vfdprint();
+         for (cur = io_first; cur != NULL; cur = cur->next){
+            name = l7p_io_prof_get_filename(cur);
+            printf("  [pe %d] %.6f %.6f %-16s file %d %s pattern %d %lld %d\n",
+                  l7.penum, ts_since_t0(cur->time_in), ts_since_t0(cur->time_out),
+                  io_prof_names[cur->fname_index], cur->file_id, name ? name : "?",
+                  (int)cur->l7_disk_pattern, cur->var_long, cur->var_int);
+         }
+         fflush(stdout);
+      }
+#ifdef HAVE_MPI
+      if (l7.mpi_initialized)
+         MPI_Barrier(MPI_COMM_WORLD);
+#endif
+   }
+
+} /* End l7p_io_prof_print_timings */
+
+void l7p_io_prof_shutdown(void)
+{
+   /*
+    * Print the profile, if any, and release it. Collective.
+    */
+
+   l7p_io_prof_print_timings();
+   io_prof_clear();
+   l7.io_profiling_level = L7_IO_PROF_OFF;
+
+} /* End l7p_io_prof_shutdown */
+
+int L7_Set_IO_Profiling(
+      const int               level
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Set_IO_Profiling changes the I/O profiling level, overriding
+    * L7_IO_PROFILE. Timings collected so far are kept.
+    *
+    * Arguments
+    * =========
+    * level              (input) const int
+    *                    L7_IO_PROF_OFF, L7_IO_PROF_SIMPLE or
+    *                    L7_IO_PROF_VERBOSE.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Every process should use the same level, since the report
+    *    at L7_Terminate is collective either way but only reports the
+    *    calls made while profiling was on.
+    *
+    */
+
+   int
+     ierr;
+
+   if (level < L7_IO_PROF_LEVEL_MIN || level > L7_IO_PROF_LEVEL_MAX){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Invalid I/O profiling level", ierr);
+   }
+
+   l7.io_profiling_level = level;
+
+   return(L7_OK);
+
+} /* End L7_Set_IO_Profiling */
+
+int L7_Get_IO_Profiling(void)
+{
+   /*
+    * Returns the current I/O profiling level.
+    */
+
+   return(l7.io_profiling_level);
+}
+
+void l7_set_io_profiling_(
+      const int               *level,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Set_IO_Profiling(*level);
+}
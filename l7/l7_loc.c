@@ -0,0 +1,362 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_LOC"
+
+/*
+ * Global locations for L7_MaxLoc, L7_MinLoc, L7_MaxValLoc and
+ * L7_MinValLoc.
+ *
+ * Each rank scans its part into a struct l7p_loc holding the extreme
+ * value, as long long or double, and its 64-bit location. The global
+ * location adds the number of items on lower ranks, which comes from
+ * an MPI_Exscan of the local counts and is cached on the communicator
+ * together with the count it was computed for. A single MPI_Allreduce
+ * with a user-defined commutative op then picks the winner, the lower
+ * location on ties as MPI_MAXLOC does, and ORs a stale flag set by any
+ * rank whose count no longer matches its cache. Only then, when some
+ * rank's count has changed, is the Exscan and reduction redone, so a
+ * steady count costs one collective and no O(numpes) memory.
+ */
+
+#define LOC_CODE(op, is_float)  ((op)*2 + (is_float))
+
+int l7p_loc_scan(
+      const void              *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      const enum L7_ReduceOp  op,
+      struct l7p_loc          *loc
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Local extreme of input[0:count-1] and its first index, starting
+    * from the type's sentinel as the MPI_MAXLOC based code did. op is
+    * L7_REDUCE_MAX or L7_REDUCE_MIN.
+    *
+    * Return value
+    * ============
+    * Non-zero for an unsupported datatype.
+    */
+
+   int
+     i,
+     max = (op == L7_REDUCE_MAX),
+     local_loc = 0;
+
+   switch (l7_datatype){
+      case L7_INT:
+      case L7_INTEGER4: {
+         const int *ip = (const int *)input;
+         int cur = max ? INT_MIN : INT_MAX;
+         for (i=0; i<count; i++){
+            if (max ? ip[i] > cur : ip[i] < cur){
+               local_loc = i;
+               cur = ip[i];
+            }
+         }
+         loc->value.i = cur;
+         loc->code = LOC_CODE(op, 0);
+         break;
+      }
+      case L7_LONG: {
+         const long *lp = (const long *)input;
+         long cur = max ? LONG_MIN : LONG_MAX;
+         for (i=0; i<count; i++){
+            if (max ? lp[i] > cur : lp[i] < cur){
+               local_loc = i;
+               cur = lp[i];
+            }
+         }
+         loc->value.i = cur;
+         loc->code = LOC_CODE(op, 0);
+         break;
+      }
+      case L7_FLOAT:
+      case L7_REAL4: {
+         const float *fp = (const float *)input;
+         float cur = max ? -FLT_MAX : FLT_MAX;
+         for (i=0; i<count; i++){
+            if (max ? fp[i] > cur : fp[i] < cur){
+               local_loc = i;
+               cur = fp[i];
+            }
+         }
+         loc->value.d = cur;
+         loc->code = LOC_CODE(op, 1);
+         break;
+      }
+      case L7_DOUBLE:
+      case L7_REAL8: {
+         const double *dp = (const double *)input;
+         double cur = max ? -DBL_MAX : DBL_MAX;
+         for (i=0; i<count; i++){
+            if (max ? dp[i] > cur : dp[i] < cur){
+               local_loc = i;
+               cur = dp[i];
+            }
+         }
+         loc->value.d = cur;
+         loc->code = LOC_CODE(op, 1);
+         break;
+      }
+      default:
+         return(-1);
+   }
+
+   loc->loc   = local_loc;
+   loc->stale = 0;
+
+   return(0);
+
+} /* End l7p_loc_scan */
+
+void l7p_loc_store(
+      const struct l7p_loc    *loc,
+      const enum L7_Datatype  l7_datatype,
+      void                    *val
+      )
+{
+   /*
+    * Write the reduced value back in the caller's type.
+    */
+
+   switch (l7_datatype){
+      case L7_INT:
+      case L7_INTEGER4:
+         *((int *)val) = (int)loc->value.i;
+         break;
+      case L7_LONG:
+         *((long *)val) = (long)loc->value.i;
+         break;
+      case L7_FLOAT:
+      case L7_REAL4:
+         *((float *)val) = (float)loc->value.d;
+         break;
+      case L7_DOUBLE:
+      case L7_REAL8:
+         *((double *)val) = loc->value.d;
+         break;
+      default:
+         break;
+   }
+
+} /* End l7p_loc_store */
+
+#ifdef HAVE_MPI
+
+static void loc_combine(
+      void                    *invec,
+      void                    *inoutvec,
+      int                     *len,
+      MPI_Datatype            *datatype
+      )
+{
+   /*
+    * MPI op: keep the larger (or smaller) value, the lower location on
+    * ties, and OR the stale flags.
+    */
+
+   struct l7p_loc
+     *in    = (struct l7p_loc *)invec,
+     *inout = (struct l7p_loc *)inoutvec;
+
+   int
+     k,
+     better,
+     same;
+
+   (void)datatype;
+
+   for (k=0; k<*len; k++){
+      if (in[k].code % 2){
+         better = (in[k].code / 2 == L7_REDUCE_MAX) ?
+            in[k].value.d > inout[k].value.d : in[k].value.d < inout[k].value.d;
+         same = (in[k].value.d == inout[k].value.d);
+      }
+      else {
+         better = (in[k].code / 2 == L7_REDUCE_MAX) ?
+            in[k].value.i > inout[k].value.i : in[k].value.i < inout[k].value.i;
+         same = (in[k].value.i == inout[k].value.i);
+      }
+      if (better || (same && in[k].loc < inout[k].loc)){
+         inout[k].value = in[k].value;
+         inout[k].loc   = in[k].loc;
+      }
+      inout[k].stale |= in[k].stale;
+   }
+
+} /* End loc_combine */
+
+static int loc_offset_delete(
+      MPI_Comm                comm,
+      int                     keyval,
+      void                    *attribute_val,
+      void                    *extra_state
+      )
+{
+   (void)comm;
+   (void)keyval;
+   (void)extra_state;
+
+   free(attribute_val);
+
+   return(MPI_SUCCESS);
+
+} /* End loc_offset_delete */
+
+void l7p_loc_reduce(
+      struct l7p_loc          *loc,
+      const int               count,
+      MPI_Comm                comm
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Turn the local result of l7p_loc_scan into the global one over
+    * comm. Collective over comm.
+    */
+
+   struct l7p_loc_offset
+     *cache;
+
+   struct l7p_loc
+     global;
+
+   long long
+     local_loc = loc->loc,
+     local_count = count,
+     offset;
+
+   int
+     found,
+     rank;
+
+   MPI_Comm_get_attr(comm, l7.loc_keyval, &cache, &found);
+
+   loc->stale = ! (found && cache->count == local_count);
+   loc->loc   = local_loc + (loc->stale ? 0 : cache->offset);
+   l7p_allreduce(loc, &global, 1, l7.loc_type, l7.loc_op, comm);
+
+   if (! global.stale){
+      *loc = global;
+      return;
+   }
+
+   offset = 0;
+   MPI_Exscan(&local_count, &offset, 1, MPI_LONG_LONG_INT, MPI_SUM, comm);
+   MPI_Comm_rank(comm, &rank);
+   if (rank == 0)
+      offset = 0;
+
+   loc->stale = 0;
+   loc->loc   = local_loc + offset;
+   l7p_allreduce(loc, &global, 1, l7.loc_type, l7.loc_op, comm);
+   *loc = global;
+
+   /*
+    * Cache the offset only after the collectives, so a failed
+    * allocation here leaves the others in step; the next call redoes
+    * the scan.
+    */
+
+   if (! found){
+      cache = (struct l7p_loc_offset *)malloc(sizeof(struct l7p_loc_offset));
+      L7_ASSERTN(cache != NULL, "No memory for location offset cache", -1);
+      MPI_Comm_set_attr(comm, l7.loc_keyval, cache);
+   }
+   cache->count  = local_count;
+   cache->offset = offset;
+
+} /* End l7p_loc_reduce */
+
+#endif /* HAVE_MPI */
+
+void l7p_loc_init(void)
+{
+   /*
+    * Create the location datatype, combine op and offset cache keyval;
+    * MPI must be initialized.
+    */
+
+#ifdef HAVE_MPI
+   MPI_Type_contiguous((int)sizeof(struct l7p_loc), MPI_BYTE, &l7.loc_type);
+   MPI_Type_commit(&l7.loc_type);
+   MPI_Op_create(loc_combine, 1, &l7.loc_op);
+   MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, loc_offset_delete, &l7.loc_keyval, NULL);
+#endif
+
+} /* End l7p_loc_init */
+
+void l7p_loc_free(void)
+{
+   /*
+    * Release them (L7_Terminate, before MPI_Finalize). Caches on other
+    * communicators go when those are freed.
+    */
+
+#ifdef HAVE_MPI
+   struct l7p_loc_offset
+     *cache;
+
+   int
+     found;
+
+   if (l7.loc_keyval != MPI_KEYVAL_INVALID){
+      MPI_Comm_get_attr(MPI_COMM_WORLD, l7.loc_keyval, &cache, &found);
+      if (found)
+         MPI_Comm_delete_attr(MPI_COMM_WORLD, l7.loc_keyval);
+      MPI_Comm_free_keyval(&l7.loc_keyval);
+      MPI_Type_free(&l7.loc_type);
+      MPI_Op_free(&l7.loc_op);
+   }
+   l7.loc_keyval = MPI_KEYVAL_INVALID;
+#endif
+
+} /* End l7p_loc_free */
@@ -0,0 +1,708 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "l7.h"
+#include "l7p.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define L7_LOCATION "L7_LOCAL_REDUCE"
+
+/*
+ * Local phase of L7_Sum, L7_Max, L7_Min, L7_Any and L7_All.
+ *
+ * Each kernel keeps LOCAL_LANES independent accumulators, so the loop
+ * carries no dependence from one element to the next and the compiler
+ * turns each group of lanes into vector adds, max or min (with an omp
+ * simd hint under _OPENMP_SIMD). Integer results are the same as the
+ * scalar loops gave. Max and min of floating point values are also the
+ * same, NaNs still never winning. Floating point sums now associate
+ * across lanes; L7_SUM_REPRODUCIBLE is there when the bits matter.
+ *
+ * In OpenMP builds (mpl7), counts of at least LOCAL_PARALLEL_MIN are
+ * split into one static block per thread. The per-thread partials are
+ * combined in thread order, so the result depends only on the thread
+ * count.
+ */
+
+#define LOCAL_LANES          8
+#define LOCAL_PARALLEL_MIN   (1 << 16)
+#define LOCAL_ANY_BLOCK      64
+
+/*
+ * Kernels over x[lo:hi-1], per input type. Float values accumulate in
+ * double, as L7_Sum always did.
+ */
+
+static void local_int(
+      const int               *x,
+      const int               lo,
+      const int               hi,
+      const enum L7_ReduceOp  op,
+      int                     *result
+      )
+{
+   unsigned int
+     s[LOCAL_LANES];
+   int
+     m[LOCAL_LANES],
+     i = lo,
+     k;
+
+   switch (op){
+      case L7_REDUCE_SUM:
+         /* Unsigned lanes wrap the way the int total would. */
+         for (k=0; k<LOCAL_LANES; k++) s[k] = 0;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) s[k] += (unsigned int)x[i+k];
+         }
+         for (; i<hi; i++) s[0] += (unsigned int)x[i];
+         for (k=1; k<LOCAL_LANES; k++) s[0] += s[k];
+         *result = (int)s[0];
+         break;
+      case L7_REDUCE_MAX:
+         for (k=0; k<LOCAL_LANES; k++) m[k] = INT_MIN;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) m[k] = (x[i+k] > m[k]) ? x[i+k] : m[k];
+         }
+         for (; i<hi; i++) m[0] = (x[i] > m[0]) ? x[i] : m[0];
+         for (k=1; k<LOCAL_LANES; k++) m[0] = (m[k] > m[0]) ? m[k] : m[0];
+         *result = m[0];
+         break;
+      case L7_REDUCE_MIN:
+         for (k=0; k<LOCAL_LANES; k++) m[k] = INT_MAX;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) m[k] = (x[i+k] < m[k]) ? x[i+k] : m[k];
+         }
+         for (; i<hi; i++) m[0] = (x[i] < m[0]) ? x[i] : m[0];
+         for (k=1; k<LOCAL_LANES; k++) m[0] = (m[k] < m[0]) ? m[k] : m[0];
+         *result = m[0];
+         break;
+   }
+
+} /* End local_int */
+
+static void local_long(
+      const long              *x,
+      const int               lo,
+      const int               hi,
+      const enum L7_ReduceOp  op,
+      long                    *result
+      )
+{
+   unsigned long
+     s[LOCAL_LANES];
+   long
+     m[LOCAL_LANES];
+   int
+     i = lo,
+     k;
+
+   switch (op){
+      case L7_REDUCE_SUM:
+         for (k=0; k<LOCAL_LANES; k++) s[k] = 0;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) s[k] += (unsigned long)x[i+k];
+         }
+         for (; i<hi; i++) s[0] += (unsigned long)x[i];
+         for (k=1; k<LOCAL_LANES; k++) s[0] += s[k];
+         *result = (long)s[0];
+         break;
+      case L7_REDUCE_MAX:
+         for (k=0; k<LOCAL_LANES; k++) m[k] = LONG_MIN;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) m[k] = (x[i+k] > m[k]) ? x[i+k] : m[k];
+         }
+         for (; i<hi; i++) m[0] = (x[i] > m[0]) ? x[i] : m[0];
+         for (k=1; k<LOCAL_LANES; k++) m[0] = (m[k] > m[0]) ? m[k] : m[0];
+         *result = m[0];
+         break;
+      case L7_REDUCE_MIN:
+         for (k=0; k<LOCAL_LANES; k++) m[k] = LONG_MAX;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) m[k] = (x[i+k] < m[k]) ? x[i+k] : m[k];
+         }
+         for (; i<hi; i++) m[0] = (x[i] < m[0]) ? x[i] : m[0];
+         for (k=1; k<LOCAL_LANES; k++) m[0] = (m[k] < m[0]) ? m[k] : m[0];
+         *result = m[0];
+         break;
+   }
+
+} /* End local_long */
+
+static void local_long_long(
+      const long long         *x,
+      const int               lo,
+      const int               hi,
+      const enum L7_ReduceOp  op,
+      long long               *result
+      )
+{
+   unsigned long long
+     s[LOCAL_LANES];
+   long long
+     m[LOCAL_LANES];
+   int
+     i = lo,
+     k;
+
+   switch (op){
+      case L7_REDUCE_SUM:
+         for (k=0; k<LOCAL_LANES; k++) s[k] = 0;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) s[k] += (unsigned long long)x[i+k];
+         }
+         for (; i<hi; i++) s[0] += (unsigned long long)x[i];
+         for (k=1; k<LOCAL_LANES; k++) s[0] += s[k];
+         *result = (long long)s[0];
+         break;
+      case L7_REDUCE_MAX:
+         for (k=0; k<LOCAL_LANES; k++) m[k] = LLONG_MIN;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) m[k] = (x[i+k] > m[k]) ? x[i+k] : m[k];
+         }
+         for (; i<hi; i++) m[0] = (x[i] > m[0]) ? x[i] : m[0];
+         for (k=1; k<LOCAL_LANES; k++) m[0] = (m[k] > m[0]) ? m[k] : m[0];
+         *result = m[0];
+         break;
+      case L7_REDUCE_MIN:
+         for (k=0; k<LOCAL_LANES; k++) m[k] = LLONG_MAX;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) m[k] = (x[i+k] < m[k]) ? x[i+k] : m[k];
+         }
+         for (; i<hi; i++) m[0] = (x[i] < m[0]) ? x[i] : m[0];
+         for (k=1; k<LOCAL_LANES; k++) m[0] = (m[k] < m[0]) ? m[k] : m[0];
+         *result = m[0];
+         break;
+   }
+
+} /* End local_long_long */
+
+static void local_float(
+      const float             *x,
+      const int               lo,
+      const int               hi,
+      const enum L7_ReduceOp  op,
+      double                  *result
+      )
+{
+   double
+     s[LOCAL_LANES];
+   float
+     m[LOCAL_LANES];
+   int
+     i = lo,
+     k;
+
+   switch (op){
+      case L7_REDUCE_SUM:
+         for (k=0; k<LOCAL_LANES; k++) s[k] = 0.0;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) s[k] += (double)x[i+k];
+         }
+         for (; i<hi; i++) s[0] += (double)x[i];
+         *result = ((s[0]+s[4]) + (s[1]+s[5])) + ((s[2]+s[6]) + (s[3]+s[7]));
+         break;
+      case L7_REDUCE_MAX:
+         for (k=0; k<LOCAL_LANES; k++) m[k] = -FLT_MAX;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) m[k] = (x[i+k] > m[k]) ? x[i+k] : m[k];
+         }
+         for (; i<hi; i++) m[0] = (x[i] > m[0]) ? x[i] : m[0];
+         for (k=1; k<LOCAL_LANES; k++) m[0] = (m[k] > m[0]) ? m[k] : m[0];
+         *result = m[0];
+         break;
+      case L7_REDUCE_MIN:
+         for (k=0; k<LOCAL_LANES; k++) m[k] = FLT_MAX;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) m[k] = (x[i+k] < m[k]) ? x[i+k] : m[k];
+         }
+         for (; i<hi; i++) m[0] = (x[i] < m[0]) ? x[i] : m[0];
+         for (k=1; k<LOCAL_LANES; k++) m[0] = (m[k] < m[0]) ? m[k] : m[0];
+         *result = m[0];
+         break;
+   }
+
+} /* End local_float */
+
+static void local_double(
+      const double            *x,
+      const int               lo,
+      const int               hi,
+      const enum L7_ReduceOp  op,
+      double                  *result
+      )
+{
+   double
+     s[LOCAL_LANES];
+   int
+     i = lo,
+     k;
+
+   switch (op){
+      case L7_REDUCE_SUM:
+         for (k=0; k<LOCAL_LANES; k++) s[k] = 0.0;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) s[k] += x[i+k];
+         }
+         for (; i<hi; i++) s[0] += x[i];
+         *result = ((s[0]+s[4]) + (s[1]+s[5])) + ((s[2]+s[6]) + (s[3]+s[7]));
+         break;
+      case L7_REDUCE_MAX:
+         for (k=0; k<LOCAL_LANES; k++) s[k] = -DBL_MAX;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) s[k] = (x[i+k] > s[k]) ? x[i+k] : s[k];
+         }
+         for (; i<hi; i++) s[0] = (x[i] > s[0]) ? x[i] : s[0];
+         for (k=1; k<LOCAL_LANES; k++) s[0] = (s[k] > s[0]) ? s[k] : s[0];
+         *result = s[0];
+         break;
+      case L7_REDUCE_MIN:
+         for (k=0; k<LOCAL_LANES; k++) s[k] = DBL_MAX;
+         for (; hi - i >= LOCAL_LANES; i+=LOCAL_LANES){
+#ifdef _OPENMP_SIMD
+#pragma omp simd
+#endif
+            for (k=0; k<LOCAL_LANES; k++) s[k] = (x[i+k] < s[k]) ? x[i+k] : s[k];
+         }
+         for (; i<hi; i++) s[0] = (x[i] < s[0]) ? x[i] : s[0];
+         for (k=1; k<LOCAL_LANES; k++) s[0] = (s[k] < s[0]) ? s[k] : s[0];
+         *result = s[0];
+         break;
+   }
+
+} /* End local_double */
+
+/*
+ * Accumulator of each datatype class; long is kept as long long.
+ */
+
+union local_acc {
+   int       i;
+   long long ll;
+   double    d;
+};
+
+static int local_block(
+      const void              *input,
+      const int               lo,
+      const int               hi,
+      const enum L7_Datatype  l7_datatype,
+      const enum L7_ReduceOp  op,
+      union local_acc         *acc
+      )
+{
+   /*
+    * One kernel call on input[lo:hi-1]; non-zero for an unsupported
+    * datatype.
+    */
+
+   long
+     l = 0L;
+
+   switch (l7_datatype){
+      case L7_INT:
+      case L7_INTEGER4:
+      case L7_LOGICAL:
+         local_int((const int *)input, lo, hi, op, &acc->i);
+         break;
+      case L7_LONG:
+         local_long((const long *)input, lo, hi, op, &l);
+         acc->ll = l;
+         break;
+      case L7_LONG_LONG_INT:
+      case L7_INTEGER8:
+         local_long_long((const long long *)input, lo, hi, op, &acc->ll);
+         break;
+      case L7_FLOAT:
+      case L7_REAL4:
+         local_float((const float *)input, lo, hi, op, &acc->d);
+         break;
+      case L7_DOUBLE:
+      case L7_REAL8:
+         local_double((const double *)input, lo, hi, op, &acc->d);
+         break;
+      default:
+         return(-1);
+   }
+
+   return(0);
+
+} /* End local_block */
+
+static void local_merge(
+      const enum L7_Datatype  l7_datatype,
+      const enum L7_ReduceOp  op,
+      union local_acc         *acc,
+      const union local_acc   *part
+      )
+{
+   /*
+    * acc = acc op part, for the thread partials.
+    */
+
+   switch (l7_datatype){
+      case L7_INT:
+      case L7_INTEGER4:
+      case L7_LOGICAL:
+         if (op == L7_REDUCE_SUM)
+            acc->i = (int)((unsigned int)acc->i + (unsigned int)part->i);
+         else if (op == L7_REDUCE_MAX ? part->i > acc->i : part->i < acc->i)
+            acc->i = part->i;
+         break;
+      case L7_FLOAT:
+      case L7_REAL4:
+      case L7_DOUBLE:
+      case L7_REAL8:
+         if (op == L7_REDUCE_SUM)
+            acc->d += part->d;
+         else if (op == L7_REDUCE_MAX ? part->d > acc->d : part->d < acc->d)
+            acc->d = part->d;
+         break;
+      default:
+         if (op == L7_REDUCE_SUM)
+            acc->ll = (long long)((unsigned long long)acc->ll + (unsigned long long)part->ll);
+         else if (op == L7_REDUCE_MAX ? part->ll > acc->ll : part->ll < acc->ll)
+            acc->ll = part->ll;
+         break;
+   }
+
+} /* End local_merge */
+
+int l7p_local_reduce(
+      const void              *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      const enum L7_ReduceOp  op,
+      void                    *result
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Sum, maximum or minimum of input[0:count-1] for the first phase of
+    * the L7 reductions. The result is an int for L7_INT and
+    * L7_INTEGER4, a long for L7_LONG, a long long for L7_LONG_LONG_INT
+    * and L7_INTEGER8, and a double for the floating point types. An
+    * empty input gives 0 or the type's extreme, as before.
+    *
+    * Return value
+    * ============
+    * Non-zero for an unsupported datatype.
+    */
+
+   union local_acc
+     acc,
+     *partials = NULL;
+
+   int
+     nthreads = 1,
+     t;
+
+#ifdef _OPENMP
+   if (count >= LOCAL_PARALLEL_MIN && ! omp_in_parallel())
+      nthreads = omp_get_max_threads();
+   if (nthreads > 1)
+      partials = (union local_acc *)malloc((size_t)nthreads * sizeof(union local_acc));
+   if (partials == NULL)
+      nthreads = 1;
+#endif
+
+   if (nthreads == 1){
+      if (local_block(input, 0, count, l7_datatype, op, &acc) != 0)
+         return(-1);
+   }
+   else {
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+      {
+         int
+           me = 0;
+#ifdef _OPENMP
+         me = omp_get_thread_num();
+#endif
+         local_block(input, (int)((long long)count * me / nthreads),
+               (int)((long long)count * (me+1) / nthreads),
+               l7_datatype, op, &partials[me]);
+      }
+      if (local_block(input, 0, 0, l7_datatype, op, &acc) != 0){
+         free(partials);
+         return(-1);
+      }
+      for (t=0; t<nthreads; t++)
+         local_merge(l7_datatype, op, &acc, &partials[t]);
+      free(partials);
+   }
+
+   switch (l7_datatype){
+      case L7_INT:
+      case L7_INTEGER4:
+      case L7_LOGICAL:
+         *((int *)result) = acc.i;
+         break;
+      case L7_LONG:
+         *((long *)result) = (long)acc.ll;
+         break;
+      case L7_LONG_LONG_INT:
+      case L7_INTEGER8:
+         *((long long *)result) = acc.ll;
+         break;
+      default:
+         *((double *)result) = acc.d;
+         break;
+   }
+
+   return(0);
+
+} /* End l7p_local_reduce */
+
+int l7p_local_any(
+      const void              *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *result
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Last non-zero element of input[0:count-1], or 0, as L7_Any has
+    * always reported locally (keeping a Fortran .true. of -1 negative).
+    * Blocks are tested from the end with a vector OR, so the scan stops
+    * at the first block holding a non-zero value.
+    *
+    * Return value
+    * ============
+    * Non-zero for an unsupported datatype.
+    */
+
+   int
+     hi,
+     lo,
+     i;
+
+   switch (l7_datatype){
+      case L7_INT:
+      case L7_INTEGER4:
+      case L7_LOGICAL: {
+         const int *x = (const int *)input;
+         int any;
+         *((int *)result) = 0;
+         for (hi = count; hi > 0; hi = lo){
+            lo = (hi > LOCAL_ANY_BLOCK) ? hi - LOCAL_ANY_BLOCK : 0;
+            any = 0;
+#ifdef _OPENMP_SIMD
+#pragma omp simd reduction(|:any)
+#endif
+            for (i=lo; i<hi; i++) any |= x[i];
+            if (any){
+               for (i=hi-1; ! x[i]; i--);
+               *((int *)result) = x[i];
+               break;
+            }
+         }
+         break;
+      }
+      case L7_LONG: {
+         const long *x = (const long *)input;
+         long any;
+         *((long *)result) = 0L;
+         for (hi = count; hi > 0; hi = lo){
+            lo = (hi > LOCAL_ANY_BLOCK) ? hi - LOCAL_ANY_BLOCK : 0;
+            any = 0L;
+#ifdef _OPENMP_SIMD
+#pragma omp simd reduction(|:any)
+#endif
+            for (i=lo; i<hi; i++) any |= x[i];
+            if (any){
+               for (i=hi-1; ! x[i]; i--);
+               *((long *)result) = x[i];
+               break;
+            }
+         }
+         break;
+      }
+      case L7_LONG_LONG_INT:
+      case L7_INTEGER8: {
+         const long long *x = (const long long *)input;
+         long long any;
+         *((long long *)result) = 0LL;
+         for (hi = count; hi > 0; hi = lo){
+            lo = (hi > LOCAL_ANY_BLOCK) ? hi - LOCAL_ANY_BLOCK : 0;
+            any = 0LL;
+#ifdef _OPENMP_SIMD
+#pragma omp simd reduction(|:any)
+#endif
+            for (i=lo; i<hi; i++) any |= x[i];
+            if (any){
+               for (i=hi-1; ! x[i]; i--);
+               *((long long *)result) = x[i];
+               break;
+            }
+         }
+         break;
+      }
+      default:
+         return(-1);
+   }
+
+   return(0);
+
+} /* End l7p_local_any */
+
+int l7p_local_all(
+      const void              *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      int                     *result
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * 1 if no element of input[0:count-1] is zero, else 0, for L7_All.
+    * Blocks are tested with a vector count of zeros, stopping at the
+    * first block that holds one.
+    *
+    * Return value
+    * ============
+    * Non-zero for an unsupported datatype.
+    */
+
+   int
+     zeros = 0,
+     lo,
+     hi,
+     i;
+
+   switch (l7_datatype){
+      case L7_INT:
+      case L7_INTEGER4:
+      case L7_LOGICAL: {
+         const int *x = (const int *)input;
+         for (lo = 0; lo < count && zeros == 0; lo = hi){
+            hi = (count - lo > LOCAL_ANY_BLOCK) ? lo + LOCAL_ANY_BLOCK : count;
+#ifdef _OPENMP_SIMD
+#pragma omp simd reduction(+:zeros)
+#endif
+            for (i=lo; i<hi; i++) zeros += (x[i] == 0);
+         }
+         break;
+      }
+      case L7_LONG: {
+         const long *x = (const long *)input;
+         for (lo = 0; lo < count && zeros == 0; lo = hi){
+            hi = (count - lo > LOCAL_ANY_BLOCK) ? lo + LOCAL_ANY_BLOCK : count;
+#ifdef _OPENMP_SIMD
+#pragma omp simd reduction(+:zeros)
+#endif
+            for (i=lo; i<hi; i++) zeros += (x[i] == 0L);
+         }
+         break;
+      }
+      case L7_LONG_LONG_INT:
+      case L7_INTEGER8: {
+         const long long *x = (const long long *)input;
+         for (lo = 0; lo < count && zeros == 0; lo = hi){
+            hi = (count - lo > LOCAL_ANY_BLOCK) ? lo + LOCAL_ANY_BLOCK : count;
+#ifdef _OPENMP_SIMD
+#pragma omp simd reduction(+:zeros)
+#endif
+            for (i=lo; i<hi; i++) zeros += (x[i] == 0LL);
+         }
+         break;
+      }
+      default:
+         return(-1);
+   }
+
+   *result = (zeros == 0);
+
+   return(0);
+
+} /* End l7p_local_all */
@@ -0,0 +1,364 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_MEM"
+
+/*
+ * Host memory for benchmark data and L7 staging buffers.
+ *
+ * Every block starts with a header, padded to a cache line, that records
+ * how it was obtained so L7_Mem_Release can undo it. DEFAULT blocks come
+ * from posix_memalign and are zeroed with memset by the calling thread,
+ * which first touches them. Any other policy maps anonymous memory with
+ * mmap so it can ask for huge pages and bind pages to a NUMA node; those
+ * pages are already zero, so only the header page is touched here and
+ * the rest are placed by whichever thread writes them first. Without
+ * L7_MEM_LOCAL that is the caller's own (possibly parallel) init loop;
+ * with it every page goes to the node of the allocating thread.
+ */
+
+#ifndef MPOL_BIND
+#define MPOL_BIND 2
+#endif
+
+#define L7_MEM_MAGIC      0x4c374d45u     /* "L7ME" */
+#define L7_MEM_HEADER     64
+#define L7_MEM_HUGE_PAGE  (2UL << 20)
+
+struct l7_mem_header {
+   unsigned int
+     magic,
+     policy;                   /* Policy actually applied to this block */
+   size_t
+     map_len;                  /* Length of the mapping, 0 if malloced  */
+};
+
+static const char *l7_mem_policy_names[] = {
+   "default",
+   "thp",
+   "hugetlb",
+   "thp+hugetlb",
+   "local",
+   "thp+local",
+   "hugetlb+local",
+   "thp+hugetlb+local"
+};
+
+static int mem_bind_local(void *addr, size_t len)
+{
+   /*
+    * Bind [addr, addr+len) to the NUMA node of the CPU we run on.
+    * Returns 1 on success.
+    */
+#if defined(SYS_mbind) && defined(SYS_getcpu)
+   unsigned int cpu, node;
+   unsigned long nodemask[4];
+
+   if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 || node >= 8*sizeof(nodemask))
+      return(0);
+
+   memset(nodemask, 0, sizeof(nodemask));
+   nodemask[node / (8*sizeof(unsigned long))] = 1UL << (node % (8*sizeof(unsigned long)));
+
+   return(syscall(SYS_mbind, addr, len, MPOL_BIND, nodemask,
+            8*sizeof(nodemask), 0) == 0);
+#else
+   (void)addr; (void)len;
+   return(0);
+#endif
+}
+
+void l7p_mem_init(void)
+{
+   /*
+    * Purpose
+    * =======
+    * Read the requested allocation policy from the environment variable
+    * L7_MEM_POLICY, a list of "default", "thp", "hugetlb" and "local"
+    * separated by commas or '+'.
+    */
+
+   char
+     *env,
+     *copy,
+     *token,
+     *save = NULL;
+   int
+     policy = L7_MEM_DEFAULT;
+
+   env = getenv("L7_MEM_POLICY");
+   if (env != NULL && (copy = strdup(env)) != NULL){
+      for (token = strtok_r(copy, ",+", &save); token != NULL;
+           token = strtok_r(NULL, ",+", &save)){
+         if (strcmp(token, "thp") == 0)
+            policy |= L7_MEM_THP;
+         else if (strcmp(token, "hugetlb") == 0)
+            policy |= L7_MEM_HUGETLB;
+         else if (strcmp(token, "local") == 0)
+            policy |= L7_MEM_LOCAL;
+         else if (strcmp(token, "default") != 0){
+            L7_PRINT(0, "Unknown L7_MEM_POLICY entry ignored", -1);
+         }
+      }
+      free(copy);
+   }
+
+   l7.mem_policy = policy;
+   l7.mem_policy_in_effect = policy;
+}
+
+int L7_Mem_Set_Policy(
+      const int               policy
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Mem_Set_Policy selects the policy for subsequent L7_Mem_Alloc
+    * calls, overriding L7_MEM_POLICY.
+    *
+    * Arguments
+    * =========
+    * policy             (input) const int
+    *                    Bitwise or of enum L7_MemPolicy values.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    */
+
+   int
+     ierr;
+
+   if (policy < 0 || policy > L7_MEM_POLICY_MAX){
+      ierr = -1;
+      L7_ASSERT(policy >= 0 && policy <= L7_MEM_POLICY_MAX, "Invalid memory policy", ierr);
+   }
+
+   l7.mem_policy = policy;
+   l7.mem_policy_in_effect = policy;
+
+   return(L7_OK);
+
+} /* End L7_Mem_Set_Policy */
+
+int L7_Mem_Get_Policy(void)
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Mem_Get_Policy returns the policy applied to the most recent
+    * L7_Mem_Alloc, which lacks the bits the system refused (no huge
+    * pages configured, no NUMA support), or the requested policy if
+    * nothing has been allocated since it was set.
+    *
+    */
+
+   return(__atomic_load_n(&l7.mem_policy_in_effect, __ATOMIC_RELAXED));
+
+} /* End L7_Mem_Get_Policy */
+
+const char *L7_Mem_Policy_Name(
+      const int               policy
+      )
+{
+   if (policy < 0 || policy > L7_MEM_POLICY_MAX)
+      return("invalid");
+
+   return(l7_mem_policy_names[policy]);
+
+} /* End L7_Mem_Policy_Name */
+
+void *L7_Mem_Alloc(
+      const size_t            nbytes
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Mem_Alloc returns nbytes of zeroed host memory, 64-byte aligned,
+    * placed according to the current policy (L7_MEM_POLICY or
+    * L7_Mem_Set_Policy).
+    *
+    * Arguments
+    * =========
+    * nbytes             (input) const size_t
+    *                    Size of the block.
+    *
+    * Return value
+    * ============
+    * The block, or NULL if memory runs out. Release it with
+    * L7_Mem_Release.
+    *
+    * Notes:
+    * =====
+    * 1) L7_MEM_HUGETLB maps explicit huge pages (MAP_HUGETLB) and falls
+    *    back to L7_MEM_THP when none are reserved. L7_MEM_THP asks for
+    *    transparent huge pages with madvise(MADV_HUGEPAGE).
+    * 2) L7_MEM_LOCAL binds the pages to the NUMA node the calling
+    *    thread runs on. Pin ranks to cores for this to be meaningful.
+    * 3) Bits that could not be honored are dropped from what
+    *    L7_Mem_Get_Policy reports.
+    * 4) Only policies other than L7_MEM_DEFAULT leave the data pages
+    *    untouched, so that a parallel init loop places them.
+    *
+    */
+
+   struct l7_mem_header
+     *header;
+   void
+     *base = NULL;
+   size_t
+     total,
+     map_len = 0,
+     page_size = (size_t)sysconf(_SC_PAGESIZE);
+   int
+     policy,
+     applied = L7_MEM_DEFAULT;
+
+   policy = l7.mem_policy;
+   total  = nbytes + L7_MEM_HEADER;
+
+   if (policy == L7_MEM_DEFAULT){
+      if (posix_memalign(&base, L7_MEM_HEADER, total) != 0)
+         return(NULL);
+      memset(base, 0, total);
+   }
+   else {
+#ifdef MAP_HUGETLB
+      if (policy & L7_MEM_HUGETLB){
+         map_len = (total + L7_MEM_HUGE_PAGE - 1) & ~(L7_MEM_HUGE_PAGE - 1);
+         base = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+         if (base == MAP_FAILED){
+            base = NULL;
+            policy |= L7_MEM_THP;
+         }
+         else {
+            applied |= L7_MEM_HUGETLB;
+         }
+      }
+#else
+      if (policy & L7_MEM_HUGETLB)
+         policy |= L7_MEM_THP;
+#endif
+      if (base == NULL){
+         if (policy & L7_MEM_THP)
+            map_len = (total + L7_MEM_HUGE_PAGE - 1) & ~(L7_MEM_HUGE_PAGE - 1);
+         else
+            map_len = (total + page_size - 1) & ~(page_size - 1);
+         base = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+         if (base == MAP_FAILED)
+            return(NULL);
+#ifdef MADV_HUGEPAGE
+         if ((policy & L7_MEM_THP) && madvise(base, map_len, MADV_HUGEPAGE) == 0)
+            applied |= L7_MEM_THP;
+#endif
+      }
+
+      if ((policy & L7_MEM_LOCAL) && mem_bind_local(base, map_len))
+         applied |= L7_MEM_LOCAL;
+   }
+
+   header = (struct l7_mem_header *)base;
+   header->magic   = L7_MEM_MAGIC;
+   header->policy  = (unsigned int)applied;
+   header->map_len = map_len;
+
+   __atomic_store_n(&l7.mem_policy_in_effect, applied, __ATOMIC_RELAXED);
+
+   return((char *)base + L7_MEM_HEADER);
+
+} /* End L7_Mem_Alloc */
+
+void L7_Mem_Release(
+      void                    *ptr
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Mem_Release returns a block obtained from L7_Mem_Alloc. NULL is
+    * ignored.
+    *
+    */
+
+   struct l7_mem_header
+     *header;
+
+   if (ptr == NULL)
+      return;
+
+   header = (struct l7_mem_header *)((char *)ptr - L7_MEM_HEADER);
+   if (header->magic != L7_MEM_MAGIC){
+      L7_PRINT(header->magic == L7_MEM_MAGIC, "Block not from L7_Mem_Alloc", -1);
+      return;
+   }
+   header->magic = 0;
+
+   if (header->map_len > 0)
+      munmap(header, header->map_len);
+   else
+      free(header);
+
+} /* End L7_Mem_Release */
+
+void L7_MEM_SET_POLICY(
+      const int   *policy,
+      int         *ierr
+      )
+{
+   *ierr = L7_Mem_Set_Policy(*policy);
+}
+
+int L7_MEM_GET_POLICY(void)
+{
+   return(L7_Mem_Get_Policy());
+}
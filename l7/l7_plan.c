@@ -0,0 +1,557 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_PLAN"
+
+/*
+ * A saved plan is one file per process, <path>.<rank>, holding a fixed
+ * header followed by int arrays in this order:
+ *
+ *    recv_from[num_recvs]   recv_counts[num_recvs]
+ *    send_to[num_sends]     send_counts[num_sends]
+ *    indices_local_to_send[num_send_indices]
+ *    starting_indices[numpes+1]       (only if has_starting_indices)
+ *    ghost_offsets[num_indices_needed] (only if has_ghost_offsets)
+ *
+ * Everything is 4-byte aligned native-endian data so the file can be
+ * mapped and used in place. The checksum covers the arrays.
+ */
+
+#define L7_PLAN_MAGIC   "L7PLAN\r\n"
+#define L7_PLAN_VERSION 2
+
+struct l7_plan_header {
+   char
+     magic[8];
+   int32_t
+     version,
+     header_bytes,             /* sizeof(struct l7_plan_header)        */
+     numpes,
+     penum,
+     my_start_index,
+     num_indices_owned,
+     num_indices_needed,
+     num_recvs,
+     num_sends,
+     num_send_indices,         /* Length of indices_local_to_send      */
+     has_starting_indices,
+     has_ghost_offsets,        /* Set up with L7_Setup_Placed          */
+     owned_placed;
+   uint32_t
+     checksum;                 /* CRC32C of the arrays                 */
+};
+
+#ifdef HAVE_MPI
+static void plan_file_name(char *name, size_t len, const char *path, int penum);
+#endif
+
+int L7_Plan_Save(
+      const int               l7_id,
+      const char              *path
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Plan_Save writes the communication plan of database l7_id
+    * (neighbors, message counts, local indices to send and the block
+    * decomposition) to the file <path>.<rank>, so that a later run with
+    * the same decomposition can restore it with L7_Plan_Load instead of
+    * repeating the L7_Setup handshake.
+    *
+    * Arguments
+    * =========
+    * l7_id              (input) const int
+    *                    Handle to database to save.
+    *
+    * path               (input) const char*
+    *                    Base file name; each process appends its rank.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Purely local, no communication.
+    * 2) Serial compilation creates a no-op.
+    *
+    */
+
+   int
+     ierr;
+
+#if defined HAVE_MPI
+
+   l7_id_database
+     *l7_id_db;
+   struct l7_plan_header
+     header;
+   char
+     file_name[4096];
+   FILE
+     *fp;
+   int
+     i,
+     num_send_indices;
+   size_t
+     nwritten;
+
+   if (! l7.mpi_initialized){
+      return(0);
+   }
+
+   if (path == NULL){
+      ierr = -1;
+      L7_ASSERT( path != NULL, "path != NULL", ierr);
+   }
+
+   l7_id_db = l7p_set_database(l7_id);
+   if (l7_id_db == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
+   }
+
+   if (l7_id_db->num_sends > 0 && l7_id_db->indices_local_to_send == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db->indices_local_to_send != NULL,
+            "Send indices released by L7_Compact", ierr);
+   }
+
+   /* The plan format has no room for the copies of repeated ghosts. */
+   if (l7_id_db->num_ghost_dups > 0){
+      ierr = -1;
+      L7_ASSERT(l7_id_db->num_ghost_dups == 0,
+            "Plans of databases with repeated needed indices are not supported", ierr);
+   }
+
+   num_send_indices = 0;
+   for (i=0; i<l7_id_db->num_sends; i++)
+      num_send_indices += l7_id_db->send_counts[i];
+
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, L7_PLAN_MAGIC, sizeof(header.magic));
+   header.version              = L7_PLAN_VERSION;
+   header.header_bytes         = (int32_t)sizeof(header);
+   header.numpes               = l7_id_db->numpes;
+   header.penum                = l7_id_db->penum;
+   header.my_start_index       = l7_id_db->my_start_index;
+   header.num_indices_owned    = l7_id_db->num_indices_owned;
+   header.num_indices_needed   = l7_id_db->num_indices_needed;
+   header.num_recvs            = l7_id_db->num_recvs;
+   header.num_sends            = l7_id_db->num_sends;
+   header.num_send_indices     = num_send_indices;
+   header.has_starting_indices = (l7_id_db->starting_indices != NULL);
+   header.has_ghost_offsets    = (l7_id_db->ghost_offsets != NULL);
+   header.owned_placed         = l7_id_db->owned_placed;
+
+   header.checksum = l7p_crc32c(0, l7_id_db->recv_from, (size_t)header.num_recvs*sizeof(int));
+   header.checksum = l7p_crc32c(header.checksum, l7_id_db->recv_counts, (size_t)header.num_recvs*sizeof(int));
+   header.checksum = l7p_crc32c(header.checksum, l7_id_db->send_to, (size_t)header.num_sends*sizeof(int));
+   header.checksum = l7p_crc32c(header.checksum, l7_id_db->send_counts, (size_t)header.num_sends*sizeof(int));
+   header.checksum = l7p_crc32c(header.checksum, l7_id_db->indices_local_to_send, (size_t)num_send_indices*sizeof(int));
+   if (header.has_starting_indices)
+      header.checksum = l7p_crc32c(header.checksum, l7_id_db->starting_indices, (size_t)(header.numpes+1)*sizeof(int));
+   if (header.has_ghost_offsets)
+      header.checksum = l7p_crc32c(header.checksum, l7_id_db->ghost_offsets, (size_t)header.num_indices_needed*sizeof(int));
+
+   plan_file_name(file_name, sizeof(file_name), path, l7_id_db->penum);
+   fp = fopen(file_name, "wb");
+   if (fp == NULL){
+      ierr = -1;
+      L7_ASSERT(fp != NULL, "Could not open plan file for writing", ierr);
+   }
+
+   nwritten  = fwrite(&header, sizeof(header), 1, fp);
+   nwritten += fwrite(l7_id_db->recv_from, sizeof(int), (size_t)header.num_recvs, fp);
+   nwritten += fwrite(l7_id_db->recv_counts, sizeof(int), (size_t)header.num_recvs, fp);
+   nwritten += fwrite(l7_id_db->send_to, sizeof(int), (size_t)header.num_sends, fp);
+   nwritten += fwrite(l7_id_db->send_counts, sizeof(int), (size_t)header.num_sends, fp);
+   nwritten += fwrite(l7_id_db->indices_local_to_send, sizeof(int), (size_t)num_send_indices, fp);
+   if (header.has_starting_indices)
+      nwritten += fwrite(l7_id_db->starting_indices, sizeof(int), (size_t)(header.numpes+1), fp);
+   if (header.has_ghost_offsets)
+      nwritten += fwrite(l7_id_db->ghost_offsets, sizeof(int), (size_t)header.num_indices_needed, fp);
+
+   ierr = fclose(fp);
+
+   if (ierr != 0 || nwritten != 1 + 2*(size_t)header.num_recvs + 2*(size_t)header.num_sends
+         + (size_t)num_send_indices + (header.has_starting_indices ? (size_t)(header.numpes+1) : 0)
+         + (header.has_ghost_offsets ? (size_t)header.num_indices_needed : 0)){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Failed writing plan file", ierr);
+   }
+
+#endif /* HAVE_MPI */
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Plan_Save */
+
+int L7_Plan_Load_Comm(
+      const char              *path,
+      MPI_Comm                comm,
+      int                     *l7_id
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Plan_Load_Comm creates a new update database from the plan files
+    * written by L7_Plan_Save. Each process maps <path>.<rank>, checks it
+    * against the current job, copies the arrays into the database and
+    * builds the graph communicator and datatypes. No index exchange
+    * with other processes takes place.
+    *
+    * Arguments
+    * =========
+    * path               (input) const char*
+    *                    Base file name given to L7_Plan_Save.
+    *
+    * comm               (input) MPI_Comm
+    *                    Communicator the saved database was set up on
+    *                    (rank numbers in the plan refer to it).
+    *
+    * l7_id              (output) int*
+    *                    Handle to the new database.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error. If any process cannot
+    * use its file, all processes return an error and no database is
+    * created.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over comm; it must have the same number of
+    *    processes as the one the plan was saved from.
+    * 2) Serial compilation creates a no-op.
+    *
+    */
+
+   int
+     ierr;
+
+#if defined HAVE_MPI
+
+   l7_id_database
+     *l7_id_db;
+   const struct l7_plan_header
+     *header = NULL;
+   const int
+     *recv_from = NULL,
+     *recv_counts = NULL,
+     *send_to = NULL,
+     *send_counts = NULL,
+     *indices_local_to_send = NULL,
+     *starting_indices = NULL,
+     *ghost_offsets = NULL;
+   char
+     file_name[4096];
+   const char
+     *reason = NULL;           /* Why this process cannot use its file */
+   void
+     *map = MAP_FAILED;
+   size_t
+     map_len = 0,
+     expected_len;
+   struct stat
+     file_stat;
+   uint32_t
+     checksum;
+   int
+     fd = -1,
+     i,
+     load_ok,
+     global_ok,
+     numpes,
+     penum;
+
+   if (! l7.mpi_initialized){
+      return(0);
+   }
+
+   if (l7.initialized != 1){
+      ierr = -1;
+      L7_ASSERT( l7.initialized == 1, "L7 not initialized", ierr);
+   }
+
+   if (path == NULL || l7_id == NULL){
+      ierr = -1;
+      L7_ASSERT( path != NULL && l7_id != NULL, "path or l7_id is NULL", ierr);
+   }
+
+   ierr = MPI_Comm_rank (comm, &penum );
+   L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_rank", ierr);
+
+   ierr = MPI_Comm_size (comm, &numpes );
+   L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_size", ierr);
+
+   /*
+    * Map and validate this process's file.
+    */
+
+   plan_file_name(file_name, sizeof(file_name), path, penum);
+
+   fd = open(file_name, O_RDONLY);
+   if (fd < 0 || fstat(fd, &file_stat) != 0){
+      reason = "Could not open plan file";
+   }
+   else if ((size_t)file_stat.st_size < sizeof(struct l7_plan_header)){
+      reason = "Plan file too short";
+   }
+   else {
+      map_len = (size_t)file_stat.st_size;
+      map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED)
+         reason = "Could not map plan file";
+   }
+
+   if (reason == NULL){
+      header = (const struct l7_plan_header *)map;
+
+      if (memcmp(header->magic, L7_PLAN_MAGIC, sizeof(header->magic)) != 0 ||
+          header->version != L7_PLAN_VERSION ||
+          header->header_bytes != (int32_t)sizeof(struct l7_plan_header)){
+         reason = "Not an L7 plan file or wrong version";
+      }
+      else if (header->numpes != numpes || header->penum != penum){
+         reason = "Plan was saved by a different process layout";
+      }
+      else if (header->num_recvs < 0 || header->num_sends < 0 ||
+               header->num_send_indices < 0 || header->num_indices_needed < 0){
+         reason = "Corrupt plan header";
+      }
+   }
+
+   if (reason == NULL){
+      expected_len = sizeof(struct l7_plan_header) + sizeof(int) *
+         (2*(size_t)header->num_recvs + 2*(size_t)header->num_sends +
+          (size_t)header->num_send_indices +
+          (header->has_starting_indices ? (size_t)(numpes+1) : 0) +
+          (header->has_ghost_offsets ? (size_t)header->num_indices_needed : 0));
+
+      if (expected_len != map_len){
+         reason = "Plan file size does not match its header";
+      }
+      else {
+         recv_from             = (const int *)((const char *)map + sizeof(struct l7_plan_header));
+         recv_counts           = recv_from   + header->num_recvs;
+         send_to               = recv_counts + header->num_recvs;
+         send_counts           = send_to     + header->num_sends;
+         indices_local_to_send = send_counts + header->num_sends;
+         if (header->has_starting_indices)
+            starting_indices   = indices_local_to_send + header->num_send_indices;
+         if (header->has_ghost_offsets)
+            ghost_offsets      = indices_local_to_send + header->num_send_indices +
+                                 (header->has_starting_indices ? numpes+1 : 0);
+
+         checksum = l7p_crc32c(0, recv_from, expected_len - sizeof(struct l7_plan_header));
+         if (checksum != header->checksum)
+            reason = "Plan file checksum mismatch";
+      }
+   }
+
+   /*
+    * Everyone must agree before the collective graph creation.
+    */
+
+   load_ok = (reason == NULL);
+   ierr = MPI_Allreduce(&load_ok, &global_ok, 1, MPI_INT, MPI_MIN, comm);
+
+   if (ierr != MPI_SUCCESS || ! global_ok){
+      if (reason != NULL){
+         L7_PRINT(reason == NULL, reason, -1);
+      }
+      if (map != MAP_FAILED) munmap(map, map_len);
+      if (fd >= 0) close(fd);
+      ierr = -1;
+      L7_ASSERT(global_ok, "Plan could not be loaded on every process", ierr);
+   }
+
+   /*
+    * Copy the plan into a new database.
+    */
+
+   l7_id_db = l7p_database_new();
+   if (l7_id_db == NULL){
+      munmap(map, map_len);
+      close(fd);
+      ierr = -1;
+      L7_ASSERT( l7_id_db != NULL, "Failed to allocate new database", ierr);
+   }
+
+   l7_id_db->numpes             = numpes;
+   l7_id_db->penum              = penum;
+   l7_id_db->comm               = comm;
+   l7_id_db->my_start_index     = header->my_start_index;
+   l7_id_db->num_indices_owned  = header->num_indices_owned;
+   l7_id_db->num_indices_needed = header->num_indices_needed;
+   l7_id_db->num_recvs          = header->num_recvs;
+   l7_id_db->num_sends          = header->num_sends;
+   l7_id_db->owned_placed       = header->owned_placed;
+   l7_id_db->this_tag_update    = L7_UPDATE_TAGS_MIN;
+
+   l7_id_db->recv_from   = (int *)l7p_alloc(&l7_id_db->allocator, (size_t)(header->num_recvs+1)*sizeof(int));
+   l7_id_db->recv_counts = (int *)l7p_alloc(&l7_id_db->allocator, (size_t)(header->num_recvs+1)*sizeof(int));
+   l7_id_db->send_to     = (int *)l7p_alloc(&l7_id_db->allocator, (size_t)(header->num_sends+1)*sizeof(int));
+   l7_id_db->send_counts = (int *)l7p_alloc(&l7_id_db->allocator, (size_t)(header->num_sends+1)*sizeof(int));
+   l7_id_db->indices_local_to_send = (int *)l7p_alloc(&l7_id_db->allocator, (size_t)(header->num_send_indices+1)*sizeof(int));
+   if (starting_indices)
+      l7_id_db->starting_indices = (int *)l7p_alloc(&l7_id_db->allocator, (size_t)(numpes+1)*sizeof(int));
+   if (ghost_offsets)
+      l7_id_db->ghost_offsets = (int *)l7p_alloc(&l7_id_db->allocator, (size_t)(header->num_indices_needed+1)*sizeof(int));
+
+   load_ok = l7_id_db->recv_from && l7_id_db->recv_counts && l7_id_db->send_to &&
+             l7_id_db->send_counts && l7_id_db->indices_local_to_send &&
+             (starting_indices == NULL || l7_id_db->starting_indices) &&
+             (ghost_offsets == NULL || l7_id_db->ghost_offsets);
+
+   if (load_ok){
+      memcpy(l7_id_db->recv_from,   recv_from,   (size_t)header->num_recvs*sizeof(int));
+      memcpy(l7_id_db->recv_counts, recv_counts, (size_t)header->num_recvs*sizeof(int));
+      memcpy(l7_id_db->send_to,     send_to,     (size_t)header->num_sends*sizeof(int));
+      memcpy(l7_id_db->send_counts, send_counts, (size_t)header->num_sends*sizeof(int));
+      memcpy(l7_id_db->indices_local_to_send, indices_local_to_send,
+            (size_t)header->num_send_indices*sizeof(int));
+      if (starting_indices)
+         memcpy(l7_id_db->starting_indices, starting_indices, (size_t)(numpes+1)*sizeof(int));
+      if (ghost_offsets)
+         memcpy(l7_id_db->ghost_offsets, ghost_offsets, (size_t)header->num_indices_needed*sizeof(int));
+
+      l7_id_db->recv_from_len       = l7_id_db->num_recvs;
+      l7_id_db->recv_counts_len     = l7_id_db->num_recvs;
+      l7_id_db->send_to_len         = l7_id_db->num_sends;
+      l7_id_db->send_counts_len     = l7_id_db->num_sends;
+      l7_id_db->indices_to_send_len = header->num_send_indices;
+
+      /* Global indices to send follow from the local ones, unless the
+       * owned indices were placed; nothing reads them after setup. */
+      if (! header->owned_placed){
+         l7_id_db->indices_global_to_send = (int *)l7p_alloc(&l7_id_db->allocator, (size_t)(header->num_send_indices+1)*sizeof(int));
+         if (l7_id_db->indices_global_to_send == NULL)
+            load_ok = 0;
+         else
+            for (i=0; i<header->num_send_indices; i++)
+               l7_id_db->indices_global_to_send[i] = indices_local_to_send[i] + header->my_start_index;
+      }
+   }
+
+   munmap(map, map_len);
+   close(fd);
+
+   ierr = MPI_Allreduce(&load_ok, &global_ok, 1, MPI_INT, MPI_MIN, comm);
+   if (ierr != MPI_SUCCESS || ! global_ok){
+      L7_Free(&l7_id_db->l7_id);
+      ierr = -1;
+      L7_ASSERT(global_ok, "No memory for loaded plan", ierr);
+   }
+
+   *l7_id = l7_id_db->l7_id;
+
+   if (numpes > 1){
+      ierr = l7p_database_comm_create(l7_id_db);
+      L7_ASSERT(ierr == L7_OK, "Failed to create neighbor communication state.", ierr);
+   }
+
+   l7p_database_compact(l7_id_db, l7.compact_level);
+
+#endif /* HAVE_MPI */
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Plan_Load_Comm */
+
+int L7_Plan_Load(
+      const char              *path,
+      int                     *l7_id
+      )
+{
+   return(L7_Plan_Load_Comm(path, MPI_COMM_WORLD, l7_id));
+} /* End L7_Plan_Load */
+
+#ifdef HAVE_MPI
+
+static void plan_file_name(char *name, size_t len, const char *path, int penum)
+{
+   snprintf(name, len, "%s.%d", path, penum);
+}
+
+#endif /* HAVE_MPI */
+
+void L7_PLAN_SAVE(
+      const int   *l7_id,
+      const char  *path,
+      int         *ierr
+      )
+{
+   *ierr = L7_Plan_Save(*l7_id, path);
+}
+
+void L7_PLAN_LOAD(
+      const char  *path,
+      int         *l7_id,
+      int         *ierr
+      )
+{
+   *ierr = L7_Plan_Load(path, l7_id);
+}
+
+void L7_PLAN_LOAD_COMM(
+      const char  *path,
+      MPI_Fint    *comm,
+      int         *l7_id,
+      int         *ierr
+      )
+{
+   *ierr = L7_Plan_Load_Comm(path, MPI_Comm_f2c(*comm), l7_id);
+}
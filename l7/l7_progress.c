@@ -0,0 +1,538 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             /* pthread_setaffinity_np, sched_getaffinity */
+#endif
+#include <stdlib.h>
+#include <sched.h>
+#include <time.h>
+#include "l7.h"
+#include "l7p.h"
+
+#ifdef HAVE_MPI
+#include <pthread.h>
+#endif
+
+#define L7_LOCATION "L7_PROGRESS"
+
+/*
+ * Nonblocking L7 operations and the engine that drives them.
+ *
+ * Requests come from L7_Iupdate and the nonblocking collectives
+ * (l7_icollectives.c). Many MPI libraries only advance a nonblocking
+ * collective while the application is inside MPI, so an operation
+ * overlapped with compute makes little headway until L7_Wait.
+ * L7_Progress tests every outstanding request once and can be called
+ * from inner loops; with
+ * L7_PROGRESS_THREAD=1 a helper thread does the same in the background,
+ * bound to a spare core (see l7p_progress_start).
+ */
+
+#ifdef HAVE_MPI
+
+static pthread_t
+  progress_thread;
+static int
+  progress_running = 0,
+  progress_stop = 0;
+static long
+  progress_interval_ns = 100000;
+
+int l7p_request_new(void)
+{
+   /*
+    * Purpose
+    * =======
+    * Claim a free request handle, returned in state BUSY, or return
+    * L7_REQUEST_NULL if all L7_MAX_NUM_REQUESTS are outstanding.
+    */
+
+   int
+     request,
+     expected,
+     max_request;
+
+   for (request = 1; request <= L7_MAX_NUM_REQUESTS; request++){
+      expected = L7P_REQUEST_FREE;
+      if (__atomic_compare_exchange_n(&l7.requests[request].state, &expected,
+            L7P_REQUEST_BUSY, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)){
+         __atomic_add_fetch(&l7.num_requests_active, 1, __ATOMIC_RELAXED);
+         max_request = __atomic_load_n(&l7.max_request, __ATOMIC_RELAXED);
+         while (request > max_request &&
+               !__atomic_compare_exchange_n(&l7.max_request, &max_request,
+                  request, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+         return(request);
+      }
+   }
+   return(L7_REQUEST_NULL);
+}
+
+void l7p_request_post(
+      const int request
+      )
+{
+   /*
+    * Hand a filled-in request over to L7_Wait, L7_Test and L7_Progress.
+    */
+
+   __atomic_store_n(&l7.requests[request].state, L7P_REQUEST_ACTIVE, __ATOMIC_RELEASE);
+}
+
+void l7p_request_release(
+      const int request
+      )
+{
+   /*
+    * Give back a request claimed by l7p_request_new that was never
+    * posted, after its MPI call failed.
+    */
+
+   struct l7_request
+     *req = &l7.requests[request];
+
+   req->l7_id_db    = NULL;
+   req->data_buffer = NULL;
+   req->reductions  = NULL;
+
+   __atomic_sub_fetch(&l7.num_requests_active, 1, __ATOMIC_RELAXED);
+   __atomic_store_n(&req->state, L7P_REQUEST_FREE, __ATOMIC_RELEASE);
+}
+
+static int request_poll(
+      struct l7_request *req
+      )
+{
+   /*
+    * Test an ACTIVE request once unless another thread holds it. Returns
+    * the MPI error code.
+    */
+
+   int
+     expected = L7P_REQUEST_ACTIVE,
+     flag = 0,
+     ierr;
+
+   if (!__atomic_compare_exchange_n(&req->state, &expected, L7P_REQUEST_BUSY,
+         0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      return(MPI_SUCCESS);
+
+   ierr = MPI_Test(&req->mpi_request, &flag, MPI_STATUS_IGNORE);
+   if (flag){
+      req->time_done = MPI_Wtime();
+      __atomic_store_n(&req->state, L7P_REQUEST_DONE, __ATOMIC_RELEASE);
+   }
+   else {
+      __atomic_store_n(&req->state, L7P_REQUEST_ACTIVE, __ATOMIC_RELEASE);
+   }
+   return(ierr);
+}
+
+static void request_finish(
+      struct l7_request *req
+      )
+{
+   /*
+    * Finish a DONE request: copy repeated ghosts and record statistics
+    * of an update, or store the results of a reduction, and free it.
+    */
+
+   l7_id_database
+     *l7_id_db = req->l7_id_db;
+
+   if (l7_id_db){
+      if (l7_id_db->num_ghost_dups > 0)
+         l7p_ghost_dups_fill(l7_id_db, req->data_buffer, req->sizeof_type);
+
+      l7_id_db->stats.num_updates++;
+      l7p_stats_record(&l7_id_db->stats, l7_id_db->nbr_bytes_sent,
+            l7_id_db->nbr_bytes_recvd, l7_id_db->send_counts,
+            l7_id_db->recv_counts, req->sizeof_type,
+            req->time_done - req->time_start);
+   }
+   if (req->reductions)
+      l7p_reduce_multi_finish(req);
+
+   req->l7_id_db    = NULL;
+   req->data_buffer = NULL;
+
+   __atomic_sub_fetch(&l7.num_requests_active, 1, __ATOMIC_RELAXED);
+   __atomic_store_n(&req->state, L7P_REQUEST_FREE, __ATOMIC_RELEASE);
+}
+
+static void *progress_main(
+      void *arg
+      )
+{
+   struct timespec
+     pause;
+
+   (void)arg;
+
+   pause.tv_sec  = progress_interval_ns / 1000000000L;
+   pause.tv_nsec = progress_interval_ns % 1000000000L;
+
+   while (!__atomic_load_n(&progress_stop, __ATOMIC_ACQUIRE)){
+      if (__atomic_load_n(&l7.num_requests_active, __ATOMIC_RELAXED) > 0){
+         L7_Progress();
+         sched_yield();
+      }
+      else {
+         nanosleep(&pause, NULL);
+      }
+   }
+   return(NULL);
+}
+
+void l7p_progress_start(void)
+{
+   /*
+    * Purpose
+    * =======
+    * Start the progress thread if the environment asks for it.
+    *
+    * Notes
+    * =====
+    * 1) L7_PROGRESS_THREAD=1 turns it on; it needs MPI_THREAD_MULTIPLE,
+    *    which L7_Init then requests.
+    * 2) The thread is bound to L7_PROGRESS_CPU if set, otherwise to the
+    *    last CPU this process may run on, so that launching with one
+    *    spare core per rank keeps it off the compute threads.
+    * 3) L7_PROGRESS_INTERVAL sets how long, in microseconds, the idle
+    *    thread sleeps between checks for work (default 100).
+    *
+    */
+
+   cpu_set_t
+     cpus;
+   int
+     cpu,
+     ierr;
+
+   if (progress_running)
+      return;
+   if (getenv("L7_PROGRESS_THREAD") == NULL || atoi(getenv("L7_PROGRESS_THREAD")) == 0)
+      return;
+
+   if (l7.thread_level < MPI_THREAD_MULTIPLE){
+      L7_PRINT(l7.thread_level >= MPI_THREAD_MULTIPLE,
+            "Progress thread needs MPI_THREAD_MULTIPLE, not started", -1);
+      return;
+   }
+
+   if (getenv("L7_PROGRESS_INTERVAL") != NULL && atol(getenv("L7_PROGRESS_INTERVAL")) > 0)
+      progress_interval_ns = atol(getenv("L7_PROGRESS_INTERVAL")) * 1000L;
+
+   progress_stop = 0;
+   ierr = pthread_create(&progress_thread, NULL, progress_main, NULL);
+   if (ierr != 0){
+      L7_PRINT(ierr == 0, "Failed to start progress thread", ierr);
+      return;
+   }
+   progress_running = 1;
+
+   cpu = -1;
+   if (getenv("L7_PROGRESS_CPU") != NULL){
+      cpu = atoi(getenv("L7_PROGRESS_CPU"));
+   }
+   else if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0 && CPU_COUNT(&cpus) > 1){
+      for (cpu = CPU_SETSIZE-1; cpu >= 0 && !CPU_ISSET(cpu, &cpus); cpu--);
+   }
+   if (cpu >= 0 && cpu < CPU_SETSIZE){
+      CPU_ZERO(&cpus);
+      CPU_SET(cpu, &cpus);
+      pthread_setaffinity_np(progress_thread, sizeof(cpus), &cpus);
+   }
+}
+
+void l7p_progress_stop(void)
+{
+   /*
+    * Stop the progress thread, ahead of MPI_Finalize.
+    */
+
+   if (!progress_running)
+      return;
+
+   __atomic_store_n(&progress_stop, 1, __ATOMIC_RELEASE);
+   pthread_join(progress_thread, NULL);
+   progress_running = 0;
+}
+
+#endif /* HAVE_MPI */
+
+int L7_Progress(void)
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Progress tests each outstanding nonblocking L7 operation once,
+    * letting MPI advance them. Cheap enough for inner loops: it returns
+    * at once when nothing is outstanding.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Completed operations stay outstanding until L7_Wait or L7_Test.
+    * 2) Serial compilation creates a no-op.
+    *
+    */
+
+#ifdef HAVE_MPI
+
+   int
+     request,
+     max_request,
+     ierr;
+
+   if (__atomic_load_n(&l7.num_requests_active, __ATOMIC_RELAXED) == 0)
+      return(L7_OK);
+
+   max_request = __atomic_load_n(&l7.max_request, __ATOMIC_RELAXED);
+   for (request = 1; request <= max_request; request++){
+      if (__atomic_load_n(&l7.requests[request].state, __ATOMIC_RELAXED) != L7P_REQUEST_ACTIVE)
+         continue;
+      ierr = request_poll(&l7.requests[request]);
+      L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Test", ierr);
+   }
+
+#endif /* HAVE_MPI */
+
+   return(L7_OK);
+
+} /* End L7_Progress */
+
+int L7_Test(
+      int                     *request,
+      int                     *flag
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Test checks whether a nonblocking L7 operation has completed.
+    *
+    * Arguments
+    * =========
+    * request            (input/output) int*
+    *                    Handle from L7_Iupdate; set to L7_REQUEST_NULL
+    *                    once the operation has completed.
+    *
+    * flag               (output) int*
+    *                    1 if the operation has completed (or request was
+    *                    L7_REQUEST_NULL), else 0.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    */
+
+   int
+     ierr;
+
+   *flag = 1;
+
+#ifdef HAVE_MPI
+
+   struct l7_request
+     *req;
+
+   if (*request == L7_REQUEST_NULL)
+      return(L7_OK);
+
+   if (*request < 0 || *request > L7_MAX_NUM_REQUESTS){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Invalid request", ierr);
+   }
+
+   req = &l7.requests[*request];
+
+   ierr = request_poll(req);
+   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Test", ierr);
+
+   if (__atomic_load_n(&req->state, __ATOMIC_ACQUIRE) != L7P_REQUEST_DONE){
+      *flag = 0;
+      return(L7_OK);
+   }
+
+   request_finish(req);
+   *request = L7_REQUEST_NULL;
+
+#endif /* HAVE_MPI */
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Test */
+
+int L7_Wait(
+      int                     *request
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Wait completes a nonblocking L7 operation.
+    *
+    * Arguments
+    * =========
+    * request            (input/output) int*
+    *                    Handle from L7_Iupdate; set to L7_REQUEST_NULL.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    */
+
+   int
+     ierr;
+
+#ifdef HAVE_MPI
+
+   struct l7_request
+     *req;
+   int
+     expected;
+
+   if (*request == L7_REQUEST_NULL)
+      return(L7_OK);
+
+   if (*request < 0 || *request > L7_MAX_NUM_REQUESTS){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Invalid request", ierr);
+   }
+
+   req = &l7.requests[*request];
+
+   /* The progress thread may be testing it; wait for it to let go. */
+   for (;;){
+      expected = L7P_REQUEST_ACTIVE;
+      if (__atomic_compare_exchange_n(&req->state, &expected, L7P_REQUEST_BUSY,
+            0, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)){
+         ierr = MPI_Wait(&req->mpi_request, MPI_STATUS_IGNORE);
+         L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Wait", ierr);
+         req->time_done = MPI_Wtime();
+         break;
+      }
+      if (expected == L7P_REQUEST_DONE)
+         break;
+      if (expected == L7P_REQUEST_FREE){
+         ierr = -1;
+         L7_ASSERT(ierr == 0, "Request is not outstanding", ierr);
+      }
+      sched_yield();
+   }
+
+   request_finish(req);
+   *request = L7_REQUEST_NULL;
+
+#endif /* HAVE_MPI */
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Wait */
+
+int L7_Waitall(
+      const int               count,
+      int                     *requests
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Waitall completes count nonblocking L7 operations.
+    */
+
+   int
+     i,
+     ierr;
+
+   for (i=0; i<count; i++){
+      ierr = L7_Wait(&requests[i]);
+      if (ierr != L7_OK)
+         return(ierr);
+   }
+
+   return(L7_OK);
+
+} /* End L7_Waitall */
+
+int L7_Get_Progress_Thread(void)
+{
+   /*
+    * Returns 1 if the progress thread is running, else 0.
+    */
+
+#ifdef HAVE_MPI
+   return(progress_running);
+#else
+   return(0);
+#endif
+}
+
+void L7_WAIT(
+      int   *request,
+      int   *ierr
+      )
+{
+   *ierr = L7_Wait(request);
+}
+
+void L7_TEST(
+      int   *request,
+      int   *flag,
+      int   *ierr
+      )
+{
+   *ierr = L7_Test(request, flag);
+}
+
+void L7_PROGRESS(
+      int   *ierr
+      )
+{
+   *ierr = L7_Progress();
+}
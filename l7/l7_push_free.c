@@ -96,9 +96,6 @@ int L7_Push_Free(
       return(0);
    }
 
-   ierr = MPI_Comm_rank(MPI_COMM_WORLD, &l7.penum);
-   L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_rank error", ierr);
-
    if (l7.initialized != 1){
       ierr = -1;
       L7_ASSERT( l7.initialized != 1, "L7 not initialized", ierr);
@@ -131,6 +128,9 @@ int L7_Push_Free(
     * Free all data associated with this id.
     */
 
+   l7p_stats_accumulate(&l7.stats_freed, &l7_push_db->stats);
+   l7p_stats_nbr_free(&l7_push_db->stats, &l7_push_db->nbr_bytes_sent, &l7_push_db->nbr_bytes_recvd);
+
    if (l7_push_db->comm_partner){
       free(l7_push_db->comm_partner);
       l7_push_db->comm_partner = NULL;
@@ -125,6 +125,9 @@ int L7_Push_Setup(
 	l7_push_id_database
 	  *l7_push_id_db;
 
+	double
+	  setup_time_start;            /* MPI_Wtime at entry, for stats.       */
+
 	/*
 	 * Executable Statements
 	 */
@@ -133,6 +136,8 @@ int L7_Push_Setup(
 		return(0);
 	}
 
+	setup_time_start = MPI_Wtime();
+
         if (l7.initialized != 1){
 		ierr = -1;
 		L7_ASSERT( l7.initialized == 1, "L7 not initialized", ierr);
@@ -433,6 +438,13 @@ int L7_Push_Setup(
         L7P_Push_Type_Create(l7_push_id_db, L7_INT, &l7_push_id_db->nbr_state.update_datatypes[4]);
         L7P_Push_Type_Create(l7_push_id_db, L7_DOUBLE, &l7_push_id_db->nbr_state.update_datatypes[8]);
 
+        ierr = l7p_stats_nbr_create(&l7_push_id_db->stats, &l7_push_id_db->nbr_bytes_sent,
+              &l7_push_id_db->nbr_bytes_recvd, num_comm_partners, num_comm_partners);
+        L7_ASSERT(ierr == L7_OK, "Could not create statistics", ierr);
+
+        l7_push_id_db->stats.num_setups++;
+        l7_push_id_db->stats.setup_time += MPI_Wtime() - setup_time_start;
+
 #endif /* HAVE_MPI */
 
 	ierr = L7_OK;
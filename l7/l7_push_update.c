@@ -143,12 +143,19 @@ int L7_Push_Update(
 
    int sizeof_type = l7p_sizeof(L7_INT);
    struct l7_update_datatype *dt = &l7_push_id_db->nbr_state.update_datatypes[sizeof_type];
-   MPI_Neighbor_alltoallw(
+   double time_start = MPI_Wtime();
+   ierr = MPI_Neighbor_alltoallw(
 			  array, l7_push_id_db->nbr_state.mpi_send_counts,
 			  (MPI_Aint *)l7_push_id_db->nbr_state.mpi_send_offsets, dt->out_types,
 			  return_array, l7_push_id_db->nbr_state.mpi_recv_counts,
 			  (MPI_Aint *)l7_push_id_db->nbr_state.mpi_recv_offsets, dt->in_types,
 			  l7_push_id_db->nbr_state.comm);
+   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Neighbor_alltoallw", ierr);
+
+   l7_push_id_db->stats.num_pushes++;
+   l7p_stats_record(&l7_push_id_db->stats, l7_push_id_db->nbr_bytes_sent,
+         l7_push_id_db->nbr_bytes_recvd, l7_push_id_db->send_buffer_count,
+         l7_push_id_db->recv_buffer_count, sizeof_type, MPI_Wtime() - time_start);
 
 #endif /* HAVE_MPI */
 
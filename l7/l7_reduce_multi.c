@@ -0,0 +1,595 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_REDUCE_MULTI"
+
+/*
+ * Batched scalar reductions.
+ *
+ * Every entry is first reduced locally, in long long for the integer
+ * types and in double for the floating point ones (as L7_Sum does for
+ * floats), into a slot that also carries its operation and kind. One
+ * MPI_Allreduce with a user-defined commutative op then combines all
+ * slots, and each result is converted back to the caller's type.
+ */
+
+#define REDUCE_MULTI_STACK  16     /* Batches up to this size need no malloc. */
+
+static int reduce_is_float(
+      const enum L7_Datatype  l7_datatype
+      )
+{
+   switch (l7_datatype){
+      case L7_FLOAT:
+      case L7_REAL4:
+      case L7_DOUBLE:
+      case L7_REAL8:
+         return(1);
+      default:
+         return(0);
+   }
+}
+
+static int reduce_local(
+      const struct L7_Reduction  *r,
+      struct l7p_reduce_slot         *slot
+      )
+{
+   /*
+    * Reduce input[0:count-1] into slot; -1 for an unsupported type or
+    * operation.
+    */
+
+   long long
+     acc_i = 0;
+   double
+     acc_d = 0.0;
+   int
+     i,
+     is_float;
+
+   if (r->op < L7_REDUCE_OP_MIN || r->op > L7_REDUCE_OP_MAX)
+      return(-1);
+
+   is_float = reduce_is_float(r->l7_datatype);
+
+   if (r->op == L7_REDUCE_MAX){
+      acc_i = LLONG_MIN;
+      acc_d = -DBL_MAX;
+   }
+   else if (r->op == L7_REDUCE_MIN){
+      acc_i = LLONG_MAX;
+      acc_d = DBL_MAX;
+   }
+
+   switch (r->l7_datatype){
+      case L7_INT:
+      case L7_INTEGER4:
+         if (r->op == L7_REDUCE_MAX) acc_i = INT_MIN;
+         if (r->op == L7_REDUCE_MIN) acc_i = INT_MAX;
+         for (i=0; i<r->count; i++){
+            long long x = ((const int *)r->input)[i];
+            if (r->op == L7_REDUCE_SUM)                   acc_i += x;
+            else if ((r->op == L7_REDUCE_MAX) == (x > acc_i)) acc_i = x;
+         }
+         break;
+      case L7_LONG:
+         for (i=0; i<r->count; i++){
+            long long x = ((const long *)r->input)[i];
+            if (r->op == L7_REDUCE_SUM)                   acc_i += x;
+            else if ((r->op == L7_REDUCE_MAX) == (x > acc_i)) acc_i = x;
+         }
+         break;
+      case L7_LONG_LONG_INT:
+      case L7_INTEGER8:
+         for (i=0; i<r->count; i++){
+            long long x = ((const long long *)r->input)[i];
+            if (r->op == L7_REDUCE_SUM)                   acc_i += x;
+            else if ((r->op == L7_REDUCE_MAX) == (x > acc_i)) acc_i = x;
+         }
+         break;
+      case L7_FLOAT:
+      case L7_REAL4:
+         if (r->op == L7_REDUCE_MAX) acc_d = -FLT_MAX;
+         if (r->op == L7_REDUCE_MIN) acc_d = FLT_MAX;
+         for (i=0; i<r->count; i++){
+            double x = ((const float *)r->input)[i];
+            if (r->op == L7_REDUCE_SUM)                   acc_d += x;
+            else if ((r->op == L7_REDUCE_MAX) == (x > acc_d)) acc_d = x;
+         }
+         break;
+      case L7_DOUBLE:
+      case L7_REAL8:
+         for (i=0; i<r->count; i++){
+            double x = ((const double *)r->input)[i];
+            if (r->op == L7_REDUCE_SUM)                   acc_d += x;
+            else if ((r->op == L7_REDUCE_MAX) == (x > acc_d)) acc_d = x;
+         }
+         break;
+      default:
+         return(-1);
+   }
+
+   slot->code = (long long)r->op * 2 + is_float;
+   if (is_float)
+      slot->v.d = acc_d;
+   else
+      slot->v.i = acc_i;
+
+   return(0);
+}
+
+static void reduce_store(
+      const struct L7_Reduction  *r,
+      const struct l7p_reduce_slot   *slot
+      )
+{
+   switch (r->l7_datatype){
+      case L7_INT:
+      case L7_INTEGER4:
+         *((int *)r->output) = (int)slot->v.i;
+         break;
+      case L7_LONG:
+         *((long *)r->output) = (long)slot->v.i;
+         break;
+      case L7_LONG_LONG_INT:
+      case L7_INTEGER8:
+         *((long long *)r->output) = slot->v.i;
+         break;
+      case L7_FLOAT:
+      case L7_REAL4:
+         *((float *)r->output) = (float)slot->v.d;
+         break;
+      default:
+         *((double *)r->output) = slot->v.d;
+         break;
+   }
+}
+
+#ifdef HAVE_MPI
+
+static void reduce_multi_combine(
+      void          *invec,
+      void          *inoutvec,
+      int           *len,
+      MPI_Datatype  *datatype
+      )
+{
+   const struct l7p_reduce_slot
+     *in = (const struct l7p_reduce_slot *)invec;
+   struct l7p_reduce_slot
+     *io = (struct l7p_reduce_slot *)inoutvec;
+   int
+     k;
+
+   (void)datatype;
+
+   for (k=0; k<*len; k++){
+      switch (in[k].code){
+         case 2*L7_REDUCE_SUM:
+            io[k].v.i += in[k].v.i;
+            break;
+         case 2*L7_REDUCE_SUM+1:
+            io[k].v.d += in[k].v.d;
+            break;
+         case 2*L7_REDUCE_MAX:
+            if (in[k].v.i > io[k].v.i) io[k].v.i = in[k].v.i;
+            break;
+         case 2*L7_REDUCE_MAX+1:
+            if (in[k].v.d > io[k].v.d) io[k].v.d = in[k].v.d;
+            break;
+         case 2*L7_REDUCE_MIN:
+            if (in[k].v.i < io[k].v.i) io[k].v.i = in[k].v.i;
+            break;
+         case 2*L7_REDUCE_MIN+1:
+            if (in[k].v.d < io[k].v.d) io[k].v.d = in[k].v.d;
+            break;
+      }
+   }
+}
+
+#endif /* HAVE_MPI */
+
+void l7p_reduce_multi_init(void)
+{
+   /*
+    * Purpose
+    * =======
+    * Create the slot datatype and combining op of L7_Reduce_Multi; MPI
+    * must be initialized.
+    */
+
+#ifdef HAVE_MPI
+   MPI_Type_contiguous(2, MPI_LONG_LONG_INT, &l7.reduce_multi_type);
+   MPI_Type_commit(&l7.reduce_multi_type);
+   MPI_Op_create(reduce_multi_combine, 1, &l7.reduce_multi_op);
+#endif
+
+} /* End l7p_reduce_multi_init */
+
+void l7p_reduce_multi_free(void)
+{
+#ifdef HAVE_MPI
+   if (l7.reduce_multi_type != MPI_DATATYPE_NULL && l7.reduce_multi_type != 0){
+      MPI_Type_free(&l7.reduce_multi_type);
+      MPI_Op_free(&l7.reduce_multi_op);
+   }
+   l7.reduce_multi_type = MPI_DATATYPE_NULL;
+   l7.reduce_multi_op   = MPI_OP_NULL;
+#endif
+
+} /* End l7p_reduce_multi_free */
+
+int L7_Reduce_Multi_Comm(
+      struct L7_Reduction     *reductions,
+      const int               num_reductions,
+      MPI_Comm                comm
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Reduce_Multi_Comm performs a batch of scalar sums, maxima and
+    * minima, of mixed datatypes, with a single MPI_Allreduce. See
+    * L7_Ireduce_Multi_Comm for a nonblocking version.
+    *
+    * Arguments
+    * =========
+    * reductions         (input/output) struct L7_Reduction*
+    *                    The reductions; each output is set on return.
+    *
+    * num_reductions     (input) const int
+    *                    Number of reductions.
+    *
+    * comm               (input) MPI_Comm
+    *                    Communicator to reduce over.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Integers are combined in 64 bits and truncated to the output
+    *    type, floats in double precision. Integer results, maxima and
+    *    minima equal those of separate L7_Sum, L7_Max and L7_Min calls;
+    *    floating-point sums agree only up to rounding, since the custom
+    *    op adds the partial sums in a different order.
+    * 2) Collective; every process must pass the same operations and
+    *    datatypes in the same order.
+    * 3) Serial compilation reduces locally.
+    * 4) Double sums use the plain sum even in L7_SUM_REPRODUCIBLE
+    *    mode; only L7_Sum follows L7_Set_Sum_Mode.
+    *
+    */
+
+   struct l7p_reduce_slot
+     stack_slots[REDUCE_MULTI_STACK],
+     *slots;
+   int
+     ierr,
+     k;
+
+   if (num_reductions < 0 || (num_reductions > 0 && reductions == NULL)){
+      ierr = -1;
+      L7_ASSERT( num_reductions >= 0 && (num_reductions == 0 || reductions != NULL),
+            "Invalid reductions", ierr);
+   }
+
+   if (num_reductions == 0)
+      return(L7_OK);
+
+   slots = stack_slots;
+   if (num_reductions > REDUCE_MULTI_STACK){
+      slots = (struct l7p_reduce_slot *)malloc((size_t)num_reductions*sizeof(struct l7p_reduce_slot));
+      if (slots == NULL){
+         ierr = -1;
+         L7_ASSERT( slots != NULL, "No memory for reduction slots", ierr);
+      }
+   }
+
+   for (k=0; k<num_reductions; k++){
+      if (reduce_local(&reductions[k], &slots[k]) != 0){
+         if (slots != stack_slots) free(slots);
+         ierr = -1;
+         L7_ASSERT( ierr == 0, "Unsupported datatype or operation", ierr);
+      }
+   }
+
+#ifdef HAVE_MPI
+   if (l7.mpi_initialized){
+      ierr = l7p_allreduce(MPI_IN_PLACE, slots, num_reductions,
+            l7.reduce_multi_type, l7.reduce_multi_op, comm);
+      if (ierr != MPI_SUCCESS){
+         if (slots != stack_slots) free(slots);
+         L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Allreduce", ierr);
+      }
+   }
+#else
+   (void)comm;
+#endif
+
+   for (k=0; k<num_reductions; k++)
+      reduce_store(&reductions[k], &slots[k]);
+
+   if (slots != stack_slots)
+      free(slots);
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Reduce_Multi_Comm */
+
+int L7_Reduce_Multi(
+      struct L7_Reduction     *reductions,
+      const int               num_reductions
+      )
+{
+   return(L7_Reduce_Multi_Comm(reductions, num_reductions, MPI_COMM_WORLD));
+} /* End L7_Reduce_Multi */
+
+int l7p_reduce_multi_post(
+      struct L7_Reduction     *reductions,
+      const int               num_reductions,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Reduce a batch locally and start combining it with MPI_Iallreduce;
+    * l7p_reduce_multi_finish stores the results when the request
+    * completes. Without MPI the results are stored at once and request
+    * is L7_REQUEST_NULL.
+    */
+
+   struct L7_Reduction
+     *saved;
+   struct l7p_reduce_slot
+     one_slot,
+     *slots;
+   int
+     ierr,
+     k;
+
+   *request = L7_REQUEST_NULL;
+
+   if (num_reductions < 0 || (num_reductions > 0 && reductions == NULL)){
+      ierr = -1;
+      L7_ASSERT( num_reductions >= 0 && (num_reductions == 0 || reductions != NULL),
+            "Invalid reductions", ierr);
+   }
+
+   if (num_reductions == 0)
+      return(L7_OK);
+
+   slots = &one_slot;
+   saved = NULL;
+   if (num_reductions > 1){
+      slots = (struct l7p_reduce_slot *)malloc((size_t)num_reductions*sizeof(struct l7p_reduce_slot));
+      saved = (struct L7_Reduction *)malloc((size_t)num_reductions*sizeof(struct L7_Reduction));
+      if (slots == NULL || saved == NULL){
+         free(slots);
+         free(saved);
+         ierr = -1;
+         L7_ASSERT( ierr == 0, "No memory for reduction slots", ierr);
+      }
+   }
+
+   for (k=0; k<num_reductions; k++){
+      if (reduce_local(&reductions[k], &slots[k]) != 0){
+         if (slots != &one_slot){
+            free(slots);
+            free(saved);
+         }
+         ierr = -1;
+         L7_ASSERT( ierr == 0, "Unsupported datatype or operation", ierr);
+      }
+   }
+
+#ifdef HAVE_MPI
+   if (l7.mpi_initialized){
+      struct l7_request
+        *req;
+
+      *request = l7p_request_new();
+      if (*request == L7_REQUEST_NULL){
+         if (slots != &one_slot){
+            free(slots);
+            free(saved);
+         }
+         ierr = -1;
+         L7_ASSERT(ierr == 0, "Too many outstanding L7 requests", ierr);
+      }
+      req = &l7.requests[*request];
+
+      if (slots == &one_slot){
+         req->slot       = one_slot;
+         req->reduction  = reductions[0];
+         req->slots      = &req->slot;
+         req->reductions = &req->reduction;
+      }
+      else {
+         for (k=0; k<num_reductions; k++)
+            saved[k] = reductions[k];
+         req->slots      = slots;
+         req->reductions = saved;
+      }
+      req->num_reductions = num_reductions;
+      req->l7_id_db       = NULL;
+      req->data_buffer    = NULL;
+      req->time_start     = MPI_Wtime();
+
+      ierr = MPI_Iallreduce(MPI_IN_PLACE, req->slots, num_reductions,
+            l7.reduce_multi_type, l7.reduce_multi_op, comm, &req->mpi_request);
+      if (ierr != MPI_SUCCESS){
+         if (slots != &one_slot){
+            free(slots);
+            free(saved);
+         }
+         l7p_request_release(*request);
+         *request = L7_REQUEST_NULL;
+      }
+      L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Iallreduce", ierr);
+
+      l7p_request_post(*request);
+      return(L7_OK);
+   }
+#else
+   (void)comm;
+#endif
+
+   for (k=0; k<num_reductions; k++)
+      reduce_store(&reductions[k], &slots[k]);
+
+   if (slots != &one_slot){
+      free(slots);
+      free(saved);
+   }
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End l7p_reduce_multi_post */
+
+void l7p_reduce_multi_finish(
+      struct l7_request       *req
+      )
+{
+   /*
+    * Store the results of a completed nonblocking reduction and release
+    * its slots.
+    */
+
+#ifdef HAVE_MPI
+   int
+     k;
+
+   for (k=0; k<req->num_reductions; k++)
+      reduce_store(&req->reductions[k], &req->slots[k]);
+
+   if (req->slots != &req->slot){
+      free(req->slots);
+      free(req->reductions);
+   }
+   req->slots          = NULL;
+   req->reductions     = NULL;
+   req->num_reductions = 0;
+#else
+   (void)req;
+#endif
+
+} /* End l7p_reduce_multi_finish */
+
+int L7_Ireduce_Multi_Comm(
+      struct L7_Reduction     *reductions,
+      const int               num_reductions,
+      MPI_Comm                comm,
+      int                     *request
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Ireduce_Multi_Comm starts a batch of scalar reductions as
+    * L7_Reduce_Multi_Comm does; the outputs are set by L7_Wait or a
+    * successful L7_Test on request.
+    *
+    * Arguments
+    * =========
+    * reductions         (input) struct L7_Reduction*
+    *                    The reductions. Inputs are read before return and
+    *                    the array may be reused; outputs must stay valid
+    *                    until completion.
+    *
+    * num_reductions     (input) const int
+    *                    Number of reductions.
+    *
+    * comm               (input) MPI_Comm
+    *                    Communicator to reduce over.
+    *
+    * request            (output) int*
+    *                    Handle to pass to L7_Wait or L7_Test;
+    *                    L7_REQUEST_NULL if the results are already set.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    */
+
+   return(l7p_reduce_multi_post(reductions, num_reductions, comm, request));
+
+} /* End L7_Ireduce_Multi_Comm */
+
+int L7_Ireduce_Multi(
+      struct L7_Reduction     *reductions,
+      const int               num_reductions,
+      int                     *request
+      )
+{
+   return(L7_Ireduce_Multi_Comm(reductions, num_reductions, MPI_COMM_WORLD, request));
+} /* End L7_Ireduce_Multi */
+
+void l7_reduce_multi_(
+      struct L7_Reduction     *reductions,
+      const int               *num_reductions,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Reduce_Multi(reductions, *num_reductions);
+}
+
+void l7_ireduce_multi_(
+      struct L7_Reduction     *reductions,
+      const int               *num_reductions,
+      int                     *request,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Ireduce_Multi(reductions, *num_reductions, request);
+}
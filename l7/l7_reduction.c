@@ -42,16 +42,18 @@
 #include <float.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <string.h>
 #include "l7.h"
 #include "l7p.h"
 
 #define L7_LOCATION "L7_REDUCE"
 
-void L7_Sum(
+void L7_Sum_Comm(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
-      void                    *output
+      void                    *output,
+      MPI_Comm                comm
       )
 {
 
@@ -59,7 +61,6 @@ void L7_Sum(
 	int       local_sum_int;
 	long      local_sum_long;
 	long long local_sum_long_long;
-	int       i;
 
 #ifdef HAVE_MPI
 	double out_double;
@@ -67,26 +68,20 @@ void L7_Sum(
 	switch (l7_datatype){
 	case L7_INT:
 	case L7_INTEGER4:
-		local_sum_int = 0;
-		for (i=0; i<count; i++){
-			local_sum_int += ((int*)input)[i];
-		}
+		l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_SUM, &local_sum_int);
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_sum_int, output, 1, MPI_INT, MPI_SUM,
-					MPI_COMM_WORLD);
+			l7p_allreduce(&local_sum_int, output, 1, MPI_INT, MPI_SUM,
+					comm);
 		}
 		else{
 			*((int *)output) = local_sum_int;
 		}
 		break;
    case L7_LONG:
-      local_sum_long = 0L;
-      for (i=0; i<count; i++){
-         local_sum_long += ((long *)input)[i];
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_SUM, &local_sum_long);
       if (l7.initialized_mpi){
-         MPI_Allreduce(&local_sum_long, output, 1, MPI_LONG,
-               MPI_SUM, MPI_COMM_WORLD);
+         l7p_allreduce(&local_sum_long, output, 1, MPI_LONG,
+               MPI_SUM, comm);
       }
       else{
          *((long *)output) = local_sum_long;
@@ -94,13 +89,10 @@ void L7_Sum(
       break;
 	case L7_LONG_LONG_INT:
 	case L7_INTEGER8:
-		local_sum_long_long = 0L;
-		for (i=0; i<count; i++){
-			local_sum_long_long += ((long long*)input)[i];
-		}
+		l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_SUM, &local_sum_long_long);
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_sum_long_long, output, 1, MPI_LONG_LONG_INT,
-					MPI_SUM, MPI_COMM_WORLD);
+			l7p_allreduce(&local_sum_long_long, output, 1, MPI_LONG_LONG_INT,
+					MPI_SUM, comm);
 		}
 		else{
 			*((long long *)output) = local_sum_long_long;
@@ -108,13 +100,10 @@ void L7_Sum(
 		break;
 	case L7_FLOAT:
 	case L7_REAL4:
-		local_sum_double = 0.0;
-		for (i=0; i<count; i++){
-			local_sum_double += ((float*)input)[i];
-		}
+		l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_SUM, &local_sum_double);
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_sum_double, &out_double, 1, MPI_DOUBLE_PRECISION,
-					MPI_SUM, MPI_COMM_WORLD);
+			l7p_allreduce(&local_sum_double, &out_double, 1, MPI_DOUBLE_PRECISION,
+					MPI_SUM, comm);
 			*((float*)output) = (float)out_double;
 		}
 		else{
@@ -123,13 +112,14 @@ void L7_Sum(
 		break;
 	case L7_DOUBLE:
 	case L7_REAL8:
-		local_sum_double = 0.0;
-		for (i=0; i<count; i++){
-			local_sum_double += ((double*)input)[i];
+		if (l7.sum_mode == L7_SUM_REPRODUCIBLE){
+			l7p_repro_sum((double *)input, count, (double *)output, comm);
+			break;
 		}
+		l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_SUM, &local_sum_double);
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_sum_double, output, 1, MPI_DOUBLE_PRECISION,
-					MPI_SUM, MPI_COMM_WORLD);
+			l7p_allreduce(&local_sum_double, output, 1, MPI_DOUBLE_PRECISION,
+					MPI_SUM, comm);
 		}
 		else{
 			*((double*)output) = local_sum_double;
@@ -145,41 +135,30 @@ void L7_Sum(
    switch (l7_datatype){
    case L7_INT:
    case L7_INTEGER4:
-      local_sum_int = 0;
-      for (i=0; i<count; i++){
-         local_sum_int += ((int*)input)[i];
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_SUM, &local_sum_int);
       *((int *)output) = local_sum_int;
       break;
    case L7_LONG:
-      local_sum_long = 0L;
-      for (i=0; i<count; i++){
-         local_sum_long += ((long *)input)[i];
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_SUM, &local_sum_long);
       *((long *)output) = local_sum_long;
       break;
    case L7_LONG_LONG_INT:
    case L7_INTEGER8:
-      local_sum_long_long = 0L;
-      for (i=0; i<count; i++){
-         local_sum_long_long += ((long long*)input)[i];
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_SUM, &local_sum_long_long);
       *((long long *)output) = local_sum_long_long;
       break;
    case L7_FLOAT:
    case L7_REAL4:
-      local_sum_double = 0.0;
-      for (i=0; i<count; i++){
-         local_sum_double += ((float*)input)[i];
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_SUM, &local_sum_double);
       *((float*)output) = (float)local_sum_double;
       break;
    case L7_DOUBLE:
    case L7_REAL8:
-      local_sum_double = 0.0;
-      for (i=0; i<count; i++){
-         local_sum_double += ((double*)input)[i];
+      if (l7.sum_mode == L7_SUM_REPRODUCIBLE){
+         l7p_repro_sum((double *)input, count, (double *)output, comm);
+         break;
       }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_SUM, &local_sum_double);
       *((double*)output) = local_sum_double;
       break;
    default:
@@ -189,20 +168,30 @@ void L7_Sum(
    }
    return;
 #endif
-} /* End L7_Sum */
+} /* End L7_Sum_Comm */
 
-int L7_Max(
+void L7_Sum(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
       void                    *output
       )
+{
+   L7_Sum_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD);
+} /* End L7_Sum */
+
+int L7_Max_Comm(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output,
+      MPI_Comm                comm
+      )
 {
 	double    local_max_double;
 	int       local_max_int;
    long      local_max_long;
 	long long local_max_long_long;
-	int       i;
 
 #ifdef HAVE_MPI
 	double out_double;
@@ -210,30 +199,20 @@ int L7_Max(
 	switch (l7_datatype){
 	case L7_INT:
 	case L7_INTEGER4:
-		local_max_int = INT_MIN;
-		for (i=0; i<count; i++){
-			if (((int *)input)[i] > local_max_int){
-			   local_max_int = ((int*)input)[i];
-			}
-		}
+		l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MAX, &local_max_int);
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_max_int, output, 1, MPI_INT, MPI_MAX,
-					MPI_COMM_WORLD);
+			l7p_allreduce(&local_max_int, output, 1, MPI_INT, MPI_MAX,
+					comm);
 		}
 		else{
 			*((int *)output) = local_max_int;
 		}
 		break;
    case L7_LONG:
-      local_max_long = LONG_MIN;
-      for (i=0; i<count; i++){
-         if (((long *)input)[i] > local_max_long){
-            local_max_long = ((long *)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MAX, &local_max_long);
       if (l7.initialized_mpi){
-         MPI_Allreduce(&local_max_long, output, 1, MPI_LONG,
-               MPI_MAX, MPI_COMM_WORLD);
+         l7p_allreduce(&local_max_long, output, 1, MPI_LONG,
+               MPI_MAX, comm);
       }
       else{
          *((long *)output) = local_max_long;
@@ -241,15 +220,10 @@ int L7_Max(
       break;
 	case L7_LONG_LONG_INT:
 	case L7_INTEGER8:
-		local_max_long_long = LONG_MIN;
-		for (i=0; i<count; i++){
-			if (((long long *)input)[i] > local_max_long_long){
-			   local_max_long_long = ((long long *)input)[i];
-			}
-		}
+		l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MAX, &local_max_long_long);
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_max_long_long, output, 1, MPI_LONG_LONG_INT,
-					MPI_MAX, MPI_COMM_WORLD);
+			l7p_allreduce(&local_max_long_long, output, 1, MPI_LONG_LONG_INT,
+					MPI_MAX, comm);
 		}
 		else{
 			*((long long *)output) = local_max_long_long;
@@ -257,15 +231,10 @@ int L7_Max(
 		break;
 	case L7_FLOAT:
 	case L7_REAL4:
-		local_max_double = -FLT_MAX;
-		for (i=0; i<count; i++){
-			if ((double)((float *)input)[i] > local_max_double){
-			   local_max_double = (double)((float*)input)[i];
-			}
-		}
+		l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MAX, &local_max_double);
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_max_double, &out_double, 1, MPI_DOUBLE_PRECISION,
-					MPI_MAX, MPI_COMM_WORLD);
+			l7p_allreduce(&local_max_double, &out_double, 1, MPI_DOUBLE_PRECISION,
+					MPI_MAX, comm);
          *((float*)output) = (float)out_double;
 		}
 		else{
@@ -274,15 +243,10 @@ int L7_Max(
 		break;
 	case L7_DOUBLE:
 	case L7_REAL8:
-		local_max_double = -DBL_MAX;
-		for (i=0; i<count; i++){
-			if (((double *)input)[i] > local_max_double){
-			   local_max_double = ((double*)input)[i];
-			}
-		}
+		l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MAX, &local_max_double);
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_max_double, output, 1, MPI_DOUBLE_PRECISION,
-					MPI_MAX, MPI_COMM_WORLD);
+			l7p_allreduce(&local_max_double, output, 1, MPI_DOUBLE_PRECISION,
+					MPI_MAX, comm);
 		}
 		else{
 			*((double*)output) = local_max_double;
@@ -298,51 +262,26 @@ int L7_Max(
    switch (l7_datatype){
    case L7_INT:
    case L7_INTEGER4:
-      local_max_int = INT_MIN;
-      for (i=0; i<count; i++){
-         if (((int *)input)[i] > local_max_int){
-            local_max_int = ((int*)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MAX, &local_max_int);
       *((int *)output) = local_max_int;
       break;
    case L7_LONG:
-      local_max_long = LONG_MIN;
-      for (i=0; i<count; i++){
-         if (((long *)input)[i] > local_max_long){
-            local_max_long = ((long *)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MAX, &local_max_long);
       *((long *)output) = local_max_long;
       break;
    case L7_LONG_LONG_INT:
    case L7_INTEGER8:
-      local_max_long_long = LONG_MIN;
-      for (i=0; i<count; i++){
-         if (((long long *)input)[i] > local_max_long_long){
-            local_max_long_long = ((long long *)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MAX, &local_max_long_long);
       *((long long *)output) = local_max_long_long;
       break;
    case L7_FLOAT:
    case L7_REAL4:
-      local_max_double = -FLT_MAX;
-      for (i=0; i<count; i++){
-         if ((double)((float *)input)[i] > local_max_double){
-            local_max_double = (double)((float*)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MAX, &local_max_double);
       *((float*)output) = (float)local_max_double;
       break;
    case L7_DOUBLE:
    case L7_REAL8:
-      local_max_double = -DBL_MAX;
-      for (i=0; i<count; i++){
-         if (((double *)input)[i] > local_max_double){
-            local_max_double = ((double*)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MAX, &local_max_double);
       *((double*)output) = local_max_double;
       break;
    default:
@@ -352,6 +291,16 @@ int L7_Max(
    }
    return(0);
 #endif
+} /* End L7_Max_Comm */
+
+int L7_Max(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output
+      )
+{
+   return(L7_Max_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD));
 } /* End L7_Max */
 
 void l7_max_(
@@ -365,18 +314,18 @@ void l7_max_(
 	*ierr = L7_Max(input, *count, *l7_datatype, output);
 } /* End l7_max_ */
 
-int L7_Min(
+int L7_Min_Comm(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
-      void                    *output
+      void                    *output,
+      MPI_Comm                comm
       )
 {
    double    local_min_double;
    int       local_min_int;
    long      local_min_long;
    long long local_min_long_long;
-   int       i;
 
 #ifdef HAVE_MPI
    double out_double;
@@ -384,30 +333,20 @@ int L7_Min(
    switch (l7_datatype){
    case L7_INT:
    case L7_INTEGER4:
-      local_min_int = INT_MAX;
-      for (i=0; i<count; i++){
-         if (((int *)input)[i] < local_min_int){
-            local_min_int = ((int*)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MIN, &local_min_int);
       if (l7.initialized_mpi){
-         MPI_Allreduce(&local_min_int, output, 1, MPI_INT, MPI_MIN,
-               MPI_COMM_WORLD);
+         l7p_allreduce(&local_min_int, output, 1, MPI_INT, MPI_MIN,
+               comm);
       }
       else{
          *((int *)output) = local_min_int;
       }
       break;
    case L7_LONG:
-      local_min_long = LONG_MAX;
-      for (i=0; i<count; i++){
-         if (((long *)input)[i] < local_min_long){
-            local_min_long = ((long *)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MIN, &local_min_long);
       if (l7.initialized_mpi){
-         MPI_Allreduce(&local_min_long, output, 1, MPI_LONG,
-               MPI_MIN, MPI_COMM_WORLD);
+         l7p_allreduce(&local_min_long, output, 1, MPI_LONG,
+               MPI_MIN, comm);
       }
       else{
          *((long *)output) = local_min_long;
@@ -415,15 +354,10 @@ int L7_Min(
       break;
    case L7_LONG_LONG_INT:
    case L7_INTEGER8:
-      local_min_long_long = LONG_MAX;
-      for (i=0; i<count; i++){
-         if (((long long *)input)[i] < local_min_long_long){
-            local_min_long_long = ((long long *)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MIN, &local_min_long_long);
       if (l7.initialized_mpi){
-         MPI_Allreduce(&local_min_long_long, output, 1, MPI_LONG_LONG_INT,
-               MPI_MIN, MPI_COMM_WORLD);
+         l7p_allreduce(&local_min_long_long, output, 1, MPI_LONG_LONG_INT,
+               MPI_MIN, comm);
       }
       else{
          *((long long *)output) = local_min_long_long;
@@ -431,15 +365,10 @@ int L7_Min(
       break;
    case L7_FLOAT:
    case L7_REAL4:
-      local_min_double = FLT_MAX;
-      for (i=0; i<count; i++){
-         if ((double)((float *)input)[i] < local_min_double){
-            local_min_double = (double)((float*)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MIN, &local_min_double);
       if (l7.initialized_mpi){
-         MPI_Allreduce(&local_min_double, &out_double, 1, MPI_DOUBLE_PRECISION,
-               MPI_MIN, MPI_COMM_WORLD);
+         l7p_allreduce(&local_min_double, &out_double, 1, MPI_DOUBLE_PRECISION,
+               MPI_MIN, comm);
          *((float*)output) = (float)out_double;
       }
       else{
@@ -448,15 +377,10 @@ int L7_Min(
       break;
    case L7_DOUBLE:
    case L7_REAL8:
-      local_min_double = DBL_MAX;
-      for (i=0; i<count; i++){
-         if (((double *)input)[i] < local_min_double){
-            local_min_double = ((double*)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MIN, &local_min_double);
       if (l7.initialized_mpi){
-         MPI_Allreduce(&local_min_double, output, 1, MPI_DOUBLE_PRECISION,
-               MPI_MIN, MPI_COMM_WORLD);
+         l7p_allreduce(&local_min_double, output, 1, MPI_DOUBLE_PRECISION,
+               MPI_MIN, comm);
       }
       else{
          *((double*)output) = local_min_double;
@@ -472,51 +396,26 @@ int L7_Min(
    switch (l7_datatype){
    case L7_INT:
    case L7_INTEGER4:
-      local_min_int = INT_MAX;
-      for (i=0; i<count; i++){
-         if (((int *)input)[i] < local_min_int){
-            local_min_int = ((int*)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MIN, &local_min_int);
       *((int *)output) = local_min_int;
       break;
    case L7_LONG:
-      local_min_long = LONG_MAX;
-      for (i=0; i<count; i++){
-         if (((long *)input)[i] < local_min_long){
-            local_min_long = ((long *)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MIN, &local_min_long);
       *((long *)output) = local_min_long;
       break;
    case L7_LONG_LONG_INT:
    case L7_INTEGER8:
-      local_min_long_long = LONG_MAX;
-      for (i=0; i<count; i++){
-         if (((long long *)input)[i] < local_min_long_long){
-            local_min_long_long = ((long long *)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MIN, &local_min_long_long);
       *((long long *)output) = local_min_long_long;
       break;
    case L7_FLOAT:
    case L7_REAL4:
-      local_min_double = FLT_MAX;
-      for (i=0; i<count; i++){
-         if ((double)((float *)input)[i] < local_min_double){
-            local_min_double = (double)((float*)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MIN, &local_min_double);
       *((float*)output) = (float)local_min_double;
       break;
    case L7_DOUBLE:
    case L7_REAL8:
-      local_min_double = DBL_MAX;
-      for (i=0; i<count; i++){
-         if (((double *)input)[i] < local_min_double){
-            local_min_double = ((double*)input)[i];
-         }
-      }
+      l7p_local_reduce(input, count, l7_datatype, L7_REDUCE_MIN, &local_min_double);
       *((double*)output) = local_min_double;
       break;
    default:
@@ -526,6 +425,16 @@ int L7_Min(
    }
    return(0);
 #endif
+} /* End L7_Min_Comm */
+
+int L7_Min(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output
+      )
+{
+   return(L7_Min_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD));
 } /* End L7_Min */
 
 void l7_min_(
@@ -539,31 +448,26 @@ void l7_min_(
    *ierr = L7_Min(input, *count, *l7_datatype, output);
 } /* End l7_min_ */
 
-int L7_Any(
+int L7_Any_Comm(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
-      void                    *output
+      void                    *output,
+      MPI_Comm                comm
       )
 {
 	int       local_any_int;
 	long      local_any_long;
 	long long local_any_long_long;
-	int       i;
 
 #ifdef HAVE_MPI
 	switch (l7_datatype){
 	case L7_INT:
 	case L7_LOGICAL:
-		local_any_int = 0;
-		for (i=0; i<count; i++){
-			if (((int *)input)[i]){
-			   local_any_int = ((int*)input)[i];
-			}
-		}
+		l7p_local_any(input, count, l7_datatype, &local_any_int);
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_any_int, output, 1, MPI_INT, MPI_SUM,
-					MPI_COMM_WORLD);
+			l7p_allreduce(&local_any_int, output, 1, MPI_INT, MPI_SUM,
+					comm);
 			if (*((int*)output)){
 				if (*((int *)output) < 0){
 					*((int *)output) = -1;
@@ -578,15 +482,10 @@ int L7_Any(
 		}
 		break;
    case L7_LONG:
-      local_any_long = 0L;
-      for (i=0; i<count; i++){
-         if (((long *)input)[i]){
-            local_any_long = ((long*)input)[i];
-         }
-      }
+      l7p_local_any(input, count, l7_datatype, &local_any_long);
       if (l7.initialized_mpi){
-         MPI_Allreduce(&local_any_long, output, 1, MPI_LONG, MPI_SUM,
-               MPI_COMM_WORLD);
+         l7p_allreduce(&local_any_long, output, 1, MPI_LONG, MPI_SUM,
+               comm);
          if (*((long*)output)){
             if (*((long *)output) < 0){
                *((long *)output) = -1;
@@ -601,15 +500,10 @@ int L7_Any(
       }
       break;
 	case L7_LONG_LONG_INT:
-		local_any_long_long = 0L;
-		for (i=0; i<count; i++){
-			if (((long long *)input)[i]){
-			   local_any_long_long = ((long long*)input)[i];
-			}
-		}
+		l7p_local_any(input, count, l7_datatype, &local_any_long_long);
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_any_long_long, output, 1, MPI_LONG_LONG_INT, MPI_SUM,
-					MPI_COMM_WORLD);
+			l7p_allreduce(&local_any_long_long, output, 1, MPI_LONG_LONG_INT, MPI_SUM,
+					comm);
 			if (*((long long*)output)){
 				if (*((long long *)output) < 0){
 					*((long long *)output) = -1;
@@ -633,30 +527,15 @@ int L7_Any(
    switch (l7_datatype){
    case L7_INT:
    case L7_LOGICAL:
-      local_any_int = 0;
-      for (i=0; i<count; i++){
-         if (((int *)input)[i]){
-            local_any_int = ((int*)input)[i];
-         }
-      }
+      l7p_local_any(input, count, l7_datatype, &local_any_int);
       *((int *)output) = local_any_int;
       break;
    case L7_LONG:
-      local_any_long = 0L;
-      for (i=0; i<count; i++){
-         if (((long *)input)[i]){
-            local_any_long = ((long*)input)[i];
-         }
-      }
+      l7p_local_any(input, count, l7_datatype, &local_any_long);
       *((long *)output) = local_any_long;
       break;
    case L7_LONG_LONG_INT:
-      local_any_long_long = 0L;
-      for (i=0; i<count; i++){
-         if (((long long *)input)[i]){
-            local_any_long_long = ((long long*)input)[i];
-         }
-      }
+      l7p_local_any(input, count, l7_datatype, &local_any_long_long);
       *((long long *)output) = local_any_long_long;
       break;
     default:
@@ -666,6 +545,16 @@ int L7_Any(
    }
    return(0);
 #endif
+} /* End L7_Any_Comm */
+
+int L7_Any(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output
+      )
+{
+   return(L7_Any_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD));
 } /* End L7_Any */
 
 void l7_any_(
@@ -679,32 +568,29 @@ void l7_any_(
 	*ierr = L7_Any(input, *count, *l7_datatype, output);
 } /* End l7_any_ */
 
-int L7_All(
+int L7_All_Comm(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
-      void                    *output
+      void                    *output,
+      MPI_Comm                comm
       )
 {
 	int       local_all_int;
    long      local_all_long, sign_long;
 	long long local_all_long_long, sign_long_long;
-	int       i, sign;
+	int       all, sign;
 
 #ifdef HAVE_MPI
 	switch (l7_datatype){
 	case L7_INT:
 	case L7_LOGICAL:
-		local_all_int = 0;
-		sign = ((int *)input)[0];
-		for (i=0; i<count; i++){
-			if (! ((int *)input)[i]){
-			   local_all_int = 0;
-			}
-		}
+		l7p_local_all(input, count, l7_datatype, &all);
+		local_all_int = all;
+		sign = (count > 0) ? ((int *)input)[0] : 1;
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_all_int, output, 1, MPI_INT, MPI_LAND,
-					MPI_COMM_WORLD);
+			l7p_allreduce(&local_all_int, output, 1, MPI_INT, MPI_LAND,
+					comm);
 			if (*((int *)output)){
 				*((int *)output) = sign;
 			}
@@ -714,16 +600,12 @@ int L7_All(
 		}
 		break;
    case L7_LONG:
-      local_all_long = 0L;
-      sign_long=((long *)input)[0];
-      for (i=0; i<count; i++){
-         if (! ((long *)input)[i]){
-            local_all_long = 0L;
-         }
-      }
+      l7p_local_all(input, count, l7_datatype, &all);
+      local_all_long = all;
+      sign_long = (count > 0) ? ((long *)input)[0] : 1L;
       if (l7.initialized_mpi){
-         MPI_Allreduce(&local_all_long, output, 1, MPI_LONG, MPI_LAND,
-               MPI_COMM_WORLD);
+         l7p_allreduce(&local_all_long, output, 1, MPI_LONG, MPI_LAND,
+               comm);
          if (*((long *)output)){
             *((long *)output) = sign_long;
          }
@@ -733,16 +615,12 @@ int L7_All(
       }
       break;
 	case L7_LONG_LONG_INT:
-		local_all_long_long = 0L;
-		sign_long_long=((long long *)input)[0];
-		for (i=0; i<count; i++){
-			if (! ((long long *)input)[i]){
-			   local_all_long_long = 0L;
-			}
-		}
+		l7p_local_all(input, count, l7_datatype, &all);
+		local_all_long_long = all;
+		sign_long_long = (count > 0) ? ((long long *)input)[0] : 1LL;
 		if (l7.initialized_mpi){
-			MPI_Allreduce(&local_all_long_long, output, 1, MPI_LONG_LONG_INT, MPI_LAND,
-					MPI_COMM_WORLD);
+			l7p_allreduce(&local_all_long_long, output, 1, MPI_LONG_LONG_INT, MPI_LAND,
+					comm);
 			if (*((long long *)output)){
 				*((long long *)output) = sign_long_long;
 			}
@@ -761,33 +639,21 @@ int L7_All(
    switch (l7_datatype){
    case L7_INT:
    case L7_LOGICAL:
-      local_all_int = 0;
-      sign = ((int *)input)[0];
-      for (i=0; i<count; i++){
-         if (! ((int *)input)[i]){
-            local_all_int = 0;
-         }
-      }
+      l7p_local_all(input, count, l7_datatype, &all);
+      local_all_int = all;
+      sign = (count > 0) ? ((int *)input)[0] : 1;
       *((int *)output) = local_all_int;
       break;
    case L7_LONG:
-      local_all_long = 0L;
-      sign_long=((long *)input)[0];
-      for (i=0; i<count; i++){
-         if (! ((long *)input)[i]){
-            local_all_long = 0L;
-         }
-      }
+      l7p_local_all(input, count, l7_datatype, &all);
+      local_all_long = all;
+      sign_long = (count > 0) ? ((long *)input)[0] : 1L;
       *((long *)output) = local_all_long;
       break;
    case L7_LONG_LONG_INT:
-      local_all_long_long = 0L;
-      sign_long_long=((long long *)input)[0];
-      for (i=0; i<count; i++){
-         if (! ((long long *)input)[i]){
-            local_all_long_long = 0L;
-         }
-      }
+      l7p_local_all(input, count, l7_datatype, &all);
+      local_all_long_long = all;
+      sign_long_long = (count > 0) ? ((long long *)input)[0] : 1LL;
       *((long long *)output) = local_all_long_long;
       break;
    default:
@@ -797,6 +663,16 @@ int L7_All(
    }
    return(0);
 #endif
+} /* End L7_All_Comm */
+
+int L7_All(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output
+      )
+{
+   return(L7_All_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD));
 } /* End L7_All */
 
 void l7_all_(
@@ -810,11 +686,12 @@ void l7_all_(
 	*ierr = L7_All(input, *count, *l7_datatype, output);
 } /* End l7_all_ */
 
-int L7_Array_Sum(
+int L7_Array_Sum_Comm(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
-      void                    *output
+      void                    *output,
+      MPI_Comm                comm
       )
 {
 #ifdef HAVE_MPI
@@ -832,8 +709,11 @@ int L7_Array_Sum(
 	case L7_REAL8:
 		if (l7.initialized_mpi){
 			mpi_type = l7p_mpi_type (l7_datatype);
-			MPI_Allreduce(input, output, count, mpi_type, MPI_SUM,
-					MPI_COMM_WORLD);
+			l7p_allreduce(input, output, count, mpi_type, MPI_SUM,
+					comm);
+		}
+		else if (output != input){
+			memcpy(output, input, (size_t)count * l7p_sizeof(l7_datatype));
 		}
 		break;
    default:
@@ -877,6 +757,16 @@ int L7_Array_Sum(
    }
 #endif
    return(0);
+} /* End L7_Array_Sum_Comm */
+
+int L7_Array_Sum(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output
+      )
+{
+   return(L7_Array_Sum_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD));
 } /* End L7_Array_Sum */
 
 void l7_array_sum_(
@@ -890,11 +780,12 @@ void l7_array_sum_(
 	*ierr = L7_Array_Sum(input, *count, *l7_datatype, output);
 } /* End l7_array_sum_ */
 
-int L7_Array_Max(
+int L7_Array_Max_Comm(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
-      void                    *output
+      void                    *output,
+      MPI_Comm                comm
       )
 {
 #ifdef HAVE_MPI
@@ -912,8 +803,11 @@ int L7_Array_Max(
 	case L7_REAL8:
 		if (l7.initialized_mpi){
 			mpi_type = l7p_mpi_type (l7_datatype);
-			MPI_Allreduce(input, output, count, mpi_type, MPI_MAX,
-					MPI_COMM_WORLD);
+			l7p_allreduce(input, output, count, mpi_type, MPI_MAX,
+					comm);
+		}
+		else if (output != input){
+			memcpy(output, input, (size_t)count * l7p_sizeof(l7_datatype));
 		}
 		break;
    default:
@@ -957,6 +851,16 @@ int L7_Array_Max(
    }
 #endif
 	return(0);
+} /* End L7_Array_Max_Comm */
+
+int L7_Array_Max(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output
+      )
+{
+   return(L7_Array_Max_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD));
 } /* End L7_Array_Max */
 
 void l7_array_max_(
@@ -970,11 +874,12 @@ void l7_array_max_(
 	*ierr = L7_Array_Max(input, *count, *l7_datatype, output);
 } /* End l7_array_max_ */
 
-int L7_Array_Min(
+int L7_Array_Min_Comm(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
-      void                    *output
+      void                    *output,
+      MPI_Comm                comm
       )
 {
 #ifdef HAVE_MPI
@@ -992,8 +897,11 @@ int L7_Array_Min(
 	case L7_REAL8:
 		if (l7.initialized_mpi){
 			mpi_type = l7p_mpi_type (l7_datatype);
-			MPI_Allreduce(input, output, count, mpi_type, MPI_MIN,
-					MPI_COMM_WORLD);
+			l7p_allreduce(input, output, count, mpi_type, MPI_MIN,
+					comm);
+		}
+		else if (output != input){
+			memcpy(output, input, (size_t)count * l7p_sizeof(l7_datatype));
 		}
 		break;
    default:
@@ -1037,6 +945,16 @@ int L7_Array_Min(
    }
 #endif
    return(0);
+} /* End L7_Array_Min_Comm */
+
+int L7_Array_Min(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *output
+      )
+{
+   return(L7_Array_Min_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD));
 } /* End L7_Array_Min */
 
 void l7_array_min_(
@@ -1050,226 +968,48 @@ void l7_array_min_(
 	*ierr = L7_Array_Min(input, *count, *l7_datatype, output);
 } /* End l7_array_min_ */
 
-int L7_MaxLoc(
+int L7_MaxLoc_Comm(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
-      int                     *output
+      int                     *output,
+      MPI_Comm                comm
       )
 {
-   int       int_cur_max;
-   long      long_cur_max;
-   //long long longlong_cur_max;
-   float     float_cur_max;
-   double real_cur_max;
+   /*
+    * The global location is the local one plus the items on lower
+    * ranks; see l7_loc.c for how that offset is found without
+    * gathering every rank's count.
+    */
 
-   int    i, local_maxloc;
+   struct l7p_loc
+     cur;
 
-   int *iptrinp = NULL;
-   long *lptrinp = NULL;
-   //long long *llptrinp=NULL;
-   float *fptrinp = NULL;
-   double *rptrinp = NULL;
+   if (l7p_loc_scan(input, count, l7_datatype, L7_REDUCE_MAX, &cur) != 0){
+      printf("Error -- L7_DATATYPE not supported in L7_MaxLoc\n");
+      exit(1);
+   }
 
 #ifdef HAVE_MPI
-	int    iprocs, istart;
-	int    nprocs, mype;
-	int    local_count[1];
-	int    *counts = NULL;
-
-   struct {
-      int    value;
-      int    index;
-   } in_int, out_int;
-   struct {
-      long    value;
-      int     index;
-   } in_long, out_long;
-//   struct {
-//      long long   value;
-//      int         index;
-//   } in_longlong, out_longlong;
-   struct {
-      float    value;
-      int      index;
-   } in_float, out_float;
-	struct {
-		double value;
-		int    index;
-	} in_double, out_double;
+   if (l7.initialized_mpi)
+      l7p_loc_reduce(&cur, count, comm);
+#else
+   (void)comm;
+#endif
 
-	nprocs = l7.numpes;
-	mype = l7.penum;
+   *output = (int)cur.loc;
 
-   istart = 0;
-   if (l7.initialized_mpi){
-     counts = (int *)malloc(nprocs*sizeof(int));
-     local_count[0] = count;
-	  MPI_Allgather(local_count, 1, MPI_INT, counts, 1, MPI_INT,
-			MPI_COMM_WORLD);
-	  for (iprocs = 0; iprocs < mype; iprocs++){
-	    istart+=counts[iprocs];
-	  }
-	  free(counts);
-   }
+   return(0);
+} /* End L7_MaxLoc_Comm */
 
-	switch (l7_datatype){
-	   case L7_INT:
-	   case L7_INTEGER4:
-         int_cur_max=INT_MIN;
-         local_maxloc = 0;
-         iptrinp=(int *)input;
-         for (i=0;i<count;i++){
-            if (iptrinp[i] > int_cur_max){
-               local_maxloc=i;
-               int_cur_max=iptrinp[i];
-            }
-         }
-         local_maxloc += istart;
-         if (l7.initialized_mpi){
-           in_int.value = int_cur_max;
-           in_int.index = local_maxloc;
-           MPI_Allreduce(&in_int, &out_int, 1, MPI_2INT,
-               MPI_MAXLOC, MPI_COMM_WORLD);
-           *output = out_int.index;
-         }
-         else {
-            *output = local_maxloc;
-         }
-         break;
-	   case L7_LONG:
-         long_cur_max=LONG_MIN;
-         local_maxloc = 0;
-         lptrinp=(long *)input;
-         for (i=0;i<count;i++){
-            if (lptrinp[i] > long_cur_max){
-               local_maxloc=i;
-               long_cur_max=lptrinp[i];
-            }
-         }
-         local_maxloc += istart;
-         if (l7.initialized_mpi){
-           in_long.value = long_cur_max;
-           in_long.index = local_maxloc;
-           MPI_Allreduce(&in_long, &out_long, 1, MPI_LONG_INT,
-               MPI_MAXLOC, MPI_COMM_WORLD);
-           *output = out_long.index;
-         }
-         else {
-            *output = local_maxloc;
-         }
-         break;
-	   case L7_FLOAT:
-	   case L7_REAL4:
-         float_cur_max=-FLT_MAX;
-         local_maxloc = 0;
-         fptrinp=(float *)input;
-         for (i=0;i<count;i++){
-            if (fptrinp[i] > float_cur_max){
-               local_maxloc=i;
-               float_cur_max=fptrinp[i];
-            }
-         }
-         local_maxloc += istart;
-         if (l7.initialized_mpi){
-           in_float.value = float_cur_max;
-           in_float.index = local_maxloc;
-           MPI_Allreduce(&in_float, &out_float, 1, MPI_FLOAT_INT,
-               MPI_MAXLOC, MPI_COMM_WORLD);
-           *output = out_float.index;
-         }
-         else {
-            *output = local_maxloc;
-         }
-         break;
-	   case L7_DOUBLE:
-	   case L7_REAL8:
-    		real_cur_max=-DBL_MAX;
-	   	local_maxloc = 0;
-		   rptrinp=(double *)input;
-		   for (i=0;i<count;i++){
-			   if (rptrinp[i] > real_cur_max){
-				   local_maxloc=i;
-				   real_cur_max=rptrinp[i];
-   			}
-	   	}
-		   local_maxloc += istart;
-         if (l7.initialized_mpi){
-           in_double.value = real_cur_max;
-	   	  in_double.index = local_maxloc;
-		     MPI_Allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
-			   	MPI_MAXLOC, MPI_COMM_WORLD);
-	   	  *output = out_double.index;
-         }
-         else {
-            *output = local_maxloc;
-         }
-		   break;
-   	 default:
-	      printf("Error -- L7_DATATYPE not supported in L7_MaxLoc\n");
-	      exit(1);
-	      break;
-	}
-#else
-   switch (l7_datatype){
-      case L7_INT:
-      case L7_INTEGER4:
-         int_cur_max=INT_MIN;
-         local_maxloc = 0;
-         iptrinp=(int *)input;
-         for (i=0;i<count;i++){
-            if (iptrinp[i] > int_cur_max){
-               local_maxloc=i;
-               int_cur_max=iptrinp[i];
-            }
-         }
-         *output = local_maxloc;
-         break;
-      case L7_LONG:
-         long_cur_max=LONG_MIN;
-         local_maxloc = 0;
-         lptrinp=(long *)input;
-         for (i=0;i<count;i++){
-            if (lptrinp[i] > long_cur_max){
-               local_maxloc=i;
-               long_cur_max=lptrinp[i];
-            }
-         }
-         *output = local_maxloc;
-         break;
-      case L7_FLOAT:
-      case L7_REAL4:
-         float_cur_max=-FLT_MAX;
-         local_maxloc = 0;
-         fptrinp=(float *)input;
-         for (i=0;i<count;i++){
-            if (fptrinp[i] > float_cur_max){
-               local_maxloc=i;
-               float_cur_max=fptrinp[i];
-            }
-         }
-         *output = local_maxloc;
-         break;
-      case L7_DOUBLE:
-      case L7_REAL8:
-         real_cur_max=-DBL_MAX;
-         local_maxloc = 0;
-         rptrinp=(double *)input;
-         for (i=0;i<count;i++){
-            if (rptrinp[i] > real_cur_max){
-               local_maxloc=i;
-               real_cur_max=rptrinp[i];
-            }
-         }
-         *output = local_maxloc;
-         break;
-       default:
-         printf("Error -- L7_DATATYPE not supported in L7_MaxLoc\n");
-         exit(1);
-         break;
-   }
-#endif
-	return(0);
+int L7_MaxLoc(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      int                     *output
+      )
+{
+   return(L7_MaxLoc_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD));
 } /* End L7_MaxLoc */
 
 void l7_maxloc_(
@@ -1283,226 +1023,42 @@ void l7_maxloc_(
 	*ierr=L7_MaxLoc(input, *count, *l7_datatype, output);
 } /* End l7_maxloc_ */
 
-int L7_MinLoc(
+int L7_MinLoc_Comm(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
-      int                     *output
+      int                     *output,
+      MPI_Comm                comm
       )
 {
-   int       int_cur_min;
-   long      long_cur_min;
-   //long long longlong_cur_min;
-   float     float_cur_min;
-   double real_cur_min;
-
-   int    i, local_minloc;
-
-   int *iptrinp = NULL;
-   long *lptrinp = NULL;
-   //long long *llptrinp=NULL;
-   float *fptrinp = NULL;
-   double *rptrinp = NULL;
+   struct l7p_loc
+     cur;
 
-#ifdef HAVE_MPI
-   int    iprocs, istart;
-   int    nprocs, mype;
-   int    local_count[1];
-   int    *counts = NULL;
-
-   struct {
-      int    value;
-      int    index;
-   } in_int, out_int;
-   struct {
-      long    value;
-      int     index;
-   } in_long, out_long;
-//   struct {
-//      long long   value;
-//      int         index;
-//   } in_longlong, out_longlong;
-   struct {
-      float    value;
-      int      index;
-   } in_float, out_float;
-   struct {
-      double value;
-      int    index;
-   } in_double, out_double;
-
-   nprocs = l7.numpes;
-   mype = l7.penum;
-
-   istart = 0;
-   if (l7.initialized_mpi){
-     counts = (int *)malloc(nprocs*sizeof(int));
-     local_count[0] = count;
-     MPI_Allgather(local_count, 1, MPI_INT, counts, 1, MPI_INT,
-         MPI_COMM_WORLD);
-     for (iprocs = 0; iprocs < mype; iprocs++){
-        istart+=counts[iprocs];
-     }
-     free(counts);
+   if (l7p_loc_scan(input, count, l7_datatype, L7_REDUCE_MIN, &cur) != 0){
+      printf("Error -- L7_DATATYPE not supported in L7_MinLoc\n");
+      exit(1);
    }
 
-   switch (l7_datatype){
-      case L7_INT:
-      case L7_INTEGER4:
-         int_cur_min=INT_MAX;
-         local_minloc = 0;
-         iptrinp=(int *)input;
-         for (i=0;i<count;i++){
-            if (iptrinp[i] < int_cur_min){
-               local_minloc=i;
-               int_cur_min=iptrinp[i];
-            }
-         }
-         local_minloc += istart;
-         if (l7.initialized_mpi){
-           in_int.value = int_cur_min;
-           in_int.index = local_minloc;
-           MPI_Allreduce(&in_int, &out_int, 1, MPI_2INT,
-               MPI_MINLOC, MPI_COMM_WORLD);
-           *output = out_int.index;
-         }
-         else {
-            *output = local_minloc;
-         }
-         break;
-      case L7_LONG:
-         long_cur_min=LONG_MAX;
-         local_minloc = 0;
-         lptrinp=(long *)input;
-         for (i=0;i<count;i++){
-            if (lptrinp[i] < long_cur_min){
-               local_minloc=i;
-               long_cur_min=lptrinp[i];
-            }
-         }
-         local_minloc += istart;
-         if (l7.initialized_mpi){
-           in_long.value = long_cur_min;
-           in_long.index = local_minloc;
-           MPI_Allreduce(&in_long, &out_long, 1, MPI_LONG_INT,
-               MPI_MINLOC, MPI_COMM_WORLD);
-           *output = out_long.index;
-         }
-         else {
-            *output = local_minloc;
-         }
-         break;
-      case L7_FLOAT:
-      case L7_REAL4:
-         float_cur_min=FLT_MAX;
-         local_minloc = 0;
-         fptrinp=(float *)input;
-         for (i=0;i<count;i++){
-            if (fptrinp[i] < float_cur_min){
-               local_minloc=i;
-               float_cur_min=fptrinp[i];
-            }
-         }
-         local_minloc += istart;
-         if (l7.initialized_mpi){
-           in_float.value = float_cur_min;
-           in_float.index = local_minloc;
-           MPI_Allreduce(&in_float, &out_float, 1, MPI_FLOAT_INT,
-               MPI_MINLOC, MPI_COMM_WORLD);
-           *output = out_float.index;
-         }
-         else {
-            *output = local_minloc;
-         }
-         break;
-      case L7_DOUBLE:
-      case L7_REAL8:
-         real_cur_min=DBL_MAX;
-         local_minloc = 0;
-         rptrinp=(double *)input;
-         for (i=0;i<count;i++){
-            if (rptrinp[i] < real_cur_min){
-               local_minloc=i;
-               real_cur_min=rptrinp[i];
-            }
-         }
-         local_minloc += istart;
-         if (l7.initialized_mpi){
-           in_double.value = real_cur_min;
-           in_double.index = local_minloc;
-           MPI_Allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
-               MPI_MINLOC, MPI_COMM_WORLD);
-           *output = out_double.index;
-         }
-         else {
-            *output = local_minloc;
-         }
-         break;
-       default:
-         printf("Error -- L7_DATATYPE not supported in L7_MinLoc\n");
-         exit(1);
-         break;
-   }
+#ifdef HAVE_MPI
+   if (l7.initialized_mpi)
+      l7p_loc_reduce(&cur, count, comm);
 #else
-   switch (l7_datatype){
-      case L7_INT:
-      case L7_INTEGER4:
-         int_cur_min=INT_MAX;
-         local_minloc = 0;
-         iptrinp=(int *)input;
-         for (i=0;i<count;i++){
-            if (iptrinp[i] < int_cur_min){
-               local_minloc=i;
-               int_cur_min=iptrinp[i];
-            }
-         }
-         *output = local_minloc;
-         break;
-      case L7_LONG:
-         long_cur_min=LONG_MAX;
-         local_minloc = 0;
-         lptrinp=(long *)input;
-         for (i=0;i<count;i++){
-            if (lptrinp[i] < long_cur_min){
-               local_minloc=i;
-               long_cur_min=lptrinp[i];
-            }
-         }
-         *output = local_minloc;
-         break;
-      case L7_FLOAT:
-      case L7_REAL4:
-         float_cur_min=FLT_MAX;
-         local_minloc = 0;
-         fptrinp=(float *)input;
-         for (i=0;i<count;i++){
-            if (fptrinp[i] < float_cur_min){
-               local_minloc=i;
-               float_cur_min=fptrinp[i];
-            }
-         }
-         *output = local_minloc;
-         break;
-      case L7_DOUBLE:
-      case L7_REAL8:
-         real_cur_min=DBL_MAX;
-         local_minloc = 0;
-         rptrinp=(double *)input;
-         for (i=0;i<count;i++){
-            if (rptrinp[i] < real_cur_min){
-               local_minloc=i;
-               real_cur_min=rptrinp[i];
-            }
-         }
-         *output = local_minloc;
-         break;
-       default:
-         printf("Error -- L7_DATATYPE not supported in L7_MinLoc\n");
-         exit(1);
-         break;
-   }
+   (void)comm;
 #endif
+
+   *output = (int)cur.loc;
+
    return(0);
+} /* End L7_MinLoc_Comm */
+
+int L7_MinLoc(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      int                     *output
+      )
+{
+   return(L7_MinLoc_Comm(input, count, l7_datatype, output, MPI_COMM_WORLD));
 } /* End L7_MinLoc */
 
 void l7_minloc_(
@@ -1516,243 +1072,45 @@ void l7_minloc_(
    *ierr=L7_MinLoc(input, *count, *l7_datatype, output);
 } /* End l7_minloc_ */
 
-int L7_MaxValLoc(
+int L7_MaxValLoc_Comm(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
       void                    *val,
-      int                     *loc
+      int                     *loc,
+      MPI_Comm                comm
       )
 {
-   int       int_cur_max;
-   long      long_cur_max;
-   //long long longlong_cur_max;
-   float     float_cur_max;
-   double real_cur_max;
+   struct l7p_loc
+     cur;
 
-   int    i, local_maxloc;
-
-   int *iptrinp = NULL;
-   long *lptrinp = NULL;
-   //long long *llptrinp=NULL;
-   float *fptrinp = NULL;
-   double *rptrinp = NULL;
-
-#ifdef HAVE_MPI
-
-   int    iprocs, istart;
-   int    nprocs, mype;
-   int    local_count[1];
-   int    *counts = NULL;
-
-   struct {
-      int    value;
-      int    index;
-   } in_int, out_int;
-   struct {
-      long    value;
-      int     index;
-   } in_long, out_long;
-//   struct {
-//      long long   value;
-//      int         index;
-//   } in_longlong, out_longlong;
-   struct {
-      float    value;
-      int      index;
-   } in_float, out_float;
-   struct {
-      double value;
-      int    index;
-   } in_double, out_double;
-
-   nprocs = l7.numpes;
-   mype = l7.penum;
-
-   istart = 0;
-   if (l7.initialized_mpi){
-     counts = (int *)malloc(nprocs*sizeof(int));
-     local_count[0] = count;
-     MPI_Allgather(local_count, 1, MPI_INT, counts, 1, MPI_INT,
-         MPI_COMM_WORLD);
-     for (iprocs = 0; iprocs < mype; iprocs++){
-        istart+=counts[iprocs];
-     }
-     free(counts);
+   if (l7p_loc_scan(input, count, l7_datatype, L7_REDUCE_MAX, &cur) != 0){
+      printf("Error -- L7_DATATYPE not supported in L7_MaxValLoc\n");
+      exit(1);
    }
 
-   switch (l7_datatype){
-      case L7_INT:
-      case L7_INTEGER4:
-         int_cur_max=INT_MIN;
-         local_maxloc = 0;
-         iptrinp=(int *)input;
-         for (i=0;i<count;i++){
-            if (iptrinp[i] > int_cur_max){
-               local_maxloc=i;
-               int_cur_max=iptrinp[i];
-            }
-         }
-         if (l7.initialized_mpi){
-           local_maxloc += istart;
-           in_int.value = int_cur_max;
-           in_int.index = local_maxloc;
-           MPI_Allreduce(&in_int, &out_int, 1, MPI_2INT,
-               MPI_MAXLOC, MPI_COMM_WORLD);
-           *((int *)val) = out_int.value;
-           *loc = out_int.index;
-         }
-         else {
-            *((int *)val) = int_cur_max;
-            *loc = local_maxloc;
-         }
-         break;
-      case L7_LONG:
-         long_cur_max=LONG_MIN;
-         local_maxloc = 0;
-         lptrinp=(long *)input;
-         for (i=0;i<count;i++){
-            if (lptrinp[i] > long_cur_max){
-               local_maxloc=i;
-               long_cur_max=lptrinp[i];
-            }
-         }
-         local_maxloc += istart;
-         if (l7.initialized_mpi){
-           in_long.value = long_cur_max;
-           in_long.index = local_maxloc;
-           MPI_Allreduce(&in_long, &out_long, 1, MPI_LONG_INT,
-               MPI_MAXLOC, MPI_COMM_WORLD);
-           *((long *)val) = out_long.value;
-           *loc = out_long.index;
-         }
-         else {
-            *((long *)val) = long_cur_max;
-            *loc = local_maxloc;
-         }
-         break;
-      case L7_FLOAT:
-      case L7_REAL4:
-         float_cur_max=-FLT_MAX;
-         local_maxloc = 0;
-         fptrinp=(float *)input;
-         for (i=0;i<count;i++){
-            if (fptrinp[i] > float_cur_max){
-               local_maxloc=i;
-               float_cur_max=fptrinp[i];
-            }
-         }
-         local_maxloc += istart;
-         if (l7.initialized_mpi){
-           in_float.value = float_cur_max;
-           in_float.index = local_maxloc;
-           MPI_Allreduce(&in_float, &out_float, 1, MPI_FLOAT_INT,
-               MPI_MAXLOC, MPI_COMM_WORLD);
-           *((float *)val) = out_float.value;
-           *loc = out_float.index;
-         }
-         else {
-            *((float *)val) = float_cur_max;
-            *loc = local_maxloc;
-
-         }
-         break;
-      case L7_DOUBLE:
-      case L7_REAL8:
-         real_cur_max=-DBL_MAX;
-         local_maxloc = 0;
-         rptrinp=(double *)input;
-         for (i=0;i<count;i++){
-            if (rptrinp[i] > real_cur_max){
-               local_maxloc=i;
-               real_cur_max=rptrinp[i];
-            }
-         }
-         if (l7.initialized_mpi){
-            local_maxloc += istart;
-            in_double.value = real_cur_max;
-            in_double.index = local_maxloc;
-            MPI_Allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
-               MPI_MAXLOC, MPI_COMM_WORLD);
-
-            *((double *)val) = out_double.value;
-            *loc = out_double.index;
-         }
-         else {
-            *((double *)val) = real_cur_max;
-            *loc = local_maxloc;
-         }
-
-         break;
-       default:
-         printf("Error -- L7_DATATYPE not supported in L7_MaxValLoc\n");
-         exit(1);
-         break;
-   }
+#ifdef HAVE_MPI
+   if (l7.initialized_mpi)
+      l7p_loc_reduce(&cur, count, comm);
 #else
-   switch (l7_datatype){
-      case L7_INT:
-      case L7_INTEGER4:
-         int_cur_max=INT_MIN;
-         local_maxloc = 0;
-         iptrinp=(int *)input;
-         for (i=0;i<count;i++){
-            if (iptrinp[i] > int_cur_max){
-               local_maxloc=i;
-               int_cur_max=iptrinp[i];
-            }
-         }
-         *((int *)val) = int_cur_max;
-         *loc = local_maxloc;
-         break;
-      case L7_LONG:
-         long_cur_max=LONG_MIN;
-         local_maxloc = 0;
-         lptrinp=(long *)input;
-         for (i=0;i<count;i++){
-            if (lptrinp[i] > long_cur_max){
-               local_maxloc=i;
-               long_cur_max=lptrinp[i];
-            }
-         }
-         *((long *)val) = long_cur_max;
-         *loc = local_maxloc;
-         break;
-      case L7_FLOAT:
-      case L7_REAL4:
-         float_cur_max=-FLT_MAX;
-         local_maxloc = 0;
-         fptrinp=(float *)input;
-         for (i=0;i<count;i++){
-            if (fptrinp[i] > float_cur_max){
-               local_maxloc=i;
-               float_cur_max=fptrinp[i];
-            }
-         }
-         *((float *)val) = float_cur_max;
-         *loc = local_maxloc;
-         break;
-      case L7_DOUBLE:
-      case L7_REAL8:
-         real_cur_max=-DBL_MAX;
-         local_maxloc = 0;
-         rptrinp=(double *)input;
-         for (i=0;i<count;i++){
-            if (rptrinp[i] > real_cur_max){
-               local_maxloc=i;
-               real_cur_max=rptrinp[i];
-            }
-         }
-         *((double *)val) = real_cur_max;
-         *loc = local_maxloc;
-         break;
-       default:
-         printf("Error -- L7_DATATYPE not supported in L7_MaxValLoc\n");
-         exit(1);
-         break;
-   }
+   (void)comm;
 #endif
+
+   l7p_loc_store(&cur, l7_datatype, val);
+   *loc = (int)cur.loc;
+
    return(0);
+} /* End L7_MaxValLoc_Comm */
+
+int L7_MaxValLoc(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *val,
+      int                     *loc
+      )
+{
+   return(L7_MaxValLoc_Comm(input, count, l7_datatype, val, loc, MPI_COMM_WORLD));
 } /* End L7_MaxValLoc */
 
 
@@ -1768,241 +1126,45 @@ void l7_maxvalloc_(
 	*ierr=L7_MaxValLoc(input, *count, *l7_datatype, val, loc);
 } /* End l7_maxvalloc_ */
 
-int L7_MinValLoc(
+int L7_MinValLoc_Comm(
       void                    *input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
       void                    *val,
-      int                     *loc
+      int                     *loc,
+      MPI_Comm                comm
       )
 {
-   int       int_cur_min;
-   long      long_cur_min;
-   //long long longlong_cur_min;
-   float     float_cur_min;
-   double real_cur_min;
-
-   int    i, local_minloc;
-
-   int *iptrinp = NULL;
-   long *lptrinp = NULL;
-   //long long *llptrinp=NULL;
-   float *fptrinp = NULL;
-   double *rptrinp = NULL;
+   struct l7p_loc
+     cur;
 
-#ifdef HAVE_MPI
-   int    iprocs, istart;
-   int    nprocs, mype;
-   int    local_count[1];
-   int    *counts = NULL;
-
-   struct {
-      int    value;
-      int    index;
-   } in_int, out_int;
-   struct {
-      long    value;
-      int     index;
-   } in_long, out_long;
-//   struct {
-//      long long   value;
-//      int         index;
-//   } in_longlong, out_longlong;
-   struct {
-      float    value;
-      int      index;
-   } in_float, out_float;
-   struct {
-      double value;
-      int    index;
-   } in_double, out_double;
-
-   nprocs = l7.numpes;
-   mype = l7.penum;
-
-   if (l7.initialized_mpi){
-     counts = (int *)malloc(nprocs*sizeof(int));
-     local_count[0] = count;
-     MPI_Allgather(local_count, 1, MPI_INT, counts, 1, MPI_INT,
-         MPI_COMM_WORLD);
-     istart = 0;
-     for (iprocs = 0; iprocs < mype; iprocs++){
-        istart+=counts[iprocs];
-     }
-     free(counts);
+   if (l7p_loc_scan(input, count, l7_datatype, L7_REDUCE_MIN, &cur) != 0){
+      printf("Error -- L7_DATATYPE not supported in L7_MinValLoc\n");
+      exit(1);
    }
 
-   switch (l7_datatype){
-      case L7_INT:
-      case L7_INTEGER4:
-         int_cur_min=INT_MAX;
-         local_minloc = 0;
-         iptrinp=(int *)input;
-         for (i=0;i<count;i++){
-            if (iptrinp[i] < int_cur_min){
-               local_minloc=i;
-               int_cur_min=iptrinp[i];
-            }
-         }
-         if (l7.initialized_mpi){
-           local_minloc += istart;
-           in_int.value = int_cur_min;
-           in_int.index = local_minloc;
-           MPI_Allreduce(&in_int, &out_int, 1, MPI_2INT,
-               MPI_MINLOC, MPI_COMM_WORLD);
-           *((int *)val) = out_int.value;
-           *loc = out_int.index;
-         }
-         else {
-            *((int *)val) = int_cur_min;
-            *loc = local_minloc;
-         }
-         break;
-      case L7_LONG:
-         long_cur_min=LONG_MAX;
-         local_minloc = 0;
-         lptrinp=(long *)input;
-         for (i=0;i<count;i++){
-            if (lptrinp[i] < long_cur_min){
-               local_minloc=i;
-               long_cur_min=lptrinp[i];
-            }
-         }
-         if (l7.initialized_mpi){
-           local_minloc += istart;
-           in_long.value = long_cur_min;
-           in_long.index = local_minloc;
-           MPI_Allreduce(&in_long, &out_long, 1, MPI_LONG_INT,
-               MPI_MINLOC, MPI_COMM_WORLD);
-           *((long *)val) = out_long.value;
-           *loc = out_long.index;
-         }
-         else {
-            *((long *)val) = long_cur_min;
-            *loc = local_minloc;
-         }
-         break;
-      case L7_FLOAT:
-      case L7_REAL4:
-         float_cur_min=FLT_MAX;
-         local_minloc = 0;
-         fptrinp=(float *)input;
-         for (i=0;i<count;i++){
-            if (fptrinp[i] < float_cur_min){
-               local_minloc=i;
-               float_cur_min=fptrinp[i];
-            }
-         }
-         if (l7.initialized_mpi){
-           local_minloc += istart;
-           in_float.value = float_cur_min;
-           in_float.index = local_minloc;
-           MPI_Allreduce(&in_float, &out_float, 1, MPI_FLOAT_INT,
-               MPI_MINLOC, MPI_COMM_WORLD);
-           *((float *)val) = out_float.value;
-           *loc = out_float.index;
-         }
-         else {
-            *((float *)val) = float_cur_min;
-            *loc = local_minloc;
-         }
-         break;
-      case L7_DOUBLE:
-      case L7_REAL8:
-         real_cur_min=DBL_MAX;
-         local_minloc = 0;
-         rptrinp=(double *)input;
-         for (i=0;i<count;i++){
-            if (rptrinp[i] < real_cur_min){
-               local_minloc=i;
-               real_cur_min=rptrinp[i];
-            }
-         }
-         if (l7.initialized_mpi){
-            local_minloc += istart;
-            in_double.value = real_cur_min;
-            in_double.index = local_minloc;
-            MPI_Allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
-               MPI_MINLOC, MPI_COMM_WORLD);
-
-            *((double *)val) = out_double.value;
-            *loc = out_double.index;
-         }
-         else {
-            *((double *)val) = real_cur_min;
-            *loc = local_minloc;
-         }
-
-         break;
-       default:
-         printf("Error -- L7_DATATYPE not supported in L7_MinValLoc\n");
-         exit(1);
-         break;
-   }
+#ifdef HAVE_MPI
+   if (l7.initialized_mpi)
+      l7p_loc_reduce(&cur, count, comm);
 #else
-   switch (l7_datatype){
-      case L7_INT:
-      case L7_INTEGER4:
-         int_cur_min=INT_MAX;
-         local_minloc = 0;
-         iptrinp=(int *)input;
-         for (i=0;i<count;i++){
-            if (iptrinp[i] < int_cur_min){
-               local_minloc=i;
-               int_cur_min=iptrinp[i];
-            }
-         }
-         *((int *)val) = int_cur_min;
-         *loc = local_minloc;
-         break;
-      case L7_LONG:
-         long_cur_min=LONG_MAX;
-         local_minloc = 0;
-         lptrinp=(long *)input;
-         for (i=0;i<count;i++){
-            if (lptrinp[i] < long_cur_min){
-               local_minloc=i;
-               long_cur_min=lptrinp[i];
-            }
-         }
-         *((long *)val) = long_cur_min;
-         *loc = local_minloc;
-         break;
-      case L7_FLOAT:
-      case L7_REAL4:
-         float_cur_min=FLT_MAX;
-         local_minloc = 0;
-         fptrinp=(float *)input;
-         for (i=0;i<count;i++){
-            if (fptrinp[i] < float_cur_min){
-               local_minloc=i;
-               float_cur_min=fptrinp[i];
-            }
-         }
-         *((float *)val) = float_cur_min;
-         *loc = local_minloc;
-         break;
-      case L7_DOUBLE:
-      case L7_REAL8:
-         real_cur_min=DBL_MAX;
-         local_minloc = 0;
-         rptrinp=(double *)input;
-         for (i=0;i<count;i++){
-            if (rptrinp[i] < real_cur_min){
-               local_minloc=i;
-               real_cur_min=rptrinp[i];
-            }
-         }
-         *((double *)val) = real_cur_min;
-         *loc = local_minloc;
-         break;
-       default:
-         printf("Error -- L7_DATATYPE not supported in L7_MinValLoc\n");
-         exit(1);
-         break;
-   }
+   (void)comm;
 #endif
+
+   l7p_loc_store(&cur, l7_datatype, val);
+   *loc = (int)cur.loc;
+
    return(0);
+} /* End L7_MinValLoc_Comm */
+
+int L7_MinValLoc(
+      void                    *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *val,
+      int                     *loc
+      )
+{
+   return(L7_MinValLoc_Comm(input, count, l7_datatype, val, loc, MPI_COMM_WORLD));
 } /* End L7_MinValLoc */
 
 
@@ -2018,14 +1180,15 @@ void l7_minvalloc_(
    *ierr=L7_MinValLoc(input, *count, *l7_datatype, val, loc);
 } /* End l7_minvalloc_ */
 
-int L7_MaxValLocLoc_Int4(
+int L7_MaxValLocLoc_Int4_Comm(
       void                    *input,
       void                    *loc2input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
       void                    *val,
       void                    *loc,
-      void                    *loc2
+      void                    *loc2,
+      MPI_Comm                comm
       )
 {
    double real_cur_max;
@@ -2044,15 +1207,14 @@ int L7_MaxValLocLoc_Int4(
 		int    index;
 	} in_double, out_double;
 
-	nprocs = l7.numpes;
-	mype = l7.penum;
+	l7p_comm_size_rank(comm, &nprocs, &mype);
 	istart = 0;
 
 	if (l7.initialized_mpi){
 	  counts = (int *)malloc(nprocs*sizeof(int));
 	  local_count[0] = count;
 	  MPI_Allgather(local_count, 1, MPI_INT, counts, 1, MPI_INT,
-			MPI_COMM_WORLD);
+			comm);
 	  istart = 0;
 	  for (iprocs = 0; iprocs < mype; iprocs++){
 		  istart+=counts[iprocs];
@@ -2077,14 +1239,14 @@ int L7_MaxValLocLoc_Int4(
 		  local_maxloc += istart;
 		  in_double.value = real_cur_max;
 		  in_double.index = local_maxloc;
-		  MPI_Allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
-				MPI_MAXLOC, MPI_COMM_WORLD);
+		  l7p_allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
+				MPI_MAXLOC, comm);
 		  *((double *)val) = out_double.value;
 		  *((int *)loc) = out_double.index;
 
 		  in_double.index = local_maxloc2;
-		  MPI_Allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
-				  MPI_MAXLOC, MPI_COMM_WORLD);
+		  l7p_allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
+				  MPI_MAXLOC, comm);
 		  *((int*)loc2) = out_double.index;
 		}
 		else {
@@ -2124,6 +1286,19 @@ int L7_MaxValLocLoc_Int4(
    }
 #endif
 	return(0);
+} /* End L7_MaxValLocLoc_Int4_Comm */
+
+int L7_MaxValLocLoc_Int4(
+      void                    *input,
+      void                    *loc2input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *val,
+      void                    *loc,
+      void                    *loc2
+      )
+{
+   return(L7_MaxValLocLoc_Int4_Comm(input, loc2input, count, l7_datatype, val, loc, loc2, MPI_COMM_WORLD));
 } /* End L7_MaxValLocLoc_Int4 */
 
 void l7_maxvallocloc_int4_(
@@ -2140,14 +1315,15 @@ void l7_maxvallocloc_int4_(
 	*ierr=L7_MaxValLocLoc_Int4(input, loc2input, *count, *l7_datatype, val, loc, loc2);
 } /* End l7_maxvallocloc_int4_ */
 
-int L7_MaxValLocLoc_Int8(
+int L7_MaxValLocLoc_Int8_Comm(
       void                    *input,
       void                    *loc2input,
       const int               count,
       const enum L7_Datatype  l7_datatype,
       void                    *val,
       void                    *loc,
-      void                    *loc2
+      void                    *loc2,
+      MPI_Comm                comm
       )
 {
 	double    real_cur_max;
@@ -2166,15 +1342,14 @@ int L7_MaxValLocLoc_Int8(
 		int    index;
 	} in_double, out_double;
 
-	nprocs = l7.numpes;
-	mype = l7.penum;
+	l7p_comm_size_rank(comm, &nprocs, &mype);
 	istart = 0;
 
 	if (l7.initialized_mpi){
 	  counts = (int *)malloc(nprocs*sizeof(int));
 	  local_count[0] = count;
 	  MPI_Allgather(local_count, 1, MPI_INT, counts, 1, MPI_INT,
-			MPI_COMM_WORLD);
+			comm);
 	  istart = 0;
 	  for (iprocs = 0; iprocs < mype; iprocs++){
 		  istart+=counts[iprocs];
@@ -2199,14 +1374,14 @@ int L7_MaxValLocLoc_Int8(
 		  local_maxloc += istart;
 		  in_double.value = real_cur_max;
 		  in_double.index = local_maxloc;
-		  MPI_Allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
-				MPI_MAXLOC, MPI_COMM_WORLD);
+		  l7p_allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
+				MPI_MAXLOC, comm);
 		  *((double *)val) = out_double.value;
 		  *((int *)loc) = out_double.index;
 
 		  in_double.index = local_maxloc2;
-		  MPI_Allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
-				  MPI_MAXLOC, MPI_COMM_WORLD);
+		  l7p_allreduce(&in_double, &out_double, 1, MPI_DOUBLE_INT,
+				  MPI_MAXLOC, comm);
 		  *((int*)loc2) = out_double.index;
 		}
 		else {
@@ -2246,6 +1421,19 @@ int L7_MaxValLocLoc_Int8(
    }
 #endif
 	return(0);
+} /* End L7_MaxValLocLoc_Int8_Comm */
+
+int L7_MaxValLocLoc_Int8(
+      void                    *input,
+      void                    *loc2input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *val,
+      void                    *loc,
+      void                    *loc2
+      )
+{
+   return(L7_MaxValLocLoc_Int8_Comm(input, loc2input, count, l7_datatype, val, loc, loc2, MPI_COMM_WORLD));
 } /* End L7_MaxValLocLoc_Int8 */
 
 void l7_maxvallocloc_int8_(
@@ -2262,12 +1450,13 @@ void l7_maxvallocloc_int8_(
 	*ierr=L7_MaxValLocLoc_Int8(input, loc2input, *count, *l7_datatype, val, loc, loc2);
 } /* End l7_maxvallocloc_int8_ */
 
-int L7_GetGlobal(
+int L7_GetGlobal_Comm(
       void                    *array,
       const int               count,
       const enum L7_Datatype  l7_datatype,
       const int               index,
-      void                    *val
+      void                    *val,
+      MPI_Comm                comm
       )
 {
 #ifdef HAVE_MPI
@@ -2279,8 +1468,7 @@ int L7_GetGlobal(
 	int   *counts = NULL;
 	int   *iptrinp = NULL;
 
-	nprocs = l7.numpes;
-	mype   = l7.penum;
+	l7p_comm_size_rank(comm, &nprocs, &mype);
 
 	istart = 0;
 	index_start = 0;
@@ -2294,7 +1482,7 @@ int L7_GetGlobal(
 		  counts = (int *)malloc(nprocs*sizeof(int));
 		  local_count[0] = count;
 		  MPI_Allgather(local_count, 1, MPI_INT, counts, 1, MPI_INT,
-				MPI_COMM_WORLD);
+				comm);
 		  istart = 0;
 		  for (iprocs = 0; iprocs < mype; iprocs++){
 			  istart+=counts[iprocs];
@@ -2318,7 +1506,7 @@ int L7_GetGlobal(
 		found_value = iptrinp[index];
 	}
 
-	L7_Broadcast(&found_value, 1, l7_datatype, root_pe);
+	L7_Broadcast_Comm(&found_value, 1, l7_datatype, root_pe, comm);
 
 	*((int *)val) = found_value;
 
@@ -2326,7 +1514,18 @@ int L7_GetGlobal(
    *((int *)val) = ((int *)array)[index];
 #endif
 	return(0);
-}
+} /* End L7_GetGlobal_Comm */
+
+int L7_GetGlobal(
+      void                    *array,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      const int               index,
+      void                    *val
+      )
+{
+   return(L7_GetGlobal_Comm(array, count, l7_datatype, index, val, MPI_COMM_WORLD));
+} /* End L7_GetGlobal */
 
 void l7_getglobal_(
       void                   *array,
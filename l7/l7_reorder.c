@@ -0,0 +1,523 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_REORDER"
+
+#ifdef HAVE_MPI
+
+/*
+ * Sharing pattern of the owned cells: cell c is sent to the neighbors
+ * nbr[start[c]] .. nbr[start[c+1]-1], in increasing send_to order.
+ */
+struct reorder_key {
+   const int
+     *start,
+     *nbr;
+};
+
+/* A ghost's new global index and its position before the reorder. */
+struct reorder_ghost {
+   int
+     gid,
+     pos;
+};
+
+static int reorder_compare(const struct reorder_key *key, int a, int b);
+static void reorder_sort(const struct reorder_key *key, int *cells, int *work, int n);
+static int int_compare(const void *a, const void *b);
+static int ghost_compare(const void *a, const void *b);
+
+#endif /* HAVE_MPI */
+
+int L7_Reorder(
+      const int               l7_id,
+      int                     *new_local_index,
+      int                     *num_boundary,
+      int                     *new_indices_needed,
+      int                     *new_ghost_index
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Reorder computes a renumbering of the owned indices of a
+    * database that makes halo sends contiguous, and switches the
+    * database to it. Cells sent to neighbors come first, grouped by the
+    * set of neighbors they go to (in send_to order, so the cells sent
+    * only to one neighbor form a single block, followed by those it
+    * shares with later neighbors); interior cells follow in their
+    * original order. Each message is then sent in ascending new index
+    * order and the receivers put their ghosts in the same order, so
+    * every neighbor is served from one or a few contiguous blocks.
+    *
+    * Arguments
+    * =========
+    * l7_id              (input) const int
+    *                    Handle to database to reorder.
+    *
+    * new_local_index    (output) int*
+    *                    Array of length num_indices_owned; owned index i
+    *                    (0-based, local) moves to new_local_index[i]. The
+    *                    application must permute its owned data
+    *                    accordingly before the next update.
+    *
+    * num_boundary       (output) int*
+    *                    Number of owned indices sent to any neighbor;
+    *                    they occupy [0, num_boundary) in the new order,
+    *                    and interior indices [num_boundary,
+    *                    num_indices_owned) can be computed while an
+    *                    update is in flight.
+    *
+    * new_indices_needed (output) int*
+    *                    If not NULL, array of length num_indices_needed
+    *                    receiving the new global index of each ghost,
+    *                    in the order of the ghosts before the call.
+    *
+    * new_ghost_index    (output) int*
+    *                    If not NULL, array of length num_indices_needed;
+    *                    ghost i (0-based, counted from num_indices_owned)
+    *                    moves to new_ghost_index[i]. Not written when the
+    *                    ghosts keep their places (note 2).
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over the neighbors of the database: every process
+    *    renumbers its own cells, and the new global indices of ghosts
+    *    are exchanged with one neighbor collective.
+    * 2) The ghosts from each neighbor are put in ascending order of
+    *    their new global indices, so the new ghost list is ascending
+    *    as from L7_Setup. Ghosts placed by L7_Setup_Placed, or given
+    *    to L7_Setup unsorted, keep their places; only the receive
+    *    order changes.
+    * 3) Other databases over the same owned indices are not changed
+    *    and must be set up again with the new numbering.
+    * 4) Needs the send indices, so not available after
+    *    L7_Compact(l7_id, L7_COMPACT_ALL).
+    * 5) Not available for databases whose owned indices were placed
+    *    by L7_Setup_Placed; placed ghosts are fine.
+    * 6) A global id map (L7_Gid_To_Local) is rebuilt for the new
+    *    numbering.
+    * 7) Serial compilation creates a no-op (num_boundary = 0).
+    *
+    */
+
+   int
+     ierr;
+
+#if defined HAVE_MPI
+
+   l7_id_database
+     *l7_id_db;
+   struct reorder_key
+     key;
+   int
+     *start = NULL,            /* Per-cell offsets into nbr            */
+     *nbr = NULL,              /* Neighbors each cell is sent to       */
+     *cells = NULL,            /* Boundary cells in new order          */
+     *work = NULL,             /* Merge sort workspace, new ghost ids  */
+     *new_gids = NULL,         /* New global ids, owned then ghosts    */
+     *ghost_gids = NULL,       /* New ghost ids in new receive order   */
+     *ghost_index = NULL,      /* New receive position of each ghost   */
+     *new_offsets = NULL;      /* ghost_offsets in new receive order   */
+   struct reorder_ghost
+     *ghosts = NULL;           /* One receive block, sorted            */
+   size_t
+     new_gids_len;
+   int
+     c,
+     i,
+     j,
+     k,
+     map_ierr = L7_OK,         /* Rebuilding the global id map         */
+     num_indices_owned,
+     num_indices_needed,
+     num_send_indices,
+     num_boundary_cells,
+     num_sends,
+     num_recvs,
+     offset;
+
+#endif /* HAVE_MPI */
+
+   if (new_local_index == NULL || num_boundary == NULL){
+      ierr = -1;
+      L7_ASSERT(new_local_index != NULL && num_boundary != NULL,
+            "new_local_index or num_boundary is NULL", ierr);
+   }
+
+#if defined HAVE_MPI
+
+   if (! l7.mpi_initialized){
+      return(0);
+   }
+
+   if (l7_id <= 0){
+      ierr = -1;
+      L7_ASSERT( l7_id > 0, "l7_id <= 0", ierr);
+   }
+
+   l7_id_db = l7p_set_database(l7_id);
+   if (l7_id_db == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
+   }
+
+   num_indices_owned  = l7_id_db->num_indices_owned;
+   num_indices_needed = l7_id_db->num_indices_needed;
+   num_sends          = l7_id_db->num_sends;
+   num_recvs          = l7_id_db->num_recvs;
+
+   if (l7_id_db->numpes == 1){
+      for (i=0; i<num_indices_owned; i++)
+         new_local_index[i] = i;
+      *num_boundary = 0;
+      return(L7_OK);
+   }
+
+   if (l7_id_db->owned_placed){
+      ierr = -1;
+      L7_ASSERT(! l7_id_db->owned_placed,
+            "Owned indices placed by L7_Setup_Placed", ierr);
+   }
+
+   if (num_sends > 0 && l7_id_db->indices_local_to_send == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db->indices_local_to_send != NULL,
+            "Send indices released by L7_Compact", ierr);
+   }
+
+   num_send_indices = 0;
+   for (k=0; k<num_sends; k++)
+      num_send_indices += l7_id_db->send_counts[k];
+
+   start     = (int *)calloc((size_t)num_indices_owned+1, sizeof(int));
+   nbr       = (int *)malloc(((size_t)num_send_indices+1)*sizeof(int));
+   cells     = (int *)malloc(((size_t)num_indices_owned+1)*sizeof(int));
+   work      = (int *)malloc(((size_t)(num_indices_owned > num_indices_needed ?
+                                num_indices_owned : num_indices_needed)+1)*sizeof(int));
+   new_gids_len = (size_t)num_indices_owned + num_indices_needed;
+   if (l7_id_db->ghost_offsets){
+      for (i=0; i<num_indices_needed; i++){
+         if ((size_t)l7_id_db->ghost_offsets[i] >= new_gids_len)
+            new_gids_len = (size_t)l7_id_db->ghost_offsets[i] + 1;
+      }
+   }
+   new_gids  = (int *)malloc((new_gids_len+1)*sizeof(int));
+   ghost_gids  = (int *)malloc(((size_t)num_indices_needed+1)*sizeof(int));
+   ghost_index = (int *)malloc(((size_t)num_indices_needed+1)*sizeof(int));
+   new_offsets = (int *)malloc(((size_t)num_indices_needed+1)*sizeof(int));
+   ghosts = (struct reorder_ghost *)malloc(((size_t)num_indices_needed+1)*sizeof(struct reorder_ghost));
+   if (!start || !nbr || !cells || !work || !new_gids ||
+       !ghost_gids || !ghost_index || !new_offsets || !ghosts){
+      free(start); free(nbr); free(cells); free(work); free(new_gids);
+      free(ghost_gids); free(ghost_index); free(new_offsets); free(ghosts);
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "No memory for L7_Reorder", ierr);
+   }
+
+   /*
+    * Neighbor lists per owned cell, in CSR form. Walking the messages
+    * in send_to order leaves each list sorted.
+    */
+
+   offset = 0;
+   for (k=0; k<num_sends; k++){
+      for (j=0; j<l7_id_db->send_counts[k]; j++){
+         start[l7_id_db->indices_local_to_send[offset+j]+1]++;
+      }
+      offset += l7_id_db->send_counts[k];
+   }
+   for (c=0; c<num_indices_owned; c++)
+      start[c+1] += start[c];
+
+   memcpy(work, start, (size_t)num_indices_owned*sizeof(int));
+   offset = 0;
+   for (k=0; k<num_sends; k++){
+      for (j=0; j<l7_id_db->send_counts[k]; j++){
+         c = l7_id_db->indices_local_to_send[offset+j];
+         nbr[work[c]++] = k;
+      }
+      offset += l7_id_db->send_counts[k];
+   }
+
+   /*
+    * Boundary cells sorted by sharing pattern, then interior cells.
+    */
+
+   num_boundary_cells = 0;
+   for (c=0; c<num_indices_owned; c++){
+      if (start[c+1] > start[c])
+         cells[num_boundary_cells++] = c;
+   }
+
+   key.start     = start;
+   key.nbr       = nbr;
+   reorder_sort(&key, cells, work, num_boundary_cells);
+
+   for (i=0; i<num_boundary_cells; i++)
+      new_local_index[cells[i]] = i;
+
+   i = num_boundary_cells;
+   for (c=0; c<num_indices_owned; c++){
+      if (start[c+1] == start[c])
+         new_local_index[c] = i++;
+   }
+
+   *num_boundary = num_boundary_cells;
+
+   /*
+    * Tell receivers the new global index of every ghost, with the
+    * datatypes of the old numbering.
+    */
+
+   for (c=0; c<num_indices_owned; c++)
+      new_gids[c] = l7_id_db->my_start_index + new_local_index[c];
+
+   ierr = MPI_Neighbor_alltoallw(new_gids,
+         l7_id_db->nbr_state.mpi_send_counts,
+         (MPI_Aint *)l7_id_db->nbr_state.mpi_send_offsets,
+         l7_id_db->nbr_state.update_datatypes[4].out_types,
+         new_gids,
+         l7_id_db->nbr_state.mpi_recv_counts,
+         (MPI_Aint *)l7_id_db->nbr_state.mpi_recv_offsets,
+         l7_id_db->nbr_state.update_datatypes[4].in_types,
+         l7_id_db->nbr_state.comm);
+
+   if (ierr == MPI_SUCCESS){
+
+      /*
+       * Renumber the send lists, each message in ascending order.
+       */
+
+      offset = 0;
+      for (k=0; k<num_sends; k++){
+         for (j=0; j<l7_id_db->send_counts[k]; j++){
+            l7_id_db->indices_local_to_send[offset+j] =
+               new_local_index[l7_id_db->indices_local_to_send[offset+j]];
+         }
+         qsort(&l7_id_db->indices_local_to_send[offset], (size_t)l7_id_db->send_counts[k],
+               sizeof(int), int_compare);
+         offset += l7_id_db->send_counts[k];
+      }
+
+      if (l7_id_db->indices_global_to_send){
+         for (i=0; i<num_send_indices; i++){
+            l7_id_db->indices_global_to_send[i] =
+               l7_id_db->indices_local_to_send[i] + l7_id_db->my_start_index;
+         }
+      }
+
+      /*
+       * The new ghost ids in receive order, then each neighbor's block
+       * sorted to match the order it now sends in.
+       */
+
+      for (i=0; i<num_indices_needed; i++){
+         work[i] = l7_id_db->ghost_offsets ? new_gids[l7_id_db->ghost_offsets[i]]
+                                           : new_gids[num_indices_owned+i];
+      }
+
+      offset = 0;
+      for (k=0; k<num_recvs; k++){
+         for (j=0; j<l7_id_db->recv_counts[k]; j++){
+            ghosts[j].gid = work[offset+j];
+            ghosts[j].pos = offset+j;
+         }
+         qsort(ghosts, (size_t)l7_id_db->recv_counts[k], sizeof(struct reorder_ghost), ghost_compare);
+         for (j=0; j<l7_id_db->recv_counts[k]; j++){
+            ghost_gids[offset+j] = ghosts[j].gid;
+            ghost_index[ghosts[j].pos] = offset+j;
+            if (l7_id_db->ghost_offsets)
+               new_offsets[offset+j] = l7_id_db->ghost_offsets[ghosts[j].pos];
+         }
+         offset += l7_id_db->recv_counts[k];
+      }
+
+      /* Placed ghosts keep their slots; the others move with the order. */
+      if (l7_id_db->ghost_offsets){
+         memcpy(l7_id_db->ghost_offsets, new_offsets, (size_t)num_indices_needed*sizeof(int));
+      }
+      else if (new_ghost_index){
+         memcpy(new_ghost_index, ghost_index, (size_t)num_indices_needed*sizeof(int));
+      }
+
+      if (l7_id_db->indices_needed){
+         memcpy(l7_id_db->indices_needed, ghost_gids, (size_t)num_indices_needed*sizeof(int));
+      }
+      if (new_indices_needed){
+         memcpy(new_indices_needed, work, (size_t)num_indices_needed*sizeof(int));
+      }
+
+      l7p_database_types_free(l7_id_db);
+      l7p_database_types_create(l7_id_db);
+
+      /* The map follows the new numbering. */
+      if (l7_id_db->gid_runs){
+         map_ierr = l7p_gid_map_build(l7_id_db, NULL, ghost_gids);
+      }
+   }
+
+   free(start);
+   free(nbr);
+   free(cells);
+   free(work);
+   free(new_gids);
+   free(ghost_gids);
+   free(ghost_index);
+   free(new_offsets);
+   free(ghosts);
+
+   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Neighbor_alltoallw", ierr);
+   L7_ASSERT(map_ierr == L7_OK, "Failed to rebuild global id map", map_ierr);
+
+   l7_id_db->stats.memory_bytes = (long long)l7p_database_memory_usage(l7_id_db);
+
+#else
+
+   (void)l7_id;
+   (void)new_indices_needed;
+   (void)new_ghost_index;
+   *num_boundary = 0;
+
+#endif /* HAVE_MPI */
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Reorder */
+
+#ifdef HAVE_MPI
+
+static int reorder_compare(const struct reorder_key *key, int a, int b)
+{
+   /* Lexicographic on the neighbor lists, a prefix sorting first, then
+    * by the old index. */
+
+   int
+     i,
+     len_a = key->start[a+1] - key->start[a],
+     len_b = key->start[b+1] - key->start[b];
+   const int
+     *nbr_a = &key->nbr[key->start[a]],
+     *nbr_b = &key->nbr[key->start[b]];
+
+   for (i=0; i<len_a && i<len_b; i++){
+      if (nbr_a[i] != nbr_b[i])
+         return(nbr_a[i] < nbr_b[i] ? -1 : 1);
+   }
+   if (len_a != len_b)
+      return(len_a < len_b ? -1 : 1);
+
+   return(a < b ? -1 : (a > b));
+}
+
+static int int_compare(const void *a, const void *b)
+{
+   int
+     ia = *(const int *)a,
+     ib = *(const int *)b;
+
+   return(ia < ib ? -1 : (ia > ib));
+}
+
+static int ghost_compare(const void *a, const void *b)
+{
+   const struct reorder_ghost
+     *ga = (const struct reorder_ghost *)a,
+     *gb = (const struct reorder_ghost *)b;
+
+   return(ga->gid < gb->gid ? -1 : (ga->gid > gb->gid));
+}
+
+static void reorder_sort(const struct reorder_key *key, int *cells, int *work, int n)
+{
+   /* Bottom-up merge sort; qsort has no way to pass the key. */
+
+   int
+     width,
+     lo,
+     mid,
+     hi,
+     i,
+     j,
+     k,
+     *src = cells,
+     *dst = work,
+     *tmp;
+
+   for (width=1; width<n; width*=2){
+      for (lo=0; lo<n; lo+=2*width){
+         mid = (lo+width < n) ? lo+width : n;
+         hi  = (lo+2*width < n) ? lo+2*width : n;
+         i = lo; j = mid; k = lo;
+         while (i < mid && j < hi)
+            dst[k++] = (reorder_compare(key, src[i], src[j]) <= 0) ? src[i++] : src[j++];
+         while (i < mid) dst[k++] = src[i++];
+         while (j < hi)  dst[k++] = src[j++];
+      }
+      tmp = src; src = dst; dst = tmp;
+   }
+
+   if (src != cells)
+      memcpy(cells, src, (size_t)n*sizeof(int));
+}
+
+#endif /* HAVE_MPI */
+
+void L7_REORDER(
+      const int   *l7_id,
+      int         *new_local_index,
+      int         *num_boundary,
+      int         *new_indices_needed,
+      int         *new_ghost_index,
+      int         *ierr
+      )
+{
+   *ierr = L7_Reorder(*l7_id, new_local_index, num_boundary, new_indices_needed, new_ghost_index);
+}
@@ -0,0 +1,453 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_REPRO_SUM"
+
+/*
+ * Reproducible sum of doubles (L7_SUM_REPRODUCIBLE).
+ *
+ * The binary exponent range is cut into fixed levels RSUM_WIDTH bits
+ * apart; level j has grid 2^g(j), g(j) = RSUM_TOP - RSUM_WIDTH*j. A
+ * value x contributes RN(x, 2^g(j)) - RN(x, 2^g(j-1)) to level j, a
+ * function of x alone, and these contributions are added exactly: the
+ * sum of a level therefore does not depend on the order of the values
+ * or on how they are split among processes. A partial sum keeps the
+ * RSUM_FOLD levels below the level of its largest value, each as a
+ * double s plus a carry count c of 2^(g+RSUM_WIDTH) units; two partial
+ * sums merge by aligning levels, dropping whole levels that fall off
+ * the bottom, and adding exactly. The final double is computed from a
+ * canonical form of the surviving levels, so every decomposition and
+ * process count gives the same bits.
+ *
+ * RN(x, 2^g) is (x + M) - M with M = 1.5*2^(g+52), which relies on
+ * IEEE double arithmetic: like a Kahan sum it must not be reassociated,
+ * which the VECTOR_FPMODEL flags ensure and -ffast-math breaks. Values
+ * are deposited in blocks of RSUM_BLOCK with omp simd loops, whose
+ * vector partial sums are all exact: a block is small enough that no
+ * partial sum can outgrow its level before the carry is taken.
+ *
+ * Accuracy is about 2^-80 of the largest magnitude per value, far
+ * better than a plain sum. Infinities, NaNs and magnitudes of 2^959
+ * and above fall back to a plain, non-reproducible sum.
+ */
+
+#define RSUM_FOLD       3          /* Written out in rsum_deposit. */
+#define RSUM_WIDTH      40
+#define RSUM_TOP        920        /* Grid exponent of level 0. */
+#define RSUM_LEVEL_MAX  47         /* Finest top level; its bottom level
+                                    * grid 2^-1040 is representable. */
+#define RSUM_BLOCK      4096
+
+struct rsum_state
+{
+   double
+     s[RSUM_FOLD],                 /* Levels level .. level+RSUM_FOLD-1.  */
+     c[RSUM_FOLD],                 /* Carries, in 2^(g+RSUM_WIDTH) units. */
+     fallback;                     /* Plain sum when fallback_flag is set. */
+   int
+     level,
+     fallback_flag;
+};
+
+static int rsum_level(
+      const int      e
+      )
+{
+   /*
+    * Top level whose window holds values of magnitude below 2^e:
+    * 2^e <= 2^(g+RSUM_WIDTH-1). -1 if no level does.
+    */
+
+   int
+     level;
+
+   if (e > RSUM_TOP + RSUM_WIDTH - 1)
+      return(-1);
+
+   level = (RSUM_TOP + RSUM_WIDTH - 1 - e) / RSUM_WIDTH;
+   if (level > RSUM_LEVEL_MAX)
+      level = RSUM_LEVEL_MAX;
+   return(level);
+}
+
+static void rsum_shift(
+      struct rsum_state  *st,
+      const int          level
+      )
+{
+   /*
+    * Move st up to the coarser top level; levels falling off the
+    * bottom are dropped whole.
+    */
+
+   int
+     d,
+     k;
+
+   if (level >= st->level)
+      return;
+
+   d = st->level - level;
+   for (k=RSUM_FOLD-1; k>=0; k--){
+      st->s[k] = (k-d >= 0) ? st->s[k-d] : 0.0;
+      st->c[k] = (k-d >= 0) ? st->c[k-d] : 0.0;
+   }
+   st->level = level;
+}
+
+static void rsum_carry(
+      struct rsum_state  *st,
+      const int          k
+      )
+{
+   /*
+    * Move whole 2^(g+RSUM_WIDTH) units of level k from s to c, leaving
+    * s in [0, 2^(g+RSUM_WIDTH)). Every step is exact.
+    */
+
+   int
+     g = RSUM_TOP - RSUM_WIDTH*(st->level + k);
+   double
+     units;
+
+   units = floor(st->s[k] * ldexp(1.0, -(g + RSUM_WIDTH)));
+   st->s[k] -= units * ldexp(1.0, g + RSUM_WIDTH);
+   st->c[k] += units;
+}
+
+static double rsum_value(
+      const struct rsum_state  *in
+      )
+{
+   /*
+    * The double nearest (to within a few ulps) the exact sum held by in,
+    * computed from a canonical form so that equal sums give equal bits.
+    */
+
+   struct rsum_state
+     st = *in;
+   int
+     k;
+   double
+     value;
+
+   if (st.fallback_flag)
+      return(st.fallback);
+
+   /* Fold each level's carries into the level above: the carry unit of
+    * level k is the grid of level k-1, so this is exact. */
+   for (k=RSUM_FOLD-1; k>=0; k--){
+      rsum_carry(&st, k);
+      if (k > 0){
+         st.s[k-1] += st.c[k] * ldexp(1.0, RSUM_TOP - RSUM_WIDTH*(st.level + k) + RSUM_WIDTH);
+         st.c[k] = 0.0;
+      }
+   }
+
+   value = st.c[0] * ldexp(1.0, RSUM_TOP - RSUM_WIDTH*st.level + RSUM_WIDTH) + st.s[0];
+   for (k=1; k<RSUM_FOLD; k++)
+      value += st.s[k];
+
+   return(value);
+}
+
+static void rsum_merge(
+      const struct rsum_state  *in,
+      struct rsum_state        *inout
+      )
+{
+   struct rsum_state
+     a = *in;
+   int
+     k;
+
+   if (a.fallback_flag || inout->fallback_flag){
+      inout->fallback = rsum_value(&a) + rsum_value(inout);
+      inout->fallback_flag = 1;
+      return;
+   }
+
+   rsum_shift(&a, inout->level);
+   rsum_shift(inout, a.level);
+
+   for (k=0; k<RSUM_FOLD; k++){
+      inout->s[k] += a.s[k];
+      inout->c[k] += a.c[k];
+      rsum_carry(inout, k);
+   }
+}
+
+static void rsum_deposit(
+      const double       *x,
+      const int          count,
+      struct rsum_state  *st
+      )
+{
+   uint64_t
+     bits;
+   unsigned int
+     max_exp,
+     e;
+   double
+     s0,
+     s1,
+     s2,
+     big0,
+     big1,
+     big2,
+     r,
+     v;
+   int
+     block,
+     len,
+     level,
+     g,
+     i;
+
+   for (block=0; block<count; block+=RSUM_BLOCK){
+      len = (count - block < RSUM_BLOCK) ? count - block : RSUM_BLOCK;
+      const double *xb = x + block;
+
+      /* Largest biased exponent in the block; 2047 flags an infinity
+       * or NaN. Integer maxima vectorize where double ones do not. */
+      max_exp = 0;
+#ifdef _OPENMP_SIMD
+#pragma omp simd reduction(max:max_exp)
+#endif
+      for (i=0; i<len; i++){
+         memcpy(&bits, &xb[i], sizeof(bits));
+         e = (unsigned int)(bits >> 52) & 0x7ff;
+         max_exp = (e > max_exp) ? e : max_exp;
+      }
+
+      /* |x| < 2^(max_exp-1022), subnormals and zero included. */
+      level = (max_exp == 0x7ff) ? -1 : rsum_level((int)max_exp - 1022);
+      if (level < 0){
+         st->fallback = 0.0;
+         for (i=0; i<count; i++)
+            st->fallback += x[i];
+         st->fallback_flag = 1;
+         return;
+      }
+      rsum_shift(st, level);
+
+      g = RSUM_TOP - RSUM_WIDTH*st->level;
+      big0 = 1.5 * ldexp(1.0, g + 52);
+      big1 = 1.5 * ldexp(1.0, g - RSUM_WIDTH + 52);
+      big2 = 1.5 * ldexp(1.0, g - 2*RSUM_WIDTH + 52);
+
+      /* Every addition below is exact, so any vector order gives the
+       * same sums. */
+      s0 = 0.0;
+      s1 = 0.0;
+      s2 = 0.0;
+#ifdef _OPENMP_SIMD
+#pragma omp simd reduction(+:s0,s1,s2)
+#endif
+      for (i=0; i<len; i++){
+         v = xb[i];
+         r = (v + big0) - big0;
+         s0 += r;
+         v -= r;
+         r = (v + big1) - big1;
+         s1 += r;
+         v -= r;
+         s2 += (v + big2) - big2;
+      }
+
+      st->s[0] += s0;
+      st->s[1] += s1;
+      st->s[2] += s2;
+      for (i=0; i<RSUM_FOLD; i++)
+         rsum_carry(st, i);
+   }
+}
+
+#ifdef HAVE_MPI
+
+static void rsum_combine(
+      void          *invec,
+      void          *inoutvec,
+      int           *len,
+      MPI_Datatype  *datatype
+      )
+{
+   int
+     k;
+
+   (void)datatype;
+
+   for (k=0; k<*len; k++)
+      rsum_merge(&((const struct rsum_state *)invec)[k],
+                 &((struct rsum_state *)inoutvec)[k]);
+}
+
+#endif /* HAVE_MPI */
+
+void l7p_repro_sum_init(void)
+{
+   /*
+    * Create the partial sum datatype and merge op; MPI must be
+    * initialized.
+    */
+
+#ifdef HAVE_MPI
+   MPI_Type_contiguous((int)sizeof(struct rsum_state), MPI_BYTE, &l7.repro_sum_type);
+   MPI_Type_commit(&l7.repro_sum_type);
+   MPI_Op_create(rsum_combine, 1, &l7.repro_sum_op);
+#endif
+
+} /* End l7p_repro_sum_init */
+
+void l7p_repro_sum_free(void)
+{
+#ifdef HAVE_MPI
+   if (l7.repro_sum_type != MPI_DATATYPE_NULL && l7.repro_sum_type != 0){
+      MPI_Type_free(&l7.repro_sum_type);
+      MPI_Op_free(&l7.repro_sum_op);
+   }
+   l7.repro_sum_type = MPI_DATATYPE_NULL;
+   l7.repro_sum_op   = MPI_OP_NULL;
+#endif
+
+} /* End l7p_repro_sum_free */
+
+void l7p_repro_sum(
+      const double            *input,
+      const int               count,
+      double                  *output,
+      MPI_Comm                comm
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Reproducible global sum of input[0:count-1] into *output, for
+    * L7_Sum_Comm in L7_SUM_REPRODUCIBLE mode.
+    */
+
+   struct rsum_state
+     local,
+     global;
+
+   memset(&local, 0, sizeof(local));
+   local.level = RSUM_LEVEL_MAX;
+
+   rsum_deposit(input, count, &local);
+
+#ifdef HAVE_MPI
+   if (l7.initialized_mpi){
+      l7p_allreduce(&local, &global, 1, l7.repro_sum_type, l7.repro_sum_op, comm);
+      *output = rsum_value(&global);
+      return;
+   }
+#endif
+   (void)comm;
+   (void)global;
+
+   *output = rsum_value(&local);
+
+} /* End l7p_repro_sum */
+
+int L7_Set_Sum_Mode(
+      const int               mode
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Set_Sum_Mode selects how L7_Sum adds L7_DOUBLE and L7_REAL8
+    * values, overriding L7_SUM_MODE.
+    *
+    * Arguments
+    * =========
+    * mode               (input) const int
+    *                    L7_SUM_FAST or L7_SUM_REPRODUCIBLE.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Collective in effect: all processes must use the same mode.
+    * 2) Only L7_Sum and L7_Sum_Comm follow the mode. The double sums
+    *    of L7_Isum, L7_Ireduce_Multi and L7_Reduce_Multi are always
+    *    plain sums, so they can differ from L7_Sum in the last bits.
+    *
+    */
+
+   int
+     ierr;
+
+   if (mode != L7_SUM_FAST && mode != L7_SUM_REPRODUCIBLE){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Invalid sum mode", ierr);
+   }
+
+   l7.sum_mode = mode;
+
+   return(L7_OK);
+
+} /* End L7_Set_Sum_Mode */
+
+int L7_Get_Sum_Mode(void)
+{
+   /*
+    * Returns the enum L7_SumMode used by L7_Sum.
+    */
+
+   return(l7.sum_mode);
+}
+
+void l7_set_sum_mode_(
+      const int               *mode,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Set_Sum_Mode(*mode);
+}
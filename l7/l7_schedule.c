@@ -0,0 +1,444 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_SCHEDULE"
+
+#ifdef HAVE_MPI
+
+struct send_key {
+   long long key;
+   int       index;
+};
+
+static int send_key_compare(const void *va, const void *vb)
+{
+   const struct send_key *a = (const struct send_key *)va;
+   const struct send_key *b = (const struct send_key *)vb;
+
+   if (a->key != b->key)
+      return((a->key < b->key) ? -1 : 1);
+   return(a->index - b->index);
+}
+
+#endif /* HAVE_MPI */
+
+int l7p_database_schedule_create(
+      l7_id_database *l7_id_db
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_database_schedule_create (re)builds the point-to-point update
+    * schedule of a database from its send lists: the posting order of
+    * the sends, their offsets in the pack buffer and the request array.
+    * Databases using L7_UPDATE_NEIGHBOR get none.
+    *
+    * Notes
+    * =====
+    * 1) l7p_update_p2p sizes the pack buffer for the element size of
+    *    each update. Without indices_local_to_send (L7_COMPACT_ALL) it
+    *    sends with the send datatypes instead.
+    *
+    */
+
+#ifdef HAVE_MPI
+
+   struct send_key
+     *keys;
+   int
+     i,
+     ierr,
+     num_sends,
+     num_recvs,
+     numpes,
+     rotate,
+     total;
+
+   l7p_database_schedule_free(l7_id_db);
+
+   if (l7_id_db->update_method != L7_UPDATE_P2P)
+      return(L7_OK);
+
+   num_sends = l7_id_db->num_sends;
+   num_recvs = l7_id_db->num_recvs;
+   numpes    = l7_id_db->numpes;
+
+   l7_id_db->send_schedule = (int *)malloc((size_t)(num_sends+1) * sizeof(int));
+   l7_id_db->send_offsets  = (int *)malloc((size_t)(num_sends+1) * sizeof(int));
+   l7_id_db->p2p_requests  = (MPI_Request *)malloc((size_t)(num_recvs+num_sends+1) * sizeof(MPI_Request));
+   keys = (struct send_key *)malloc((size_t)(num_sends+1) * sizeof(struct send_key));
+   if (l7_id_db->send_schedule == NULL || l7_id_db->send_offsets == NULL ||
+       l7_id_db->p2p_requests == NULL || keys == NULL){
+      free(keys);
+      l7p_database_schedule_free(l7_id_db);
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "No memory for update schedule", ierr);
+   }
+
+   total = 0;
+   for (i=0; i<num_sends; i++){
+      l7_id_db->send_offsets[i] = total;
+      total += l7_id_db->send_counts[i];
+
+      rotate = (l7_id_db->send_to[i] - l7_id_db->penum + numpes) % numpes;
+      keys[i].index = i;
+      switch (l7_id_db->send_order){
+         case L7_SEND_ORDER_ROTATE:
+            keys[i].key = rotate;
+            break;
+         case L7_SEND_ORDER_SIZE:
+            keys[i].key = ((long long)(INT_MAX - l7_id_db->send_counts[i]) << 32) | rotate;
+            break;
+         default:
+            keys[i].key = i;
+            break;
+      }
+   }
+
+   l7_id_db->send_offsets[num_sends] = total;
+
+   qsort(keys, (size_t)num_sends, sizeof(struct send_key), send_key_compare);
+   for (i=0; i<num_sends; i++)
+      l7_id_db->send_schedule[i] = keys[i].index;
+   free(keys);
+
+#endif /* HAVE_MPI */
+
+   return(L7_OK);
+
+} /* End l7p_database_schedule_create */
+
+void l7p_database_schedule_free(
+      l7_id_database *l7_id_db
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Release the state built by l7p_database_schedule_create.
+    */
+
+#ifdef HAVE_MPI
+
+   free(l7_id_db->send_schedule);
+   free(l7_id_db->send_offsets);
+   free(l7_id_db->p2p_requests);
+   L7_Mem_Release(l7_id_db->pack_buffer);
+
+   l7_id_db->send_schedule   = NULL;
+   l7_id_db->send_offsets    = NULL;
+   l7_id_db->p2p_requests    = NULL;
+   l7_id_db->pack_buffer     = NULL;
+   l7_id_db->pack_buffer_len = 0;
+
+#endif /* HAVE_MPI */
+
+} /* End l7p_database_schedule_free */
+
+#ifdef HAVE_MPI
+
+static void pack_send(
+      const l7_id_database   *l7_id_db,
+      const void             *data_buffer,
+      const int              sizeof_type,
+      const int              send
+      )
+{
+   /*
+    * Gather the data for send 'send' into its slot of the pack buffer.
+    */
+
+   const int
+     *indices = &l7_id_db->indices_local_to_send[l7_id_db->send_offsets[send]];
+   int
+     j,
+     count = l7_id_db->send_counts[send];
+   char
+     *packed = l7_id_db->pack_buffer + (size_t)l7_id_db->send_offsets[send] * sizeof_type;
+
+   switch (sizeof_type){
+      case 8:
+         for (j=0; j<count; j++)
+            ((uint64_t *)packed)[j] = ((const uint64_t *)data_buffer)[indices[j]];
+         break;
+      case 4:
+         for (j=0; j<count; j++)
+            ((uint32_t *)packed)[j] = ((const uint32_t *)data_buffer)[indices[j]];
+         break;
+      case 2:
+         for (j=0; j<count; j++)
+            ((uint16_t *)packed)[j] = ((const uint16_t *)data_buffer)[indices[j]];
+         break;
+      default:
+         for (j=0; j<count; j++)
+            memcpy(packed + (size_t)j * sizeof_type,
+                  (const char *)data_buffer + (size_t)indices[j] * sizeof_type, sizeof_type);
+         break;
+   }
+}
+
+#endif /* HAVE_MPI */
+
+int l7p_update_p2p(
+      l7_id_database            *l7_id_db,
+      void                      *data_buffer,
+      const int                 sizeof_type,
+      struct l7_update_datatype *update_datatype
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_update_p2p is the L7_UPDATE_P2P body of L7_Update. Every
+    * receive is posted first, straight into the ghost locations through
+    * the receive datatypes, so no message arrives unexpected. Sends are
+    * then packed and posted in schedule order as elements of the same
+    * base type, so both sides have the same type signature; once
+    * max_in_flight sends are outstanding, the next waits for one of them
+    * to complete.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    */
+
+#ifdef HAVE_MPI
+
+   MPI_Request
+     *recv_requests,
+     *send_requests;
+   int
+     i,
+     k,
+     done,
+     ierr,
+     in_flight,
+     num_recvs,
+     num_sends,
+     packed,
+     tag;
+   size_t
+     pack_len;
+
+   num_sends = l7_id_db->num_sends;
+   num_recvs = l7_id_db->num_recvs;
+
+   /* The pack buffer only grows, to the largest element size updated. */
+   packed = (l7_id_db->indices_local_to_send != NULL);
+   pack_len = (size_t)l7_id_db->send_offsets[num_sends] * sizeof_type;
+   if (packed && pack_len > l7_id_db->pack_buffer_len){
+      L7_Mem_Release(l7_id_db->pack_buffer);
+      l7_id_db->pack_buffer_len = 0;
+      l7_id_db->pack_buffer = (char *)L7_Mem_Alloc(pack_len);
+      if (l7_id_db->pack_buffer == NULL){
+         ierr = -1;
+         L7_ASSERT(ierr == 0, "No memory for pack buffer", ierr);
+      }
+      l7_id_db->pack_buffer_len = pack_len;
+   }
+
+   /* Each database has its own graph communicator, created without
+    * reordering, so its ranks are those of l7_id_db->comm and a fixed
+    * tag cannot match another database's or the application's messages.
+    * Handles are numbered per process and cannot be used as tags. */
+   tag = L7_UPDATE_P2P_TAG;
+
+   recv_requests = l7_id_db->p2p_requests;
+   send_requests = &l7_id_db->p2p_requests[num_recvs];
+
+   for (i=0; i<num_recvs; i++){
+      ierr = MPI_Irecv(data_buffer, 1, update_datatype->in_types[i],
+            l7_id_db->recv_from[i], tag, l7_id_db->nbr_state.comm, &recv_requests[i]);
+      L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Irecv", ierr);
+   }
+
+   for (i=0; i<num_sends; i++)
+      send_requests[i] = MPI_REQUEST_NULL;
+
+   in_flight = 0;
+   for (k=0; k<num_sends; k++){
+      i = l7_id_db->send_schedule[k];
+
+      if (l7_id_db->max_in_flight > 0 && in_flight >= l7_id_db->max_in_flight){
+         ierr = MPI_Waitany(num_sends, send_requests, &done, MPI_STATUS_IGNORE);
+         L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Waitany", ierr);
+         in_flight--;
+      }
+
+      if (packed){
+         pack_send(l7_id_db, data_buffer, sizeof_type, i);
+         ierr = MPI_Isend(l7_id_db->pack_buffer + (size_t)l7_id_db->send_offsets[i] * sizeof_type,
+               l7_id_db->send_counts[i], update_datatype->base_type,
+               l7_id_db->send_to[i], tag, l7_id_db->nbr_state.comm, &send_requests[i]);
+      }
+      else {
+         ierr = MPI_Isend(data_buffer, 1, update_datatype->out_types[i],
+               l7_id_db->send_to[i], tag, l7_id_db->nbr_state.comm, &send_requests[i]);
+      }
+      L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Isend", ierr);
+      in_flight++;
+   }
+
+   ierr = MPI_Waitall(num_recvs + num_sends, l7_id_db->p2p_requests, MPI_STATUSES_IGNORE);
+   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Waitall", ierr);
+
+#endif /* HAVE_MPI */
+
+   return(L7_OK);
+
+} /* End l7p_update_p2p */
+
+int L7_Set_Update_Schedule(
+      const int               l7_id,
+      const int               method,
+      const int               send_order,
+      const int               max_in_flight
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Set_Update_Schedule chooses how L7_Update exchanges data for a
+    * database (see enum L7_UpdateMethod and enum L7_SendOrder).
+    *
+    * Arguments
+    * =========
+    * l7_id              (input) const int
+    *                    Handle to an existing database.
+    *
+    * method             (input) const int
+    *                    L7_UPDATE_NEIGHBOR or L7_UPDATE_P2P.
+    *
+    * send_order         (input) const int
+    *                    enum L7_SendOrder, used by L7_UPDATE_P2P.
+    *
+    * max_in_flight      (input) const int
+    *                    Most sends outstanding at once in L7_UPDATE_P2P,
+    *                    0 for no limit.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over the database's communicator: every process
+    *    must pass the same method, since a P2P exchange cannot meet a
+    *    neighbor collective. send_order and max_in_flight are local
+    *    and may differ between processes.
+    * 2) The choice survives later setups of the same handle.
+    *
+    */
+
+   int
+     ierr;
+
+#ifdef HAVE_MPI
+
+   l7_id_database
+     *l7_id_db;
+   int
+     method_range[2];      /* Max of method and of -method. */
+
+   if (! l7.mpi_initialized){
+      return(0);
+   }
+
+   l7_id_db = l7p_set_database(l7_id);
+   if (l7_id_db == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
+   }
+
+   /*
+    * All processes must agree on the method; check with one allreduce
+    * of (method, -method).
+    */
+
+   method_range[0] =  method;
+   method_range[1] = -method;
+   ierr = MPI_Allreduce(MPI_IN_PLACE, method_range, 2, MPI_INT, MPI_MAX, l7_id_db->comm);
+   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Allreduce", ierr);
+   if (method_range[0] != -method_range[1]){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Update method differs between processes", ierr);
+   }
+
+   if (method < L7_UPDATE_METHOD_MIN || method > L7_UPDATE_METHOD_MAX ||
+       send_order < L7_SEND_ORDER_MIN || send_order > L7_SEND_ORDER_MAX ||
+       max_in_flight < 0){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Invalid update schedule", ierr);
+   }
+
+   l7_id_db->update_method = method;
+   l7_id_db->send_order    = send_order;
+   l7_id_db->max_in_flight = max_in_flight;
+
+   ierr = l7p_database_schedule_create(l7_id_db);
+   L7_ASSERT(ierr == L7_OK, "Failed to create update schedule", ierr);
+
+   l7_id_db->stats.memory_bytes = (long long)l7p_database_memory_usage(l7_id_db);
+
+#endif /* HAVE_MPI */
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Set_Update_Schedule */
+
+void L7_SET_UPDATE_SCHEDULE(
+      const int   *l7_id,
+      const int   *method,
+      const int   *send_order,
+      const int   *max_in_flight,
+      int         *ierr
+      )
+{
+   *ierr = L7_Set_Update_Schedule(*l7_id, *method, *send_order, *max_in_flight);
+}
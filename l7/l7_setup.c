@@ -46,12 +46,15 @@
 #define L7_LOCATION "L7_SETUP"
 //#define _L7_DEBUG
 
-int L7_Setup(
+static int l7p_setup(
 		const int      num_base,
 		const int      my_start_index,
 		const int      num_indices_owned,
 		int            *indices_needed,
-		const int      num_indices_needed,
+		int            num_indices_needed,
+		const int      *owned_offsets,
+		const int      *ghost_offsets,
+		MPI_Comm       comm,
 		int            *l7_id
 		)
 {
@@ -85,12 +88,27 @@ int L7_Setup(
 	 *
 	 * indices_needed       (input) const L7_INT*
 	 *                      Array containing indices needed by
-	 *                      calling process.
+	 *                      calling process, in any order and possibly
+	 *                      repeated; ghost i holds indices_needed[i].
+	 *                      Strictly ascending lists skip the internal
+	 *                      sort.
 	 *
 	 * num_indices_needed   (input) const L7_INT
 	 *                      Number of indices of interest listed
 	 *                      in array 'num_indices_needed'.
 	 *
+	 * owned_offsets        (input) const int*
+	 *                      Local offset of each owned index, or NULL
+	 *                      for offsets 0 .. num_indices_owned-1.
+	 *
+	 * ghost_offsets        (input) const int*
+	 *                      Local offset of each needed index, or NULL
+	 *                      to receive them after the owned indices.
+	 *
+	 * comm                 (input) MPI_Comm
+	 *                      Communicator whose processes share the
+	 *                      global indexing set.
+	 *
 	 * l7_id                (input/output) int*
 	 *                      Handle to database to be setup.
 	 *
@@ -141,8 +159,6 @@ int L7_Setup(
 	  numpes,                      /* Alias for l7_id_db.numpes.           */
 	  num_indices_acctd_for,
 	  num_outstanding_requests = 0,
-          num_recvs,
-	  num_sends,
 	  offset,
 	  penum,                       /* Alias for l7_id_db.penum.             */
 	  *pi4_in,                     /* (int *)l7.receive_buffer              */
@@ -150,6 +166,9 @@ int L7_Setup(
 	  start_indices_needed,
 	  this_index;                  /* Offset into indexing set.             */
 
+	double
+	  setup_time_start;            /* MPI_Wtime at entry, for stats.       */
+
 	l7_id_database
 	  *l7_id_db;
 
@@ -175,6 +194,8 @@ int L7_Setup(
 		return(0);
 	}
 
+	setup_time_start = MPI_Wtime();
+
    if (l7.initialized != 1){
 		ierr = -1;
 		L7_ASSERT( l7.initialized == 1, "L7 not initialized", ierr);
@@ -207,6 +228,25 @@ int L7_Setup(
 					"indices_needed == NULL", ierr);
 		}
 	}
+
+	if (ghost_offsets){
+		for (i=0; i<num_indices_needed; i++){
+			if (ghost_offsets[i] < 0){
+				ierr = -1;
+				L7_ASSERT( ghost_offsets[i] >= 0, "ghost_offsets[i] < 0", ierr);
+			}
+		}
+	}
+
+	if (owned_offsets){
+		for (i=0; i<num_indices_owned; i++){
+			if (owned_offsets[i] < 0){
+				ierr = -1;
+				L7_ASSERT( owned_offsets[i] >= 0, "owned_offsets[i] < 0", ierr);
+			}
+		}
+	}
+
 	if (*l7_id < 0){
 		ierr = *l7_id;
 		L7_ASSERT( *l7_id >=0,
@@ -242,11 +282,8 @@ int L7_Setup(
 					ierr);
 		}
 
-                l7p_nbr_state_free(&l7_id_db->nbr_state);
-                L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[1]);
-                L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[2]);
-                L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[4]);
-                L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[8]);
+		l7p_database_comm_free(l7_id_db);
+		l7p_database_arrays_reset(l7_id_db);
 	}
 	else{
 
@@ -254,49 +291,13 @@ int L7_Setup(
 		 * Allocate new database, insert into linked list.
 		 */
 
-		if (l7.num_dbs >= L7_MAX_NUM_DBS){
-			ierr = -1;
-			L7_ASSERT(l7.num_dbs < L7_MAX_NUM_DBS,
-					"Too many L7 databases allocataed",
-					ierr);
-		}
-
-		l7_id_db = (l7_id_database*)calloc(1L, sizeof(l7_id_database) );
-
+		l7_id_db = l7p_database_new();
 		if (l7_id_db == NULL){
 			ierr = -1;
 			L7_ASSERT( l7_id_db != NULL, "Failed to allocate new database",
 					ierr);
 		}
 
-		if ( !(l7.first_db) ){
-			l7.first_db = l7_id_db;
-			l7.last_db  = l7_id_db;
-			l7_id_db->next_db = NULL; /* Paranoia */
-
-			l7_id_db->l7_id = 1;
-
-			l7.num_dbs = 1;
-		}
-		else{
-
-			/*
-			 * Assign a l7_id.
-			 */
-
-			l7_id_db->l7_id = l7.last_db->l7_id + 1;
-
-			/*
-			 * Reset links.
-			 */
-
-			l7.last_db->next_db = l7_id_db;
-
-			l7.last_db = l7_id_db;
-
-			l7.num_dbs++;
-		}
-
 		*l7_id = l7_id_db->l7_id;
 
 		/*
@@ -325,10 +326,10 @@ int L7_Setup(
 	if ( (l7_id_db->indices_needed_len < num_indices_needed ) &&
 		 (num_indices_needed > 0) ){
 		if (l7_id_db->indices_needed)
-			 free(l7_id_db->indices_needed);
+			 l7p_release(&l7_id_db->allocator, l7_id_db->indices_needed);
 
 		l7_id_db->indices_needed =
-			 (int *)calloc((unsigned long long)num_indices_needed, sizeof(int) );
+			 (int *) l7p_alloc(&l7_id_db->allocator, (size_t)num_indices_needed*sizeof(int));
 
 		if (l7_id_db->indices_needed == NULL){
 			 ierr = -1;
@@ -352,14 +353,62 @@ int L7_Setup(
 
 	l7_id_db->num_indices_needed = num_indices_needed;
 
-	ierr = MPI_Comm_rank (MPI_COMM_WORLD, &l7_id_db->penum );
+	/*
+	 * Placement of received indices (L7_Setup_Placed).
+	 */
+
+	if (l7_id_db->ghost_offsets){
+		l7p_release(&l7_id_db->allocator, l7_id_db->ghost_offsets);
+		l7_id_db->ghost_offsets = NULL;
+	}
+
+	if (ghost_offsets){
+		l7_id_db->ghost_offsets =
+			(int *)l7p_alloc(&l7_id_db->allocator, ((size_t)num_indices_needed+1)*sizeof(int));
+		if (l7_id_db->ghost_offsets == NULL){
+			ierr = -1;
+			L7_ASSERT( l7_id_db->ghost_offsets != NULL,
+			           "Memory failure for ghost_offsets", ierr);
+		}
+		for (i=0; i<num_indices_needed; i++){
+			l7_id_db->ghost_offsets[i] = ghost_offsets[i];
+		}
+	}
+
+	l7_id_db->owned_placed = (owned_offsets != NULL);
+
+	/*
+	 * Needed indices may come in any order and repeat. Unless they are
+	 * strictly ascending, sort and deduplicate the database's copy and
+	 * route each ghost to the caller's slot (l7p_needed_normalize); the
+	 * handshake below then works on the unique, ascending list.
+	 */
+
+	ierr = l7p_needed_normalize(l7_id_db, num_indices_needed, &num_indices_needed);
+	L7_ASSERT( ierr == L7_OK, "Failed to sort indices_needed", ierr);
+
+	indices_needed = l7_id_db->indices_needed;
+	l7_id_db->num_indices_needed = num_indices_needed;
+
+	/*
+	 * Global id map for L7_Gid_To_Local, now while owned_offsets are at
+	 * hand; otherwise the first lookup builds it.
+	 */
+
+	l7p_gid_map_free(l7_id_db);
+	if (l7.gid_map){
+		ierr = l7p_gid_map_build(l7_id_db, owned_offsets, indices_needed);
+		L7_ASSERT( ierr == L7_OK, "Failed to build global id map", ierr);
+	}
+
+	l7_id_db->comm = comm;
+
+	ierr = MPI_Comm_rank (comm, &l7_id_db->penum );
 	L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_rank", ierr);
 
-	ierr = MPI_Comm_size (MPI_COMM_WORLD, &l7_id_db->numpes );
+	ierr = MPI_Comm_size (comm, &l7_id_db->numpes );
 	L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_size", ierr);
 
-	l7.penum = l7_id_db->penum;
-
 	/* Local shorthand */
 
 	numpes   = l7_id_db->numpes;
@@ -381,8 +430,11 @@ int L7_Setup(
 	 * The latter two steps allows arrays to be used as below.
 	 */
 
+	if (l7_id_db->starting_indices)
+		l7p_release(&l7_id_db->allocator, l7_id_db->starting_indices);
+
 	l7_id_db->starting_indices =
-		(int *)calloc((unsigned long long)(numpes+1), sizeof(int));
+		(int *) l7p_alloc(&l7_id_db->allocator, (size_t)(numpes+1)*sizeof(int));
 	if(l7_id_db->starting_indices == NULL){
 		ierr = -1;
 		L7_ASSERT(l7_id_db->starting_indices != NULL,
@@ -391,7 +443,7 @@ int L7_Setup(
 
         ierr = MPI_Allgather( &(l7_id_db->num_indices_owned), 1, MPI_INT,
 			&(l7_id_db->starting_indices[1]), 1, MPI_INT,
-			MPI_COMM_WORLD);
+			comm);
 	L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Allgather (num_indices_owned)",
 			ierr);
 
@@ -461,10 +513,10 @@ int L7_Setup(
 
 	if (l7_id_db->num_recvs > l7_id_db->recv_counts_len){
 		if (l7_id_db->recv_counts)
-			free(l7_id_db->recv_counts);
+			l7p_release(&l7_id_db->allocator, l7_id_db->recv_counts);
 
 		l7_id_db->recv_counts =
-			(int *)calloc((unsigned long long)l7_id_db->num_recvs, sizeof(int) );
+			(int *) l7p_alloc(&l7_id_db->allocator, (size_t)l7_id_db->num_recvs*sizeof(int));
 		if (l7_id_db->recv_counts == NULL){
 			ierr = -1;
 			L7_ASSERT(l7_id_db->recv_counts != NULL,
@@ -483,10 +535,10 @@ int L7_Setup(
 
 	if (l7_id_db->num_recvs > l7_id_db->recv_from_len){
 		if (l7_id_db->recv_from)
-			free(l7_id_db->recv_from);
+			l7p_release(&l7_id_db->allocator, l7_id_db->recv_from);
 
 		l7_id_db->recv_from =
-			(int *)calloc((unsigned long long)l7_id_db->num_recvs, sizeof(int) );
+			(int *) l7p_alloc(&l7_id_db->allocator, (size_t)l7_id_db->num_recvs*sizeof(int));
 
 	if (l7_id_db->recv_from == NULL){
 		ierr = -1;
@@ -560,10 +612,9 @@ int L7_Setup(
          * those pes need. This is done use a reduction (MPI_Allreduce).
          */
         if (l7.sizeof_send_buffer < 2 * numpes * (int)sizeof(int)){
-           if (l7.send_buffer)
-              free(l7.send_buffer);
+           L7_Mem_Release(l7.send_buffer);
 
-           l7.send_buffer = calloc ((unsigned long long)(2*numpes), sizeof(int));
+           l7.send_buffer = L7_Mem_Alloc((size_t)(2*numpes) * sizeof(int));
            if (l7.send_buffer == NULL){
               ierr = -1;
               L7_ASSERT(l7.send_buffer != NULL, "No memory for send buffer", ierr);
@@ -581,7 +632,7 @@ int L7_Setup(
 	for (i=0; i<l7_id_db->num_recvs; i++)
 	   pi4_in[l7_id_db->recv_from[i]] = 1;
 
-	ierr = MPI_Allreduce(pi4_in, pi4_out, numpes, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+	ierr = MPI_Allreduce(pi4_in, pi4_out, numpes, MPI_INT, MPI_SUM, comm);
 
 	L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Allreduce ( l7_id_db->recv_from )", ierr);
 
@@ -604,9 +655,9 @@ int L7_Setup(
 
 	if (num_msgs > l7_id_db->mpi_request_len) {
 	   if (l7_id_db->mpi_request)
-	      free(l7_id_db->mpi_request);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->mpi_request);
 
-	   l7_id_db->mpi_request = (MPI_Request *) calloc ((unsigned long long)num_msgs, sizeof(MPI_Request));
+	   l7_id_db->mpi_request = (MPI_Request *) l7p_alloc(&l7_id_db->allocator, (size_t)num_msgs*sizeof(MPI_Request));
 
 	  if (l7_id_db->mpi_request == NULL){
 	     ierr = -1;
@@ -618,9 +669,9 @@ int L7_Setup(
 
 	if (num_msgs > l7_id_db->mpi_status_len){
 	   if (l7_id_db->mpi_status)
-	      free(l7_id_db->mpi_status);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->mpi_status);
 
-	   l7_id_db->mpi_status = (MPI_Status *) calloc((unsigned long long)num_msgs, sizeof(MPI_Status) );
+	   l7_id_db->mpi_status = (MPI_Status *) l7p_alloc(&l7_id_db->allocator, (size_t)num_msgs*sizeof(MPI_Status));
 	   if (l7_id_db->mpi_status == NULL){
 	      ierr = -1;
 	      L7_ASSERT(l7_id_db->mpi_status != NULL,
@@ -647,7 +698,7 @@ int L7_Setup(
 
 	   ierr = MPI_Isend(&l7_id_db->recv_counts[i], 1, MPI_INT,
 	         l7_id_db->recv_from[i], L7_SETUP_SEND_COUNT_TAG,
-	         MPI_COMM_WORLD, &mpi_request[num_outstanding_requests++] );
+	         comm, &mpi_request[num_outstanding_requests++] );
 	   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Isend (recv_counts[i] )",
 	         ierr);
 	}
@@ -660,9 +711,9 @@ int L7_Setup(
 
 	if (l7_id_db->num_sends > l7_id_db->send_counts_len){
 	   if (l7_id_db->send_counts)
-	      free(l7_id_db->send_counts);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->send_counts);
 
-	   l7_id_db->send_counts = (int *) calloc((unsigned long long)l7_id_db->num_sends, sizeof(int) );
+	   l7_id_db->send_counts = (int *) l7p_alloc(&l7_id_db->allocator, (size_t)l7_id_db->num_sends*sizeof(int));
 	   if (l7_id_db->send_counts == NULL){
 	      ierr = -1;
 	      L7_ASSERT(l7_id_db->send_counts != NULL,
@@ -673,9 +724,9 @@ int L7_Setup(
 
 	if (l7_id_db->num_sends > l7_id_db->send_to_len){
 	   if (l7_id_db->send_to)
-	      free(l7_id_db->send_to);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->send_to);
 
-	   l7_id_db->send_to = (int *) calloc((unsigned long long)l7_id_db->num_sends, sizeof(int) );
+	   l7_id_db->send_to = (int *) l7p_alloc(&l7_id_db->allocator, (size_t)l7_id_db->num_sends*sizeof(int));
 	   if (l7_id_db->send_to == NULL){
 	      ierr = -1;
          L7_ASSERT(l7_id_db->send_to != NULL,
@@ -686,7 +737,7 @@ int L7_Setup(
 
 	for (i=0; i<l7_id_db->num_sends; i++){
 	   ierr = MPI_Irecv(&l7_id_db->send_counts[i], 1, MPI_INT,
-	         MPI_ANY_SOURCE, L7_SETUP_SEND_COUNT_TAG, MPI_COMM_WORLD,
+	         MPI_ANY_SOURCE, L7_SETUP_SEND_COUNT_TAG, comm,
 	         &mpi_request[num_outstanding_requests++] );
 	   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Irecv ( indices_needed[i] )", ierr);
 	}
@@ -718,11 +769,12 @@ int L7_Setup(
 	   count_total += l7_id_db->send_counts[i];
 	}
 
-	if (count_total > l7_id_db->indices_to_send_len){
+	if (count_total > l7_id_db->indices_to_send_len ||
+	    l7_id_db->indices_global_to_send == NULL){
 	   if (l7_id_db->indices_global_to_send)
-	      free(l7_id_db->indices_global_to_send);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->indices_global_to_send);
 
-	   l7_id_db->indices_global_to_send = (int *) calloc((unsigned long long)count_total, sizeof(int) );
+	   l7_id_db->indices_global_to_send = (int *) l7p_alloc(&l7_id_db->allocator, (size_t)count_total*sizeof(int));
 	   if (l7_id_db->indices_global_to_send == NULL){
 	      ierr = -1;
 	      L7_ASSERT(l7_id_db->indices_global_to_send != NULL,
@@ -730,9 +782,9 @@ int L7_Setup(
 	   }
 
 	   if (l7_id_db->indices_local_to_send)
-	      free(l7_id_db->indices_local_to_send);
+	      l7p_release(&l7_id_db->allocator, l7_id_db->indices_local_to_send);
 
-	   l7_id_db->indices_local_to_send = (int *) calloc((unsigned long long)count_total, sizeof(int) );
+	   l7_id_db->indices_local_to_send = (int *) l7p_alloc(&l7_id_db->allocator, (size_t)count_total*sizeof(int));
       if (l7_id_db->indices_local_to_send == NULL){
          ierr = -1;
          L7_ASSERT(l7_id_db->indices_local_to_send != NULL,
@@ -760,7 +812,7 @@ int L7_Setup(
 	   ierr = MPI_Isend(&l7_id_db->indices_needed[offset],
 	         l7_id_db->recv_counts[i], MPI_INT,
 	         l7_id_db->recv_from[i], L7_SETUP_INDICES_NEEDED_TAG,
-	         MPI_COMM_WORLD, &mpi_request[num_outstanding_requests++] );
+	         comm, &mpi_request[num_outstanding_requests++] );
 	   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Isend ( indices_needed[i] )", ierr);
 
 	   offset+=l7_id_db->recv_counts[i];
@@ -776,7 +828,7 @@ int L7_Setup(
 	   ierr = MPI_Irecv(&l7_id_db->indices_global_to_send[offset],
 	         l7_id_db->send_counts[i], MPI_INT,
 	         l7_id_db->send_to[i], L7_SETUP_INDICES_NEEDED_TAG,
-	         MPI_COMM_WORLD, &mpi_request[num_outstanding_requests++] );
+	         comm, &mpi_request[num_outstanding_requests++] );
 	   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Irecv ( indices_global_to_send )", ierr);
 
 	   offset += l7_id_db->send_counts[i];
@@ -793,7 +845,7 @@ int L7_Setup(
 
 #if defined _L7_DEBUG
 
-	ierr = MPI_Barrier(MPI_COMM_WORLD);
+	ierr = MPI_Barrier(comm);
 	offset = 0;
 
 	for (j=0; j<numpes; j++){
@@ -835,21 +887,30 @@ int L7_Setup(
            offset += counts;
 	}
 
+	/* Owned indices placed by the caller (L7_Setup_Placed). */
+
+	if (owned_offsets){
+	   for (i=0; i<offset; i++){
+	      l7_id_db->indices_local_to_send[i] =
+	         owned_offsets[l7_id_db->indices_local_to_send[i] - base_adj];
+	   }
+	}
+
 #if defined _L7_DEBUG
 
-	ierr = MPI_Barrier(MPI_COMM_WORLD);
+	ierr = MPI_Barrier(comm);
 
 	for (i=0; i<numpes; i++){
 	   if (penum == i){
 	      for (j=0; j<l7_id_db->num_sends; j++){
 	         printf("[pe %d] send %d indices to pe %d \n", penum,
 	               l7_id_db->send_counts[j], l7_id_db->send_to[j] );
-	         ierr = MPI_Barrier(MPI_COMM_WORLD);
+	         ierr = MPI_Barrier(comm);
 	      }
 	   }
 	}
 	fflush(stdout);
-	ierr = MPI_Barrier(MPI_COMM_WORLD);
+	ierr = MPI_Barrier(comm);
 	L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Barrier failure", ierr);
 
 	for (i=0; i<numpes; i++){
@@ -871,40 +932,16 @@ int L7_Setup(
 #endif /* _L7_DEBUG */
 
         /* Now that we have all of the information on our communiation partners
-         * and which indicies needto be communicated where, setup a neighbor collective
-         * to do all the acutal work. Start using the graph information to create a
-         * communicator with a distributed graph topology for neighbor communication */
-        num_sends = l7_id_db->num_sends;
-        num_recvs = l7_id_db->num_recvs;
-
-        ierr = MPI_Dist_graph_create_adjacent(MPI_COMM_WORLD,
-			num_recvs, l7_id_db->recv_from, MPI_UNWEIGHTED,
-			num_sends, l7_id_db->send_to, MPI_UNWEIGHTED,
-			MPI_INFO_NULL, 0, &l7_id_db->nbr_state.comm);
-
-        if (ierr != MPI_SUCCESS) {
-	  ierr = -1;
-          L7_ASSERT(ierr == MPI_SUCCESS, "Failed to create graph communicator.", ierr)
-        }
+         * and which indicies needto be communicated where, build the graph
+         * communicator and neighbor datatypes that do all the actual work. */
+        ierr = l7p_database_comm_create(l7_id_db);
+        L7_ASSERT(ierr == L7_OK, "Failed to create neighbor communication state.", ierr);
 
-        /* The sender/receiver order used by MPI neighbor collectives is the same as
-         * the order in the send_to/recv_from list used to create the graph; MPI guarantees
-         * that this is the case if the graph was created with graph_create_adjacent.
-         *
-         * We cannot know the offset in bytes here, which is what the neighbor
-         * collectives want, as it depends on the type we're sending/receiving
-         * and we don't know that at setup. As a result we use an offset of 0
-         * and count of 1 and let the derived datatypes take care of where in
-         * the array the data goes to and comes from. */
+        /* Drop setup-only state when the job asked for it (L7_COMPACT). */
+        l7p_database_compact(l7_id_db, l7.compact_level);
 
-        /* Create update_datatypes for all the L7 datatype sizes */
-        ierr = l7p_nbr_state_create(&l7_id_db->nbr_state, num_recvs, num_sends);
-        L7_ASSERT(ierr == L7_OK, "Could not create neighbor state", ierr);
-
-        L7P_Update_Type_Create(l7_id_db, L7_CHAR, &l7_id_db->nbr_state.update_datatypes[1]);
-        L7P_Update_Type_Create(l7_id_db, L7_SHORT, &l7_id_db->nbr_state.update_datatypes[2]);
-        L7P_Update_Type_Create(l7_id_db, L7_INT, &l7_id_db->nbr_state.update_datatypes[4]);
-        L7P_Update_Type_Create(l7_id_db, L7_DOUBLE, &l7_id_db->nbr_state.update_datatypes[8]);
+        l7_id_db->stats.num_setups++;
+        l7_id_db->stats.setup_time += MPI_Wtime() - setup_time_start;
 
 	/*
 	 * Database is setup for this l7_id -- return.
@@ -916,8 +953,122 @@ int L7_Setup(
 
    return(ierr);
 
+} /* End l7p_setup */
+
+int L7_Setup(
+		const int      num_base,
+		const int      my_start_index,
+		const int      num_indices_owned,
+		int            *indices_needed,
+		const int      num_indices_needed,
+		int            *l7_id
+		)
+{
+	/* Purpose
+	 * =======
+	 * L7_Setup sets up an update database with the owned indices
+	 * at local offsets 0 .. num_indices_owned-1 and the needed
+	 * indices received after them, in 'indices_needed' order.
+	 * See l7p_setup for the arguments.
+	 */
+
+	return(l7p_setup(num_base, my_start_index, num_indices_owned,
+			 indices_needed, num_indices_needed, NULL, NULL,
+			 MPI_COMM_WORLD, l7_id));
+
 } /* End L7_Setup */
 
+int L7_Setup_Placed(
+		const int      num_base,
+		const int      my_start_index,
+		const int      num_indices_owned,
+		int            *indices_needed,
+		const int      num_indices_needed,
+		const int      *owned_offsets,
+		const int      *ghost_offsets,
+		int            *l7_id
+		)
+{
+	/* Purpose
+	 * =======
+	 * L7_Setup_Placed is L7_Setup for applications that keep ghost
+	 * data interleaved with owned data. L7_Update then writes each
+	 * needed index straight to data_buffer[ghost_offsets[i]] and
+	 * reads owned index my_start_index+i from
+	 * data_buffer[owned_offsets[i]], so no scatter pass is needed
+	 * after the update.
+	 *
+	 * Arguments
+	 * =========
+	 * As L7_Setup, plus
+	 *
+	 * owned_offsets        (input) const int*
+	 *                      0-based local offset of each owned index,
+	 *                      length num_indices_owned; NULL keeps the
+	 *                      owned indices at 0 .. num_indices_owned-1.
+	 *
+	 * ghost_offsets        (input) const int*
+	 *                      0-based local offset of each needed index,
+	 *                      length num_indices_needed, in the order of
+	 *                      'indices_needed'; NULL receives them after
+	 *                      the owned indices as L7_Setup does.
+	 *
+	 * Notes:
+	 * =====
+	 * 1) Offsets must not overlap each other; the receive datatypes
+	 * coalesce consecutive offsets into blocks, so runs of ghosts that
+	 * are adjacent in memory cost no more than the default layout.
+	 *
+	 * 2) L7_Dev_Update does not support placed databases.
+	 */
+
+	return(l7p_setup(num_base, my_start_index, num_indices_owned,
+			 indices_needed, num_indices_needed, owned_offsets,
+			 ghost_offsets, MPI_COMM_WORLD, l7_id));
+
+} /* End L7_Setup_Placed */
+
+int L7_Setup_Comm(
+		const int      num_base,
+		const int      my_start_index,
+		const int      num_indices_owned,
+		int            *indices_needed,
+		const int      num_indices_needed,
+		MPI_Comm       comm,
+		int            *l7_id
+		)
+{
+	/* Purpose
+	 * =======
+	 * L7_Setup_Comm is L7_Setup over the processes of 'comm' rather
+	 * than MPI_COMM_WORLD. The global indexing set is decomposed
+	 * across the members of 'comm' only, so independent groups of
+	 * processes (e.g. the halves of an MPI_Comm_split) can each set
+	 * up and update their own databases.
+	 *
+	 * Arguments
+	 * =========
+	 * As L7_Setup, plus
+	 *
+	 * comm                 (input) MPI_Comm
+	 *                      Communicator to set up over. It must stay
+	 *                      valid until the database is freed.
+	 *
+	 * Notes:
+	 * =====
+	 * 1) Collective over 'comm'; L7_Update and L7_Free on the
+	 * database only involve its members.
+	 *
+	 * 2) The *_Comm reductions and L7_Broadcast_Comm take the same
+	 * communicator for collectives within the group.
+	 */
+
+	return(l7p_setup(num_base, my_start_index, num_indices_owned,
+			 indices_needed, num_indices_needed, NULL, NULL,
+			 comm, l7_id));
+
+} /* End L7_Setup_Comm */
+
 void L7_SETUP(
         const int       *my_start_index,
         const int       *num_indices_owned,
@@ -928,3 +1079,30 @@ void L7_SETUP(
 {
    L7_Setup(0, *my_start_index, *num_indices_owned, indices_needed, *num_indices_needed, l7_id);
 }
+
+void L7_SETUP_PLACED(
+        const int       *my_start_index,
+        const int       *num_indices_owned,
+        int             *indices_needed,
+        const int       *num_indices_needed,
+        const int       *owned_offsets,
+        const int       *ghost_offsets,
+        int             *l7_id
+        )
+{
+   L7_Setup_Placed(0, *my_start_index, *num_indices_owned, indices_needed,
+         *num_indices_needed, owned_offsets, ghost_offsets, l7_id);
+}
+
+void L7_SETUP_COMM(
+        const int       *my_start_index,
+        const int       *num_indices_owned,
+        int             *indices_needed,
+        const int       *num_indices_needed,
+        MPI_Fint        *comm,
+        int             *l7_id
+        )
+{
+   L7_Setup_Comm(0, *my_start_index, *num_indices_owned, indices_needed,
+         *num_indices_needed, MPI_Comm_f2c(*comm), l7_id);
+}
@@ -0,0 +1,378 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_SETUP_KNOWN"
+
+#ifdef HAVE_MPI
+
+static int *copy_ints(
+      l7p_allocator   *allocator,
+      const int       *src,
+      const int       count
+      )
+{
+   /*
+    * Copy of src[0:count-1] from the database allocator; NULL on failure.
+    */
+
+   int
+     *dst;
+
+   dst = (int *)l7p_alloc(allocator, ((size_t)count+1)*sizeof(int));
+   if (dst != NULL && count > 0)
+      memcpy(dst, src, (size_t)count*sizeof(int));
+   return(dst);
+}
+
+#endif /* HAVE_MPI */
+
+int L7_Setup_Known(
+      const int               num_base,
+      const int               my_start_index,
+      const int               num_indices_owned,
+      const int               num_recvs,
+      const int               *recv_from,
+      const int               *recv_counts,
+      const int               num_sends,
+      const int               *send_to,
+      const int               *send_counts,
+      const int               *indices_local_to_send,
+      MPI_Comm                comm,
+      int                     *l7_id
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Setup_Known sets up an update database from communication lists
+    * the caller already has, skipping the exchange of counts and indices
+    * that L7_Setup performs. Only the graph communicator and the update
+    * datatypes are built, so the sole communication is the graph
+    * creation.
+    *
+    * Arguments
+    * =========
+    * num_base             (input) const int
+    *                      0 for C, 1 for Fortran local indexing.
+    *
+    * my_start_index       (input) const int
+    *                      Global index of the first owned index.
+    *
+    * num_indices_owned    (input) const int
+    *                      Number of owned indices.
+    *
+    * num_recvs            (input) const int
+    *                      Number of processes this process receives from.
+    *
+    * recv_from            (input) const int*
+    *                      Their ranks in comm.
+    *
+    * recv_counts          (input) const int*
+    *                      Number of indices received from each. The
+    *                      ghosts are received after the owned data in
+    *                      recv_from order, as L7_Setup lays them out.
+    *
+    * num_sends            (input) const int
+    *                      Number of processes this process sends to.
+    *
+    * send_to              (input) const int*
+    *                      Their ranks in comm.
+    *
+    * send_counts          (input) const int*
+    *                      Number of indices sent to each.
+    *
+    * indices_local_to_send (input) const int*
+    *                      Local indices (num_base based) sent to each
+    *                      send_to process, concatenated in send_to order,
+    *                      each group in the order the receiver stores
+    *                      them.
+    *
+    * comm                 (input) MPI_Comm
+    *                      Communicator of the ranks above.
+    *
+    * l7_id                (input/output) int*
+    *                      0 for a new database, > 0 to reset an existing
+    *                      one, as for L7_Setup.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over comm (MPI_Dist_graph_create_adjacent).
+    * 2) The lists must agree between processes: what p sends to q is
+    *    what q receives from p, in the same order. That cannot be
+    *    checked without the exchange this routine avoids; L7_Update_Check
+    *    catches disagreements.
+    * 3) Serial compilation creates a no-op.
+    *
+    */
+
+   int
+     ierr;
+
+#ifdef HAVE_MPI
+
+   l7_id_database
+     *l7_id_db;
+   int
+     i,
+     numpes,
+     penum,
+     total_sends,
+     total_recvs;
+   double
+     setup_time_start;
+
+   setup_time_start = MPI_Wtime();
+
+   if (! l7.mpi_initialized){
+      return(0);
+   }
+
+   if (l7.initialized != 1){
+      ierr = 1;
+      L7_ASSERT(l7.initialized == 1, "L7 not initialized", ierr);
+   }
+
+   /*
+    * Check input; local only.
+    */
+
+   ierr = MPI_Comm_size(comm, &numpes);
+   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Comm_size", ierr);
+   ierr = MPI_Comm_rank(comm, &penum);
+   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Comm_rank", ierr);
+
+   if (my_start_index < 0 || num_indices_owned < 0 || num_recvs < 0 || num_sends < 0 ||
+       (num_recvs > 0 && (recv_from == NULL || recv_counts == NULL)) ||
+       (num_sends > 0 && (send_to == NULL || send_counts == NULL)) ||
+       *l7_id < 0){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Invalid arguments", ierr);
+   }
+
+   total_recvs = 0;
+   for (i=0; i<num_recvs; i++){
+      if (recv_from[i] < 0 || recv_from[i] >= numpes || recv_from[i] == penum ||
+          recv_counts[i] <= 0){
+         ierr = -1;
+         L7_ASSERT(ierr == 0, "Invalid recv_from or recv_counts", ierr);
+      }
+      total_recvs += recv_counts[i];
+   }
+
+   total_sends = 0;
+   for (i=0; i<num_sends; i++){
+      if (send_to[i] < 0 || send_to[i] >= numpes || send_to[i] == penum ||
+          send_counts[i] <= 0){
+         ierr = -1;
+         L7_ASSERT(ierr == 0, "Invalid send_to or send_counts", ierr);
+      }
+      total_sends += send_counts[i];
+   }
+
+   if (total_sends > 0 && indices_local_to_send == NULL){
+      ierr = -1;
+      L7_ASSERT(indices_local_to_send != NULL, "indices_local_to_send == NULL", ierr);
+   }
+   for (i=0; i<total_sends; i++){
+      if (indices_local_to_send[i] - num_base < 0 ||
+          indices_local_to_send[i] - num_base >= num_indices_owned){
+         ierr = -1;
+         L7_ASSERT(ierr == 0, "indices_local_to_send outside owned indices", ierr);
+      }
+   }
+
+   /*
+    * Setup database structure.
+    */
+
+   if (*l7_id != 0){
+      l7_id_db = l7p_set_database(*l7_id);
+      if (l7_id_db == NULL){
+         ierr = -1;
+         L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
+      }
+
+      /* Setup state of a previous L7_Setup does not describe this one. */
+      l7p_database_comm_free(l7_id_db);
+      l7p_database_arrays_reset(l7_id_db);
+      l7p_gid_map_free(l7_id_db);
+   }
+   else {
+      l7_id_db = l7p_database_new();
+      if (l7_id_db == NULL){
+         ierr = -1;
+         L7_ASSERT(l7_id_db != NULL, "Failed to allocate new database", ierr);
+      }
+      *l7_id = l7_id_db->l7_id;
+   }
+
+   l7_id_db->comm               = comm;
+   l7_id_db->numpes             = numpes;
+   l7_id_db->penum              = penum;
+   l7_id_db->my_start_index     = my_start_index;
+   l7_id_db->num_indices_owned  = num_indices_owned;
+   l7_id_db->num_indices_needed = total_recvs;
+   l7_id_db->num_recvs          = num_recvs;
+   l7_id_db->num_sends          = num_sends;
+   l7_id_db->owned_placed       = 0;
+   l7_id_db->this_tag_update    = L7_UPDATE_TAGS_MIN;
+
+   /* Ghost global ids are not known here, so only owned ids are mapped. */
+   if (l7.gid_map){
+      ierr = l7p_gid_map_build(l7_id_db, NULL, NULL);
+      L7_ASSERT(ierr == L7_OK, "Failed to build global id map", ierr);
+   }
+
+   l7_id_db->recv_from   = copy_ints(&l7_id_db->allocator, recv_from,   num_recvs);
+   l7_id_db->recv_counts = copy_ints(&l7_id_db->allocator, recv_counts, num_recvs);
+   l7_id_db->send_to     = copy_ints(&l7_id_db->allocator, send_to,     num_sends);
+   l7_id_db->send_counts = copy_ints(&l7_id_db->allocator, send_counts, num_sends);
+   l7_id_db->indices_local_to_send =
+      copy_ints(&l7_id_db->allocator, indices_local_to_send, total_sends);
+
+   if (l7_id_db->recv_from == NULL || l7_id_db->recv_counts == NULL ||
+       l7_id_db->send_to == NULL || l7_id_db->send_counts == NULL ||
+       l7_id_db->indices_local_to_send == NULL){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "No memory for communication lists", ierr);
+   }
+
+   for (i=0; i<total_sends; i++)
+      l7_id_db->indices_local_to_send[i] -= num_base;
+
+   l7_id_db->recv_from_len       = num_recvs;
+   l7_id_db->recv_counts_len     = num_recvs;
+   l7_id_db->send_to_len         = num_sends;
+   l7_id_db->send_counts_len     = num_sends;
+   l7_id_db->indices_to_send_len = total_sends;
+
+   if (numpes > 1){
+      ierr = l7p_database_comm_create(l7_id_db);
+      L7_ASSERT(ierr == L7_OK, "Failed to create neighbor communication state.", ierr);
+   }
+
+   l7p_database_compact(l7_id_db, l7.compact_level);
+
+   l7_id_db->stats.num_setups++;
+   l7_id_db->stats.setup_time += MPI_Wtime() - setup_time_start;
+
+#endif /* HAVE_MPI */
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Setup_Known */
+
+int L7_Setup_Symmetric(
+      const int               num_base,
+      const int               my_start_index,
+      const int               num_indices_owned,
+      const int               num_neighbors,
+      const int               *neighbors,
+      const int               *counts,
+      const int               *indices_local_to_send,
+      MPI_Comm                comm,
+      int                     *l7_id
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Setup_Symmetric is L7_Setup_Known for symmetric patterns, where
+    * a process receives from exactly the processes it sends to and the
+    * same number of indices each way. counts[k] indices of
+    * indices_local_to_send go to neighbors[k], and as many ghosts come
+    * back from it.
+    */
+
+   return(L7_Setup_Known(num_base, my_start_index, num_indices_owned,
+         num_neighbors, neighbors, counts,
+         num_neighbors, neighbors, counts,
+         indices_local_to_send, comm, l7_id));
+
+} /* End L7_Setup_Symmetric */
+
+void L7_SETUP_KNOWN(
+      const int   *num_base,
+      const int   *my_start_index,
+      const int   *num_indices_owned,
+      const int   *num_recvs,
+      const int   *recv_from,
+      const int   *recv_counts,
+      const int   *num_sends,
+      const int   *send_to,
+      const int   *send_counts,
+      const int   *indices_local_to_send,
+      MPI_Fint    *comm,
+      int         *l7_id,
+      int         *ierr
+      )
+{
+   *ierr = L7_Setup_Known(*num_base, *my_start_index, *num_indices_owned,
+         *num_recvs, recv_from, recv_counts, *num_sends, send_to, send_counts,
+         indices_local_to_send, MPI_Comm_f2c(*comm), l7_id);
+}
+
+void L7_SETUP_SYMMETRIC(
+      const int   *num_base,
+      const int   *my_start_index,
+      const int   *num_indices_owned,
+      const int   *num_neighbors,
+      const int   *neighbors,
+      const int   *counts,
+      const int   *indices_local_to_send,
+      MPI_Fint    *comm,
+      int         *l7_id,
+      int         *ierr
+      )
+{
+   *ierr = L7_Setup_Symmetric(*num_base, *my_start_index, *num_indices_owned,
+         *num_neighbors, neighbors, counts, indices_local_to_send,
+         MPI_Comm_f2c(*comm), l7_id);
+}
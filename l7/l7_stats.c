@@ -0,0 +1,491 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_STATS"
+
+#ifdef HAVE_MPI
+static void l7p_stats_export(
+      struct L7_Stats   *stats_out,
+      const struct L7_Stats *stats,
+      const int         *send_to,
+      const int         *recv_from,
+      const long long   *nbr_bytes_sent,
+      const long long   *nbr_bytes_recvd
+      );
+#endif
+
+int L7_Get_Stats(
+      const int               l7_id,
+      struct L7_Stats         *stats
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Get_Stats returns the communication statistics gathered for
+    * the update database associated with l7_id: setup count and time,
+    * update count, bytes and messages sent and received (in total and
+    * per neighbor), cumulative and maximum update time and a log2
+    * histogram of update latencies.
+    *
+    * Arguments
+    * =========
+    * l7_id              (input) const int
+    *                    Handle to database.
+    *
+    * stats              (output) struct L7_Stats*
+    *                    Statistics for this database on this process.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Purely local, no communication.
+    * 2) Serial compilation returns zeroed statistics.
+    *
+    */
+
+   int
+     ierr;                 /* Error code for return              */
+
+   if (stats == NULL){
+      ierr = -1;
+      L7_ASSERT( stats != NULL, "stats != NULL", ierr);
+   }
+
+   memset(stats, 0, sizeof(struct L7_Stats));
+
+#if defined HAVE_MPI
+
+   l7_id_database
+     *l7_id_db;            /* database associated with l7_id.    */
+
+   if (! l7.mpi_initialized){
+      return(L7_OK);
+   }
+
+   if (l7_id <= 0){
+      ierr = -1;
+      L7_ASSERT( l7_id > 0, "l7_id <= 0", ierr);
+   }
+
+   l7_id_db = l7p_set_database(l7_id);
+   if (l7_id_db == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
+   }
+
+   l7p_stats_export(stats, &l7_id_db->stats,
+         l7_id_db->send_to, l7_id_db->recv_from,
+         l7_id_db->nbr_bytes_sent, l7_id_db->nbr_bytes_recvd);
+
+#endif /* HAVE_MPI */
+
+   return(L7_OK);
+
+} /* End L7_Get_Stats */
+
+int L7_Push_Get_Stats(
+      const int               l7_push_id,
+      struct L7_Stats         *stats
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Push_Get_Stats is the L7_Get_Stats equivalent for push
+    * databases. Both send_to and recv_from are the comm_partner list
+    * given to L7_Push_Setup.
+    *
+    * Arguments
+    * =========
+    * l7_push_id         (input) const int
+    *                    Handle to push database.
+    *
+    * stats              (output) struct L7_Stats*
+    *                    Statistics for this database on this process.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    */
+
+   int
+     ierr;                 /* Error code for return              */
+
+   if (stats == NULL){
+      ierr = -1;
+      L7_ASSERT( stats != NULL, "stats != NULL", ierr);
+   }
+
+   memset(stats, 0, sizeof(struct L7_Stats));
+
+#if defined HAVE_MPI
+
+   l7_push_id_database
+     *l7_push_id_db;
+
+   if (! l7.mpi_initialized){
+      return(L7_OK);
+   }
+
+   l7_push_id_db = l7.first_push_db;
+   while (l7_push_id_db){
+      if (l7_push_id_db->l7_push_id == l7_push_id)
+         break;
+      l7_push_id_db = l7_push_id_db->next_push_db;
+   }
+
+   if (l7_push_id_db == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_push_id_db != NULL, "Failed to find database.", ierr);
+   }
+
+   l7p_stats_export(stats, &l7_push_id_db->stats,
+         l7_push_id_db->comm_partner, l7_push_id_db->comm_partner,
+         l7_push_id_db->nbr_bytes_sent, l7_push_id_db->nbr_bytes_recvd);
+
+#endif /* HAVE_MPI */
+
+   return(L7_OK);
+
+} /* End L7_Push_Get_Stats */
+
+int L7_Stats_Report(void)
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Stats_Report prints, on rank 0, the minimum, average and
+    * maximum over all processes of the statistics accumulated by every
+    * update and push database, including databases already freed, and
+    * the summed update latency histogram.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over MPI_COMM_WORLD.
+    * 2) L7_Terminate calls this when the environment variable
+    *    L7_STATS_REPORT is set.
+    *
+    */
+
+#if defined HAVE_MPI
+
+   enum { STAT_SETUPS, STAT_SETUP_TIME, STAT_UPDATES, STAT_PUSHES,
+          STAT_UPDATE_TIME, STAT_UPDATE_TIME_MAX, STAT_BYTES_SENT,
+          STAT_BYTES_RECVD, STAT_MSGS_SENT, STAT_MSGS_RECVD, STAT_CHECKS,
+          STAT_CHECK_ERRORS, STAT_DB_MEMORY, NUM_STATS };
+
+   static const char *stat_names[NUM_STATS] = {
+      "setups", "setup time (s)", "updates", "pushes",
+      "update time (s)", "max update time (s)", "bytes sent",
+      "bytes received", "messages sent", "messages received",
+      "update checks", "update check errors", "database memory (B)" };
+
+   int
+     i,
+     ierr,
+     numpes,
+     penum;
+
+   double
+     local[NUM_STATS],
+     global_min[NUM_STATS],
+     global_max[NUM_STATS],
+     global_sum[NUM_STATS];
+
+   long long
+     global_hist[L7_STATS_NUM_BUCKETS];
+
+   struct L7_Stats
+     total;
+
+   l7_id_database
+     *l7_id_db;
+
+   l7_push_id_database
+     *l7_push_id_db;
+
+   if (! l7.mpi_initialized){
+      return(L7_OK);
+   }
+
+   /*
+    * Totals over live databases plus those already freed.
+    */
+
+   total = l7.stats_freed;
+
+   for (l7_id_db = l7.first_db; l7_id_db; l7_id_db = l7_id_db->next_db)
+      l7p_stats_accumulate(&total, &l7_id_db->stats);
+
+   for (l7_push_id_db = l7.first_push_db; l7_push_id_db;
+        l7_push_id_db = l7_push_id_db->next_push_db)
+      l7p_stats_accumulate(&total, &l7_push_id_db->stats);
+
+   local[STAT_SETUPS]          = (double)total.num_setups;
+   local[STAT_SETUP_TIME]      = total.setup_time;
+   local[STAT_UPDATES]         = (double)total.num_updates;
+   local[STAT_PUSHES]          = (double)total.num_pushes;
+   local[STAT_UPDATE_TIME]     = total.update_time;
+   local[STAT_UPDATE_TIME_MAX] = total.update_time_max;
+   local[STAT_BYTES_SENT]      = (double)total.bytes_sent;
+   local[STAT_BYTES_RECVD]     = (double)total.bytes_recvd;
+   local[STAT_MSGS_SENT]       = (double)total.msgs_sent;
+   local[STAT_MSGS_RECVD]      = (double)total.msgs_recvd;
+   local[STAT_CHECKS]          = (double)total.num_checks;
+   local[STAT_CHECK_ERRORS]    = (double)total.num_check_errors;
+   local[STAT_DB_MEMORY]       = (double)total.memory_bytes;
+
+   ierr = MPI_Comm_rank(MPI_COMM_WORLD, &penum);
+   L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_rank", ierr);
+   ierr = MPI_Comm_size(MPI_COMM_WORLD, &numpes);
+   L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Comm_size", ierr);
+
+   ierr = MPI_Reduce(local, global_min, NUM_STATS, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+   L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Reduce (min)", ierr);
+   ierr = MPI_Reduce(local, global_max, NUM_STATS, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+   L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Reduce (max)", ierr);
+   ierr = MPI_Reduce(local, global_sum, NUM_STATS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+   L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Reduce (sum)", ierr);
+   ierr = MPI_Reduce(total.latency_hist, global_hist, L7_STATS_NUM_BUCKETS,
+         MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+   L7_ASSERT( ierr == MPI_SUCCESS, "MPI_Reduce (latency_hist)", ierr);
+
+   if (penum == 0){
+      printf("\n");
+      printf("======================================\n");
+      printf("    L7 communication statistics       \n");
+      printf("======================================\n");
+      printf("%-22s %14s %14s %14s\n", "", "min", "avg", "max");
+      for (i=0; i<NUM_STATS; i++){
+         printf("%-22s %14.6g %14.6g %14.6g\n", stat_names[i],
+               global_min[i], global_sum[i]/(double)numpes, global_max[i]);
+      }
+      printf("\n");
+      printf("Update latency histogram (all pes)\n");
+      for (i=0; i<L7_STATS_NUM_BUCKETS; i++){
+         if (global_hist[i] == 0) continue;
+         if (i == 0)
+            printf("  %10s < %9d us  %lld\n", "", 1, global_hist[i]);
+         else if (i == L7_STATS_NUM_BUCKETS-1)
+            printf("  %10d <=%9s us  %lld\n", 1 << (i-1), "", global_hist[i]);
+         else
+            printf("  %10d -  %9d us  %lld\n", 1 << (i-1), 1 << i, global_hist[i]);
+      }
+      printf("======================================\n");
+      printf("\n");
+      fflush(stdout);
+   }
+
+#endif /* HAVE_MPI */
+
+   return(L7_OK);
+
+} /* End L7_Stats_Report */
+
+#ifdef HAVE_MPI
+
+int l7p_stats_nbr_create(
+      struct L7_Stats   *stats,
+      long long         **nbr_bytes_sent,
+      long long         **nbr_bytes_recvd,
+      const int         num_sends,
+      const int         num_recvs
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Allocate zeroed per-neighbor counters for a (re)setup database and
+    * count the setup. Counters from a previous pattern are discarded.
+    */
+
+   l7p_stats_nbr_free(stats, nbr_bytes_sent, nbr_bytes_recvd);
+
+   if (num_sends > 0){
+      *nbr_bytes_sent = (long long *)calloc((size_t)num_sends, sizeof(long long));
+      L7_ASSERT(*nbr_bytes_sent != NULL,
+            "Could not allocate space for nbr_bytes_sent.", -1);
+   }
+
+   if (num_recvs > 0){
+      *nbr_bytes_recvd = (long long *)calloc((size_t)num_recvs, sizeof(long long));
+      L7_ASSERT(*nbr_bytes_recvd != NULL,
+            "Could not allocate space for nbr_bytes_recvd.", -1);
+   }
+
+   stats->num_sends = num_sends;
+   stats->num_recvs = num_recvs;
+
+   return(L7_OK);
+}
+
+void l7p_stats_nbr_free(
+      struct L7_Stats   *stats,
+      long long         **nbr_bytes_sent,
+      long long         **nbr_bytes_recvd
+      )
+{
+   if (*nbr_bytes_sent){
+      free(*nbr_bytes_sent);
+      *nbr_bytes_sent = NULL;
+   }
+   if (*nbr_bytes_recvd){
+      free(*nbr_bytes_recvd);
+      *nbr_bytes_recvd = NULL;
+   }
+   stats->num_sends = 0;
+   stats->num_recvs = 0;
+}
+
+void l7p_stats_record(
+      struct L7_Stats   *stats,
+      long long         *nbr_bytes_sent,
+      long long         *nbr_bytes_recvd,
+      const int         *send_counts,
+      const int         *recv_counts,
+      const int         sizeof_type,
+      const double      elapsed
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Record one completed exchange of sizeof_type elements: bytes and
+    * messages per neighbor, time and latency bucket. The caller counts
+    * the call itself (num_updates or num_pushes).
+    */
+
+   int
+     i,
+     bucket;
+
+   long long
+     bytes,
+     usecs;
+
+   for (i=0; i<stats->num_sends; i++){
+      bytes = (long long)send_counts[i] * sizeof_type;
+      if (nbr_bytes_sent) nbr_bytes_sent[i] += bytes;
+      stats->bytes_sent += bytes;
+   }
+   for (i=0; i<stats->num_recvs; i++){
+      bytes = (long long)recv_counts[i] * sizeof_type;
+      if (nbr_bytes_recvd) nbr_bytes_recvd[i] += bytes;
+      stats->bytes_recvd += bytes;
+   }
+   stats->msgs_sent  += stats->num_sends;
+   stats->msgs_recvd += stats->num_recvs;
+
+   stats->update_time += elapsed;
+   if (elapsed > stats->update_time_max)
+      stats->update_time_max = elapsed;
+
+   /* Bucket is the bit length of the latency in whole microseconds. */
+   usecs = (long long)(elapsed * 1.0e6);
+   for (bucket = 0; usecs > 0 && bucket < L7_STATS_NUM_BUCKETS-1; bucket++)
+      usecs >>= 1;
+   stats->latency_hist[bucket]++;
+}
+
+void l7p_stats_accumulate(
+      struct L7_Stats         *total,
+      const struct L7_Stats   *stats
+      )
+{
+   int
+     i;
+
+   total->num_setups  += stats->num_setups;
+   total->num_updates += stats->num_updates;
+   total->num_pushes  += stats->num_pushes;
+   total->bytes_sent  += stats->bytes_sent;
+   total->bytes_recvd += stats->bytes_recvd;
+   total->msgs_sent   += stats->msgs_sent;
+   total->msgs_recvd  += stats->msgs_recvd;
+   total->num_checks  += stats->num_checks;
+   total->num_check_errors += stats->num_check_errors;
+   total->memory_bytes += stats->memory_bytes;
+   total->setup_time  += stats->setup_time;
+   total->update_time += stats->update_time;
+   if (stats->update_time_max > total->update_time_max)
+      total->update_time_max = stats->update_time_max;
+   for (i=0; i<L7_STATS_NUM_BUCKETS; i++)
+      total->latency_hist[i] += stats->latency_hist[i];
+}
+
+static void l7p_stats_export(
+      struct L7_Stats   *stats_out,
+      const struct L7_Stats *stats,
+      const int         *send_to,
+      const int         *recv_from,
+      const long long   *nbr_bytes_sent,
+      const long long   *nbr_bytes_recvd
+      )
+{
+   *stats_out = *stats;
+   stats_out->send_to         = send_to;
+   stats_out->recv_from       = recv_from;
+   stats_out->nbr_bytes_sent  = nbr_bytes_sent;
+   stats_out->nbr_bytes_recvd = nbr_bytes_recvd;
+}
+
+#endif /* HAVE_MPI */
+
+void L7_STATS_REPORT(
+      int *ierr
+      )
+{
+   *ierr = L7_Stats_Report();
+}
@@ -51,7 +51,9 @@ int L7_Terminate (void)
 	 * =======
 	 * L7_Terminate deallocates its workspace, then, if L7 initialized
 	 * MPI on behalf of the application program, terminates the MPI
-	 * environment.
+	 * environment. If the environment variable L7_STATS_REPORT is set,
+	 * the communication statistics summary (L7_Stats_Report) is
+	 * printed first.
 	 *
 	 * Arguments
 	 * =========
@@ -96,6 +98,30 @@ int L7_Terminate (void)
 		L7_ASSERT( l7.initialized == 1, "L7 not initialized", ierr );
 	}
 
+	/*
+	 * Optional end-of-run statistics report; must precede MPI_Finalize.
+	 */
+
+	if ( getenv("L7_STATS_REPORT") != NULL ){
+		ierr = L7_Stats_Report();
+		L7_ASSERT( ierr == L7_OK, "L7_Stats_Report", ierr );
+	}
+
+	/*
+	 * The progress thread calls into MPI, cached batch graphs hold
+	 * communicators, and open files and the I/O profile report need
+	 * collective calls.
+	 */
+
+	l7p_progress_stop();
+	l7p_file_shutdown();
+	l7p_io_prof_shutdown();
+	l7p_batch_free_all();
+	l7p_reduce_multi_free();
+	l7p_repro_sum_free();
+	l7p_loc_free();
+	l7p_hier_coll_free();
+
 	if ( l7.initialized_mpi == 1 ){
 		ierr = MPI_Finalized ( &flag );
 		if ( !flag ){
@@ -106,7 +132,8 @@ int L7_Terminate (void)
 	}
 
 	if ( l7.send_buffer != NULL ){
-		free ( l7.send_buffer);
+		L7_Mem_Release ( l7.send_buffer);
+		l7.send_buffer = NULL;
 		l7.sizeof_send_buffer = 0;
 	}
 
@@ -87,6 +87,9 @@ int L7_Update(
     * Notes:
     * =====
     * 1) Serial compilation creates a no-op
+    * 2) With the environment variable L7_UPDATE_CHECK=n set, every n-th
+    *    update of a database is followed by L7_Update_Check and its
+    *    result is returned.
     *
     */
 #if defined HAVE_MPI
@@ -102,6 +105,8 @@ int L7_Update(
      sizeof_type;	   /* sizeof the L7 datatype */
    struct l7_update_datatype
      *update_datatype;     /* Info on the datatypes to scatter/gather */
+   double
+     time_start;           /* MPI_Wtime before the exchange, for stats */
 
    /*
     * Executable Statements
@@ -148,8 +153,6 @@ int L7_Update(
       L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
    }
 
-   l7.penum = l7_id_db->penum;
-
    if (l7_id_db->numpes == 1){ /* No-op */
       ierr = L7_OK;
       return(ierr);
@@ -175,9 +178,17 @@ int L7_Update(
 
 #endif /* _L7_DEBUG */
 
-   /* Now that everything is all set up, neighbor_alltoallw does all of
-    * the work (and data movement optimization) */
-   ierr = MPI_Neighbor_alltoallw((void *)data_buffer,
+   time_start = MPI_Wtime();
+
+   if (l7_id_db->update_method == L7_UPDATE_P2P){
+      /* Scheduled point-to-point exchange (L7_Set_Update_Schedule). */
+      ierr = l7p_update_p2p(l7_id_db, data_buffer, sizeof_type, update_datatype);
+      L7_ASSERT(ierr == L7_OK, "l7p_update_p2p", ierr);
+   }
+   else {
+      /* Now that everything is all set up, neighbor_alltoallw does all of
+       * the work (and data movement optimization) */
+      ierr = MPI_Neighbor_alltoallw((void *)data_buffer,
 			  l7_id_db->nbr_state.mpi_send_counts,
 			  (MPI_Aint *)l7_id_db->nbr_state.mpi_send_offsets,
 			  update_datatype->out_types,
@@ -186,6 +197,28 @@ int L7_Update(
 			  (MPI_Aint *)l7_id_db->nbr_state.mpi_recv_offsets,
 			  update_datatype->in_types,
 			  l7_id_db->nbr_state.comm);
+      L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Neighbor_alltoallw", ierr);
+   }
+
+   /* Repeated needed indices (l7p_needed_normalize). */
+   if (l7_id_db->num_ghost_dups > 0)
+      l7p_ghost_dups_fill(l7_id_db, data_buffer, sizeof_type);
+
+   l7_id_db->stats.num_updates++;
+   l7p_stats_record(&l7_id_db->stats, l7_id_db->nbr_bytes_sent,
+         l7_id_db->nbr_bytes_recvd, l7_id_db->send_counts,
+         l7_id_db->recv_counts, sizeof_type, MPI_Wtime() - time_start);
+
+   /*
+    * Sampled ghost verification (environment L7_UPDATE_CHECK).
+    */
+
+   if (l7.update_check_interval > 0 &&
+       l7_id_db->stats.num_updates % l7.update_check_interval == 0){
+      ierr = L7_Update_Check(data_buffer, l7_datatype, l7_id);
+      if (ierr != L7_OK)
+         return(ierr);
+   }
 
 #endif /* HAVE_MPI */
 
@@ -193,6 +226,133 @@ int L7_Update(
 
 } /* End L7_Update */
 
+int L7_Iupdate(
+      void                   *data_buffer,
+      const enum L7_Datatype l7_datatype,
+      const int              l7_id,
+      int                    *request
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Iupdate starts the exchange L7_Update performs and returns at
+    * once, so it can be overlapped with computation on owned data. The
+    * ghost region of data_buffer is valid, and no part of data_buffer
+    * that is sent may be modified, until L7_Wait or L7_Test completes
+    * the request.
+    *
+    * Arguments
+    * =========
+    * data_buffer, l7_datatype, l7_id
+    *                    As for L7_Update.
+    *
+    * request            (output) int*
+    *                    Handle for L7_Wait, L7_Test and L7_Progress;
+    *                    L7_REQUEST_NULL if there is nothing to wait for.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Uses MPI_Ineighbor_alltoallw whatever the database's update
+    *    method; L7_UPDATE_CHECK is not applied.
+    * 2) Statistics time the update from posting until completion is
+    *    first observed, by L7_Progress, L7_Test or L7_Wait.
+    * 3) Serial compilation creates a no-op.
+    *
+    */
+
+   int
+     ierr;
+
+   *request = L7_REQUEST_NULL;
+
+#if defined HAVE_MPI
+
+   l7_id_database
+     *l7_id_db;
+   struct l7_update_datatype
+     *update_datatype;
+   struct l7_request
+     *req;
+   int
+     sizeof_type;
+
+   if (! l7.mpi_initialized){
+      return(0);
+   }
+
+   if (l7.initialized !=1){
+      ierr = 1;
+      L7_ASSERT(l7.initialized == 1, "L7 not initialized", ierr);
+   }
+
+   if (data_buffer == NULL){
+      ierr = -1;
+      L7_ASSERT( data_buffer != NULL, "data_buffer != NULL", ierr);
+   }
+
+   sizeof_type = l7p_sizeof(l7_datatype);
+   L7_ASSERT((sizeof_type > 0) && (sizeof_type <= 8), "Invalid L7 type in Iupdate.", -1);
+
+   if (l7.numpes == 1){
+      return(L7_OK);
+   }
+
+   l7_id_db = l7p_set_database(l7_id);
+   if (l7_id_db == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
+   }
+
+   if (l7_id_db->numpes == 1){ /* No-op */
+      return(L7_OK);
+   }
+
+   update_datatype = &l7_id_db->nbr_state.update_datatypes[sizeof_type];
+   L7_ASSERT(update_datatype->in_types != NULL, "Invalid gather datatype.", -1);
+   L7_ASSERT(update_datatype->out_types != NULL, "Invalid scatter datatype.", -1);
+
+   *request = l7p_request_new();
+   if (*request == L7_REQUEST_NULL){
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "Too many outstanding L7 requests", ierr);
+   }
+   req = &l7.requests[*request];
+
+   req->l7_id_db    = l7_id_db;
+   req->data_buffer = data_buffer;
+   req->sizeof_type = sizeof_type;
+   req->time_start  = MPI_Wtime();
+
+   ierr = MPI_Ineighbor_alltoallw((void *)data_buffer,
+			  l7_id_db->nbr_state.mpi_send_counts,
+			  (MPI_Aint *)l7_id_db->nbr_state.mpi_send_offsets,
+			  update_datatype->out_types,
+			  (void *)data_buffer,
+			  l7_id_db->nbr_state.mpi_recv_counts,
+			  (MPI_Aint *)l7_id_db->nbr_state.mpi_recv_offsets,
+			  update_datatype->in_types,
+			  l7_id_db->nbr_state.comm,
+			  &req->mpi_request);
+   if (ierr != MPI_SUCCESS){
+      l7p_request_release(*request);
+      *request = L7_REQUEST_NULL;
+   }
+   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Ineighbor_alltoallw", ierr);
+
+   l7p_request_post(*request);
+
+#endif /* HAVE_MPI */
+
+   ierr = L7_OK;
+   return(ierr);
+
+} /* End L7_Iupdate */
+
 void L7_UPDATE(
       void                    *data_buffer,
       const enum L7_Datatype  *l7_datatype,
@@ -203,6 +363,18 @@ void L7_UPDATE(
     L7_Update(data_buffer, *l7_datatype, *l7_id);
 }
 
+void L7_IUPDATE(
+      void                    *data_buffer,
+      const enum L7_Datatype  *l7_datatype,
+      const int               *l7_id,
+      int                     *request,
+      int                     *ierr
+      )
+{
+
+    *ierr = L7_Iupdate(data_buffer, *l7_datatype, *l7_id, request);
+}
+
 int L7_Get_Num_Indices(const int l7_id)
 {
    int ierr;
@@ -252,6 +424,12 @@ int L7_Get_Local_Indices(const int l7_id, int *local_indices)
       L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
    }
 
+   if (l7_id_db->num_sends > 0 && l7_id_db->indices_local_to_send == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db->indices_local_to_send != NULL,
+            "Send indices released by L7_Compact", ierr);
+   }
+
    //int num_indices = 0;
 
    int num_sends = l7_id_db->num_sends;
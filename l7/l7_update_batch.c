@@ -0,0 +1,598 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_UPDATE_BATCH"
+
+#ifdef HAVE_MPI
+
+static void batch_graph_free(
+      l7_batch *batch
+      )
+{
+   /*
+    * Release the union graph of a batch, keeping its id set.
+    */
+
+   int
+     d;
+
+   if (batch->comm != MPI_COMM_NULL)
+      MPI_Comm_free(&batch->comm);
+   batch->comm = MPI_COMM_NULL;
+
+   for (d=0; d<batch->num_ids; d++){
+      if (batch->send_slot) free(batch->send_slot[d]);
+      if (batch->recv_slot) free(batch->recv_slot[d]);
+   }
+   free(batch->send_slot);
+   free(batch->recv_slot);
+   free(batch->send_to);
+   free(batch->recv_from);
+   free(batch->send_bytes);
+   free(batch->recv_bytes);
+   L7_Mem_Release(batch->send_buffer);
+   L7_Mem_Release(batch->recv_buffer);
+
+   batch->send_slot = NULL;
+   batch->recv_slot = NULL;
+   batch->send_to = NULL;
+   batch->recv_from = NULL;
+   batch->send_bytes = NULL;
+   batch->recv_bytes = NULL;
+   batch->send_buffer = NULL;
+   batch->recv_buffer = NULL;
+   batch->send_buffer_len = 0;
+   batch->recv_buffer_len = 0;
+   batch->num_sends = 0;
+   batch->num_recvs = 0;
+}
+
+static int union_add(
+      int       *ranks,
+      int       *num_ranks,
+      const int rank
+      )
+{
+   /*
+    * Index of rank in the sorted list ranks, inserting it if absent.
+    */
+
+   int
+     lo = 0,
+     hi = *num_ranks,
+     mid;
+
+   while (lo < hi){
+      mid = (lo + hi) / 2;
+      if (ranks[mid] < rank) lo = mid + 1;
+      else hi = mid;
+   }
+   if (lo < *num_ranks && ranks[lo] == rank)
+      return(lo);
+
+   memmove(&ranks[lo+1], &ranks[lo], (size_t)(*num_ranks - lo) * sizeof(int));
+   ranks[lo] = rank;
+   (*num_ranks)++;
+   return(lo);
+}
+
+static int union_index(
+      const int *ranks,
+      const int num_ranks,
+      const int rank
+      )
+{
+   int
+     lo = 0,
+     hi = num_ranks,
+     mid;
+
+   while (lo < hi){
+      mid = (lo + hi) / 2;
+      if (ranks[mid] < rank) lo = mid + 1;
+      else hi = mid;
+   }
+   return(lo);
+}
+
+static int batch_graph_create(
+      l7_batch              *batch,
+      l7_id_database        **dbs
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Build the union neighbor graph of the databases in a batch: the
+    * sorted union of their send_to and recv_from lists, the position of
+    * every database neighbor in it, and a graph communicator over it.
+    *
+    * Notes
+    * =====
+    * 1) Collective over the databases' communicator.
+    *
+    */
+
+   int
+     d,
+     k,
+     ierr,
+     max_sends = 0,
+     max_recvs = 0;
+
+   for (d=0; d<batch->num_ids; d++){
+      max_sends += dbs[d]->num_sends;
+      max_recvs += dbs[d]->num_recvs;
+   }
+
+   batch->send_to    = (int *)malloc((size_t)(max_sends+1) * sizeof(int));
+   batch->recv_from  = (int *)malloc((size_t)(max_recvs+1) * sizeof(int));
+   batch->send_slot  = (int **)calloc((size_t)(unsigned)batch->num_ids, sizeof(int *));
+   batch->recv_slot  = (int **)calloc((size_t)(unsigned)batch->num_ids, sizeof(int *));
+   if (batch->send_to == NULL || batch->recv_from == NULL ||
+       batch->send_slot == NULL || batch->recv_slot == NULL){
+      batch_graph_free(batch);
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "No memory for batch graph", ierr);
+   }
+
+   for (d=0; d<batch->num_ids; d++){
+      for (k=0; k<dbs[d]->num_sends; k++)
+         union_add(batch->send_to, &batch->num_sends, dbs[d]->send_to[k]);
+      for (k=0; k<dbs[d]->num_recvs; k++)
+         union_add(batch->recv_from, &batch->num_recvs, dbs[d]->recv_from[k]);
+   }
+
+   for (d=0; d<batch->num_ids; d++){
+      batch->send_slot[d] = (int *)malloc((size_t)(dbs[d]->num_sends+1) * sizeof(int));
+      batch->recv_slot[d] = (int *)malloc((size_t)(dbs[d]->num_recvs+1) * sizeof(int));
+      if (batch->send_slot[d] == NULL || batch->recv_slot[d] == NULL){
+         batch_graph_free(batch);
+         ierr = -1;
+         L7_ASSERT(ierr == 0, "No memory for batch graph", ierr);
+      }
+      for (k=0; k<dbs[d]->num_sends; k++)
+         batch->send_slot[d][k] = union_index(batch->send_to, batch->num_sends, dbs[d]->send_to[k]);
+      for (k=0; k<dbs[d]->num_recvs; k++)
+         batch->recv_slot[d][k] = union_index(batch->recv_from, batch->num_recvs, dbs[d]->recv_from[k]);
+      batch->generations[d] = dbs[d]->generation;
+   }
+
+   /* Byte counts followed by displacements, for each side. */
+   batch->send_bytes = (int *)malloc((size_t)(2*batch->num_sends+1) * sizeof(int));
+   batch->recv_bytes = (int *)malloc((size_t)(2*batch->num_recvs+1) * sizeof(int));
+   if (batch->send_bytes == NULL || batch->recv_bytes == NULL){
+      batch_graph_free(batch);
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "No memory for batch graph", ierr);
+   }
+
+   ierr = MPI_Dist_graph_create_adjacent(dbs[0]->comm,
+         batch->num_recvs, batch->recv_from, MPI_UNWEIGHTED,
+         batch->num_sends, batch->send_to, MPI_UNWEIGHTED,
+         MPI_INFO_NULL, 0, &batch->comm);
+   L7_ASSERT(ierr == MPI_SUCCESS, "Failed to create batch graph communicator.", ierr);
+
+   return(L7_OK);
+}
+
+static l7_batch *batch_find(
+      const int             n,
+      const int             *l7_ids,
+      l7_id_database        **dbs
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Return the cached batch for this id set, building or rebuilding its
+    * union graph if it is new or any database was set up again since.
+    */
+
+   l7_batch
+     *batch;
+   int
+     d,
+     ierr,
+     stale;
+
+   for (batch = l7.first_batch; batch != NULL; batch = batch->next_batch){
+      if (batch->num_ids == n && memcmp(batch->l7_ids, l7_ids, (size_t)n * sizeof(int)) == 0)
+         break;
+   }
+
+   if (batch == NULL){
+      batch = (l7_batch *)calloc(1L, sizeof(l7_batch));
+      if (batch == NULL) return(NULL);
+      batch->l7_ids      = (int *)malloc((size_t)n * sizeof(int));
+      batch->generations = (int *)malloc((size_t)n * sizeof(int));
+      if (batch->l7_ids == NULL || batch->generations == NULL){
+         free(batch->l7_ids);
+         free(batch->generations);
+         free(batch);
+         return(NULL);
+      }
+      memcpy(batch->l7_ids, l7_ids, (size_t)n * sizeof(int));
+      for (d=0; d<n; d++)
+         batch->generations[d] = -1;
+      batch->num_ids = n;
+      batch->comm    = MPI_COMM_NULL;
+
+      batch->next_batch = l7.first_batch;
+      l7.first_batch = batch;
+   }
+
+   stale = (batch->comm == MPI_COMM_NULL);
+   for (d=0; d<n; d++){
+      if (batch->generations[d] != dbs[d]->generation) stale = 1;
+   }
+
+   if (stale){
+      batch_graph_free(batch);
+      ierr = batch_graph_create(batch, dbs);
+      if (ierr != L7_OK) return(NULL);
+   }
+
+   return(batch);
+}
+
+static int batch_buffer_reserve(
+      char      **buffer,
+      size_t    *buffer_len,
+      const int len
+      )
+{
+   if ((size_t)len <= *buffer_len && *buffer != NULL)
+      return(L7_OK);
+
+   L7_Mem_Release(*buffer);
+   *buffer_len = 0;
+   *buffer = (char *)L7_Mem_Alloc((size_t)len + 1);
+   if (*buffer == NULL)
+      return(-1);
+   *buffer_len = (size_t)len;
+   return(L7_OK);
+}
+
+#endif /* HAVE_MPI */
+
+int L7_Update_Batch(
+      const int              n,
+      void                   **data_buffers,
+      const enum L7_Datatype *l7_datatypes,
+      const int              *l7_ids
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Update_Batch performs L7_Update on n databases at once, sending
+    * one message to each distinct neighbor of the set instead of one per
+    * database and neighbor. Each database's contribution for a neighbor
+    * is packed with its send datatype, the merged messages go through a
+    * single MPI_Neighbor_alltoallv over the union of the neighbor graphs,
+    * and each contribution is unpacked with the receive datatype.
+    *
+    * Arguments
+    * =========
+    * n                  (input) const int
+    *                    Number of databases.
+    *
+    * data_buffers       (input/output) void**
+    *                    Array to update for each database, as for
+    *                    L7_Update.
+    *
+    * l7_datatypes       (input) const enum L7_Datatype*
+    *                    Type of each array.
+    *
+    * l7_ids             (input) const int*
+    *                    Handle of each database.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over the databases' communicator, which must be the
+    *    same for all of them; every process lists the ids in the same
+    *    order.
+    * 2) The union graph is cached for the id set and rebuilt when one of
+    *    the databases is set up again. The first call for an id set is
+    *    as expensive as a setup. L7_Free of any of the databases drops
+    *    the cached graph, so the cache holds only live id sets.
+    * 3) Each database records its own bytes and an even share of the
+    *    batch time in its statistics.
+    * 4) Two threads must not batch the same id set concurrently, and
+    *    cached batches are only built from one thread at a time.
+    * 5) Serial compilation creates a no-op.
+    *
+    */
+
+#if defined HAVE_MPI
+
+   l7_id_database
+     **dbs;
+   l7_batch
+     *batch;
+   struct l7_update_datatype
+     *update_datatype;
+   int
+     d,
+     k,
+     slot,
+     bytes,
+     ierr,
+     total,
+     position,
+     sizeof_type,
+     *send_displs,
+     *recv_displs;
+   double
+     time_start,
+     elapsed;
+
+   if (! l7.mpi_initialized){
+      return(0);
+   }
+
+   if (l7.initialized != 1){
+      ierr = 1;
+      L7_ASSERT(l7.initialized == 1, "L7 not initialized", ierr);
+   }
+
+   if (n <= 0 || data_buffers == NULL || l7_datatypes == NULL || l7_ids == NULL){
+      ierr = -1;
+      L7_ASSERT(n > 0, "Invalid batch", ierr);
+   }
+
+   if (l7.numpes == 1){
+      ierr = L7_OK;
+      return(ierr);
+   }
+
+   dbs = (l7_id_database **)malloc((size_t)n * sizeof(l7_id_database *));
+   if (dbs == NULL){
+      ierr = -1;
+      L7_ASSERT(dbs != NULL, "No memory for batch", ierr);
+   }
+
+   for (d=0; d<n; d++){
+      dbs[d] = l7p_set_database(l7_ids[d]);
+      if (dbs[d] == NULL || data_buffers[d] == NULL){
+         free(dbs);
+         ierr = -1;
+         L7_ASSERT(ierr == 0, "Failed to find database or buffer.", ierr);
+      }
+      sizeof_type = l7p_sizeof(l7_datatypes[d]);
+      if (sizeof_type <= 0 || sizeof_type > 8 ||
+          dbs[d]->nbr_state.update_datatypes[sizeof_type].in_types == NULL ||
+          dbs[d]->comm != dbs[0]->comm){
+         free(dbs);
+         ierr = -1;
+         L7_ASSERT(ierr == 0, "Invalid type or communicator in batch.", ierr);
+      }
+   }
+
+   if (dbs[0]->numpes == 1){ /* No-op */
+      free(dbs);
+      return(L7_OK);
+   }
+
+   batch = batch_find(n, l7_ids, dbs);
+   if (batch == NULL){
+      free(dbs);
+      ierr = -1;
+      L7_ASSERT(batch != NULL, "Failed to build batch graph.", ierr);
+   }
+
+   time_start = MPI_Wtime();
+
+   send_displs = &batch->send_bytes[batch->num_sends];
+   recv_displs = &batch->recv_bytes[batch->num_recvs];
+
+   /*
+    * Merged message sizes for these datatypes.
+    */
+
+   memset(batch->send_bytes, 0, (size_t)batch->num_sends * sizeof(int));
+   memset(batch->recv_bytes, 0, (size_t)batch->num_recvs * sizeof(int));
+   for (d=0; d<n; d++){
+      update_datatype = &dbs[d]->nbr_state.update_datatypes[l7p_sizeof(l7_datatypes[d])];
+      for (k=0; k<dbs[d]->num_sends; k++){
+         MPI_Pack_size(1, update_datatype->out_types[k], batch->comm, &bytes);
+         batch->send_bytes[batch->send_slot[d][k]] += bytes;
+      }
+      for (k=0; k<dbs[d]->num_recvs; k++){
+         MPI_Pack_size(1, update_datatype->in_types[k], batch->comm, &bytes);
+         batch->recv_bytes[batch->recv_slot[d][k]] += bytes;
+      }
+   }
+
+   total = 0;
+   for (slot=0; slot<batch->num_sends; slot++){
+      send_displs[slot] = total;
+      total += batch->send_bytes[slot];
+   }
+   ierr = batch_buffer_reserve(&batch->send_buffer, &batch->send_buffer_len, total);
+   if (ierr != L7_OK) free(dbs);
+   L7_ASSERT(ierr == L7_OK, "No memory for batch send buffer", ierr);
+
+   total = 0;
+   for (slot=0; slot<batch->num_recvs; slot++){
+      recv_displs[slot] = total;
+      total += batch->recv_bytes[slot];
+   }
+   ierr = batch_buffer_reserve(&batch->recv_buffer, &batch->recv_buffer_len, total);
+   if (ierr != L7_OK) free(dbs);
+   L7_ASSERT(ierr == L7_OK, "No memory for batch receive buffer", ierr);
+
+   /*
+    * Pack each database's contribution behind the previous database's
+    * in the message for that neighbor; displacements advance as we go
+    * and are restored afterwards.
+    */
+
+   for (d=0; d<n; d++){
+      update_datatype = &dbs[d]->nbr_state.update_datatypes[l7p_sizeof(l7_datatypes[d])];
+      for (k=0; k<dbs[d]->num_sends; k++){
+         slot = batch->send_slot[d][k];
+         position = send_displs[slot];
+         ierr = MPI_Pack(data_buffers[d], 1, update_datatype->out_types[k],
+               batch->send_buffer, (int)batch->send_buffer_len, &position, batch->comm);
+         if (ierr != MPI_SUCCESS) free(dbs);
+         L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Pack", ierr);
+         send_displs[slot] = position;
+      }
+   }
+   for (slot=0; slot<batch->num_sends; slot++)
+      send_displs[slot] -= batch->send_bytes[slot];
+
+   ierr = MPI_Neighbor_alltoallv(batch->send_buffer, batch->send_bytes, send_displs, MPI_BYTE,
+         batch->recv_buffer, batch->recv_bytes, recv_displs, MPI_BYTE, batch->comm);
+   if (ierr != MPI_SUCCESS) free(dbs);
+   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Neighbor_alltoallv", ierr);
+
+   for (d=0; d<n; d++){
+      update_datatype = &dbs[d]->nbr_state.update_datatypes[l7p_sizeof(l7_datatypes[d])];
+      for (k=0; k<dbs[d]->num_recvs; k++){
+         slot = batch->recv_slot[d][k];
+         position = recv_displs[slot];
+         ierr = MPI_Unpack(batch->recv_buffer, (int)batch->recv_buffer_len, &position,
+               data_buffers[d], 1, update_datatype->in_types[k], batch->comm);
+         if (ierr != MPI_SUCCESS) free(dbs);
+         L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Unpack", ierr);
+         recv_displs[slot] = position;
+      }
+      if (dbs[d]->num_ghost_dups > 0)
+         l7p_ghost_dups_fill(dbs[d], data_buffers[d], l7p_sizeof(l7_datatypes[d]));
+   }
+
+   elapsed = (MPI_Wtime() - time_start) / n;
+   for (d=0; d<n; d++){
+      dbs[d]->stats.num_updates++;
+      l7p_stats_record(&dbs[d]->stats, dbs[d]->nbr_bytes_sent,
+            dbs[d]->nbr_bytes_recvd, dbs[d]->send_counts,
+            dbs[d]->recv_counts, l7p_sizeof(l7_datatypes[d]), elapsed);
+   }
+
+   free(dbs);
+
+#endif /* HAVE_MPI */
+
+   return(L7_OK);
+
+} /* End L7_Update_Batch */
+
+void l7p_batch_free_id(
+      const int              l7_id
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Release every cached batch that lists database l7_id (L7_Free).
+    * Collective over the database's communicator, like L7_Free.
+    */
+
+#ifdef HAVE_MPI
+
+   l7_batch
+     *batch,
+     **link;
+   int
+     d,
+     found;
+
+   link = &l7.first_batch;
+   while ((batch = *link) != NULL){
+      found = 0;
+      for (d=0; d<batch->num_ids; d++){
+         if (batch->l7_ids[d] == l7_id) found = 1;
+      }
+      if (found){
+         *link = batch->next_batch;
+         batch_graph_free(batch);
+         free(batch->l7_ids);
+         free(batch->generations);
+         free(batch);
+      }
+      else {
+         link = &batch->next_batch;
+      }
+   }
+
+#else
+   (void)l7_id;
+#endif /* HAVE_MPI */
+
+}
+
+void l7p_batch_free_all(void)
+{
+   /*
+    * Purpose
+    * =======
+    * Release every cached batch (L7_Terminate, before MPI_Finalize).
+    */
+
+#ifdef HAVE_MPI
+
+   l7_batch
+     *batch,
+     *next_batch;
+
+   for (batch = l7.first_batch; batch != NULL; batch = next_batch){
+      next_batch = batch->next_batch;
+      batch_graph_free(batch);
+      free(batch->l7_ids);
+      free(batch->generations);
+      free(batch);
+   }
+   l7.first_batch = NULL;
+
+#endif /* HAVE_MPI */
+
+}
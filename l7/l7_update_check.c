@@ -0,0 +1,249 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7_UPDATE_CHECK"
+
+int L7_Update_Check(
+      void                    *data_buffer,
+      const enum L7_Datatype  l7_datatype,
+      const int               l7_id
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * L7_Update_Check verifies the ghost data placed in data_buffer by a
+    * previous L7_Update. Each process computes a CRC32C checksum of the
+    * values it sends to each neighbor, the checksums are exchanged in
+    * one small neighbor alltoall, and each process compares them with
+    * checksums of the corresponding segments of its ghost region.
+    *
+    * Arguments
+    * =========
+    * data_buffer        (input) void*
+    *                    Array updated by L7_Update with the same l7_id
+    *                    and l7_datatype; neither the owned nor the ghost
+    *                    data may have changed since.
+    *
+    * l7_datatype        (input) const enum L7_Datatype
+    *                    The type of data contained in array data_buffer.
+    *
+    * l7_id              (input) const int
+    *                    Handle to database containing communication requirements.
+    *
+    * Return value
+    * ============
+    * L7_OK if every ghost segment matches, otherwise the number of
+    * neighbors whose ghost data differs on this process (negative for
+    * errors). Mismatches are also reported on the assert output and
+    * counted in the database statistics.
+    *
+    * Notes:
+    * =====
+    * 1) Collective over the neighbors of the database, like L7_Update.
+    * 2) Setting the environment variable L7_UPDATE_CHECK=n makes
+    *    L7_Update call this after every n-th update of each database,
+    *    a sampled check cheap enough to leave on in production.
+    * 3) Serial compilation creates a no-op
+    *
+    */
+
+   int
+     ierr;                 /* Error code for return              */
+
+#if defined HAVE_MPI
+
+   /*
+    * Local variables
+    */
+   l7_id_database
+     *l7_id_db;            /* database associated with l7_id.    */
+   int
+     i,
+     num_errors,           /* Ghost segments that do not match   */
+     num_recvs,
+     num_sends,
+     offset,
+     sizeof_type,          /* sizeof the L7 datatype             */
+     sums_needed;          /* Length of check_sums required      */
+   uint32_t
+     *send_sums,           /* Checksums of data sent to each pe  */
+     *recv_sums,           /* Checksums as computed by the owner */
+     ghost_sum;            /* Checksum of received ghost data    */
+   char
+     *ghost;
+
+   /*
+    * Executable Statements
+    */
+
+   if (! l7.mpi_initialized){
+      return(0);
+   }
+
+   if (l7.initialized !=1){
+      ierr = 1;
+      L7_ASSERT(l7.initialized == 1, "L7 not initialized", ierr);
+   }
+
+   if (data_buffer == NULL){
+      ierr = -1;
+      L7_ASSERT( data_buffer != NULL, "data_buffer != NULL", ierr);
+   }
+
+   sizeof_type = l7p_sizeof(l7_datatype);
+   L7_ASSERT((sizeof_type > 0) && (sizeof_type <= 8), "Invalid L7 type in Update_Check.", -1);
+
+   if (l7_id <= 0){
+      ierr = -1;
+      L7_ASSERT( l7_id > 0, "l7_id <= 0", ierr);
+   }
+
+   if (l7.numpes == 1){
+      ierr = L7_OK;
+      return(ierr);
+   }
+
+   l7_id_db = l7p_set_database(l7_id);
+   if (l7_id_db == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db != NULL, "Failed to find database.", ierr);
+   }
+
+   if (l7_id_db->numpes == 1){ /* No-op */
+      ierr = L7_OK;
+      return(ierr);
+   }
+
+   if (l7_id_db->num_sends > 0 && l7_id_db->indices_local_to_send == NULL){
+      ierr = -1;
+      L7_ASSERT(l7_id_db->indices_local_to_send != NULL,
+            "Send indices released by L7_Compact", ierr);
+   }
+
+   num_sends = l7_id_db->num_sends;
+   num_recvs = l7_id_db->num_recvs;
+
+   /*
+    * Checksums live in the database's own workspace.
+    */
+
+   sums_needed = num_sends + num_recvs + 1;
+   if (l7_id_db->check_sums_len < sums_needed){
+      if (l7_id_db->check_sums)
+         free(l7_id_db->check_sums);
+
+      l7_id_db->check_sums = (uint32_t *)malloc((size_t)sums_needed * sizeof(uint32_t));
+      if (l7_id_db->check_sums == NULL){
+         l7_id_db->check_sums_len = 0;
+         ierr = -1;
+         L7_ASSERT(l7_id_db->check_sums != NULL, "No memory for check_sums", ierr);
+      }
+      l7_id_db->check_sums_len = sums_needed;
+   }
+
+   send_sums = l7_id_db->check_sums;
+   recv_sums = &send_sums[num_sends];
+
+   offset = 0;
+   for (i=0; i<num_sends; i++){
+      send_sums[i] = l7p_crc32c_gather(0, data_buffer,
+            &l7_id_db->indices_local_to_send[offset],
+            l7_id_db->send_counts[i], sizeof_type);
+      offset += l7_id_db->send_counts[i];
+   }
+
+   ierr = MPI_Neighbor_alltoall(send_sums, 1, MPI_UINT32_T,
+         recv_sums, 1, MPI_UINT32_T, l7_id_db->nbr_state.comm);
+   L7_ASSERT(ierr == MPI_SUCCESS, "MPI_Neighbor_alltoall (checksums)", ierr);
+
+   /*
+    * Ghost data from each neighbor follows the owned data in order,
+    * unless L7_Setup_Placed gave every ghost its own offset.
+    */
+
+   num_errors = 0;
+   offset = 0;
+   ghost = (char *)data_buffer + (size_t)l7_id_db->num_indices_owned * sizeof_type;
+   for (i=0; i<num_recvs; i++){
+      if (l7_id_db->ghost_offsets)
+         ghost_sum = l7p_crc32c_gather(0, data_buffer, &l7_id_db->ghost_offsets[offset],
+               l7_id_db->recv_counts[i], sizeof_type);
+      else
+         ghost_sum = l7p_crc32c(0, ghost, (size_t)l7_id_db->recv_counts[i] * sizeof_type);
+      if (ghost_sum != recv_sums[i]){
+         fprintf(l7.assert_out_file ? l7.assert_out_file : stderr,
+               "[pe %d] L7_Update_Check: ghost data from pe %d does not match "
+               "(checksum 0x%08x, owner sent 0x%08x) for l7_id %d\n",
+               l7_id_db->penum, l7_id_db->recv_from[i], ghost_sum,
+               recv_sums[i], l7_id);
+         num_errors++;
+      }
+      ghost += (size_t)l7_id_db->recv_counts[i] * sizeof_type;
+      offset += l7_id_db->recv_counts[i];
+   }
+
+   l7_id_db->stats.num_checks++;
+   l7_id_db->stats.num_check_errors += num_errors;
+
+   return(num_errors);
+
+#else
+
+   ierr = L7_OK;
+   return(ierr);
+
+#endif /* HAVE_MPI */
+
+} /* End L7_Update_Check */
+
+void L7_UPDATE_CHECK(
+      void                    *data_buffer,
+      const enum L7_Datatype  *l7_datatype,
+      const int               *l7_id,
+      int                     *ierr
+      )
+{
+   *ierr = L7_Update_Check(data_buffer, *l7_datatype, *l7_id);
+}
@@ -111,6 +111,24 @@ double l7_wtime_(void)
     return(l7_wtime);
 }
 
+int L7_Get_Thread_Level(void)
+{
+#ifdef HAVE_MPI
+   return(l7.thread_level);
+#else
+   return(0);
+#endif
+}
+
+int l7_get_thread_level_(void)
+{
+#ifdef HAVE_MPI
+   return(l7.thread_level);
+#else
+   return(0);
+#endif
+}
+
 int L7_Get_Timeout_Signal(void)
 {
     return(SIGURG);
@@ -130,3 +148,19 @@ long long l7_address_(void *var)
    return((long long)var);
 }
 
+
+void l7p_comm_size_rank(MPI_Comm comm, int *numpes, int *penum)
+{
+   /*
+    * Size of, and rank in, the given communicator. MPI_COMM_WORLD
+    * uses the values cached by L7_Init.
+    */
+   if (comm == MPI_COMM_WORLD || ! l7.initialized_mpi){
+      *numpes = l7.numpes;
+      *penum  = l7.penum;
+   }
+   else {
+      MPI_Comm_size(comm, numpes);
+      MPI_Comm_rank(comm, penum);
+   }
+}
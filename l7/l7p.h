@@ -3,6 +3,7 @@
 
 #include <sys/types.h>
 #include <sys/time.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #ifdef HAVE_CONFIG_H
@@ -78,6 +79,8 @@ enum
 
 #define l7_id_database int
 
+#define l7_batch       int
+
 #define Comm_Datatype  int
 
 #define Comm_Op        int  /* Reduction operation type. */
@@ -97,12 +100,17 @@ enum
 #define L7_MAX_NUM_DBS  50 /* May be more space, but exceeding this
                               probably indicates a leak. */
 
+#define L7_MAX_NUM_REQUESTS 256 /* Nonblocking operations outstanding
+                                   at once (L7_Iupdate). */
+
 /*
  * Message tag management.
  */
 
 #define L7_SETUP_SEND_COUNT_TAG      1000
 #define L7_SETUP_INDICES_NEEDED_TAG  1001
+#define L7_FILE_RELAY_TAG            1002
+#define L7_UPDATE_P2P_TAG            1003 /* On the private nbr_state.comm. */
 
 #define L7_UPDATE_TAGS_MIN           2001
 #define L7_UPDATE_TAGS_MAX           2999
@@ -111,12 +119,24 @@ enum
                                              MPI_Requests initially
                                              allocated, times "num_recvs". */
 
+/*
+ * Allocator of a database (L7_Allocator operations and their state).
+ */
+typedef struct l7p_allocator
+{
+   L7_Allocator
+     ops;                      /* Copied from l7.allocator at creation.     */
+   void
+     *state;                   /* From ops.create.                          */
+} l7p_allocator;
+
 /*
  * Database state and prototypes associated with neighbor collectives
  */
 struct l7_update_datatype {
    MPI_Datatype *in_types;
    MPI_Datatype *out_types;
+   MPI_Datatype base_type;	/* Element type of in_types and out_types. */
 };
 
 struct nbr_state {
@@ -133,6 +153,9 @@ struct nbr_state {
       *mpi_send_offsets, 	/* Offset of datatype to send on an edge (always 0) */
       *mpi_recv_offsets; 	/* Offset of datatype to recv on an edge (always 0) */
 
+   l7p_allocator
+     *allocator;		/* Where the arrays come from; NULL for the heap */
+
    struct l7_update_datatype
       update_datatypes[9];	/* Neighbor datatypes indexed by l7_sizeof result */
 };
@@ -140,6 +163,17 @@ struct nbr_state {
 int l7p_nbr_state_create( struct nbr_state *nbr_state, int num_recvs, int num_sends );
 int l7p_nbr_state_free( struct nbr_state *nbr_state );
 
+/*
+ * Run of consecutive global ids at consecutive local offsets
+ * (L7_Gid_To_Local).
+ */
+struct l7_gid_run {
+   int
+     gid,                      /* First global id.                          */
+     len,                      /* Number of ids.                            */
+     local;                    /* Offset of the first one.                  */
+};
+
 /*
  * Struct for data associated with specified L7 handle.
  */
@@ -147,10 +181,12 @@ int l7p_nbr_state_free( struct nbr_state *nbr_state );
 typedef struct l7_id_database
 {
    int
-     *global_ids,              /* Global ids associated with local indices.
-                                  After l7p_gid2index has been executed,
-                                  contains gids for needed indices as well  */
-     *index_for_gid,           /* Local indices associated with global ids. */
+     *global_ids,              /* Global id hash keys (L7_Gid_To_Local) for
+                                  ids outside gid_runs, -1 if empty.        */
+     *index_for_gid,           /* Local offset for each global_ids key.     */
+     gid_hash_size,            /* Slots in global_ids, a power of two.      */
+     gid_hash_shift,           /* 32 - log2(gid_hash_size).                 */
+     num_gid_runs,             /* Entries in gid_runs.                      */
      *indices_needed,          /* As input to L7_SETUP.                     */
      *indices_global_to_send,  /* Array of global indices this pe sends,    */
      *indices_local_to_send,   /* Array of local indices this pe sends.     */
@@ -166,8 +202,8 @@ typedef struct l7_id_database
      num_recvs,                /* Number of processes this pe recvs from.   */
      num_reqs_outstanding,     /* Num MPI_Requests posted in packing model. */
      num_sends,                /* Number of processes this pe sends to.     */
-     numpes,                   /* Size of MPI_COMM_WORLD                    */
-     penum,                    /* Process rank in MPI_COMM_WORLD            */
+     numpes,                   /* Size of comm                              */
+     penum,                    /* Process rank in comm                      */
      *recv_from,               /* Processes this pe receives from.          */
      recv_from_len,            /* Length (in int) of recv_from.             */
      *recv_counts,             /* Array of msg counts for recv_from pes.    */
@@ -177,6 +213,16 @@ typedef struct l7_id_database
      *send_counts,             /* Msg counts for send_to pes.               */
      send_counts_len,          /* Length (in int) of send_counts_len.       */
      *starting_indices,        /* Array of my_start_index from each pe.     */
+     *ghost_offsets,           /* Local offset of each needed index
+                                  (L7_Setup_Placed), NULL for the default
+                                  layout after the owned indices.          */
+     owned_placed,             /* 1 if owned indices were given local
+                                  offsets by L7_Setup_Placed, else 0.       */
+     generation,               /* Unique per l7p_database_comm_create, so
+                                  cached batches notice a new setup.        */
+     num_ghost_dups,           /* Repeats in the caller's indices_needed.   */
+     *ghost_dup_dst,           /* Slot of each repeat ...                   */
+     *ghost_dup_src,           /* ... and the slot it is copied from.       */
      this_tag_update;          /* Msg tag for updates.                      */
 
    /* MPI parameters */
@@ -187,14 +233,80 @@ typedef struct l7_id_database
    MPI_Status
      *mpi_status;
 
+   MPI_Comm
+     comm;                     /* Communicator the database was set up on;
+                                  MPI_COMM_WORLD unless L7_Setup_Comm.      */
+
    struct nbr_state nbr_state;
 
+   l7p_allocator
+     allocator;                /* Communication lists, index arrays and
+                                  neighbor state, released in bulk on a
+                                  new setup and by L7_Free.                 */
+
+   struct l7_gid_run
+     *gid_runs;                /* Global id runs sorted by gid; NULL until
+                                  the global id map is built.               */
+
+   /* Communication statistics */
+
+   struct L7_Stats
+     stats;
+
+   long long
+     *nbr_bytes_sent,          /* Bytes sent to each send_to pe.            */
+     *nbr_bytes_recvd;         /* Bytes received from each recv_from pe.    */
+
+   /* Point-to-point update schedule (enum L7_UpdateMethod). The
+    * schedule arrays exist only while update_method is L7_UPDATE_P2P. */
+
+   int
+     update_method,            /* enum L7_UpdateMethod.                     */
+     send_order,               /* enum L7_SendOrder.                        */
+     max_in_flight,            /* Cap on outstanding sends, 0 for none.     */
+     *send_schedule,           /* Send indices in posting order.            */
+     *send_offsets;            /* First element of each send in pack_buffer */
+
+   char
+     *pack_buffer;             /* Packed send data (L7_Mem_Alloc).          */
+   size_t
+     pack_buffer_len;          /* Bytes in pack_buffer.                     */
+
+   MPI_Request
+     *p2p_requests;            /* num_recvs receives then num_sends sends.  */
+
+   /* Workspace for L7_Update_Check, kept per database so threads
+    * updating different databases do not share it. */
+
+   uint32_t
+     *check_sums;              /* Send then receive checksums.              */
+   int
+     check_sums_len;           /* Allocated length of check_sums.           */
+
 #ifdef HAVE_OPENCL
    int
      num_indices_have,         /* Count of indices needed for send in update */
      *indices_have;            /* list of indices have on pe for send       */
 
    cl_mem dev_indices_have;    /* list of indices on the device             */
+
+   cl_mem dev_packed_data;     /* Pooled device pack buffer (L7_Dev_Update) */
+   size_t dev_packed_bytes;    /* Allocated size of dev_packed_data.        */
+   cl_mem
+     host_packed_mem,          /* Pinned buffers behind host_packed_data    */
+     host_ghost_mem;           /* and host_ghost_data.                      */
+   void
+     *host_packed_data,        /* Mapped host copy of dev_packed_data.      */
+     *host_ghost_data,         /* Mapped contiguous ghost receive buffer.   */
+     *host_update_data;        /* Owned+ghost array, host L7_Update path.   */
+   size_t
+     host_packed_bytes,        /* Allocated size of host_packed_data.       */
+     host_ghost_bytes,         /* Allocated size of host_ghost_data.        */
+     host_update_bytes;        /* Allocated size of host_update_data.       */
+   MPI_Request
+     *dev_requests;            /* num_recvs receives then num_sends sends.  */
+   int
+     dev_requests_len;         /* Allocated length of dev_requests.         */
 #endif
 
    struct l7_id_database
@@ -222,11 +334,178 @@ typedef struct l7_push_id_database
 
    struct nbr_state nbr_state;
 
+   struct L7_Stats
+     stats;                    /* Communication statistics.                 */
+
+   long long
+     *nbr_bytes_sent,          /* Bytes sent to each comm_partner.          */
+     *nbr_bytes_recvd;         /* Bytes received from each comm_partner.    */
+
    struct l7_push_id_database
      *next_push_db;            /* Link to next database.                    */
 
 } l7_push_id_database;
 
+/*
+ * Partial result of one L7_Reduce_Multi entry as it crosses the wire:
+ * its operation and kind, and a 64-bit integer or double value.
+ */
+
+struct l7p_reduce_slot
+{
+   long long
+     code;                     /* op * 2 + 1 if floating point.             */
+   union {
+      long long i;
+      double    d;
+   } v;
+};
+
+/*
+ * Candidate of L7_MaxLoc and friends: the extreme value and its global
+ * location, reduced by one user-defined op (l7_loc.c).
+ */
+
+struct l7p_loc
+{
+   union {
+      long long i;
+      double    d;
+   } value;
+   long long
+     loc;                      /* Global 0-based location.                  */
+   int
+     code,                     /* op * 2 + 1 if floating point.             */
+     stale;                    /* Set if the cached offset is out of date.  */
+};
+
+/*
+ * Nonblocking operation (L7_Iupdate). The state moves FREE -> BUSY while
+ * it is filled in, then ACTIVE; whoever tests or waits on the MPI request
+ * first moves it ACTIVE -> BUSY so only one thread touches it at a time,
+ * and DONE once it has completed. L7_Wait/L7_Test on the owning thread
+ * record statistics and return it to FREE.
+ */
+
+enum l7p_request_state
+{
+   L7P_REQUEST_FREE = 0,
+   L7P_REQUEST_BUSY,
+   L7P_REQUEST_ACTIVE,
+   L7P_REQUEST_DONE
+};
+
+struct l7_request
+{
+   int
+     state,                    /* enum l7p_request_state, atomic.           */
+     sizeof_type;              /* Element size of an update.                */
+
+   MPI_Request
+     mpi_request;
+
+   struct l7_id_database
+     *l7_id_db;                /* Database being updated.                   */
+
+   void
+     *data_buffer;             /* Array being updated.                      */
+
+   double
+     time_start,               /* MPI_Wtime when posted.                    */
+     time_done;                /* MPI_Wtime when completion was seen.       */
+
+   /* Nonblocking reductions (L7_Isum, L7_Ireduce_Multi, ...) only. */
+   int
+     num_reductions;           /* Entries in reductions and slots.          */
+   struct L7_Reduction
+     *reductions,              /* Outputs to fill in on completion; NULL
+                                  for other operations.                     */
+     reduction;                /* Storage for a single entry.               */
+   struct l7p_reduce_slot
+     *slots,                   /* Reduced in place by MPI_Iallreduce.       */
+     slot;                     /* Storage for a single entry.               */
+};
+
+/*
+ * Cached union neighbor graph for an L7_Update_Batch id set.
+ */
+
+typedef struct l7_batch
+{
+   int
+     num_ids,                  /* Number of databases in the batch.         */
+     *l7_ids,                  /* Their handles, in call order.             */
+     *generations,             /* Their generation when the graph was built */
+     num_sends,                /* Distinct ranks any database sends to.     */
+     *send_to,                 /* Those ranks, ascending.                   */
+     num_recvs,                /* Distinct ranks any database recvs from.   */
+     *recv_from,               /* Those ranks, ascending.                   */
+     **send_slot,              /* [d][k]: index in send_to of send k of
+                                  database d.                               */
+     **recv_slot,              /* [d][k]: index in recv_from of recv k.     */
+     *send_bytes,              /* Merged send sizes, then displacements.    */
+     *recv_bytes;              /* Merged recv sizes, then displacements.    */
+
+   MPI_Comm
+     comm;                     /* Graph communicator over the union.        */
+
+   char
+     *send_buffer,             /* Packed merged messages (L7_Mem_Alloc).    */
+     *recv_buffer;
+
+   size_t
+     send_buffer_len,
+     recv_buffer_len;
+
+   struct l7_batch
+     *next_batch;              /* Link to next cached batch.                */
+
+} l7_batch;
+
+/*
+ * Offset of this rank's items for the location reductions, cached on a
+ * communicator as an attribute (l7_loc.c).
+ */
+
+struct l7p_loc_offset
+{
+   long long
+     count,                    /* Local count the offset was computed for.  */
+     offset;                   /* Items on lower ranks (MPI_Exscan).        */
+};
+
+/*
+ * Node-hierarchical collective state of one communicator, cached on it
+ * as an attribute (l7_hier_coll.c).
+ */
+
+struct l7p_hier
+{
+   MPI_Comm
+     comm,                     /* Communicator this state belongs to.       */
+     node_comm,                /* Ranks sharing memory with this one.       */
+     leader_comm;              /* Node rank 0 of every node, else NULL.     */
+
+   MPI_Win
+     win;                      /* Shared window: node_size slots, then the
+                                  result area, each slot_bytes long.        */
+
+   char
+     *slots,                   /* Window base of the node leader.           */
+     *result;
+
+   int
+     enabled,                  /* 0 for one node or one rank per node.      */
+     node_rank,
+     node_size,
+     slot_bytes,
+     *node_of,                 /* [rank]: leader_comm rank of its node.     */
+     *node_rank_of;            /* [rank]: its rank in its node_comm.        */
+
+   struct l7p_hier
+     *next_hier;               /* Link to next cached state.                */
+};
+
 #endif /* HAVE_MPI */
 
 /*
@@ -247,29 +526,58 @@ typedef struct
 
    l7_id_database
      *first_db,                /* For linked list of dbs.              */
-     *last_db;
+     *last_db,
+     *db_table[L7_MAX_NUM_DBS+1]; /* Database for each l7_id, NULL if
+                                * unused. Read with atomic loads so
+                                * l7p_set_database needs no lock.      */
 
    l7_push_id_database
      *first_push_db,           /* For linked list of push dbs.         */
      *last_push_db;
 
+   l7_batch
+     *first_batch;             /* Cached L7_Update_Batch graphs.       */
+
    int
-     data_check_len,           /* Number of bytes in array data_check. */
+     update_check_interval,    /* L7_Update runs L7_Update_Check every
+                                * this many updates, 0 for never
+                                * (environment L7_UPDATE_CHECK).       */
+     compact_level,            /* enum L7_CompactLevel applied at the
+                                * end of every setup (environment
+                                * L7_COMPACT).                         */
      initialized,              /* 1 if L7 initialized, else 0          */
      initialized_mpi,          /* 1 if L7 initialized MPI, else 0      */
      mpi_initialized,          /* 1 if L7_init sets use mpi, else 0    */
      num_dbs,                  /* Number of databases allocated.       */
      num_push_dbs,             /* Number of push databases allocated.  */
      numpes,                   /* Number of processors in mpi job      */
-     penum;                    /* Process id for currently set db.     */
+     penum,                    /* Rank in MPI_COMM_WORLD; set once by
+                                * L7_Init and read-only afterwards.    */
+     thread_level,             /* MPI thread support provided.         */
+     mem_policy,               /* enum L7_MemPolicy bits requested for
+                                * L7_Mem_Alloc (L7_MEM_POLICY).        */
+     mem_policy_in_effect,     /* Bits the last L7_Mem_Alloc applied.  */
+     update_method,            /* Defaults for new databases, from     */
+     send_order,               /* L7_UPDATE_METHOD, L7_SEND_ORDER and  */
+     max_in_flight,            /* L7_MAX_IN_FLIGHT.                    */
+     gid_map,                  /* 1 if setup builds the global id map
+                                * (environment L7_GID_MAP).            */
+     sum_mode,                 /* enum L7_SumMode of L7_Sum on doubles
+                                * (environment L7_SUM_MODE).           */
+     hier_coll_max,            /* Largest message in bytes sent through
+                                * the node-hierarchical collectives, 0
+                                * for none (environment
+                                * L7_COLL_HIER_MAX).                   */
+     db_generation;            /* Last database generation issued.     */
+
+   L7_Allocator
+     allocator;                /* For databases created from now on
+                                * (L7_Set_Allocator, L7_ALLOCATOR).    */
 
 #ifdef HAVE_QUO
    QUO_SubComm subComm;
 #endif
 
-   void
-     *data_check;              /* Workspace for use in l7_update_check */
-
    FILE
      *assert_out_file,         /* output file for MAYAP_ASSERT.
                                 * if NULL, default is stderr           */
@@ -293,7 +601,44 @@ typedef struct
 #endif
 
    int
-     io_profiling_level;       /* L7_IO_PROF_OFF / SIMPLE / VERBOSE    */
+     io_profiling_level,       /* L7_IO_PROF_OFF / SIMPLE / VERBOSE    */
+     next_file_id;             /* Handle of the next L7_File_Open.     */
+   long long
+     io_buffer_size;           /* Aggregation buffer per file, bytes
+                                * (environment L7_IO_BUFFER).          */
+   struct l7_file_record
+     *first_file;              /* Open files.                          */
+
+#ifdef HAVE_MPI
+   struct L7_Stats
+     stats_freed;              /* Totals from databases already freed. */
+
+   struct l7_request
+     requests[L7_MAX_NUM_REQUESTS+1]; /* Nonblocking operations, by
+                                * handle; 0 is L7_REQUEST_NULL.        */
+   int
+     num_requests_active,      /* Requests not yet FREE, atomic.       */
+     max_request;              /* Highest handle handed out so far.    */
+
+   MPI_Op
+     reduce_multi_op;          /* L7_Reduce_Multi combiner and the     */
+   MPI_Datatype
+     reduce_multi_type;        /* slot type it works on, or NULL.      */
+   MPI_Op
+     repro_sum_op;             /* Reproducible sum merge op and the    */
+   MPI_Datatype
+     repro_sum_type;           /* partial sum type, or NULL.           */
+   int
+     hier_keyval;              /* Attribute holding struct l7p_hier.   */
+   struct l7p_hier
+     *first_hier;              /* Every communicator holding one.      */
+   MPI_Op
+     loc_op;                   /* Location reduction op, its datatype  */
+   MPI_Datatype
+     loc_type;                 /* and the offset cache keyval.         */
+   int
+     loc_keyval;
+#endif
 } l7_globals;
 
 L7_EXTERN l7_globals l7;
@@ -336,9 +681,17 @@ struct verbose_fd {
    struct timespec valid_end;
 };
 
+/* Which member of union l7_file_handler a file record uses. */
+#define L7_FILE_FD      0
+#define L7_FILE_STREAM  1
+#define L7_FILE_MPI     2
+
 union l7_file_handler {
    int  fd;
    FILE *fstream;
+#ifdef HAVE_MPI
+   MPI_File mpi_fh;             /* L7_ALL_PROCS, L7_BUFFERED_ALL_PROCS */
+#endif
 };
 
 struct l7_file_record {
@@ -348,6 +701,21 @@ struct l7_file_record {
    enum L7_DiskPatternType  l7_disk_pattern;
    char                     *file_name;
    union l7_file_handler    file_handler;
+   int                      handler;      /* L7_FILE_FD, _STREAM or _MPI. */
+   int                      is_open;      /* This process holds the file. */
+   /* L7_BUFFERED_ALL_PROCS stages writes here and writes them with one
+    * collective call when the buffer fills, before a read or seek back,
+    * and at close. */
+   char                     *buffer;
+   long long                buffer_used;
+   long long                stage_end;    /* End of the last staged write in
+                                           * the file, same on every pe. */
+   long long                stage_max;    /* Bound on buffer_used of every
+                                           * pe, same on every pe.       */
+   long long                *seg_offset;  /* File offset and length of   */
+   int                      *seg_length;  /* each staged piece.          */
+   int                      num_segs;
+   int                      max_segs;
 };
 
 
@@ -363,10 +731,283 @@ int l7p_sizeof (
       const enum L7_Datatype  l7_datatype
       );
 
+void l7p_mem_init(void);
+
+void l7p_comm_size_rank(
+      MPI_Comm                comm,
+      int                     *numpes,
+      int                     *penum
+      );
+
 l7_id_database *l7p_set_database(
       const int l7_id
       );
 
+l7_id_database *l7p_database_new(void);
+
+int l7p_database_comm_create(
+      l7_id_database *l7_id_db
+      );
+
+void l7p_database_comm_free(
+      l7_id_database *l7_id_db
+      );
+
+void l7p_database_types_create(
+      l7_id_database *l7_id_db
+      );
+
+void l7p_database_types_free(
+      l7_id_database *l7_id_db
+      );
+
+void l7p_database_compact(
+      l7_id_database *l7_id_db,
+      int            level
+      );
+
+int l7p_database_schedule_create(
+      l7_id_database *l7_id_db
+      );
+
+void l7p_database_schedule_free(
+      l7_id_database *l7_id_db
+      );
+
+int l7p_update_p2p(
+      l7_id_database            *l7_id_db,
+      void                      *data_buffer,
+      const int                 sizeof_type,
+      struct l7_update_datatype *update_datatype
+      );
+
+size_t l7p_database_memory_usage(
+      const l7_id_database *l7_id_db
+      );
+
+void l7p_batch_free_id(
+      const int              l7_id
+      );
+
+void l7p_batch_free_all(void);
+
+int l7p_needed_normalize(
+      l7_id_database  *l7_id_db,
+      const int       num_indices_needed,
+      int             *num_unique
+      );
+
+void l7p_ghost_dups_fill(
+      const l7_id_database  *l7_id_db,
+      void                  *data_buffer,
+      const int             sizeof_type
+      );
+
+int l7p_gid_map_build(
+      l7_id_database  *l7_id_db,
+      const int       *owned_offsets,
+      const int       *ghost_gids
+      );
+
+void l7p_gid_map_free(
+      l7_id_database  *l7_id_db
+      );
+
+#ifdef HAVE_OPENCL
+int l7p_dev_pool_reserve(
+      l7_id_database  *l7_id_db,
+      const size_t    elsize
+      );
+
+void l7p_dev_pool_free(
+      l7_id_database  *l7_id_db
+      );
+#endif
+
+void l7p_allocator_create(
+      l7p_allocator   *allocator
+      );
+
+void *l7p_alloc(
+      l7p_allocator   *allocator,
+      const size_t    nbytes
+      );
+
+void l7p_release(
+      l7p_allocator   *allocator,
+      void            *ptr
+      );
+
+void l7p_allocator_reset(
+      l7p_allocator   *allocator
+      );
+
+void l7p_allocator_destroy(
+      l7p_allocator   *allocator
+      );
+
+void l7p_allocator_default(
+      L7_Allocator    *ops
+      );
+
+void l7p_database_arrays_reset(
+      l7_id_database  *l7_id_db
+      );
+
+void l7p_repro_sum_init(void);
+
+void l7p_repro_sum_free(void);
+
+void l7p_repro_sum(
+      const double            *input,
+      const int               count,
+      double                  *output,
+      MPI_Comm                comm
+      );
+
+int l7p_allreduce(
+      const void              *sendbuf,
+      void                    *recvbuf,
+      const int               count,
+      MPI_Datatype            mpi_type,
+      MPI_Op                  op,
+      MPI_Comm                comm
+      );
+
+int l7p_bcast(
+      void                    *buffer,
+      const int               count,
+      MPI_Datatype            mpi_type,
+      const int               root,
+      MPI_Comm                comm
+      );
+
+void l7p_hier_coll_free(void);
+
+int l7p_local_reduce(
+      const void              *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      const enum L7_ReduceOp  op,
+      void                    *result
+      );
+
+int l7p_local_any(
+      const void              *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      void                    *result
+      );
+
+int l7p_local_all(
+      const void              *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      int                     *result
+      );
+
+int l7p_loc_scan(
+      const void              *input,
+      const int               count,
+      const enum L7_Datatype  l7_datatype,
+      const enum L7_ReduceOp  op,
+      struct l7p_loc          *loc
+      );
+
+void l7p_loc_store(
+      const struct l7p_loc    *loc,
+      const enum L7_Datatype  l7_datatype,
+      void                    *val
+      );
+
+void l7p_loc_reduce(
+      struct l7p_loc          *loc,
+      const int               count,
+      MPI_Comm                comm
+      );
+
+void l7p_loc_init(void);
+
+void l7p_loc_free(void);
+
+void l7p_reduce_multi_init(void);
+
+void l7p_reduce_multi_free(void);
+
+int l7p_reduce_multi_post(
+      struct L7_Reduction     *reductions,
+      const int               num_reductions,
+      MPI_Comm                comm,
+      int                     *request
+      );
+
+void l7p_reduce_multi_finish(
+      struct l7_request       *req
+      );
+
+int l7p_request_new(void);
+
+void l7p_request_post(
+      const int request
+      );
+
+void l7p_request_release(
+      const int request
+      );
+
+void l7p_progress_start(void);
+
+void l7p_progress_stop(void);
+
+/*
+ * L7 statistics private prototypes
+ */
+int l7p_stats_nbr_create(
+      struct L7_Stats   *stats,
+      long long         **nbr_bytes_sent,
+      long long         **nbr_bytes_recvd,
+      const int         num_sends,
+      const int         num_recvs
+      );
+
+void l7p_stats_nbr_free(
+      struct L7_Stats   *stats,
+      long long         **nbr_bytes_sent,
+      long long         **nbr_bytes_recvd
+      );
+
+void l7p_stats_record(
+      struct L7_Stats   *stats,
+      long long         *nbr_bytes_sent,
+      long long         *nbr_bytes_recvd,
+      const int         *send_counts,
+      const int         *recv_counts,
+      const int         sizeof_type,
+      const double      elapsed
+      );
+
+void l7p_stats_accumulate(
+      struct L7_Stats         *total,
+      const struct L7_Stats   *stats
+      );
+
+/*
+ * CRC32C checksum private prototypes
+ */
+uint32_t l7p_crc32c(
+      uint32_t          crc,
+      const void        *buf,
+      size_t            nbytes
+      );
+
+uint32_t l7p_crc32c_gather(
+      uint32_t          crc,
+      const void        *base,
+      const int         *indices,
+      const int         count,
+      const int         sizeof_type
+      );
+
 /*
  * L7 Update type private prototypes
  */
@@ -0,0 +1,213 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <string.h>
+#include "l7.h"
+#include "l7p.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define L7_HAVE_CRC32C_HW 1
+#endif
+
+/*
+ * CRC32C (Castagnoli) checksums used to verify ghost data in
+ * L7_Update_Check. On x86_64 the SSE4.2 crc32 instruction is used when
+ * the processor supports it (checked once at run time), otherwise a
+ * byte-wise table lookup. Both give identical results, so processes
+ * using different paths still agree. Like zlib's crc32, pass 0 to
+ * start and the previous result to continue a running checksum.
+ */
+
+#define L7_CRC32C_POLY 0x82F63B78u /* Reflected Castagnoli polynomial */
+
+/*
+ * The table and the hardware probe are set up on first use. Threads may
+ * race to do so; both produce identical results, and the ready flags
+ * are published with release stores so no thread reads a partial table.
+ */
+
+static uint32_t crc32c_table[256];
+static int      crc32c_table_ready = 0;
+
+static void crc32c_table_init(void)
+{
+   uint32_t crc;
+   int i, k;
+
+   for (i=0; i<256; i++){
+      crc = (uint32_t)i;
+      for (k=0; k<8; k++)
+         crc = (crc & 1) ? (crc >> 1) ^ L7_CRC32C_POLY : crc >> 1;
+      crc32c_table[i] = crc;
+   }
+   __atomic_store_n(&crc32c_table_ready, 1, __ATOMIC_RELEASE);
+}
+
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t nbytes)
+{
+   if (! __atomic_load_n(&crc32c_table_ready, __ATOMIC_ACQUIRE)) crc32c_table_init();
+
+   while (nbytes--)
+      crc = crc32c_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+   return(crc);
+}
+
+#ifdef L7_HAVE_CRC32C_HW
+
+static int crc32c_hw_available(void)
+{
+   static int have_hw = -1;
+   int hw = __atomic_load_n(&have_hw, __ATOMIC_RELAXED);
+
+   if (hw < 0){
+      __builtin_cpu_init();
+      hw = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+      __atomic_store_n(&have_hw, hw, __ATOMIC_RELAXED);
+   }
+   return(hw);
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t nbytes)
+{
+   uint64_t crc64 = crc, word;
+
+   for (; nbytes >= 8; nbytes -= 8, p += 8){
+      memcpy(&word, p, 8);
+      crc64 = _mm_crc32_u64(crc64, word);
+   }
+   crc = (uint32_t)crc64;
+   for (; nbytes > 0; nbytes--, p++)
+      crc = _mm_crc32_u8(crc, *p);
+   return(crc);
+}
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw_gather(uint32_t crc, const unsigned char *base,
+      const int *indices, int count, int sizeof_type)
+{
+   uint64_t crc64 = crc, u64;
+   uint32_t u32;
+   uint16_t u16;
+   int i;
+
+   switch (sizeof_type){
+      case 8:
+         for (i=0; i<count; i++){
+            memcpy(&u64, base + (size_t)indices[i]*8, 8);
+            crc64 = _mm_crc32_u64(crc64, u64);
+         }
+         crc = (uint32_t)crc64;
+         break;
+      case 4:
+         for (i=0; i<count; i++){
+            memcpy(&u32, base + (size_t)indices[i]*4, 4);
+            crc = _mm_crc32_u32(crc, u32);
+         }
+         break;
+      case 2:
+         for (i=0; i<count; i++){
+            memcpy(&u16, base + (size_t)indices[i]*2, 2);
+            crc = _mm_crc32_u16(crc, u16);
+         }
+         break;
+      default:
+         for (i=0; i<count; i++)
+            crc = crc32c_hw(crc, base + (size_t)indices[i]*sizeof_type, (size_t)sizeof_type);
+         break;
+   }
+   return(crc);
+}
+
+#endif /* L7_HAVE_CRC32C_HW */
+
+uint32_t l7p_crc32c(
+      uint32_t    crc,
+      const void  *buf,
+      size_t      nbytes
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Continue CRC32C checksum crc over nbytes contiguous bytes at buf.
+    */
+
+   crc = ~crc;
+#ifdef L7_HAVE_CRC32C_HW
+   if (crc32c_hw_available())
+      return(~crc32c_hw(crc, (const unsigned char *)buf, nbytes));
+#endif
+   return(~crc32c_sw(crc, (const unsigned char *)buf, nbytes));
+}
+
+uint32_t l7p_crc32c_gather(
+      uint32_t    crc,
+      const void  *base,
+      const int   *indices,
+      const int   count,
+      const int   sizeof_type
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Continue CRC32C checksum crc over the elements base[indices[0..count-1]]
+    * of sizeof_type bytes each. The result equals l7p_crc32c over the
+    * same elements packed contiguously, which is what the receiving
+    * process checksums in its ghost region.
+    */
+
+   const unsigned char
+     *p = (const unsigned char *)base;
+   int
+     i;
+
+   crc = ~crc;
+#ifdef L7_HAVE_CRC32C_HW
+   if (crc32c_hw_available())
+      return(~crc32c_hw_gather(crc, p, indices, count, sizeof_type));
+#endif
+   for (i=0; i<count; i++)
+      crc = crc32c_sw(crc, p + (size_t)indices[i]*sizeof_type, (size_t)sizeof_type);
+   return(~crc);
+}
@@ -0,0 +1,512 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "l7.h"
+#include "l7p.h"
+
+#include <stdlib.h>
+
+#define L7_LOCATION "L7P_DATABASE"
+
+#if defined HAVE_MPI
+
+l7_id_database *l7p_database_new(void)
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_database_new allocates a zeroed update database, assigns it the
+    * next l7_id, appends it to the linked list of databases and
+    * publishes it in l7.db_table for l7p_set_database.
+    *
+    * Return value
+    * ============
+    * The new database, or NULL if the limit on databases is reached or
+    * memory runs out.
+    *
+    */
+
+   l7_id_database
+     *l7_id_db;
+   int
+     l7_id;
+
+   if (l7.num_dbs >= L7_MAX_NUM_DBS){
+      L7_PRINT(l7.num_dbs < L7_MAX_NUM_DBS,
+            "Too many L7 databases allocataed", -1);
+      return(NULL);
+   }
+
+   l7_id_db = (l7_id_database*)calloc(1L, sizeof(l7_id_database) );
+   if (l7_id_db == NULL){
+      L7_PRINT(l7_id_db != NULL, "Failed to allocate new database", -1);
+      return(NULL);
+   }
+
+   /*
+    * Handles follow the last database as before; once they reach the
+    * end of l7.db_table, the lowest free slot is reused.
+    */
+
+   l7_id = l7.last_db ? l7.last_db->l7_id + 1 : 1;
+   if (l7_id > L7_MAX_NUM_DBS || l7.db_table[l7_id] != NULL){
+      for (l7_id = 1; l7.db_table[l7_id] != NULL; l7_id++);
+   }
+
+   if ( !(l7.first_db) ){
+      l7.first_db = l7_id_db;
+      l7.last_db  = l7_id_db;
+      l7_id_db->next_db = NULL; /* Paranoia */
+
+      l7.num_dbs = 1;
+   }
+   else{
+      /*
+       * Reset links.
+       */
+
+      l7.last_db->next_db = l7_id_db;
+      l7.last_db = l7_id_db;
+
+      l7.num_dbs++;
+   }
+
+   l7_id_db->l7_id          = l7_id;
+   l7_id_db->comm           = MPI_COMM_WORLD;
+   l7_id_db->nbr_state.comm = MPI_COMM_NULL;
+   l7_id_db->update_method  = l7.update_method;
+   l7_id_db->send_order     = l7.send_order;
+   l7_id_db->max_in_flight  = l7.max_in_flight;
+
+   l7p_allocator_create(&l7_id_db->allocator);
+   l7_id_db->nbr_state.allocator = &l7_id_db->allocator;
+
+   __atomic_store_n(&l7.db_table[l7_id], l7_id_db, __ATOMIC_RELEASE);
+
+   return(l7_id_db);
+
+} /* End l7p_database_new */
+
+int l7p_database_comm_create(
+      l7_id_database *l7_id_db
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_database_comm_create builds everything an update needs once
+    * send_to/send_counts, recv_from/recv_counts and indices_local_to_send
+    * are known: the distributed graph communicator, the neighbor
+    * collective state, the per-neighbor statistics and the update
+    * datatypes for every L7 datatype size.
+    *
+    * Notes
+    * =====
+    * 1) Collective over l7_id_db->comm (MPI_Dist_graph_create_adjacent);
+    *    send_to and recv_from are ranks in that communicator.
+    *
+    */
+
+   int
+     ierr,
+     num_recvs,
+     num_sends;
+
+   /* Now that we have all of the information on our communiation partners
+    * and which indicies needto be communicated where, setup a neighbor collective
+    * to do all the acutal work. Start using the graph information to create a
+    * communicator with a distributed graph topology for neighbor communication */
+   num_sends = l7_id_db->num_sends;
+   num_recvs = l7_id_db->num_recvs;
+
+   ierr = MPI_Dist_graph_create_adjacent(l7_id_db->comm,
+         num_recvs, l7_id_db->recv_from, MPI_UNWEIGHTED,
+         num_sends, l7_id_db->send_to, MPI_UNWEIGHTED,
+         MPI_INFO_NULL, 0, &l7_id_db->nbr_state.comm);
+
+   if (ierr != MPI_SUCCESS) {
+      ierr = -1;
+      L7_ASSERT(ierr == MPI_SUCCESS, "Failed to create graph communicator.", ierr)
+   }
+
+   /* The sender/receiver order used by MPI neighbor collectives is the same as
+    * the order in the send_to/recv_from list used to create the graph; MPI guarantees
+    * that this is the case if the graph was created with graph_create_adjacent.
+    *
+    * We cannot know the offset in bytes here, which is what the neighbor
+    * collectives want, as it depends on the type we're sending/receiving
+    * and we don't know that at setup. As a result we use an offset of 0
+    * and count of 1 and let the derived datatypes take care of where in
+    * the array the data goes to and comes from. */
+
+   /* Create update_datatypes for all the L7 datatype sizes */
+   ierr = l7p_nbr_state_create(&l7_id_db->nbr_state, num_recvs, num_sends);
+   L7_ASSERT(ierr == L7_OK, "Could not create neighbor state", ierr);
+
+   ierr = l7p_stats_nbr_create(&l7_id_db->stats, &l7_id_db->nbr_bytes_sent,
+         &l7_id_db->nbr_bytes_recvd, num_sends, num_recvs);
+   L7_ASSERT(ierr == L7_OK, "Could not create statistics", ierr);
+
+   l7p_database_types_create(l7_id_db);
+
+   l7_id_db->generation = __atomic_add_fetch(&l7.db_generation, 1, __ATOMIC_RELAXED);
+
+   return(L7_OK);
+
+} /* End l7p_database_comm_create */
+
+void l7p_database_types_create(
+      l7_id_database *l7_id_db
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Build the update datatypes for every L7 datatype size from the
+    * current recv_counts and indices_local_to_send, and the
+    * point-to-point schedule that goes with them.
+    */
+
+   L7P_Update_Type_Create(l7_id_db, L7_CHAR, &l7_id_db->nbr_state.update_datatypes[1]);
+   L7P_Update_Type_Create(l7_id_db, L7_SHORT, &l7_id_db->nbr_state.update_datatypes[2]);
+   L7P_Update_Type_Create(l7_id_db, L7_INT, &l7_id_db->nbr_state.update_datatypes[4]);
+   L7P_Update_Type_Create(l7_id_db, L7_DOUBLE, &l7_id_db->nbr_state.update_datatypes[8]);
+
+   l7p_database_schedule_create(l7_id_db);
+
+} /* End l7p_database_types_create */
+
+void l7p_database_types_free(
+      l7_id_database *l7_id_db
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Release the update datatypes and schedule built by
+    * l7p_database_types_create.
+    */
+
+   L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[1]);
+   L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[2]);
+   L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[4]);
+   L7P_Update_Type_Free(l7_id_db, &l7_id_db->nbr_state.update_datatypes[8]);
+
+   l7p_database_schedule_free(l7_id_db);
+
+} /* End l7p_database_types_free */
+
+void l7p_database_comm_free(
+      l7_id_database *l7_id_db
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Release the graph communicator, neighbor state and update datatypes
+    * created by l7p_database_comm_create, ahead of a new setup of the
+    * database or its destruction.
+    */
+
+   l7p_nbr_state_free(&l7_id_db->nbr_state);
+   l7p_database_types_free(l7_id_db);
+
+} /* End l7p_database_comm_free */
+
+void l7p_database_compact(
+      l7_id_database *l7_id_db,
+      int            level
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Release database state that updates no longer read once the
+    * communicator and datatypes exist (see enum L7_CompactLevel), then
+    * record the memory the database still holds in its statistics.
+    *
+    * Notes
+    * =====
+    * 1) A later L7_Setup on the same l7_id reallocates whatever it needs.
+    * 2) Counts (num_indices_needed, send_counts, recv_counts, ...) and
+    *    ghost_offsets are kept; statistics, checks and device updates
+    *    use them.
+    * 3) The default arena returns large arrays at once; small ones are
+    *    reused by the next setup.
+    *
+    */
+
+   if (level >= L7_COMPACT_SETUP){
+
+      /* Setup input and handshake state. */
+
+      if (l7_id_db->indices_needed){
+         l7p_release(&l7_id_db->allocator, l7_id_db->indices_needed);
+         l7_id_db->indices_needed = NULL;
+      }
+      l7_id_db->indices_needed_len = 0;
+
+      if (l7_id_db->indices_global_to_send){
+         l7p_release(&l7_id_db->allocator, l7_id_db->indices_global_to_send);
+         l7_id_db->indices_global_to_send = NULL;
+      }
+
+      if (l7_id_db->starting_indices){
+         l7p_release(&l7_id_db->allocator, l7_id_db->starting_indices);
+         l7_id_db->starting_indices = NULL;
+      }
+
+      if (l7_id_db->mpi_request){
+         l7p_release(&l7_id_db->allocator, l7_id_db->mpi_request);
+         l7_id_db->mpi_request = NULL;
+      }
+      l7_id_db->mpi_request_len = 0;
+
+      if (l7_id_db->mpi_status){
+         l7p_release(&l7_id_db->allocator, l7_id_db->mpi_status);
+         l7_id_db->mpi_status = NULL;
+      }
+      l7_id_db->mpi_status_len = 0;
+
+#ifdef HAVE_OPENCL
+      /* Only the device copy is read by L7_Dev_Update. */
+      if (l7_id_db->indices_have){
+         free(l7_id_db->indices_have);
+         l7_id_db->indices_have = NULL;
+      }
+#endif
+   }
+
+   if (level >= L7_COMPACT_ALL){
+
+      /* The send datatypes hold their own copy of these. */
+
+      if (l7_id_db->indices_local_to_send){
+         l7p_release(&l7_id_db->allocator, l7_id_db->indices_local_to_send);
+         l7_id_db->indices_local_to_send = NULL;
+      }
+      l7_id_db->indices_to_send_len = 0;
+
+      /* Point-to-point sends now go out through the send datatypes. */
+
+      L7_Mem_Release(l7_id_db->pack_buffer);
+      l7_id_db->pack_buffer = NULL;
+      l7_id_db->pack_buffer_len = 0;
+   }
+
+   l7_id_db->stats.memory_bytes = (long long)l7p_database_memory_usage(l7_id_db);
+
+} /* End l7p_database_compact */
+
+void l7p_database_arrays_reset(
+      l7_id_database *l7_id_db
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Return every array a setup took from the database allocator, after
+    * l7p_database_comm_free, so a new setup starts from an empty (but
+    * not shrunk) arena.
+    */
+
+   l7p_allocator
+     *allocator = &l7_id_db->allocator;
+
+   l7p_release(allocator, l7_id_db->indices_needed);
+   l7p_release(allocator, l7_id_db->recv_from);
+   l7p_release(allocator, l7_id_db->recv_counts);
+   l7p_release(allocator, l7_id_db->send_to);
+   l7p_release(allocator, l7_id_db->send_counts);
+   l7p_release(allocator, l7_id_db->indices_global_to_send);
+   l7p_release(allocator, l7_id_db->indices_local_to_send);
+   l7p_release(allocator, l7_id_db->starting_indices);
+   l7p_release(allocator, l7_id_db->ghost_offsets);
+   l7p_release(allocator, l7_id_db->ghost_dup_dst);
+   l7p_release(allocator, l7_id_db->ghost_dup_src);
+   l7p_release(allocator, l7_id_db->mpi_request);
+   l7p_release(allocator, l7_id_db->mpi_status);
+
+   l7_id_db->indices_needed         = NULL;
+   l7_id_db->recv_from              = NULL;
+   l7_id_db->recv_counts            = NULL;
+   l7_id_db->send_to                = NULL;
+   l7_id_db->send_counts            = NULL;
+   l7_id_db->indices_global_to_send = NULL;
+   l7_id_db->indices_local_to_send  = NULL;
+   l7_id_db->starting_indices       = NULL;
+   l7_id_db->ghost_offsets          = NULL;
+   l7_id_db->ghost_dup_dst          = NULL;
+   l7_id_db->ghost_dup_src          = NULL;
+   l7_id_db->mpi_request            = NULL;
+   l7_id_db->mpi_status             = NULL;
+
+   l7_id_db->indices_needed_len  = 0;
+   l7_id_db->recv_from_len       = 0;
+   l7_id_db->recv_counts_len     = 0;
+   l7_id_db->send_to_len         = 0;
+   l7_id_db->send_counts_len     = 0;
+   l7_id_db->indices_to_send_len = 0;
+   l7_id_db->mpi_request_len     = 0;
+   l7_id_db->mpi_status_len      = 0;
+   l7_id_db->num_ghost_dups      = 0;
+
+   l7p_allocator_reset(allocator);
+
+} /* End l7p_database_arrays_reset */
+
+static size_t type_memory_usage(MPI_Datatype type)
+{
+   /* Approximate by the arguments the type was constructed from. */
+
+   int
+     num_integers,
+     num_addresses,
+     num_datatypes,
+     combiner;
+
+   if (type == MPI_DATATYPE_NULL)
+      return(0);
+
+   if (MPI_Type_get_envelope(type, &num_integers, &num_addresses,
+         &num_datatypes, &combiner) != MPI_SUCCESS)
+      return(0);
+
+   if (combiner == MPI_COMBINER_NAMED)
+      return(0);
+
+   return((size_t)num_integers * sizeof(int) +
+          (size_t)num_addresses * sizeof(MPI_Aint) +
+          (size_t)num_datatypes * sizeof(MPI_Datatype));
+}
+
+size_t l7p_database_memory_usage(
+      const l7_id_database *l7_id_db
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Bytes of host memory held by an update database: the database
+    * itself, its index and neighbor arrays, request space, neighbor
+    * collective state and statistics, plus an estimate for the update
+    * datatypes. Buffers shared by all databases are not included.
+    *
+    */
+
+   const struct l7_update_datatype
+     *types;
+
+   size_t
+     bytes;
+
+   int
+     i,
+     j,
+     num_neighbors;
+
+   num_neighbors = l7_id_db->num_sends + l7_id_db->num_recvs;
+
+   bytes = sizeof(l7_id_database);
+
+   if (l7_id_db->indices_needed)
+      bytes += (size_t)l7_id_db->indices_needed_len * sizeof(int);
+   if (l7_id_db->indices_global_to_send)
+      bytes += (size_t)l7_id_db->indices_to_send_len * sizeof(int);
+   if (l7_id_db->indices_local_to_send)
+      bytes += (size_t)l7_id_db->indices_to_send_len * sizeof(int);
+   if (l7_id_db->starting_indices)
+      bytes += (size_t)(l7_id_db->numpes + 1) * sizeof(int);
+   if (l7_id_db->ghost_offsets)
+      bytes += (size_t)l7_id_db->num_indices_needed * sizeof(int);
+   if (l7_id_db->ghost_dup_dst)
+      bytes += (size_t)l7_id_db->num_ghost_dups * 2 * sizeof(int);
+   if (l7_id_db->gid_runs)
+      bytes += (size_t)(l7_id_db->num_gid_runs + 1) * sizeof(struct l7_gid_run) +
+               (size_t)l7_id_db->gid_hash_size * 2 * sizeof(int);
+
+   bytes += (size_t)(l7_id_db->recv_from_len + l7_id_db->recv_counts_len +
+                     l7_id_db->send_to_len + l7_id_db->send_counts_len) * sizeof(int);
+
+   if (l7_id_db->mpi_request)
+      bytes += (size_t)l7_id_db->mpi_request_len * sizeof(MPI_Request);
+   if (l7_id_db->mpi_status)
+      bytes += (size_t)l7_id_db->mpi_status_len * sizeof(MPI_Status);
+   if (l7_id_db->check_sums)
+      bytes += (size_t)l7_id_db->check_sums_len * sizeof(uint32_t);
+
+#ifdef HAVE_OPENCL
+   if (l7_id_db->indices_have)
+      bytes += (size_t)l7_id_db->num_indices_have * sizeof(int);
+#endif
+
+   /* Neighbor collective counts/offsets and per-neighbor statistics. */
+   if (l7_id_db->nbr_state.mpi_send_counts)
+      bytes += (size_t)num_neighbors * (sizeof(int) + sizeof(long));
+   if (l7_id_db->nbr_bytes_sent)
+      bytes += (size_t)num_neighbors * sizeof(long long);
+
+   /* Point-to-point update schedule. */
+   if (l7_id_db->send_schedule)
+      bytes += (size_t)l7_id_db->num_sends * 2 * sizeof(int);
+   if (l7_id_db->p2p_requests)
+      bytes += (size_t)num_neighbors * sizeof(MPI_Request);
+   bytes += l7_id_db->pack_buffer_len;
+
+   /* Update datatypes for each L7 datatype size. */
+   for (i=0; i<9; i++){
+      types = &l7_id_db->nbr_state.update_datatypes[i];
+      if (types->in_types){
+         bytes += (size_t)l7_id_db->num_recvs * sizeof(MPI_Datatype);
+         for (j=0; j<l7_id_db->num_recvs; j++)
+            bytes += type_memory_usage(types->in_types[j]);
+      }
+      if (types->out_types){
+         bytes += (size_t)l7_id_db->num_sends * sizeof(MPI_Datatype);
+         for (j=0; j<l7_id_db->num_sends; j++)
+            bytes += type_memory_usage(types->out_types[j]);
+      }
+   }
+
+   return(bytes);
+
+} /* End l7p_database_memory_usage */
+
+#endif /* HAVE_MPI */
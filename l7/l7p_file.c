@@ -0,0 +1,358 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L /* fseeko, ftello */
+#endif
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "l7.h"
+#include "l7p.h"
+
+#define L7_LOCATION "L7P_FILE"
+
+/*
+ * Bookkeeping for L7_File_*: the list of open files and the low level
+ * POSIX transfers and positioning.
+ *
+ * Every process keeps a record for every open file, whether or not it
+ * holds the file itself, and handles are issued in the same order
+ * everywhere because L7_File_Open is collective.
+ */
+
+int l7p_file_record_new(
+      const char  *fname,
+      const int   disk_pattern,
+      const union l7_file_handler new_file_handler
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_file_record_new adds an open file to l7.first_file.
+    *
+    * Arguments
+    * =========
+    * fname              (input) const char*
+    *                    File name, copied.
+    * disk_pattern       (input) const int
+    *                    enum L7_DiskPatternType the file was opened with.
+    * new_file_handler   (input) const union l7_file_handler
+    *                    Descriptor, stream or MPI file handle.
+    *
+    * Return value
+    * ============
+    * The new file handle, or -1 if out of memory.
+    *
+    */
+
+   struct l7_file_record
+     *rec;
+
+   rec = (struct l7_file_record *)calloc(1, sizeof(struct l7_file_record));
+   if (rec == NULL)
+      return(-1);
+
+   rec->file_name = (char *)malloc(strlen(fname)+1);
+   if (rec->file_name == NULL){
+      free(rec);
+      return(-1);
+   }
+   strcpy(rec->file_name, fname);
+
+   if (l7.next_file_id <= 0)
+      l7.next_file_id = 1;
+   rec->file_id         = l7.next_file_id++;
+   rec->l7_disk_pattern = (enum L7_DiskPatternType)disk_pattern;
+   rec->file_handler    = new_file_handler;
+
+   rec->next = l7.first_file;
+   if (l7.first_file != NULL)
+      l7.first_file->prev = rec;
+   l7.first_file = rec;
+
+   return(rec->file_id);
+
+} /* End l7p_file_record_new */
+
+struct l7_file_record* l7p_file_record_get(
+      const int file_id
+      )
+{
+   /*
+    * Return the record of an open file, or NULL.
+    */
+
+   struct l7_file_record
+     *rec;
+
+   for (rec = l7.first_file; rec != NULL; rec = rec->next){
+      if (rec->file_id == file_id)
+         return(rec);
+   }
+
+   return(NULL);
+
+} /* End l7p_file_record_get */
+
+void l7p_file_record_delete(
+      const int file_id
+      )
+{
+   /*
+    * Unlink a record and free it with its staging buffer. The file
+    * itself must already be closed.
+    */
+
+   struct l7_file_record
+     *rec;
+
+   rec = l7p_file_record_get(file_id);
+   if (rec == NULL)
+      return;
+
+   if (rec->prev != NULL)
+      rec->prev->next = rec->next;
+   else
+      l7.first_file = rec->next;
+   if (rec->next != NULL)
+      rec->next->prev = rec->prev;
+
+   free(rec->buffer);
+   free(rec->seg_offset);
+   free(rec->seg_length);
+   free(rec->file_name);
+   free(rec);
+
+} /* End l7p_file_record_delete */
+
+void l7p_file_shutdown(void)
+{
+   /*
+    * Close whatever the application left open; called by L7_Terminate
+    * on every process, so the collective closes match up.
+    */
+
+   while (l7.first_file != NULL)
+      L7_File_Close(l7.first_file->file_id);
+
+} /* End l7p_file_shutdown */
+
+void l7p_file_record_printall(void)
+{
+   /*
+    * Debug listing of the open files on this process.
+    */
+
+   struct l7_file_record
+     *rec;
+
+   for (rec = l7.first_file; rec != NULL; rec = rec->next){
+      printf("[pe %d] L7 file %d %s pattern %d%s staged %lld bytes in %d pieces\n",
+            l7.penum, rec->file_id, rec->file_name, (int)rec->l7_disk_pattern,
+            rec->is_open ? "" : " (not held)", rec->buffer_used, rec->num_segs);
+   }
+
+} /* End l7p_file_record_printall */
+
+long long l7p_readfd(
+      const int  fd,
+      void       *buf,
+      const      size_t num
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_readfd reads num bytes from the current position of fd,
+    * retrying short and interrupted reads.
+    *
+    * Return value
+    * ============
+    * Bytes read, short only at end of file, or -1 on error.
+    *
+    */
+
+   char
+     *p = (char *)buf;
+   size_t
+     done = 0;
+   ssize_t
+     n;
+
+   while (done < num){
+      n = read(fd, p + done, num - done);
+      if (n < 0){
+         if (errno == EINTR)
+            continue;
+         return(-1);
+      }
+      if (n == 0)
+         break;
+      done += (size_t)n;
+   }
+
+   return((long long)done);
+
+} /* End l7p_readfd */
+
+long long l7p_writefd(
+      const int    fd,
+      void         *buf,
+      const size_t num
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_writefd writes num bytes at the current position of fd,
+    * retrying short and interrupted writes.
+    *
+    * Return value
+    * ============
+    * Bytes written, or -1 on error.
+    *
+    */
+
+   const char
+     *p = (const char *)buf;
+   size_t
+     done = 0;
+   ssize_t
+     n;
+
+   while (done < num){
+      n = write(fd, p + done, num - done);
+      if (n < 0){
+         if (errno == EINTR)
+            continue;
+         return(-1);
+      }
+      done += (size_t)n;
+   }
+
+   return((long long)done);
+
+} /* End l7p_writefd */
+
+long long l7p_fseek(
+      const int       fid,
+      const long long disk_loc
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * l7p_fseek moves this process's position in a file it holds to
+    * byte disk_loc. MPI-IO files are always addressed with explicit
+    * offsets, so there is nothing to move.
+    *
+    * Return value
+    * ============
+    * The new position, or -1 on error.
+    *
+    */
+
+   struct l7_file_record
+     *rec;
+   int
+     ierr;
+
+   rec = l7p_file_record_get(fid);
+   if (rec == NULL || !rec->is_open){
+      ierr = -1;
+      L7_ASSERT(rec != NULL && rec->is_open, "File not open on this pe", ierr);
+   }
+
+   switch (rec->handler){
+      case L7_FILE_STREAM:
+         if (fseeko(rec->file_handler.fstream, (off_t)disk_loc, SEEK_SET) != 0)
+            return(-1);
+         return(disk_loc);
+      case L7_FILE_FD:
+         return((long long)lseek(rec->file_handler.fd, (off_t)disk_loc, SEEK_SET));
+      default:
+         return(disk_loc);
+   }
+
+} /* End l7p_fseek */
+
+long long l7p_ftell(
+      const int fid
+      )
+{
+   /*
+    * Current position of this process in a file it holds, or -1. For
+    * MPI-IO files, which keep no position, the file size.
+    */
+
+   struct l7_file_record
+     *rec;
+   int
+     ierr;
+#ifdef HAVE_MPI
+   MPI_Offset
+     size;
+#endif
+
+   rec = l7p_file_record_get(fid);
+   if (rec == NULL || !rec->is_open){
+      ierr = -1;
+      L7_ASSERT(rec != NULL && rec->is_open, "File not open on this pe", ierr);
+   }
+
+   switch (rec->handler){
+      case L7_FILE_STREAM:
+         return((long long)ftello(rec->file_handler.fstream));
+      case L7_FILE_FD:
+         return((long long)lseek(rec->file_handler.fd, 0, SEEK_CUR));
+#ifdef HAVE_MPI
+      case L7_FILE_MPI:
+         if (MPI_File_get_size(rec->file_handler.mpi_fh, &size) != MPI_SUCCESS)
+            return(-1);
+         return((long long)size);
+#endif
+      default:
+         return(-1);
+   }
+
+} /* End l7p_ftell */
@@ -49,24 +49,25 @@ int l7p_nbr_state_free(
 		)
 {
 	/* Free neighbor collective state set up for previous version. */
-	if (l7.numpes > 1){
+	if (l7.numpes > 1 && nbr_state->comm != MPI_COMM_NULL){
             MPI_Comm_free(&nbr_state->comm);
+            nbr_state->comm = MPI_COMM_NULL;
         }
         if (nbr_state->mpi_recv_counts) {
-            free(nbr_state->mpi_recv_counts);
+            l7p_release(nbr_state->allocator, nbr_state->mpi_recv_counts);
             nbr_state->mpi_recv_counts = NULL;
         }
         if (nbr_state->mpi_send_counts) {
-            free(nbr_state->mpi_send_counts);
+            l7p_release(nbr_state->allocator, nbr_state->mpi_send_counts);
             nbr_state->mpi_send_counts = NULL;
         }
 
         if (nbr_state->mpi_recv_offsets) {
-            free(nbr_state->mpi_recv_offsets);
+            l7p_release(nbr_state->allocator, nbr_state->mpi_recv_offsets);
             nbr_state->mpi_recv_offsets = NULL;
         }
         if (nbr_state->mpi_send_offsets) {
-           free(nbr_state->mpi_send_offsets);
+           l7p_release(nbr_state->allocator, nbr_state->mpi_send_offsets);
            nbr_state->mpi_send_offsets = NULL;
 	}
 
@@ -81,17 +82,17 @@ int l7p_nbr_state_create(
 {
 	int i;
 
-        nbr_state->mpi_recv_counts = calloc(num_recvs, sizeof(int));
+        nbr_state->mpi_recv_counts = l7p_alloc(nbr_state->allocator, (size_t)num_recvs*sizeof(int));
         L7_ASSERT(nbr_state->mpi_recv_counts != NULL,
      	     "Could not allocate space for mpi_recv_counts.", -1);
-        nbr_state->mpi_send_counts = calloc(num_sends, sizeof(int));
+        nbr_state->mpi_send_counts = l7p_alloc(nbr_state->allocator, (size_t)num_sends*sizeof(int));
         L7_ASSERT(nbr_state->mpi_send_counts != NULL,
      	     "Could not allocate space for mpi_send_counts.", -1);
 
-        nbr_state->mpi_recv_offsets = calloc(num_recvs, sizeof(long));
+        nbr_state->mpi_recv_offsets = l7p_alloc(nbr_state->allocator, (size_t)num_recvs*sizeof(long));
         L7_ASSERT(nbr_state->mpi_recv_offsets != NULL,
      	     "Could not allocate space for mpi_recv_offsets.", -1);
-        nbr_state->mpi_send_offsets = calloc(num_sends, sizeof(long));
+        nbr_state->mpi_send_offsets = l7p_alloc(nbr_state->allocator, (size_t)num_sends*sizeof(long));
         L7_ASSERT(nbr_state->mpi_send_offsets != NULL,
      	     "Could not allocate space for mpi_send_offsets.", -1);
 
@@ -0,0 +1,368 @@
+/*
+ *  Copyright (c) 2011-2019, Triad National Security, LLC.
+ *  All rights Reserved.
+ *
+ *  CLAMR -- LA-CC-11-094
+ *
+ *  Copyright 2011-2019. Triad National Security, LLC. This software was produced
+ *  under U.S. Government contract 89233218CNA000001 for Los Alamos National
+ *  Laboratory (LANL), which is operated by Triad National Security, LLC
+ *  for the U.S. Department of Energy. The U.S. Government has rights to use,
+ *  reproduce, and distribute this software.  NEITHER THE GOVERNMENT NOR
+ *  TRIAD NATIONAL SECURITY, LLC MAKES ANY WARRANTY, EXPRESS OR IMPLIED, OR
+ *  ASSUMES ANY LIABILITY FOR THE USE OF THIS SOFTWARE.  If software is modified
+ *  to produce derivative works, such modified software should be clearly marked,
+ *  so as not to confuse it with the version available from LANL.
+ *
+ *  Additionally, redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Triad National Security, LLC, Los Alamos
+ *       National Laboratory, LANL, the U.S. Government, nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE TRIAD NATIONAL SECURITY, LLC AND
+ *  CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT
+ *  NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL TRIAD NATIONAL
+ *  SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *  PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ *  OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ *  WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "l7.h"
+#include "l7p.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define L7_LOCATION "L7P_NEEDED"
+
+/*
+ * Needed-index lists in any order, with repeats.
+ *
+ * The setup handshake walks indices_needed in ascending order, one owner
+ * at a time. When the caller's list is not strictly ascending,
+ * l7p_needed_normalize sorts the database's copy of it with a stable
+ * radix sort that remembers where each index came from, drops repeats
+ * for the wire, and records the ghost placement so every caller slot is
+ * still filled: the first occurrence of each index is received straight
+ * into its slot through ghost_offsets, and later occurrences are copied
+ * from it by l7p_ghost_dups_fill after each update.
+ */
+
+#ifdef HAVE_MPI
+
+#define RADIX_BITS     8
+#define RADIX_BUCKETS  (1 << RADIX_BITS)
+#define RADIX_PARALLEL_MIN 65536   /* Below this, one thread sorts. */
+
+static int radix_sort_pairs(
+      const int   n,
+      uint32_t    *keys,
+      int         *vals,
+      uint32_t    *keys_tmp,
+      int         *vals_tmp
+      )
+{
+   /*
+    * Stable LSD radix sort of keys, carrying vals along; each thread
+    * histograms and scatters its own contiguous block. Passes in which
+    * every key has the same digit are skipped. Returns L7_OK, or -1
+    * with the keys unsorted if out of memory.
+    */
+
+   uint32_t
+     *keys_out,
+     *keys_swap;
+   int
+     *vals_out,
+     *vals_swap,
+     nthreads,
+     shift,
+     skip;
+   size_t
+     *counts;
+
+   nthreads = 1;
+#ifdef _OPENMP
+   if (n >= RADIX_PARALLEL_MIN)
+      nthreads = omp_get_max_threads();
+#endif
+
+   counts = (size_t *)malloc((size_t)nthreads * RADIX_BUCKETS * sizeof(size_t));
+   if (counts == NULL){
+      nthreads = 1;
+      counts = (size_t *)malloc(RADIX_BUCKETS * sizeof(size_t));
+      if (counts == NULL)
+         return(-1);
+   }
+
+   keys_out = keys_tmp;
+   vals_out = vals_tmp;
+
+   for (shift = 0; shift < 32; shift += RADIX_BITS){
+      skip = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+      {
+         int
+           t = 0,
+           d;
+         size_t
+           i,
+           lo,
+           hi,
+           *my_counts;
+
+#ifdef _OPENMP
+         t = omp_get_thread_num();
+#endif
+         lo = (size_t)n * t / nthreads;
+         hi = (size_t)n * (t+1) / nthreads;
+         my_counts = &counts[(size_t)t * RADIX_BUCKETS];
+
+         memset(my_counts, 0, RADIX_BUCKETS * sizeof(size_t));
+         for (i=lo; i<hi; i++)
+            my_counts[(keys[i] >> shift) & (RADIX_BUCKETS-1)]++;
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+         {
+            size_t
+              sum = 0,
+              c;
+            int
+              u;
+
+            for (d=0; d<RADIX_BUCKETS; d++){
+               c = 0;
+               for (u=0; u<nthreads; u++)
+                  c += counts[(size_t)u * RADIX_BUCKETS + d];
+               if (c == (size_t)n) skip = 1;
+               for (u=0; u<nthreads; u++){
+                  c = counts[(size_t)u * RADIX_BUCKETS + d];
+                  counts[(size_t)u * RADIX_BUCKETS + d] = sum;
+                  sum += c;
+               }
+            }
+         }
+
+         if (!skip){
+            for (i=lo; i<hi; i++){
+               size_t dst = my_counts[(keys[i] >> shift) & (RADIX_BUCKETS-1)]++;
+               keys_out[dst] = keys[i];
+               vals_out[dst] = vals[i];
+            }
+         }
+      }
+
+      if (!skip){
+         keys_swap = keys; keys = keys_out; keys_out = keys_swap;
+         vals_swap = vals; vals = vals_out; vals_out = vals_swap;
+      }
+   }
+
+   /* After an odd number of passes the result is in the scratch arrays. */
+   if (keys == keys_tmp){
+      memcpy(keys_out, keys, (size_t)n * sizeof(uint32_t));
+      memcpy(vals_out, vals, (size_t)n * sizeof(int));
+   }
+
+   free(counts);
+
+   return(L7_OK);
+}
+
+int l7p_needed_normalize(
+      l7_id_database  *l7_id_db,
+      const int       num_indices_needed,
+      int             *num_unique
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Sort and deduplicate l7_id_db->indices_needed in place unless it is
+    * already strictly ascending, replacing ghost_offsets with the slot of
+    * the first occurrence of each unique index and recording the slots
+    * of repeats in ghost_dup_dst/ghost_dup_src.
+    *
+    * Arguments
+    * =========
+    * l7_id_db             (input/output) l7_id_database*
+    *                      Database whose indices_needed, num_indices_owned
+    *                      and ghost_offsets (caller slots, or NULL for
+    *                      slots after the owned data) are set.
+    *
+    * num_indices_needed   (input) const int
+    *                      Length of the caller's list.
+    *
+    * num_unique           (output) int*
+    *                      Length of the list that goes on the wire.
+    *
+    * Return value
+    * ============
+    * Value other than L7_OK indicates an error.
+    *
+    */
+
+   uint32_t
+     *keys,
+     *keys_tmp;
+   int
+     *needed = l7_id_db->indices_needed,
+     *pos,
+     *pos_tmp,
+     *new_offsets,
+     i,
+     ierr,
+     m,
+     d,
+     sorted,
+     first_slot = 0,
+     slot;
+
+   l7p_release(&l7_id_db->allocator, l7_id_db->ghost_dup_dst);
+   l7p_release(&l7_id_db->allocator, l7_id_db->ghost_dup_src);
+   l7_id_db->ghost_dup_dst  = NULL;
+   l7_id_db->ghost_dup_src  = NULL;
+   l7_id_db->num_ghost_dups = 0;
+
+   *num_unique = num_indices_needed;
+
+   sorted = 1;
+   for (i=1; i<num_indices_needed && sorted; i++){
+      if (needed[i] <= needed[i-1]) sorted = 0;
+   }
+   if (sorted)
+      return(L7_OK);
+
+   keys        = (uint32_t *)malloc((size_t)num_indices_needed * sizeof(uint32_t));
+   keys_tmp    = (uint32_t *)malloc((size_t)num_indices_needed * sizeof(uint32_t));
+   pos         = (int *)malloc((size_t)num_indices_needed * sizeof(int));
+   pos_tmp     = (int *)malloc((size_t)num_indices_needed * sizeof(int));
+   new_offsets = (int *)l7p_alloc(&l7_id_db->allocator, ((size_t)num_indices_needed+1) * sizeof(int));
+   l7_id_db->ghost_dup_dst = (int *)l7p_alloc(&l7_id_db->allocator, (size_t)num_indices_needed * sizeof(int));
+   l7_id_db->ghost_dup_src = (int *)l7p_alloc(&l7_id_db->allocator, (size_t)num_indices_needed * sizeof(int));
+   if (keys == NULL || keys_tmp == NULL || pos == NULL || pos_tmp == NULL ||
+       new_offsets == NULL || l7_id_db->ghost_dup_dst == NULL || l7_id_db->ghost_dup_src == NULL){
+      free(keys); free(keys_tmp); free(pos); free(pos_tmp);
+      l7p_release(&l7_id_db->allocator, new_offsets);
+      ierr = -1;
+      L7_ASSERT(ierr == 0, "No memory to sort indices_needed", ierr);
+   }
+
+   /* Flipping the sign bit orders signed values as unsigned keys. */
+#ifdef _OPENMP
+#pragma omp parallel for if (num_indices_needed >= RADIX_PARALLEL_MIN)
+#endif
+   for (i=0; i<num_indices_needed; i++){
+      keys[i] = (uint32_t)needed[i] ^ 0x80000000u;
+      pos[i]  = i;
+   }
+
+   ierr = radix_sort_pairs(num_indices_needed, keys, pos, keys_tmp, pos_tmp);
+   if (ierr != L7_OK){
+      free(keys); free(keys_tmp); free(pos); free(pos_tmp);
+      l7p_release(&l7_id_db->allocator, new_offsets);
+      L7_ASSERT(ierr == L7_OK, "No memory to sort indices_needed", ierr);
+   }
+
+   m = 0;
+   d = 0;
+   for (i=0; i<num_indices_needed; i++){
+      slot = l7_id_db->ghost_offsets ? l7_id_db->ghost_offsets[pos[i]]
+                                     : l7_id_db->num_indices_owned + pos[i];
+      if (i == 0 || keys[i] != keys[i-1]){
+         needed[m]      = (int)(keys[i] ^ 0x80000000u);
+         new_offsets[m] = slot;
+         first_slot     = slot;
+         m++;
+      }
+      else {
+         l7_id_db->ghost_dup_dst[d] = slot;
+         l7_id_db->ghost_dup_src[d] = first_slot;
+         d++;
+      }
+   }
+
+   free(keys);
+   free(keys_tmp);
+   free(pos);
+   free(pos_tmp);
+
+   l7p_release(&l7_id_db->allocator, l7_id_db->ghost_offsets);
+   l7_id_db->ghost_offsets  = new_offsets;
+   l7_id_db->num_ghost_dups = d;
+   if (d == 0){
+      l7p_release(&l7_id_db->allocator, l7_id_db->ghost_dup_src);
+      l7p_release(&l7_id_db->allocator, l7_id_db->ghost_dup_dst);
+      l7_id_db->ghost_dup_dst = NULL;
+      l7_id_db->ghost_dup_src = NULL;
+   }
+
+   *num_unique = m;
+
+   return(L7_OK);
+
+} /* End l7p_needed_normalize */
+
+void l7p_ghost_dups_fill(
+      const l7_id_database  *l7_id_db,
+      void                  *data_buffer,
+      const int             sizeof_type
+      )
+{
+   /*
+    * Purpose
+    * =======
+    * Copy each repeated needed index from the slot its first occurrence
+    * was received into. Called after every exchange that fills ghosts.
+    */
+
+   const int
+     *dst = l7_id_db->ghost_dup_dst,
+     *src = l7_id_db->ghost_dup_src;
+   int
+     i,
+     n = l7_id_db->num_ghost_dups;
+
+   switch (sizeof_type){
+      case 8:
+         for (i=0; i<n; i++)
+            ((uint64_t *)data_buffer)[dst[i]] = ((uint64_t *)data_buffer)[src[i]];
+         break;
+      case 4:
+         for (i=0; i<n; i++)
+            ((uint32_t *)data_buffer)[dst[i]] = ((uint32_t *)data_buffer)[src[i]];
+         break;
+      case 2:
+         for (i=0; i<n; i++)
+            ((uint16_t *)data_buffer)[dst[i]] = ((uint16_t *)data_buffer)[src[i]];
+         break;
+      default:
+         for (i=0; i<n; i++)
+            memcpy((char *)data_buffer + (size_t)dst[i] * sizeof_type,
+                   (char *)data_buffer + (size_t)src[i] * sizeof_type, sizeof_type);
+         break;
+   }
+
+} /* End l7p_ghost_dups_fill */
+
+#endif /* HAVE_MPI */
@@ -61,38 +61,20 @@ l7_id_database *l7p_set_database(
     * Notes:
     * ======
     * 1) Serial compilation creates a no-op.
+    * 2) Lock-free: handles index l7.db_table, which setup and L7_Free
+    *    update with atomic stores, so threads may look up databases
+    *    while another thread sets up or frees a different one.
     *
     */
 
 #if defined HAVE_MPI
 
-   /*
-    * Local Declarations
-    */
-
-   struct l7_id_database
-     *l7_id_db;    /* For searching through list of databases */
-
-   /*
-    * Executable statements
-    */
-
-   /*
-    * Search initialized databases for input db handle.
-    */
-
-   l7_id_db = l7.first_db;
-
-   while (l7_id_db){
-      if (l7_id_db->l7_id == l7_id){
-         return(l7_id_db);
-      }
-      else{
-         /* Move to next one */
-         l7_id_db = l7_id_db->next_db;
-      }
+   if (l7_id < 1 || l7_id > L7_MAX_NUM_DBS){
+      return(NULL);
    }
 
+   return(__atomic_load_n(&l7.db_table[l7_id], __ATOMIC_ACQUIRE));
+
 #endif /* HAVE_MPI */
 
    return(NULL);
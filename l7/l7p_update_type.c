@@ -49,8 +49,8 @@
 /* Forward declarations of internal subroutines. */
 static int create_recv_type(int recv_count, int init_offset,
 		            MPI_Datatype base_type, MPI_Datatype *send_type);
-static int create_send_type(l7_id_database *l7_id_db, int send_count, int init_offset,
-		            MPI_Datatype base_type, MPI_Datatype *send_type);
+static int create_indexed_type(l7p_allocator *allocator, const int *indices, int count,
+		            MPI_Datatype base_type, MPI_Datatype *new_type);
 
 int L7P_Update_Type_Create(
       l7_id_database            *l7_id_db,
@@ -99,13 +99,16 @@ int L7P_Update_Type_Create(
    L7_ASSERT(l7_update_datatype != NULL, "l7_update_datatype == NULL.", -1);
 
    mpi_type = l7p_mpi_type(l7_datatype);
+   l7_update_datatype->base_type = mpi_type;
    num_sends = l7_id_db->num_sends;
    num_recvs = l7_id_db->num_recvs;
 
-   l7_update_datatype->in_types = calloc(num_recvs, sizeof(MPI_Datatype));
+   l7_update_datatype->in_types = l7p_alloc(&l7_id_db->allocator,
+	(size_t)num_recvs*sizeof(MPI_Datatype));
    L7_ASSERT(l7_update_datatype->in_types != NULL,
 	     "Could not allocate space for update datatype in_types.", -1);
-   l7_update_datatype->out_types = calloc(num_sends, sizeof(MPI_Datatype));
+   l7_update_datatype->out_types = l7p_alloc(&l7_id_db->allocator,
+	(size_t)num_sends*sizeof(MPI_Datatype));
    L7_ASSERT(l7_update_datatype->out_types != NULL,
 	     "Could not allocate space for update datatype out_types.", -1);
 
@@ -120,8 +123,12 @@ int L7P_Update_Type_Create(
       printf("[pe %d] Constructing recv type %d (%d elements at offset %d) from [pe %d].\n",
              l7.penum, i, msg_count, offset, l7_id_db->recv_from[i]);
 #endif
-      ierr = create_recv_type(msg_count, offset,
-			      mpi_type, &l7_update_datatype->in_types[i]);
+      if (l7_id_db->ghost_offsets)
+         ierr = create_indexed_type(&l7_id_db->allocator, &l7_id_db->ghost_offsets[offset - l7_id_db->num_indices_owned],
+                                    msg_count, mpi_type, &l7_update_datatype->in_types[i]);
+      else
+         ierr = create_recv_type(msg_count, offset,
+			         mpi_type, &l7_update_datatype->in_types[i]);
       L7_ASSERT(ierr == 0, "Failed to create update recv datatype.", ierr);
 
       offset += msg_count;
@@ -134,8 +141,8 @@ int L7P_Update_Type_Create(
       printf("[pe %d] Constructing send type %d (%d elements) to [pe %d].\n",
              l7.penum, i, msg_count, l7_id_db->send_to[i]);
 #endif
-      ierr = create_send_type(l7_id_db, msg_count, offset,
-                              mpi_type, &l7_update_datatype->out_types[i]);
+      ierr = create_indexed_type(&l7_id_db->allocator, &l7_id_db->indices_local_to_send[offset], msg_count,
+                                 mpi_type, &l7_update_datatype->out_types[i]);
       L7_ASSERT(ierr == 0, "Failed to create update send datatype.", ierr);
 
       offset += msg_count;
@@ -162,14 +169,14 @@ L7P_Update_Type_Free(l7_id_database *l7_id_db,
    {
 	MPI_Type_free(&l7_update_datatype->out_types[i]);
    }
-   free(l7_update_datatype->out_types);
+   l7p_release(&l7_id_db->allocator, l7_update_datatype->out_types);
    l7_update_datatype->out_types = NULL;
 
    for (int i = 0; i < num_recvs; i++)
    {
 	MPI_Type_free(&l7_update_datatype->in_types[i]);
    }
-   free(l7_update_datatype->in_types);
+   l7p_release(&l7_id_db->allocator, l7_update_datatype->in_types);
    l7_update_datatype->in_types = NULL;
 
 #endif /* HAVE_MPI */
@@ -207,21 +214,25 @@ create_recv_type(int recv_count, int init_offset,
    return(L7_OK);
 }
 
+/* Sends gather from arbitrary local indices (and placed receives scatter
+ * to them), so coalesce runs of consecutive indices into the blocks of an
+ * indexed type. The block lists are temporaries from the database
+ * allocator, released in reverse order so the arena reuses the space. */
 static int
-create_send_type(l7_id_database *l7_id_db, int send_count, int init_offset,
-		 MPI_Datatype base_type, MPI_Datatype *send_type)
+create_indexed_type(l7p_allocator *allocator, const int *indices, int count,
+		    MPI_Datatype base_type, MPI_Datatype *new_type)
 {
    int num_blocks = 0;
    int last_index = -2;
-   int i, offset, blockidx;
+   int i, blockidx;
 
    int *block_lens = NULL,
        *block_offsets = NULL;
 
    /* How many blocks will the indexed type need? */
-   for (i = 0, offset = init_offset; i < send_count; i++, offset++)
+   for (i = 0; i < count; i++)
    {
-      int curr_index = l7_id_db->indices_local_to_send[offset];
+      int curr_index = indices[i];
       if (curr_index != last_index + 1) {
          num_blocks++;
       }
@@ -230,18 +241,18 @@ create_send_type(l7_id_database *l7_id_db, int send_count, int init_offset,
 
    /* Now that we know the number of blocks in the datatype, allocate
     * the lists of them and fill them out. */
-   block_lens = calloc(num_blocks, sizeof(int));
+   block_lens = l7p_alloc(allocator, (size_t)num_blocks*sizeof(int));
    L7_ASSERT(block_lens != NULL,
 	     "Could not allocate space for type block lengths.", -1);
-   block_offsets = calloc(num_blocks, sizeof(int));
+   block_offsets = l7p_alloc(allocator, (size_t)num_blocks*sizeof(int));
    L7_ASSERT(block_offsets != NULL,
 	     "Could not allocate space for type block offsets.", -1);
 
    last_index = -2;
    blockidx = -1;
-   for (i = 0, offset = init_offset; i < send_count; i++, offset++)
+   for (i = 0; i < count; i++)
    {
-      int curr_index = l7_id_db->indices_local_to_send[offset];
+      int curr_index = indices[i];
       if (curr_index != last_index + 1) {
          blockidx++;
          block_offsets[blockidx] = curr_index;
@@ -251,19 +262,19 @@ create_send_type(l7_id_database *l7_id_db, int send_count, int init_offset,
    }
 
 #if defined _L7_DEBUG
-   printf("[pe %d]     Send type has %d elements in %d blocks.\n", l7.penum,
-          send_count, num_blocks);
+   printf("[pe %d]     Indexed type has %d elements in %d blocks.\n", l7.penum,
+          count, num_blocks);
    for (int i = 0; i < num_blocks; i++) {
       printf("[pe %d]         Block %d of length %d starts at offset %d.\n",
              l7.penum, i, block_lens[i], block_offsets[i]);
    }
 #endif
 
-   MPI_Type_indexed(num_blocks, block_lens, block_offsets, base_type, send_type);
-   MPI_Type_commit(send_type);
+   MPI_Type_indexed(num_blocks, block_lens, block_offsets, base_type, new_type);
+   MPI_Type_commit(new_type);
 
-   free(block_lens);
-   free(block_offsets);
+   l7p_release(allocator, block_offsets);
+   l7p_release(allocator, block_lens);
 
    return(L7_OK);
 }
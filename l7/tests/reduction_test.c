@@ -1,6 +1,32 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
 #include "l7.h"
 
+/* Split each shared-memory node into nodes of three ranks, so the
+ * hierarchical collectives take their node path even when every rank
+ * runs on one host. The fake nodes stay inside the real ones, so the
+ * node windows are still shareable. */
+int MPI_Comm_split_type(MPI_Comm comm, int split_type, int key, MPI_Info info,
+      MPI_Comm *newcomm)
+{
+   MPI_Comm node_comm;
+   int node_rank, ierr;
+
+   if (split_type != MPI_COMM_TYPE_SHARED)
+      return(PMPI_Comm_split_type(comm, split_type, key, info, newcomm));
+
+   ierr = PMPI_Comm_split_type(comm, split_type, key, info, &node_comm);
+   if (ierr != MPI_SUCCESS) return(ierr);
+   MPI_Comm_rank(node_comm, &node_rank);
+   ierr = PMPI_Comm_split(node_comm, node_rank/3, key, newcomm);
+   MPI_Comm_free(&node_comm);
+
+   return(ierr);
+}
+
 void reduction_test()
 {
    int mype,
@@ -462,4 +488,275 @@ void reduction_test()
        }
    }
 
+   /*
+    * Arrays long enough for the vector and threaded local kernels
+    */
+
+   int nbig = 100000, *ibig;
+   double *xbig;
+
+   ibig = (int *)malloc(nbig*sizeof(int));
+   xbig = (double *)malloc(nbig*sizeof(double));
+   for (i=0; i<nbig; i++){
+      ibig[i] = 1;
+      xbig[i] = 0.5;
+   }
+   ierr = L7_All(ibig, nbig, L7_INT, &iout);
+   if (mype == 0){
+      if (ierr != L7_OK || iout != 1){
+         printf("  Error with L7_All of int arrays\n");
+       }
+       else{
+          printf("  PASSED L7_All of int arrays\n");
+       }
+   }
+
+   L7_Sum(xbig, nbig, L7_DOUBLE, &xdoubleout);
+   if (mype == 0){
+      if (xdoubleout != 0.5*(double)nbig*(double)numpes){
+         printf("  Error with L7_Sum of large double arrays\n");
+       }
+       else{
+          printf("  PASSED L7_Sum of large double arrays\n");
+       }
+   }
+   free(ibig);
+   free(xbig);
+
+   /*
+    * Locations over several items per rank, twice with the same counts
+    * and then with one item less on rank 0, which moves every offset
+    */
+
+   int nloc, loc_off, loc_total, loc_ref, *loc_data;
+
+   nloc = mype + 2;
+   loc_off = 0;
+   for (i=0; i<mype; i++){
+      loc_off += i + 2;
+   }
+   loc_total = 0;
+   for (i=0; i<numpes; i++){
+      loc_total += i + 2;
+   }
+   loc_data = (int *)malloc(nloc*sizeof(int));
+   for (i=0; i<nloc; i++){
+      loc_data[i] = ((loc_off+i)*37) % 101;
+   }
+   loc_ref = 0;
+   for (i=1; i<loc_total; i++){
+      if ((i*37) % 101 > (loc_ref*37) % 101) loc_ref = i;
+   }
+   ierr = L7_MaxLoc(loc_data, nloc, L7_INT, &iout);
+   ierr |= L7_MaxLoc(loc_data, nloc, L7_INT, &ivalout);
+   if (mype == 0){
+      if (ierr != L7_OK || iout != loc_ref || ivalout != loc_ref){
+         printf("  Error with L7_MaxLoc of int arrays\n");
+       }
+       else{
+          printf("  PASSED L7_MaxLoc of int arrays\n");
+       }
+   }
+
+   if (mype == 0){
+      nloc--;
+      for (i=0; i<nloc; i++){
+         loc_data[i] = loc_data[i+1];
+      }
+   }
+   for (i=0; i<nloc; i++){
+      loc_data[i] = -loc_data[i];
+   }
+   loc_ref = 1;
+   for (i=2; i<loc_total; i++){
+      if ((i*37) % 101 > (loc_ref*37) % 101) loc_ref = i;
+   }
+   ierr = L7_MinValLoc(loc_data, nloc, L7_INT, &ivalout, &iout);
+   if (mype == 0){
+      if (ierr != L7_OK || iout != loc_ref-1 || ivalout != -((loc_ref*37) % 101)){
+         printf("  Error with L7_MinValLoc after count change\n");
+       }
+       else{
+          printf("  PASSED L7_MinValLoc after count change\n");
+       }
+   }
+   free(loc_data);
+
+   /*
+    * Batched reductions must match the separate L7_Sum/L7_Max/L7_Min
+    */
+
+   int ireduce = 0, rlocal_i, rsum_i, rsum_ref_i;
+   double rmax_d, rmax_ref_d, rlocal_d[3];
+   float rmin_f, rmin_ref_f, rlocal_f[2];
+   long long rsum_ll, rsum_ref_ll, rlocal_ll;
+   struct L7_Reduction reductions[4];
+
+   rlocal_i    = 2*mype + 1;
+   rlocal_d[0] = (double)mype;
+   rlocal_d[1] = 0.5*(double)(mype + 10);
+   rlocal_d[2] = -1.0;
+   rlocal_f[0] = (float)(numpes - mype);
+   rlocal_f[1] = 2.5f;
+   rlocal_ll   = 3000000000LL + mype;
+
+   reductions[0] = (struct L7_Reduction){&rlocal_i,  1, L7_INT,           L7_REDUCE_SUM, &rsum_i};
+   reductions[1] = (struct L7_Reduction){rlocal_d,   3, L7_DOUBLE,        L7_REDUCE_MAX, &rmax_d};
+   reductions[2] = (struct L7_Reduction){rlocal_f,   2, L7_FLOAT,         L7_REDUCE_MIN, &rmin_f};
+   reductions[3] = (struct L7_Reduction){&rlocal_ll, 1, L7_LONG_LONG_INT, L7_REDUCE_SUM, &rsum_ll};
+   if (L7_Reduce_Multi(reductions, 4) != L7_OK) ireduce = 1;
+
+   L7_Sum(&rlocal_i, 1, L7_INT, &rsum_ref_i);
+   L7_Max(rlocal_d, 3, L7_DOUBLE, &rmax_ref_d);
+   L7_Min(rlocal_f, 2, L7_FLOAT, &rmin_ref_f);
+   L7_Sum(&rlocal_ll, 1, L7_LONG_LONG_INT, &rsum_ref_ll);
+   if (rsum_i != rsum_ref_i || rmax_d != rmax_ref_d ||
+       rmin_f != rmin_ref_f || rsum_ll != rsum_ref_ll) ireduce = 1;
+   L7_Any(&ireduce, 1, L7_INT, &ireduce);
+   if (mype == 0){
+      if (ireduce > 0){
+         printf("  Error with L7_Reduce_Multi\n");
+       }
+       else{
+          printf("  PASSED L7_Reduce_Multi\n");
+       }
+   }
+
+   /*
+    * Nonblocking collectives, overlapped with each other, must match
+    * the blocking ones
+    */
+
+   int icoll = 0, coll_requests[6], icoll_local, isum_i, isum_ref, imulti_i;
+   int iarr_in[3], iarr_out[3], iarr_ref[3], ibcast[2], ibcast_local[2], *igather;
+   double xcoll[3], imax_d, imax_ref, imulti_d;
+   struct L7_Reduction coll_reductions[2];
+
+   icoll_local = 2*mype + 1;
+   xcoll[0] = (double)mype;
+   xcoll[1] = 0.5*(double)(mype + 10);
+   xcoll[2] = -1.0;
+   igather = (int *)malloc(2*numpes*sizeof(int));
+   for (i=0; i<3; i++){
+      iarr_in[i] = mype*(i+1);
+   }
+   ibcast[0] = (mype == 0) ? 17 : -1;
+   ibcast[1] = (mype == 0) ? 42 : -1;
+   ibcast_local[0] = mype;
+   ibcast_local[1] = icoll_local;
+   coll_reductions[0] = (struct L7_Reduction){&icoll_local, 1, L7_INT,    L7_REDUCE_SUM, &imulti_i};
+   coll_reductions[1] = (struct L7_Reduction){xcoll,        3, L7_DOUBLE, L7_REDUCE_MAX, &imulti_d};
+
+   L7_Isum(&icoll_local, 1, L7_INT, &isum_i, &coll_requests[0]);
+   L7_Imax(xcoll, 3, L7_DOUBLE, &imax_d, &coll_requests[1]);
+   L7_Iarray_Sum(iarr_in, 3, L7_INT, iarr_out, &coll_requests[2]);
+   L7_Ibroadcast(ibcast, 2, L7_INT, 0, &coll_requests[3]);
+   L7_Iallgather(ibcast_local, 2, igather, L7_INT, &coll_requests[4]);
+   L7_Ireduce_Multi(coll_reductions, 2, &coll_requests[5]);
+   L7_Progress();
+   if (L7_Waitall(6, coll_requests) != L7_OK) icoll = 1;
+
+   L7_Sum(&icoll_local, 1, L7_INT, &isum_ref);
+   L7_Max(xcoll, 3, L7_DOUBLE, &imax_ref);
+   L7_Array_Sum(iarr_in, 3, L7_INT, iarr_ref);
+   if (isum_i != isum_ref || imax_d != imax_ref) icoll = 1;
+   if (imulti_i != isum_ref || imulti_d != imax_ref) icoll = 1;
+   for (i=0; i<3; i++){
+      if (iarr_out[i] != iarr_ref[i]) icoll = 1;
+   }
+   if (ibcast[0] != 17 || ibcast[1] != 42) icoll = 1;
+   for (i=0; i<numpes; i++){
+      if (igather[2*i] != i || igather[2*i+1] != 2*i + 1) icoll = 1;
+   }
+   free(igather);
+   L7_Any(&icoll, 1, L7_INT, &icoll);
+   if (mype == 0){
+      if (icoll > 0){
+         printf("  Error with nonblocking collectives\n");
+       }
+       else{
+          printf("  PASSED L7_Isum/L7_Iarray_Sum/L7_Ibroadcast/L7_Iallgather\n");
+       }
+   }
+
+
+   /*
+    * Reproducible sums must give the same bits for any decomposition and
+    * order, so each rank's chunk summed globally must match the whole
+    * array summed in reverse on one rank
+    */
+
+   int irepro = 0, nrepro = 1000;
+   double *rglobal, rglobal_rev, rrepro_sum, rrepro_ref;
+   long long rrepro_bits, rref_bits;
+
+   rglobal = (double *)malloc(nrepro*numpes*sizeof(double));
+   for (i=0; i<nrepro*numpes; i++){
+      rglobal[i] = ldexp(sin((double)i+0.5), (i*7)%61 - 30);
+      if (i%3 == 0) rglobal[i] = -rglobal[i];
+   }
+   L7_Set_Sum_Mode(L7_SUM_REPRODUCIBLE);
+   if (L7_Get_Sum_Mode() != L7_SUM_REPRODUCIBLE) irepro = 1;
+   L7_Sum(&rglobal[mype*nrepro], nrepro, L7_DOUBLE, &rrepro_sum);
+   for (i=0; i<nrepro*numpes/2; i++){
+      rglobal_rev = rglobal[i];
+      rglobal[i] = rglobal[nrepro*numpes-1-i];
+      rglobal[nrepro*numpes-1-i] = rglobal_rev;
+   }
+   L7_Sum_Comm(rglobal, nrepro*numpes, L7_DOUBLE, &rrepro_ref, MPI_COMM_SELF);
+   L7_Set_Sum_Mode(L7_SUM_FAST);
+   memcpy(&rrepro_bits, &rrepro_sum, sizeof(double));
+   memcpy(&rref_bits, &rrepro_ref, sizeof(double));
+   if (rrepro_bits != rref_bits) irepro = 1;
+   free(rglobal);
+   L7_Any(&irepro, 1, L7_INT, &irepro);
+   if (mype == 0){
+      if (irepro > 0){
+         printf("  Error with reproducible L7_Sum\n");
+       }
+       else{
+          printf("  PASSED L7_Set_Sum_Mode reproducible L7_Sum\n");
+       }
+   }
+
+
+   /*
+    * Small reductions and broadcasts with the node-hierarchical path
+    * enabled must give the flat results; with the three-rank nodes from
+    * MPI_Comm_split_type above, four or more ranks take the node path
+    */
+
+   int ihier = 0, ihier_in[3], ihier_out[3], ihier_bcast[2], ihier_root;
+   double rhier_in[3], rhier_out[3], rhier_flat[3];
+
+   L7_Set_Coll_Hierarchy(4096);
+   if (L7_Get_Coll_Hierarchy() != 4096) ihier = 1;
+   for (i=0; i<3; i++){
+      ihier_in[i] = mype*(i+1);
+      rhier_in[i] = 0.5*mype + i;
+   }
+   L7_Array_Sum(ihier_in, 3, L7_INT, ihier_out);
+   L7_Array_Sum(rhier_in, 3, L7_DOUBLE, rhier_out);
+   for (ihier_root=0; ihier_root<numpes; ihier_root++){
+      ihier_bcast[0] = (mype == ihier_root) ? 23+ihier_root : -1;
+      ihier_bcast[1] = (mype == ihier_root) ? 5 : -1;
+      L7_Broadcast(ihier_bcast, 2, L7_INT, ihier_root);
+      if (ihier_bcast[0] != 23+ihier_root || ihier_bcast[1] != 5) ihier = 1;
+   }
+   L7_Set_Coll_Hierarchy(0);
+   L7_Array_Sum(rhier_in, 3, L7_DOUBLE, rhier_flat);
+   for (i=0; i<3; i++){
+      if (ihier_out[i] != (i+1)*numpes*(numpes-1)/2) ihier = 1;
+      if (rhier_out[i] != rhier_flat[i]) ihier = 1;
+   }
+   L7_Any(&ihier, 1, L7_INT, &ihier);
+   if (mype == 0){
+      if (ihier > 0){
+         printf("  Error with hierarchical collectives\n");
+       }
+       else{
+          printf("  PASSED L7_Set_Coll_Hierarchy\n");
+       }
+   }
+
 }
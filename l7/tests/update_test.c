@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <pthread.h>
 #include <mpi.h>
 #include "l7.h"
 #include "l7p.h"
@@ -8,6 +10,48 @@
 void report_results_update(double *time_total_pe, int count_updated_pe, int num_timings,
       int num_timings_cycle);
 
+struct thread_update_args {
+   int l7_id;
+   double *data;
+   int ierr;
+};
+
+/* Allocator that frees at once and counts, to check every database
+ * array goes back through L7_Allocator. */
+struct count_allocator {
+   long allocs, live, resets, destroys;
+};
+
+static void *count_create(void *context) { return(context); }
+static void *count_alloc(void *state, size_t nbytes)
+{
+   struct count_allocator *counts = (struct count_allocator *)state;
+   counts->allocs++;
+   counts->live++;
+   return(calloc(1, nbytes > 0 ? nbytes : 1));
+}
+static void count_release(void *state, void *ptr)
+{
+   ((struct count_allocator *)state)->live--;
+   free(ptr);
+}
+static void count_reset(void *state) { ((struct count_allocator *)state)->resets++; }
+static void count_destroy(void *state) { ((struct count_allocator *)state)->destroys++; }
+
+static void *thread_update(void *arg)
+{
+   struct thread_update_args *args = (struct thread_update_args *)arg;
+   int i;
+
+   args->ierr = 0;
+   for (i=0; i<10; i++){
+      if (L7_Update(args->data, L7_DOUBLE, args->l7_id) != L7_OK) args->ierr = 1;
+   }
+   if (L7_Update_Check(args->data, L7_DOUBLE, args->l7_id) != L7_OK) args->ierr = 1;
+
+   return(NULL);
+}
+
 
 void update_test()
 {
@@ -77,7 +121,7 @@ void update_test()
    partner_pe = (int *)malloc(num_partners * sizeof(int));
 
    offset = 0;
-   for (i=num_partners_lo; i<=1; i--) {
+   for (i=num_partners_lo; i>=1; i--) {
       partner_pe[offset] = penum - i;
       offset++;
    }
@@ -267,6 +311,637 @@ void update_test()
 #endif
    }
 
+   /*
+    * Ghosts just updated must pass the check; a corrupted one must not
+    */
+
+   int icheck = 0;
+
+   if (L7_Update_Check(rdata, L7_DOUBLE, l7_id) != L7_OK) icheck = 1;
+   if (num_indices_offpe > 0) rdata[num_indices_owned] += 1.0;
+   if (L7_Update_Check(rdata, L7_DOUBLE, l7_id) != (num_indices_offpe > 0 ? 1 : 0)) icheck = 1;
+   L7_Update(rdata, L7_DOUBLE, l7_id);
+   if (L7_Update_Check(rdata, L7_DOUBLE, l7_id) != L7_OK) icheck = 1;
+   num_updates++;
+
+   L7_Any(&icheck, 1, L7_INT, &icheck);
+
+   /*
+    * Statistics should account for every setup and update above
+    */
+
+   struct L7_Stats stats;
+   int istats = 0;
+
+   L7_Get_Stats(l7_id, &stats);
+   if (numpes > 1 && (stats.num_setups != 1 || stats.num_updates != num_updates ||
+       stats.msgs_sent != (long long)stats.num_sends * num_updates)) istats = 1;
+
+   /*
+    * A plan saved and loaded back must produce the same ghost values
+    */
+
+   int iplan = 0, l7_plan_id = 0;
+   double *rsave;
+   char plan_path[64];
+
+   sprintf(plan_path, "l7test_plan_%d", numpes);
+   rsave = (double *)malloc((num_indices_offpe+1)*sizeof(double));
+   for (j=0; j<num_indices_offpe; j++){
+      rsave[j] = rdata[num_indices_owned+j];
+      rdata[num_indices_owned+j] = -1.0;
+   }
+
+   if (L7_Plan_Save(l7_id, plan_path) != L7_OK) iplan = 1;
+   if (L7_Plan_Load(plan_path, &l7_plan_id) != L7_OK) iplan = 1;
+   if (! iplan){
+      L7_Update(rdata, L7_DOUBLE, l7_plan_id);
+      for (j=0; j<num_indices_offpe; j++){
+         if (rdata[num_indices_owned+j] != rsave[j]) iplan = 1;
+      }
+      L7_Free(&l7_plan_id);
+   }
+   sprintf(plan_path, "l7test_plan_%d.%d", numpes, penum);
+   remove(plan_path);
+   free(rsave);
+
+   L7_Any(&iplan, 1, L7_INT, &iplan);
+
+   /*
+    * Compacting must shrink the database and leave updates working
+    */
+
+   int icompact = 0;
+   size_t mem_before, mem_after;
+
+   L7_Get_Memory_Usage(l7_id, &mem_before);
+   if (L7_Compact(l7_id, L7_COMPACT_SETUP) != L7_OK) icompact = 1;
+   L7_Get_Memory_Usage(l7_id, &mem_after);
+   if (numpes > 1 && (mem_after > mem_before ||
+       (l7.compact_level == L7_COMPACT_NONE && mem_after == mem_before))) icompact = 1;
+
+   for (j=0; j<num_indices_offpe; j++){
+      rdata[num_indices_owned+j] = -1.0;
+   }
+   L7_Update(rdata, L7_DOUBLE, l7_id);
+   if (L7_Update_Check(rdata, L7_DOUBLE, l7_id) != L7_OK) icompact = 1;
+
+   /* ... and a compacted database can be set up again */
+   L7_Compact(l7_id, L7_COMPACT_ALL);
+   L7_Setup(0, my_start_index, num_indices_owned, needed_indices,
+       num_indices_offpe, &l7_id);
+   for (j=0; j<num_indices_offpe; j++){
+      rdata[num_indices_owned+j] = -1.0;
+   }
+   L7_Update(rdata, L7_DOUBLE, l7_id);
+   if (L7_Update_Check(rdata, L7_DOUBLE, l7_id) != L7_OK) icompact = 1;
+
+   L7_Any(&icompact, 1, L7_INT, &icompact);
+
+   /*
+    * After L7_Reorder and permuting the owned data, the ghosts must
+    * hold the same cells in their new places, receive their new global
+    * indices and be in ascending order again
+    */
+
+   int ireorder = 0, ireorder_ok, num_boundary;
+   int *new_local_index, *new_needed, *new_ghost_index;
+   double *rnew;
+
+   new_local_index = (int *)malloc((num_indices_owned+1)*sizeof(int));
+   new_needed = (int *)malloc((num_indices_offpe+1)*sizeof(int));
+   new_ghost_index = (int *)malloc((num_indices_offpe+1)*sizeof(int));
+   rnew = (double *)malloc((num_indices_owned+num_indices_offpe)*sizeof(double));
+
+   ireorder_ok = (L7_Reorder(l7_id, new_local_index, &num_boundary, new_needed, new_ghost_index) == L7_OK);
+   L7_All(&ireorder_ok, 1, L7_INT, &ireorder_ok);
+
+   /* L7_COMPACT_ALL releases the send indices, and L7_Reorder refuses */
+   if (! ireorder_ok && l7.compact_level != L7_COMPACT_ALL) ireorder = 1;
+
+   if (ireorder_ok){
+      if (num_boundary < 0 || num_boundary > num_indices_owned) ireorder = 1;
+
+      for (i=0; i<num_indices_owned; i++){
+         rnew[new_local_index[i]] = rdata[i];
+         idata[i] = my_start_index + i;
+      }
+      for (j=0; j<num_indices_offpe; j++){
+         rnew[num_indices_owned+j] = -1.0;
+      }
+      L7_Update(rnew, L7_DOUBLE, l7_id);
+      L7_Update(idata, L7_INT, l7_id);
+      for (j=0; j<num_indices_offpe; j++){
+         if (rnew[num_indices_owned+new_ghost_index[j]] != (double)needed_indices[j]) ireorder = 1;
+         if (idata[num_indices_owned+new_ghost_index[j]] != new_needed[j]) ireorder = 1;
+         if (j > 0 && idata[num_indices_owned+j] <= idata[num_indices_owned+j-1]) ireorder = 1;
+      }
+      if (L7_Update_Check(rnew, L7_DOUBLE, l7_id) != L7_OK) ireorder = 1;
+   }
+
+   free(new_local_index);
+   free(new_needed);
+   free(new_ghost_index);
+   free(rnew);
+
+   L7_Any(&ireorder, 1, L7_INT, &ireorder);
+
+   /*
+    * Placed setup: ghosts first in reverse order, then the owned data
+    */
+
+   int iplaced = 0, l7_placed_id = 0;
+   int *owned_offsets, *ghost_offsets;
+   double *rplaced;
+
+   owned_offsets = (int *)malloc((num_indices_owned+1)*sizeof(int));
+   ghost_offsets = (int *)malloc((num_indices_offpe+1)*sizeof(int));
+   rplaced = (double *)malloc((num_indices_owned+num_indices_offpe)*sizeof(double));
+
+   for (j=0; j<num_indices_offpe; j++){
+      ghost_offsets[j] = num_indices_offpe-1-j;
+      rplaced[ghost_offsets[j]] = -1.0;
+   }
+   for (i=0; i<num_indices_owned; i++){
+      owned_offsets[i] = num_indices_offpe+i;
+      rplaced[owned_offsets[i]] = (double)(my_start_index+i);
+   }
+
+   L7_Setup_Placed(0, my_start_index, num_indices_owned, needed_indices,
+       num_indices_offpe, owned_offsets, ghost_offsets, &l7_placed_id);
+   L7_Update(rplaced, L7_DOUBLE, l7_placed_id);
+   for (j=0; j<num_indices_offpe; j++){
+      if (rplaced[ghost_offsets[j]] != (double)needed_indices[j]) iplaced = 1;
+   }
+   if (L7_Update_Check(rplaced, L7_DOUBLE, l7_placed_id) != L7_OK) iplaced = 1;
+   L7_Free(&l7_placed_id);
+
+   free(owned_offsets);
+   free(ghost_offsets);
+   free(rplaced);
+
+   L7_Any(&iplaced, 1, L7_INT, &iplaced);
+
+   /*
+    * Sub-communicator setup: even and odd ranks each form a ring
+    */
+
+   int icomm = 0, l7_comm_id = 0, comm_size, comm_rank, comm_needed, comm_sum;
+   double rcomm[11];
+   MPI_Comm half_comm;
+
+   MPI_Comm_split(MPI_COMM_WORLD, penum % 2, penum, &half_comm);
+   MPI_Comm_size(half_comm, &comm_size);
+   MPI_Comm_rank(half_comm, &comm_rank);
+
+   for (i=0; i<10; i++){
+      rcomm[i] = (double)(comm_rank*10+i);
+   }
+   rcomm[10] = -1.0;
+   comm_needed = ((comm_rank+1)%comm_size)*10;
+
+   L7_Setup_Comm(0, comm_rank*10, 10, &comm_needed, (comm_size > 1) ? 1 : 0,
+       half_comm, &l7_comm_id);
+   L7_Update(rcomm, L7_DOUBLE, l7_comm_id);
+   if (comm_size > 1 && rcomm[10] != (double)comm_needed) icomm = 1;
+   L7_Free(&l7_comm_id);
+
+   L7_Sum_Comm(&comm_rank, 1, L7_INT, &comm_sum, half_comm);
+   if (comm_sum != comm_size*(comm_size-1)/2) icomm = 1;
+
+   MPI_Comm_free(&half_comm);
+
+   L7_Any(&icomm, 1, L7_INT, &icomm);
+
+   /*
+    * Concurrent updates of two databases from two threads, when MPI
+    * provides MPI_THREAD_MULTIPLE (environment L7_THREAD_MULTIPLE=1)
+    */
+
+   int ithread = 0, t;
+   struct thread_update_args thread_args[2];
+   pthread_t threads[2];
+
+   if (L7_Get_Thread_Level() == MPI_THREAD_MULTIPLE){
+      for (t=0; t<2; t++){
+         thread_args[t].l7_id = 0;
+         thread_args[t].data = (double *)malloc((num_indices_owned+num_indices_offpe+1)*sizeof(double));
+         for (i=0; i<num_indices_owned; i++){
+            thread_args[t].data[i] = (double)(my_start_index+i+t);
+         }
+         L7_Setup(0, my_start_index, num_indices_owned, needed_indices,
+             num_indices_offpe, &thread_args[t].l7_id);
+      }
+      for (t=0; t<2; t++){
+         pthread_create(&threads[t], NULL, thread_update, &thread_args[t]);
+      }
+      for (t=0; t<2; t++){
+         pthread_join(threads[t], NULL);
+         if (thread_args[t].ierr) ithread = 1;
+         for (j=0; j<num_indices_offpe; j++){
+            if (thread_args[t].data[num_indices_owned+j] != (double)(needed_indices[j]+t)) ithread = 1;
+         }
+         L7_Free(&thread_args[t].l7_id);
+         free(thread_args[t].data);
+      }
+   }
+
+   L7_Any(&ithread, 1, L7_INT, &ithread);
+
+   /*
+    * Host allocations under every memory policy are zeroed and aligned
+    */
+
+   int imem = 0, policy, saved_policy = L7_Mem_Get_Policy();
+   char *block;
+
+   for (policy = L7_MEM_DEFAULT; policy <= L7_MEM_POLICY_MAX; policy++){
+      L7_Mem_Set_Policy(policy);
+      block = (char *)L7_Mem_Alloc(3*4096+5);
+      if (block == NULL || ((size_t)block % 64) != 0){
+         imem = 1;
+         continue;
+      }
+      for (i=0; i<3*4096+5; i++){
+         if (block[i] != 0) imem = 1;
+      }
+      block[3*4096+4] = 1;
+      /* HUGETLB may fall back to THP, nothing else is added */
+      if ((L7_Mem_Get_Policy() & ~(policy | L7_MEM_THP)) != 0) imem = 1;
+      L7_Mem_Release(block);
+   }
+   L7_Mem_Set_Policy(saved_policy);
+
+   L7_Any(&imem, 1, L7_INT, &imem);
+
+   /*
+    * Point-to-point updates in every send order, with and without a cap
+    * on sends in flight, then through the send datatypes after compaction
+    */
+
+   int isched = 0, order, l7_sched_id = 0;
+   double *rsched;
+   int *isched_data;
+
+   rsched = (double *)malloc((num_indices_owned+num_indices_offpe+1)*sizeof(double));
+   isched_data = (int *)malloc((num_indices_owned+num_indices_offpe+1)*sizeof(int));
+
+   /* A private database on pe 0 only, so handles differ across pes. */
+   int l7_self_id = 0;
+   if (penum == 0)
+      L7_Setup_Comm(0, 0, 1, NULL, 0, MPI_COMM_SELF, &l7_self_id);
+
+   L7_Setup(0, my_start_index, num_indices_owned, needed_indices,
+       num_indices_offpe, &l7_sched_id);
+
+   for (order = L7_SEND_ORDER_MIN; order <= L7_SEND_ORDER_MAX + 1; order++){
+      if (order <= L7_SEND_ORDER_MAX){
+         L7_Set_Update_Schedule(l7_sched_id, L7_UPDATE_P2P, order, order % 2);
+      }
+      else {
+         L7_Compact(l7_sched_id, L7_COMPACT_ALL);
+      }
+      for (i=0; i<num_indices_owned; i++){
+         rsched[i] = (double)(my_start_index+i+order);
+         isched_data[i] = my_start_index+i-order;
+      }
+      for (j=0; j<num_indices_offpe; j++){
+         rsched[num_indices_owned+j] = -1.0;
+         isched_data[num_indices_owned+j] = -1;
+      }
+      L7_Update(rsched, L7_DOUBLE, l7_sched_id);
+      L7_Update(isched_data, L7_INT, l7_sched_id);
+      for (j=0; j<num_indices_offpe; j++){
+         if (rsched[num_indices_owned+j] != (double)(needed_indices[j]+order)) isched = 1;
+         if (isched_data[num_indices_owned+j] != needed_indices[j]-order) isched = 1;
+      }
+   }
+   L7_Free(&l7_sched_id);
+   if (l7_self_id > 0)
+      L7_Free(&l7_self_id);
+
+   free(rsched);
+   free(isched_data);
+
+   L7_Any(&isched, 1, L7_INT, &isched);
+
+   /*
+    * Batched update of two databases with overlapping neighbors: all
+    * needed indices as doubles, every other one as ints. The second
+    * round re-sets up the second database, rebuilding the cached graph,
+    * and freeing the databases drops it.
+    */
+
+   int ibatch = 0, round, num_half = (num_indices_offpe+1)/2, batch_ids[2] = {0, 0};
+   int *half_needed, *ibatch_data;
+   double *rbatch;
+   void *batch_bufs[2];
+   enum L7_Datatype batch_types[2] = {L7_DOUBLE, L7_INT};
+
+   half_needed = (int *)malloc((num_half+1)*sizeof(int));
+   rbatch = (double *)malloc((num_indices_owned+num_indices_offpe+1)*sizeof(double));
+   ibatch_data = (int *)malloc((num_indices_owned+num_half+1)*sizeof(int));
+   for (j=0; j<num_half; j++){
+      half_needed[j] = needed_indices[2*j];
+   }
+
+   L7_Setup(0, my_start_index, num_indices_owned, needed_indices,
+       num_indices_offpe, &batch_ids[0]);
+   for (round=0; round<2; round++){
+      L7_Setup(0, my_start_index, num_indices_owned, half_needed,
+          num_half, &batch_ids[1]);
+      for (i=0; i<num_indices_owned; i++){
+         rbatch[i] = (double)(my_start_index+i+round);
+         ibatch_data[i] = -(my_start_index+i+round);
+      }
+      batch_bufs[0] = rbatch;
+      batch_bufs[1] = ibatch_data;
+      if (L7_Update_Batch(2, batch_bufs, batch_types, batch_ids) != L7_OK) ibatch = 1;
+      for (j=0; j<num_indices_offpe; j++){
+         if (rbatch[num_indices_owned+j] != (double)(needed_indices[j]+round)) ibatch = 1;
+      }
+      for (j=0; j<num_half; j++){
+         if (ibatch_data[num_indices_owned+j] != -(half_needed[j]+round)) ibatch = 1;
+      }
+   }
+   L7_Free(&batch_ids[0]);
+   L7_Free(&batch_ids[1]);
+   if (l7.first_batch != NULL) ibatch = 1;
+
+   free(half_needed);
+   free(rbatch);
+   free(ibatch_data);
+
+   L7_Any(&ibatch, 1, L7_INT, &ibatch);
+
+   /*
+    * Nonblocking updates: one completed by polling with L7_Progress and
+    * L7_Test, the other by L7_Wait
+    */
+
+   int iasync = 0, flag = 0, async_requests[2], l7_async_id = 0;
+   double *rasync;
+   int *iasync_data;
+
+   rasync = (double *)malloc((num_indices_owned+num_indices_offpe+1)*sizeof(double));
+   iasync_data = (int *)malloc((num_indices_owned+num_indices_offpe+1)*sizeof(int));
+   for (i=0; i<num_indices_owned; i++){
+      rasync[i] = (double)(my_start_index+i)+0.5;
+      iasync_data[i] = 2*(my_start_index+i);
+   }
+
+   L7_Setup(0, my_start_index, num_indices_owned, needed_indices,
+       num_indices_offpe, &l7_async_id);
+   L7_Iupdate(rasync, L7_DOUBLE, l7_async_id, &async_requests[0]);
+   L7_Iupdate(iasync_data, L7_INT, l7_async_id, &async_requests[1]);
+   while (! flag){
+      L7_Progress();
+      L7_Test(&async_requests[0], &flag);
+   }
+   L7_Wait(&async_requests[1]);
+   if (async_requests[0] != L7_REQUEST_NULL || async_requests[1] != L7_REQUEST_NULL) iasync = 1;
+   if (L7_Wait(&async_requests[1]) != L7_OK) iasync = 1;
+   for (j=0; j<num_indices_offpe; j++){
+      if (rasync[num_indices_owned+j] != (double)needed_indices[j]+0.5) iasync = 1;
+      if (iasync_data[num_indices_owned+j] != 2*needed_indices[j]) iasync = 1;
+   }
+   L7_Free(&l7_async_id);
+
+   free(rasync);
+   free(iasync_data);
+
+   L7_Any(&iasync, 1, L7_INT, &iasync);
+
+   /*
+    * Known lists: a periodic 1-D stencil two cells deep, first with
+    * L7_Setup_Symmetric, then reset with L7_Setup_Known listing the
+    * neighbors the other way round
+    */
+
+   int iknown = 0, l7_known_id = 0, num_known = 0, known_nbrs[2], known_counts[2],
+       known_send[8], known_expect[8], k, n_known_send = 0;
+   double rknown[18];
+
+   if (numpes > 1){
+      int left = (penum+numpes-1)%numpes, right = (penum+1)%numpes;
+      int left_start = left*num_indices_owned, right_start = right*num_indices_owned;
+      if (left == right){
+         known_nbrs[0] = left;
+         known_counts[0] = 4;
+         num_known = 1;
+         known_send[0] = 0; known_send[1] = 1;
+         known_send[2] = num_indices_owned-2; known_send[3] = num_indices_owned-1;
+         known_expect[0] = left_start; known_expect[1] = left_start+1;
+         known_expect[2] = left_start+num_indices_owned-2; known_expect[3] = left_start+num_indices_owned-1;
+      }
+      else {
+         known_nbrs[0] = left; known_nbrs[1] = right;
+         known_counts[0] = known_counts[1] = 2;
+         num_known = 2;
+         known_send[0] = 0; known_send[1] = 1;
+         known_send[2] = num_indices_owned-2; known_send[3] = num_indices_owned-1;
+         known_expect[0] = left_start+num_indices_owned-2; known_expect[1] = left_start+num_indices_owned-1;
+         known_expect[2] = right_start; known_expect[3] = right_start+1;
+      }
+      n_known_send = 4;
+   }
+
+   for (round=0; round<2; round++){
+      if (round == 0){
+         L7_Setup_Symmetric(0, my_start_index, num_indices_owned, num_known,
+             known_nbrs, known_counts, known_send, MPI_COMM_WORLD, &l7_known_id);
+      }
+      else {
+         /* Same pattern, 1-based send indices and neighbors swapped. */
+         if (num_known == 2){
+            int tmp;
+            tmp = known_nbrs[0]; known_nbrs[0] = known_nbrs[1]; known_nbrs[1] = tmp;
+            for (k=0; k<2; k++){
+               tmp = known_send[k]; known_send[k] = known_send[k+2]; known_send[k+2] = tmp;
+               tmp = known_expect[k]; known_expect[k] = known_expect[k+2]; known_expect[k+2] = tmp;
+            }
+         }
+         for (k=0; k<n_known_send; k++) known_send[k]++;
+         L7_Setup_Known(1, my_start_index, num_indices_owned, num_known, known_nbrs,
+             known_counts, num_known, known_nbrs, known_counts, known_send,
+             MPI_COMM_WORLD, &l7_known_id);
+      }
+      for (i=0; i<num_indices_owned; i++){
+         rknown[i] = (double)(my_start_index+i);
+      }
+      L7_Update(rknown, L7_DOUBLE, l7_known_id);
+      for (k=0; k<n_known_send; k++){
+         if (rknown[num_indices_owned+k] != (double)known_expect[k]) iknown = 1;
+      }
+   }
+   L7_Free(&l7_known_id);
+
+   L7_Any(&iknown, 1, L7_INT, &iknown);
+
+   /*
+    * Needed indices in reverse order, each listed three times; every
+    * ghost slot must get its own index, by L7_Update and L7_Iupdate
+    */
+
+   int iunsorted = 0, l7_unsorted_id = 0, num_unsorted = 3*num_indices_offpe, unsorted_request;
+   int *unsorted_needed;
+   double *runsorted;
+
+   unsorted_needed = (int *)malloc((num_unsorted+1)*sizeof(int));
+   runsorted = (double *)malloc((num_indices_owned+num_unsorted+1)*sizeof(double));
+   for (j=0; j<num_indices_offpe; j++){
+      unsorted_needed[j] = needed_indices[num_indices_offpe-1-j];
+      unsorted_needed[num_indices_offpe+j] = needed_indices[(j*7)%num_indices_offpe];
+      unsorted_needed[2*num_indices_offpe+j] = needed_indices[j];
+   }
+
+   L7_Setup(0, my_start_index, num_indices_owned, unsorted_needed,
+       num_unsorted, &l7_unsorted_id);
+   for (round=0; round<2; round++){
+      for (i=0; i<num_indices_owned; i++){
+         runsorted[i] = (double)(my_start_index+i+round);
+      }
+      for (j=0; j<num_unsorted; j++){
+         runsorted[num_indices_owned+j] = -1.0;
+      }
+      if (round == 0){
+         L7_Update(runsorted, L7_DOUBLE, l7_unsorted_id);
+      }
+      else {
+         L7_Iupdate(runsorted, L7_DOUBLE, l7_unsorted_id, &unsorted_request);
+         L7_Wait(&unsorted_request);
+      }
+      for (j=0; j<num_unsorted; j++){
+         if (runsorted[num_indices_owned+j] != (double)(unsorted_needed[j]+round)) iunsorted = 1;
+      }
+   }
+   if (L7_Update_Check(runsorted, L7_DOUBLE, l7_unsorted_id) != L7_OK) iunsorted = 1;
+
+   /*
+    * Global id map of the same database: owned ids to their offset,
+    * needed ids to the first slot holding them, others to -1
+    */
+
+   int igidmap = 0, slot, first;
+   int *gid_list, *gid_local;
+
+   gid_list = (int *)malloc((num_indices_owned+num_unsorted+2)*sizeof(int));
+   gid_local = (int *)malloc((num_indices_owned+num_unsorted+2)*sizeof(int));
+   for (i=0; i<num_indices_owned; i++){
+      gid_list[i] = my_start_index+i;
+      if (L7_Gid_To_Local(l7_unsorted_id, gid_list[i]) != i) igidmap = 1;
+   }
+   for (j=0; j<num_unsorted; j++){
+      gid_list[num_indices_owned+j] = unsorted_needed[j];
+      slot = L7_Gid_To_Local(l7_unsorted_id, unsorted_needed[j]);
+      for (first=0; unsorted_needed[first] != unsorted_needed[j]; first++);
+      if (slot != num_indices_owned+first) igidmap = 1;
+   }
+   gid_list[num_indices_owned+num_unsorted] = -5;
+   gid_list[num_indices_owned+num_unsorted+1] = 1000000000;
+   L7_Gid_To_Local_Batch(l7_unsorted_id, num_indices_owned+num_unsorted+2, gid_list, gid_local);
+   for (i=0; i<num_indices_owned+num_unsorted+2; i++){
+      if (gid_local[i] != L7_Gid_To_Local(l7_unsorted_id, gid_list[i])) igidmap = 1;
+   }
+   if (gid_local[num_indices_owned+num_unsorted] != -1 ||
+       gid_local[num_indices_owned+num_unsorted+1] != -1) igidmap = 1;
+
+   free(gid_list);
+   free(gid_local);
+   L7_Any(&igidmap, 1, L7_INT, &igidmap);
+
+   L7_Free(&l7_unsorted_id);
+
+   free(unsorted_needed);
+   free(runsorted);
+
+   L7_Any(&iunsorted, 1, L7_INT, &iunsorted);
+
+   /*
+    * Pluggable allocator: a database set up twice and freed must take
+    * its arrays from it, reset it on the second setup and return
+    * every block
+    */
+
+   int iallocator = 0, l7_alloc_id = 0;
+   struct count_allocator counts = {0, 0, 0, 0};
+   L7_Allocator count_ops = {count_create, count_alloc, count_release,
+                             count_reset, count_destroy, &counts};
+   double *ralloc;
+
+   ralloc = (double *)malloc((num_indices_owned+num_indices_offpe+1)*sizeof(double));
+   L7_Set_Allocator(&count_ops);
+   for (round=0; round<2; round++){
+      L7_Setup(0, my_start_index, num_indices_owned, needed_indices,
+          num_indices_offpe, &l7_alloc_id);
+   }
+   L7_Set_Allocator(NULL);
+   for (i=0; i<num_indices_owned; i++){
+      ralloc[i] = (double)(my_start_index+i);
+   }
+   L7_Update(ralloc, L7_DOUBLE, l7_alloc_id);
+   for (j=0; j<num_indices_offpe; j++){
+      if (ralloc[num_indices_owned+j] != (double)needed_indices[j]) iallocator = 1;
+   }
+   L7_Free(&l7_alloc_id);
+   if ((numpes > 1 && counts.allocs == 0) || counts.live != 0 || counts.resets < 1 || counts.destroys != 1)
+      iallocator = 1;
+   free(ralloc);
+
+   L7_Any(&iallocator, 1, L7_INT, &iallocator);
+
+   /*
+    * Arrays written with L7_File_Write and L7_File_Write_Id must read
+    * back the same, through pe 0 and through MPI-IO; a database on a
+    * private communicator must give the same layout as the world one
+    */
+
+   int ifile = 0, ifid, ifile_hdr, ifile_pattern[2] = {L7_BUFFERED_ONE_PROC, L7_ALL_PROCS};
+   int *ifile_data;
+   double *rfile_data;
+   long long file_loc;
+   char file_path[64];
+
+   int l7_file_comm_id = 0, file_comm_rank;
+   MPI_Comm file_comm;
+   MPI_Comm_split(MPI_COMM_WORLD, penum / 2, penum, &file_comm);
+   MPI_Comm_rank(file_comm, &file_comm_rank);
+   L7_Setup_Comm(0, file_comm_rank*num_indices_owned, num_indices_owned, NULL, 0,
+       file_comm, &l7_file_comm_id);
+
+   sprintf(file_path, "l7test_file_%d", numpes);
+   ifile_data = (int *)malloc((num_indices_owned+1)*sizeof(int));
+   rfile_data = (double *)malloc((num_indices_owned+1)*sizeof(double));
+   for (j=0; j<2; j++){
+      ifid = L7_File_Open(file_path, "w", ifile_pattern[j]);
+      if (ifid <= 0) ifile = 1;
+      file_loc = 0;
+      L7_File_Write(ifid, &file_loc, &numpes, 1, L7_INT, L7_REPLICATED);
+      L7_File_Write_Id(ifid, &file_loc, rdata, L7_DOUBLE, j ? l7_file_comm_id : l7_id);
+      L7_File_Write(ifid, &file_loc, idata, num_indices_owned, L7_INT, L7_DISTRIBUTED);
+      L7_File_Close(ifid);
+      if (file_loc != 4 + 12LL*num_indices_owned*numpes) ifile = 1;
+      if (L7_File_Size(file_path, ifile_pattern[j]) != file_loc) ifile = 1;
+
+      ifid = L7_File_Open(file_path, "r", ifile_pattern[j]);
+      file_loc = 0;
+      L7_File_Read(ifid, &file_loc, &ifile_hdr, 1, L7_INT, L7_REPLICATED);
+      L7_File_Read_Id(ifid, &file_loc, rfile_data, L7_DOUBLE, j ? l7_id : l7_file_comm_id);
+      L7_File_Read(ifid, &file_loc, ifile_data, num_indices_owned, L7_INT, L7_DISTRIBUTED);
+      L7_File_Close(ifid);
+      if (ifile_hdr != numpes) ifile = 1;
+      for (i=0; i<num_indices_owned; i++){
+         if (rfile_data[i] != rdata[i] || ifile_data[i] != idata[i]) ifile = 1;
+      }
+      L7_File_Unlink(file_path, ifile_pattern[j]);
+   }
+   if (L7_File_Inquire(file_path, L7_ONE_PROC) != 0) ifile = 1;
+   L7_Free(&l7_file_comm_id);
+   MPI_Comm_free(&file_comm);
+   free(ifile_data);
+   free(rfile_data);
+   L7_Any(&ifile, 1, L7_INT, &ifile);
+
    L7_Free(&l7_id);
 
    /*
@@ -295,6 +970,109 @@ void update_test()
        else{
          printf("  PASSED L7_Update with int and double arrays\n");
        }
+       if (icheck > 0){
+         printf("  Error with L7_Update_Check\n");
+       }
+       else{
+         printf("  PASSED L7_Update_Check\n");
+       }
+       if (istats > 0){
+         printf("  Error with L7_Get_Stats\n");
+       }
+       else{
+         printf("  PASSED L7_Get_Stats\n");
+       }
+       if (icompact > 0){
+         printf("  Error with L7_Compact\n");
+       }
+       else{
+         printf("  PASSED L7_Compact\n");
+       }
+       if (ireorder > 0){
+         printf("  Error with L7_Reorder\n");
+       }
+       else{
+         printf("  PASSED L7_Reorder\n");
+       }
+       if (iplaced > 0){
+         printf("  Error with L7_Setup_Placed\n");
+       }
+       else{
+         printf("  PASSED L7_Setup_Placed\n");
+       }
+       if (icomm > 0){
+         printf("  Error with L7_Setup_Comm\n");
+       }
+       else{
+         printf("  PASSED L7_Setup_Comm\n");
+       }
+       if (ithread > 0){
+         printf("  Error with concurrent L7_Update from threads\n");
+       }
+       else if (L7_Get_Thread_Level() == MPI_THREAD_MULTIPLE){
+         printf("  PASSED concurrent L7_Update from threads\n");
+       }
+       if (imem > 0){
+         printf("  Error with L7_Mem_Alloc\n");
+       }
+       else{
+         printf("  PASSED L7_Mem_Alloc\n");
+       }
+       if (isched > 0){
+         printf("  Error with L7_Set_Update_Schedule\n");
+       }
+       else{
+         printf("  PASSED L7_Set_Update_Schedule\n");
+       }
+       if (ibatch > 0){
+         printf("  Error with L7_Update_Batch\n");
+       }
+       else{
+         printf("  PASSED L7_Update_Batch\n");
+       }
+       if (iasync > 0){
+         printf("  Error with L7_Iupdate/L7_Wait/L7_Test\n");
+       }
+       else{
+         printf("  PASSED L7_Iupdate/L7_Wait/L7_Test%s\n",
+             L7_Get_Progress_Thread() ? " with progress thread" : "");
+       }
+       if (iknown > 0){
+         printf("  Error with L7_Setup_Symmetric/L7_Setup_Known\n");
+       }
+       else{
+         printf("  PASSED L7_Setup_Symmetric/L7_Setup_Known\n");
+       }
+       if (iunsorted > 0){
+         printf("  Error with L7_Setup of unsorted, repeated indices\n");
+       }
+       else{
+         printf("  PASSED L7_Setup of unsorted, repeated indices\n");
+       }
+       if (iallocator > 0){
+         printf("  Error with L7_Set_Allocator\n");
+       }
+       else{
+         printf("  PASSED L7_Set_Allocator\n");
+       }
+       if (ifile > 0){
+         printf("  Error with L7_File_Write/L7_File_Read\n");
+       }
+       else{
+         printf("  PASSED L7_File_Write/L7_File_Read\n");
+       }
+       if (igidmap > 0){
+         printf("  Error with L7_Gid_To_Local/L7_Gid_To_Local_Batch\n");
+       }
+       else{
+         printf("  PASSED L7_Gid_To_Local/L7_Gid_To_Local_Batch\n");
+       }
+       if (iplan > 0){
+         printf("  Error with L7_Plan_Save/L7_Plan_Load\n");
+       }
+       else{
+         printf("  PASSED L7_Plan_Save/L7_Plan_Load\n");
+       }
    }
 
    free(time_total_pe);